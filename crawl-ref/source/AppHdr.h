@@ -87,6 +87,11 @@ static inline double pow(int x, double y) { return std::pow((double)x, y); }
 //
 // #define DEBUG_GLOBALS
 
+// Uncomment to cast the LOS rays at startup as well, and check them against
+// the tables compiled in from losray-data.h.
+//
+// #define DEBUG_LOS_RAYCAST
+
 //
 // Define 'UNIX' if the target OS is UNIX-like.
 // Unknown OSes are assumed to be here.
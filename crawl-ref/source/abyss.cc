@@ -61,7 +61,18 @@ abyss_state abyssal_state;
 
 static ProceduralLayout *abyssLayout = nullptr, *levelLayout = nullptr;
 
-typedef priority_queue<ProceduralSample, vector<ProceduralSample>, ProceduralSamplePQCompare> sample_queue;
+// A priority queue of samples whose queued samples can be looked at without
+// popping them.
+class sample_queue : public priority_queue<ProceduralSample,
+                                           vector<ProceduralSample>,
+                                           ProceduralSamplePQCompare>
+{
+public:
+    explicit sample_queue(const ProceduralSamplePQCompare &cmp
+                          = ProceduralSamplePQCompare())
+        : priority_queue(cmp) { }
+    const vector<ProceduralSample> &samples() const { return c; }
+};
 
 static sample_queue abyss_sample_queue;
 static vector<dungeon_feature_type> abyssal_features;
@@ -535,8 +546,11 @@ private:
         // env.map_knowledge().known() doesn't work on unmappable levels because
         // mapping flags are not set on such levels.
         for (radius_iterator ri(you.pos(), LOS_DEFAULT); ri; ++ri)
-            if (grd(*ri) == DNGN_EXIT_ABYSS && env.map_knowledge(*ri).seen())
+            if (grd(*ri) == DNGN_EXIT_ABYSS
+                && env.map_knowledge.get(*ri).seen())
+            {
                 return true;
+            }
 
         return false;
     }
@@ -545,7 +559,7 @@ private:
     {
         // See above comment about env.map_knowledge().known().
         for (radius_iterator ri(you.pos(), LOS_DEFAULT); ri; ++ri)
-            if (env.map_knowledge(*ri).seen() && _abyssal_rune_at(*ri))
+            if (env.map_knowledge.get(*ri).seen() && _abyssal_rune_at(*ri))
                 return true;
         return false;
     }
@@ -1055,10 +1069,21 @@ const static RiverLayout rivers(1800, baseLayout);
 // This one is not fixed: [0] is a level pulled from the current game
 static vector<const ProceduralLayout*> complex_vec(2);
 
+// Samples worked out ahead of time by _prefetch_abyss_samples, by map cell.
+static FixedArray<ProceduralSample, GXM, GYM> abyss_prefetched;
+static map_bitmask abyss_prefetched_mask;
+
 static ProceduralSample _abyss_grid(const coord_def &p)
 {
     const coord_def pt = p + abyssal_state.major_coord;
 
+    if (abyss_prefetched_mask(p))
+    {
+        const ProceduralSample sample = abyss_prefetched(p);
+        abyss_sample_queue.push(sample);
+        return sample;
+    }
+
     if (_in_wastes(pt))
     {
         ProceduralSample sample = wastes(pt, abyssal_state.depth);
@@ -1082,6 +1107,67 @@ static ProceduralSample _abyss_grid(const coord_def &p)
     return sample;
 }
 
+/**
+ * Work out the samples _abyss_grid would give for the given map cells as a
+ * batch, so that neighbouring cells share their noise lattice lookups.
+ *
+ * The layouts are pure functions of position and depth, so this changes
+ * nothing but when the work is done; cells needing the main layout are left
+ * alone until _abyss_grid has made it, since making it rolls the dice.
+ */
+static void _prefetch_abyss_samples(const vector<coord_def> &cells)
+{
+    vector<coord_def> waste_pts, abyss_pts;
+    vector<coord_def> waste_cells, abyss_cells;
+    for (const coord_def &p : cells)
+    {
+        if (abyss_prefetched_mask(p))
+            continue;
+        const coord_def pt = p + abyssal_state.major_coord;
+        if (_in_wastes(pt))
+        {
+            waste_pts.push_back(pt);
+            waste_cells.push_back(p);
+        }
+        else if (abyssLayout)
+        {
+            abyss_pts.push_back(pt);
+            abyss_cells.push_back(p);
+        }
+    }
+
+    const vector<ProceduralSample> waste_samples =
+        wastes.sample_points(waste_pts, abyssal_state.depth);
+    for (int i = 0, size = waste_cells.size(); i < size; ++i)
+    {
+        abyss_prefetched(waste_cells[i]) = waste_samples[i];
+        abyss_prefetched_mask.set(waste_cells[i]);
+    }
+
+    if (abyss_pts.empty())
+        return;
+    const vector<ProceduralSample> abyss_samples =
+        abyssLayout->sample_points(abyss_pts, abyssal_state.depth);
+    for (int i = 0, size = abyss_cells.size(); i < size; ++i)
+    {
+        ASSERT(abyss_samples[i].feat() > DNGN_UNSEEN);
+        abyss_prefetched(abyss_cells[i]) = abyss_samples[i];
+        abyss_prefetched_mask.set(abyss_cells[i]);
+    }
+}
+
+// Whether _update_abyss_terrain might sample the cell at abyss coordinate p.
+static bool _abyss_may_sample(const coord_def &p,
+                              const map_bitmask &abyss_genlevel_mask,
+                              bool morph)
+{
+    const coord_def rp = p - abyssal_state.major_coord;
+    return in_bounds(rp)
+           && !map_masked(rp, MMT_VAULT)
+           && abyss_genlevel_mask(rp)
+           && (morph || grd(rp) == DNGN_UNSEEN);
+}
+
 static cloud_type _cloud_from_feat(const dungeon_feature_type &ft)
 {
     switch (ft)
@@ -1235,11 +1321,34 @@ static void _abyss_apply_terrain(const map_bitmask &abyss_genlevel_mask,
     int exits_wanted  = 0;
     int altars_wanted = 0;
     bool use_abyss_exit_map = true;
-    bool used_queue = false;
-    if (morph && !abyss_sample_queue.empty())
+    bool used_queue = morph && !abyss_sample_queue.empty();
+
+    // Sample everything the passes below might look at in one go.
+    vector<coord_def> cells;
+    if (used_queue)
+    {
+        for (const ProceduralSample &sample : abyss_sample_queue.samples())
+            if (sample.changepoint() < abyssal_state.depth
+                && _abyss_may_sample(sample.coord(), abyss_genlevel_mask,
+                                     morph))
+            {
+                cells.push_back(sample.coord() - abyssal_state.major_coord);
+            }
+    }
+    for (rectangle_iterator ri(MAPGEN_BORDER); ri; ++ri)
+    {
+        if ((!used_queue || map_masked(*ri, MMT_TURNED_TO_FLOOR))
+            && _abyss_may_sample(*ri + abyssal_state.major_coord,
+                                 abyss_genlevel_mask, morph))
+        {
+            cells.push_back(*ri);
+        }
+    }
+    _prefetch_abyss_samples(cells);
+
+    if (used_queue)
     {
         int ii = 0;
-        used_queue = true;
         while (!abyss_sample_queue.empty()
             && abyss_sample_queue.top().changepoint() < abyssal_state.depth)
         {
@@ -1295,6 +1404,7 @@ static void _abyss_apply_terrain(const map_bitmask &abyss_genlevel_mask,
     }
     if (ii)
         dprf(DIAG_ABYSS, "Nuked %d features", ii);
+    abyss_prefetched_mask.reset();
     _ensure_player_habitable(false);
     for (rectangle_iterator ri(MAPGEN_BORDER); ri; ++ri)
         ASSERT_RANGE(grd(*ri), DNGN_UNSEEN + 1, NUM_FEATURES);
@@ -5,6 +5,15 @@
 #include "env.h"
 #include "losglobal.h"
 
+// The next monster slot after i that might hold a monster in view of center.
+static int _next_near(int i, const coord_def &center, los_type los)
+{
+    // LOS_NONE sees everything, so there is nothing to narrow down.
+    if (los == LOS_NONE)
+        return env.mon_index.next(i);
+    return env.mon_index.next_near(i, center);
+}
+
 actor_near_iterator::actor_near_iterator(coord_def c, los_type los)
     : center(c), _los(los), viewer(nullptr), i(-1)
 {
@@ -64,25 +73,23 @@ bool actor_near_iterator::valid(const actor* a) const
 void actor_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
-             return;
+        if ((i = _next_near(i, center, _los)) >= MAX_MONSTERS)
+            return;
     while (!valid(**this));
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 monster_near_iterator::monster_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(0)
+    : center(c), _los(los), viewer(nullptr), i(-1)
 {
-    if (!valid(&menv[0]))
-        advance();
+    advance();
 }
 
 monster_near_iterator::monster_near_iterator(const actor *a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(0)
+    : center(a->pos()), _los(los), viewer(a), i(-1)
 {
-    if (!valid(&menv[0]))
-        advance();
+    advance();
 }
 
 monster_near_iterator::operator bool() const
@@ -128,18 +135,17 @@ bool monster_near_iterator::valid(const monster* a) const
 void monster_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
-             return;
+        if ((i = _next_near(i, center, _los)) >= MAX_MONSTERS)
+            return;
     while (!valid(**this));
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 monster_iterator::monster_iterator()
-    : i(0)
+    : i(-1)
 {
-    while (i < MAX_MONSTERS && !menv[i].alive())
-        i++;
+    advance();
 }
 
 monster_iterator::operator bool() const
@@ -162,9 +168,7 @@ monster* monster_iterator::operator->() const
 
 monster_iterator& monster_iterator::operator++()
 {
-    while (++i < MAX_MONSTERS)
-        if (menv[i].alive())
-            break;
+    advance();
     return *this;
 }
 
@@ -178,7 +182,7 @@ monster_iterator monster_iterator::operator++(int)
 void monster_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
-             return;
+        if ((i = env.mon_index.next(i)) >= MAX_MONSTERS)
+            return;
     while (!(*this)->alive());
 }
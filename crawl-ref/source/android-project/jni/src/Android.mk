@@ -11,6 +11,7 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/$(SDL_PATH)/include \
                     $(LOCAL_PATH)/../sqlite \
                     $(LOCAL_PATH)/../lua/src \
                     $(LOCAL_PATH)/../freetype/include \
+                    $(LOCAL_PATH)/../lz4 \
                     $(LOCAL_PATH)/$(CRAWL_PATH) \
                     $(LOCAL_PATH)/$(CRAWL_PATH)/rltiles
 
@@ -39,6 +40,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/chardump.cc \
     $(CRAWL_PATH)/cio.cc \
     $(CRAWL_PATH)/cloud.cc \
+    $(CRAWL_PATH)/cloud-grid.cc \
     $(CRAWL_PATH)/clua.cc \
     $(CRAWL_PATH)/cluautil.cc \
     $(CRAWL_PATH)/colour.cc \
@@ -69,7 +71,9 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/dgn-overview.cc \
     $(CRAWL_PATH)/dgn-proclayouts.cc \
     $(CRAWL_PATH)/dgn-shoals.cc \
+    $(CRAWL_PATH)/dgn-speculate.cc \
     $(CRAWL_PATH)/dgn-swamp.cc \
+    $(CRAWL_PATH)/dgn-zones.cc \
     $(CRAWL_PATH)/dgnevent.cc \
     $(CRAWL_PATH)/directn.cc \
     $(CRAWL_PATH)/dlua.cc \
@@ -147,6 +151,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/los_def.cc \
     $(CRAWL_PATH)/losglobal.cc \
     $(CRAWL_PATH)/losparam.cc \
+    $(CRAWL_PATH)/losrays.cc \
     $(CRAWL_PATH)/luaterp.cc \
     $(CRAWL_PATH)/macro.cc \
     $(CRAWL_PATH)/main.cc \
@@ -169,6 +174,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/mon-ench.cc \
     $(CRAWL_PATH)/mon-gear.cc \
     $(CRAWL_PATH)/mon-grow.cc \
+    $(CRAWL_PATH)/mon-index.cc \
     $(CRAWL_PATH)/mon-info.cc \
     $(CRAWL_PATH)/mon-movetarget.cc \
     $(CRAWL_PATH)/mon-pathfind.cc \
@@ -322,7 +328,7 @@ LOCAL_SRC_FILES := $(SDL_PATH)/src/main/android/SDL_android_main.c \
     $(CRAWL_PATH)/rltiles/tiledef-unrand.cc \
     $(CRAWL_PATH)/version.cc
 
-LOCAL_SHARED_LIBRARIES := SDL2 SDL2_image mikmod smpeg2 SDL2_mixer freetype sqlite lua zlib
+LOCAL_SHARED_LIBRARIES := SDL2 SDL2_image mikmod smpeg2 SDL2_mixer freetype sqlite lua zlib lz4
 
 LOCAL_LDLIBS := -ldl -lGLESv1_CM -lGLESv2 -llog -landroid
 
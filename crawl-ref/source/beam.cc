@@ -766,7 +766,8 @@ void bolt::bounce()
     // incorrectly thought were non-bouncy.
     if (is_tracer && agent() == &you)
     {
-        const dungeon_feature_type feat = env.map_knowledge(ray.pos()).feat();
+        const dungeon_feature_type feat =
+            env.map_knowledge.get(ray.pos()).feat();
 
         if (feat == DNGN_UNSEEN || !feat_is_solid(feat) || !is_bouncy(feat))
         {
@@ -1218,21 +1219,48 @@ void bolt::affect_cell()
         affect_ground();
 }
 
-static void _undo_tracer(bolt &orig, bolt &copy)
+// What fire() puts back after a tracer.
+// FIXME: we should have a better idea of what gets changed!
+struct tracer_undo
 {
-    // FIXME: we should have a better idea of what gets changed!
-    orig.target           = copy.target;
-    orig.source           = copy.source;
-    orig.aimed_at_spot    = copy.aimed_at_spot;
-    orig.extra_range_used = copy.extra_range_used;
-    orig.auto_hit         = copy.auto_hit;
-    orig.ray              = copy.ray;
-    orig.colour           = copy.colour;
-    orig.flavour          = copy.flavour;
-    orig.real_flavour     = copy.real_flavour;
-    orig.bounces          = copy.bounces;
-    orig.bounce_pos       = copy.bounce_pos;
-}
+    coord_def target;
+    coord_def source;
+    bool aimed_at_spot;
+    int extra_range_used;
+    bool auto_hit;
+    ray_def ray;
+    colour_t colour;
+    beam_type flavour;
+    beam_type real_flavour;
+    int bounces;
+    coord_def bounce_pos;
+
+    tracer_undo() = default;
+    tracer_undo(const bolt &beam)
+        : target(beam.target), source(beam.source),
+          aimed_at_spot(beam.aimed_at_spot),
+          extra_range_used(beam.extra_range_used), auto_hit(beam.auto_hit),
+          ray(beam.ray), colour(beam.colour), flavour(beam.flavour),
+          real_flavour(beam.real_flavour), bounces(beam.bounces),
+          bounce_pos(beam.bounce_pos)
+    {
+    }
+
+    void restore(bolt &beam) const
+    {
+        beam.target           = target;
+        beam.source           = source;
+        beam.aimed_at_spot    = aimed_at_spot;
+        beam.extra_range_used = extra_range_used;
+        beam.auto_hit         = auto_hit;
+        beam.ray              = ray;
+        beam.colour           = colour;
+        beam.flavour          = flavour;
+        beam.real_flavour     = real_flavour;
+        beam.bounces          = bounces;
+        beam.bounce_pos       = bounce_pos;
+    }
+};
 
 // This saves some important things before calling fire().
 void bolt::fire()
@@ -1244,19 +1272,18 @@ void bolt::fire()
 
     if (is_tracer)
     {
-        bolt boltcopy = *this;
+        // Only what tracer_undo puts back needs saving, so neither the bolt
+        // nor its explosion is copied.
+        const tracer_undo saved(*this);
+        tracer_undo saved_explosion;
         if (special_explosion != nullptr)
-            boltcopy.special_explosion = new bolt(*special_explosion);
+            saved_explosion = tracer_undo(*special_explosion);
 
         do_fire();
 
         if (special_explosion != nullptr)
-        {
-            _undo_tracer(*special_explosion, *boltcopy.special_explosion);
-            delete boltcopy.special_explosion;
-        }
-
-        _undo_tracer(*this, boltcopy);
+            saved_explosion.restore(*special_explosion);
+        saved.restore(*this);
     }
     else
         do_fire();
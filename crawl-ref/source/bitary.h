@@ -40,6 +40,27 @@ protected:
 #define ULONG_MAX ((unsigned long)(-1))
 #endif
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero word.
+static inline int lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long idx;
+    _BitScanForward64(&idx, word);
+    return idx;
+#else
+    int idx = 0;
+    while (!(word & 1))
+        word >>= 1, idx++;
+    return idx;
+#endif
+}
+
 template <unsigned int SIZE> class FixedBitVector
 {
 protected:
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief The clouds of a level: a packed array, and a grid indexing it.
+**/
+
+#include "AppHdr.h"
+
+#include "cloud-grid.h"
+
+#include <algorithm>
+
+#include "coord.h"
+
+COMPILE_CHECK(GXM * GYM <= UINT16_MAX);
+
+cloud_grid::cloud_grid()
+{
+    slot.init(0);
+}
+
+cloud_struct *cloud_grid::find(const coord_def &p)
+{
+    if (!map_bounds(p) || !slot(p))
+        return nullptr;
+    return &clouds[slot(p) - 1];
+}
+
+const cloud_struct *cloud_grid::find(const coord_def &p) const
+{
+    if (!map_bounds(p) || !slot(p))
+        return nullptr;
+    return &clouds[slot(p) - 1];
+}
+
+cloud_struct &cloud_grid::operator[](const coord_def &p)
+{
+    ASSERT_IN_BOUNDS(p);
+    if (!slot(p))
+    {
+        clouds.emplace_back();
+        clouds.back().pos = p;
+        slot(p) = clouds.size();
+        index(p);
+    }
+    return clouds[slot(p) - 1];
+}
+
+void cloud_grid::erase(const coord_def &p)
+{
+    if (!map_bounds(p) || !slot(p))
+        return;
+
+    const int i = slot(p) - 1;
+    slot(p) = 0;
+    unindex(p);
+    if (i + 1 < (int)clouds.size())
+    {
+        clouds[i] = std::move(clouds.back());
+        slot(clouds[i].pos) = i + 1;
+    }
+    clouds.pop_back();
+}
+
+// Move the cloud at src to dst, replacing whatever was there.
+void cloud_grid::move(const coord_def &src, const coord_def &dst)
+{
+    ASSERT_IN_BOUNDS(dst);
+    if (!map_bounds(src) || !slot(src) || src == dst)
+        return;
+
+    erase(dst);
+    const int s = slot(src);
+    slot(src) = 0;
+    slot(dst) = s;
+    clouds[s - 1].pos = dst;
+    unindex(src);
+    index(dst);
+}
+
+void cloud_grid::clear()
+{
+    clouds.clear();
+    slot.init(0);
+    sorted.clear();
+}
+
+void cloud_grid::index(const coord_def &p)
+{
+    sorted.insert(lower_bound(sorted.begin(), sorted.end(), p), p);
+}
+
+void cloud_grid::unindex(const coord_def &p)
+{
+    auto it = lower_bound(sorted.begin(), sorted.end(), p);
+    ASSERT(it != sorted.end() && *it == p);
+    sorted.erase(it);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @brief The clouds of a level: a packed array, and a grid indexing it.
+**/
+
+#ifndef CLOUD_GRID_H
+#define CLOUD_GRID_H
+
+/**
+ * The clouds of the level, packed together in no particular order, with the
+ * slot of the cloud at each cell (if any) in a grid covering the map.
+ *
+ * Removing a cloud moves the last one into its slot, and adding one may move
+ * them all, so pointers to clouds stay good only until the next cloud comes
+ * or goes.
+ */
+class cloud_grid
+{
+public:
+    typedef vector<cloud_struct>::iterator iterator;
+    typedef vector<cloud_struct>::const_iterator const_iterator;
+
+    cloud_grid();
+
+    cloud_struct *find(const coord_def &p);
+    const cloud_struct *find(const coord_def &p) const;
+
+    // The cloud at p, made (empty) if there wasn't one.
+    cloud_struct &operator[](const coord_def &p);
+
+    void erase(const coord_def &p);
+    void move(const coord_def &src, const coord_def &dst);
+    void clear();
+
+    int size() const { return clouds.size(); }
+    bool empty() const { return clouds.empty(); }
+
+    iterator begin() { return clouds.begin(); }
+    iterator end() { return clouds.end(); }
+    const_iterator begin() const { return clouds.begin(); }
+    const_iterator end() const { return clouds.end(); }
+
+    // Where the clouds are, in coord_def order: the order clouds have always
+    // been visited in, which seeded games and save files depend on. Kept as
+    // clouds come and go, so copy it before adding or removing any.
+    const vector<coord_def> &positions() const { return sorted; }
+
+private:
+    vector<cloud_struct> clouds;
+    // The slot of the cloud at each cell, plus one; zero if there's none.
+    FixedArray<uint16_t, GXM, GYM> slot;
+    // Every cloud's position, sorted.
+    vector<coord_def> sorted;
+
+    void index(const coord_def &p);
+    void unindex(const coord_def &p);
+};
+
+#endif
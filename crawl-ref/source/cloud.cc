@@ -35,7 +35,7 @@
 
 cloud_struct* cloud_at(coord_def pos)
 {
-    return map_find(env.cloud, pos);
+    return env.cloud.find(pos);
 }
 
 /// A portrait of a cloud_type.
@@ -486,15 +486,19 @@ static void _handle_spectral_cloud(const cloud_struct& cloud)
 
 void manage_clouds()
 {
-    // We can't iterate over env.cloud directly because _dissipate_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<cloud_struct *> cloud_ptrs;
-    for (auto& entry : env.cloud)
-        cloud_ptrs.push_back(&entry.second);
-
-    for (auto ptr : cloud_ptrs)
+    // Only the clouds there at the start get a turn, in coord_def order
+    // so that seeded games replay. Clouds coming and going move the others,
+    // so each is looked up afresh and handled as a copy, which is written
+    // back at the end if it's still there. The copy of the positions reuses
+    // its room from turn to turn.
+    static vector<coord_def> turn;
+    turn = env.cloud.positions();
+    for (const coord_def &pos : turn)
     {
-        cloud_struct& cloud = *ptr;
+        const cloud_struct *ptr = env.cloud.find(pos);
+        if (!ptr)
+            continue;
+        cloud_struct cloud = *ptr;
 
 #ifdef ASSERTS
         if (cell_is_solid(cloud.pos))
@@ -521,6 +525,12 @@ void manage_clouds()
         _cloud_interacts_with_terrain(cloud);
 
         _dissipate_cloud(cloud);
+
+        if (cloud_struct *after = env.cloud.find(pos))
+        {
+            after->decay = cloud.decay;
+            after->spread_rate = cloud.spread_rate;
+        }
     }
 }
 
@@ -572,12 +582,9 @@ void delete_cloud(coord_def p)
 void delete_all_clouds()
 {
     // We can't iterate over env.cloud directly because delete_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<coord_def> cloud_locs;
-    for (auto& entry : env.cloud)
-        cloud_locs.push_back(entry.first);
-
-    for (auto pos : cloud_locs)
+    // moves other clouds around.
+    const vector<coord_def> where = env.cloud.positions();
+    for (const coord_def &pos : where)
         delete_cloud(pos);
 }
 
@@ -589,9 +596,7 @@ void move_cloud(coord_def src, coord_def newpos)
         return;
     ASSERT(!cell_is_solid(newpos));
 
-    env.cloud[newpos] = env.cloud[src];
-    env.cloud.erase(src);
-    env.cloud[newpos].pos = newpos;
+    env.cloud.move(src, newpos);
     _los_cloud_changed(src, env.cloud[newpos].type);
     _los_cloud_changed(newpos, env.cloud[newpos].type);
 }
@@ -1652,9 +1657,13 @@ void remove_tornado_clouds(mid_t whose)
     // example, this approach doesn't work if we ever make Tornado a monster
     // spell (excluding immobile and mindless casters).
 
-    for (auto& entry : env.cloud)
-        if (entry.second.type == CLOUD_TORNADO && entry.second.source == whose)
-            delete_cloud(entry.first);
+    const vector<coord_def> where = env.cloud.positions();
+    for (const coord_def &pos : where)
+    {
+        const cloud_struct *cloud = cloud_at(pos);
+        if (cloud->type == CLOUD_TORNADO && cloud->source == whose)
+            delete_cloud(pos);
+    }
 }
 
 static void _spread_cloud(coord_def pos, cloud_type type, int radius, int pow,
@@ -0,0 +1,218 @@
+/*
+ * LZ4 block compression.
+ *
+ * A block is a series of sequences: a token byte holding the number of
+ * literals in its high nibble and the match length less four in its low
+ * nibble, either extended by further bytes of 255 and a final byte when
+ * they're 15; the literals; then the match, as a two byte little-endian
+ * offset back into the output. The last sequence has literals only, and
+ * the last five bytes of a block are always literals. Matches are found
+ * greedily through a hash table of four byte runs.
+ */
+
+#include "lz4.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MINMATCH 4
+/* The last match must start at least this far from the end of the block... */
+#define MFLIMIT 12
+/* ... and this much of the end is always literals. */
+#define LASTLITERALS 5
+#define HASH_LOG 12
+#define MAX_DISTANCE 65535
+
+int LZ4_versionNumber(void)
+{
+    return LZ4_VERSION_NUMBER;
+}
+
+int LZ4_compressBound(int inputSize)
+{
+    return LZ4_COMPRESSBOUND(inputSize);
+}
+
+static uint32_t LZ4_read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static unsigned LZ4_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+/* A length of 15 or more continues in bytes of 255 and a final byte. */
+static unsigned char* LZ4_putLength(unsigned char* op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+/* The most a sequence can take, so that it can be checked before writing. */
+static size_t LZ4_sequenceBound(size_t literals, size_t matchLength)
+{
+    return 1 + literals + literals / 255 + 1
+           + (matchLength ? 2 + matchLength / 255 + 1 : 0);
+}
+
+static unsigned char* LZ4_putSequence(unsigned char* op,
+                                      const unsigned char* literals,
+                                      size_t nLiterals, size_t offset,
+                                      size_t matchLength)
+{
+    unsigned char* token = op++;
+    *token = (unsigned char)((nLiterals < 15 ? nLiterals : 15) << 4);
+    if (nLiterals >= 15)
+        op = LZ4_putLength(op, nLiterals - 15);
+    if (nLiterals)
+        memcpy(op, literals, nLiterals);
+    op += nLiterals;
+
+    if (!matchLength)
+        return op;
+
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    matchLength -= MINMATCH;
+    *token |= (unsigned char)(matchLength < 15 ? matchLength : 15);
+    if (matchLength >= 15)
+        op = LZ4_putLength(op, matchLength - 15);
+    return op;
+}
+
+int LZ4_compress_default(const char* source, char* dest, int inputSize,
+                         int maxOutputSize)
+{
+    const unsigned char* const src = (const unsigned char*)source;
+    unsigned char* const dst = (unsigned char*)dest;
+    unsigned char* op = dst;
+    const size_t size = (size_t)inputSize;
+    const size_t capacity = maxOutputSize > 0 ? (size_t)maxOutputSize : 0;
+    size_t anchor = 0;
+    size_t ip = 1;
+
+    /* Positions in the block, by the hash of the four bytes there. Stale and
+     * colliding entries are weeded out by comparing the bytes. */
+    uint32_t table[1 << HASH_LOG];
+
+    if (inputSize < 0 || inputSize > LZ4_MAX_INPUT_SIZE)
+        return 0;
+    memset(table, 0, sizeof(table));
+
+    while (size > MFLIMIT && ip < size - MFLIMIT)
+    {
+        const uint32_t sequence = LZ4_read32(src + ip);
+        const unsigned h = LZ4_hash(sequence);
+        const size_t ref = table[h];
+        size_t len = MINMATCH;
+        table[h] = (uint32_t)ip;
+        if (ip - ref > MAX_DISTANCE || LZ4_read32(src + ref) != sequence)
+        {
+            /* Skip ahead faster through data that doesn't compress. */
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        while (ip + len < size - LASTLITERALS && src[ref + len] == src[ip + len])
+            ++len;
+        if (LZ4_sequenceBound(ip - anchor, len) > capacity - (size_t)(op - dst))
+            return 0;
+        op = LZ4_putSequence(op, src + anchor, ip - anchor, ip - ref, len);
+
+        /* Note the run just before the match ends, to find repeats of it. */
+        if (ip + len - 2 < size - MFLIMIT)
+            table[LZ4_hash(LZ4_read32(src + ip + len - 2))] = (uint32_t)(ip + len - 2);
+        ip += len;
+        anchor = ip;
+    }
+
+    if (LZ4_sequenceBound(size - anchor, 0) > capacity - (size_t)(op - dst))
+        return 0;
+    op = LZ4_putSequence(op, src + anchor, size - anchor, 0, 0);
+    return (int)(op - dst);
+}
+
+/* Read an extended length at *ip, adding it to *len; 0 if it runs past the
+ * end. */
+static int LZ4_getLength(const unsigned char* src, size_t size, size_t* ip,
+                         size_t* len)
+{
+    unsigned char b;
+    do
+    {
+        if (*ip >= size)
+            return 0;
+        b = src[(*ip)++];
+        *len += b;
+    }
+    while (b == 255);
+    return 1;
+}
+
+int LZ4_decompress_safe(const char* source, char* dest, int compressedSize,
+                        int maxDecompressedSize)
+{
+    const unsigned char* const src = (const unsigned char*)source;
+    unsigned char* const dst = (unsigned char*)dest;
+    size_t size, capacity;
+    size_t ip = 0, op = 0;
+
+    if (compressedSize <= 0 || maxDecompressedSize < 0)
+        return -1;
+    size = (size_t)compressedSize;
+    capacity = (size_t)maxDecompressedSize;
+
+    for (;;)
+    {
+        unsigned char token;
+        size_t nLiterals, offset, len, i;
+        const unsigned char* from;
+        unsigned char* to;
+
+        if (ip >= size)
+            return -1;
+        token = src[ip++];
+
+        nLiterals = token >> 4;
+        if (nLiterals == 15 && !LZ4_getLength(src, size, &ip, &nLiterals))
+            return -1;
+        if (nLiterals > size - ip || nLiterals > capacity - op)
+            return -1;
+        if (nLiterals)
+            memcpy(dst + op, src + ip, nLiterals);
+        ip += nLiterals;
+        op += nLiterals;
+
+        /* The last sequence has no match. */
+        if (ip == size)
+            return (int)op;
+
+        if (size - ip < 2)
+            return -1;
+        offset = src[ip] | src[ip + 1] << 8;
+        ip += 2;
+        if (!offset || offset > op)
+            return -1;
+
+        len = token & 15;
+        if (len == 15 && !LZ4_getLength(src, size, &ip, &len))
+            return -1;
+        len += MINMATCH;
+        if (len > capacity - op)
+            return -1;
+
+        /* Matches may overlap what they copy, so go a byte at a time. */
+        from = dst + op - offset;
+        to = dst + op;
+        for (i = 0; i < len; ++i)
+            to[i] = from[i];
+        op += len;
+    }
+}
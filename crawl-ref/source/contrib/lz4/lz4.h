@@ -0,0 +1,55 @@
+/*
+ * LZ4 block compression.
+ *
+ * The block functions of the LZ4 library API (lz4.h), with the same names,
+ * signatures and return conventions, so that the upstream lz4.c and lz4.h
+ * can be dropped in over this copy. Streaming, dictionaries, the frame
+ * format and LZ4HC are not provided.
+ *
+ * Blocks are in the standard LZ4 block format: anything written here can
+ * be read by any other LZ4 implementation, and vice versa.
+ */
+
+#ifndef LZ4_H_2983827168210
+#define LZ4_H_2983827168210
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define LZ4_VERSION_MAJOR    1
+#define LZ4_VERSION_MINOR    9
+#define LZ4_VERSION_RELEASE  4
+#define LZ4_VERSION_NUMBER (LZ4_VERSION_MAJOR *100*100 + LZ4_VERSION_MINOR *100 + LZ4_VERSION_RELEASE)
+
+int LZ4_versionNumber(void);
+
+#define LZ4_MAX_INPUT_SIZE        0x7E000000   /* 2 113 929 216 bytes */
+#define LZ4_COMPRESSBOUND(isize)  ((unsigned)(isize) > (unsigned)LZ4_MAX_INPUT_SIZE ? 0 : (isize) + ((isize)/255) + 16)
+
+/*
+ * The most LZ4_compress_default() can write for inputSize bytes of input,
+ * or 0 if inputSize is too large (or negative) to compress.
+ */
+int LZ4_compressBound(int inputSize);
+
+/*
+ * Compress srcSize bytes from src into dst, which has room for dstCapacity
+ * bytes. Returns the number of bytes written, or 0 if the result didn't fit
+ * (which can't happen if dstCapacity >= LZ4_compressBound(srcSize)).
+ */
+int LZ4_compress_default(const char* src, char* dst, int srcSize, int dstCapacity);
+
+/*
+ * Decompress a block of compressedSize bytes from src into dst, which has
+ * room for dstCapacity bytes. Returns the number of bytes decompressed, or
+ * a negative number if the block is malformed or doesn't fit; it never
+ * reads or writes out of bounds.
+ */
+int LZ4_decompress_safe(const char* src, char* dst, int compressedSize, int dstCapacity);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
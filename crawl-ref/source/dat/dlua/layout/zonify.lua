@@ -156,36 +156,29 @@ function zonify.map_map(e)
 
 end
 
-function zonify.map_fill_zones(e, num_to_keep, glyph, min_zone_size)
+-- Fills all the zones of the map's non-wall glyphs except the largest
+-- num_to_keep. dgn.fill_small_zones finds the zones in the same order as
+-- zonify.map, so it keeps the same one of zones the same size, without
+-- walking over the cells in Lua.
+local function map_fill_zones_of(e, wall, num_to_keep, glyph, min_zone_size)
   if num_to_keep == nil then num_to_keep = 1 end
   if glyph == nil then glyph = 'x' end
   if min_zone_size == nil then min_zone_size = 1 end
 
-  local zonemap = zonify.map_map(e)
-  zonify.fill_smallest_zones(zonemap, num_to_keep, "floor",
-                             function(x,y,cell) e.mapgrd[x][y] = glyph end, min_zone_size)
+  local gxm,gym = dgn.max_bounds()
+  e.fill_small_zones { x1 = 1, y1 = 1,
+                       x2 = math.min(gxm - 2, e.width() - 1),
+                       y2 = math.min(gym - 2, e.height() - 1),
+                       wall = wall, keep = num_to_keep, fill = glyph,
+                       min_size = min_zone_size }
 end
 
-function zonify.map_fill_lava_zones(e, num_to_keep, glyph, min_zone_size)
-  if num_to_keep == nil then num_to_keep = 1 end
-  if glyph == nil then glyph = 'x' end
-  if min_zone_size == nil then min_zone_size = 1 end
-
-  local wall = "wxcvbtg"
+function zonify.map_fill_zones(e, num_to_keep, glyph, min_zone_size)
+  map_fill_zones_of(e, "wlxcvbtg", num_to_keep, glyph, min_zone_size)
+end
 
-  -- TODO: Can we check size of current map after extend_map?
-  local gxm,gym = dgn.max_bounds()
-  local zonemap = zonify.map(
-    { x1 = 1, y1 = 1, x2 = gxm-2, y2 = gym-2 },
-    function(x,y)
-      return dgn.in_bounds(x,y) and { glyph = e.mapgrd[x][y] } or nil
-    end,
-    function(val)
-      return string.find(wall,val.glyph,1,true) and "wall" or "floor"
-    end
-  )
-  zonify.fill_smallest_zones(zonemap, num_to_keep, "floor",
-                             function(x,y,cell) e.mapgrd[x][y] = glyph end, min_zone_size)
+function zonify.map_fill_lava_zones(e, num_to_keep, glyph, min_zone_size)
+  map_fill_zones_of(e, "wxcvbtg", num_to_keep, glyph, min_zone_size)
 end
 
 -- Zonifies the current dungeon grid
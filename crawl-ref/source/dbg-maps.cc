@@ -7,21 +7,41 @@
 
 #include "dbg-maps.h"
 
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+#ifndef TARGET_OS_WINDOWS
+# include <sys/resource.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+#include "abyss.h"
+#include "artefact.h"
 #include "branch.h"
 #include "chardump.h"
 #include "crash.h"
 #include "dbg-objstat.h"
+#include "dlua.h"
 #include "dungeon.h"
 #include "env.h"
 #include "initfile.h"
+#include "items.h"
+#include "json.h"
 #include "libutil.h"
 #include "maps.h"
 #include "message.h"
 #include "ng-init.h"
+#include "package.h"
 #include "player.h"
+#include "random.h"
 #include "shopping.h"
 #include "state.h"
 #include "stringutil.h"
+#include "tag-version.h"
+#include "tags.h"
+#include "version.h"
 #include "view.h"
 
 #ifdef DEBUG_STATISTICS
@@ -45,11 +65,102 @@ static int levels_tried = 0, levels_failed = 0;
 static int build_attempts = 0, level_vetoes = 0;
 // Map from message to counts.
 static map<string, int> veto_messages;
+// Peak (items, monsters) slot usage per level.
+static map< level_id, pair<int,int> > slot_high_water;
+// Every iteration's RNG is seeded from this and the iteration's number.
+static uint64_t iteration_seed;
+
+static const char *builder_phase_names[] =
+{
+    "other", "layout", "primary_vault", "minivaults", "connectivity",
+    "monsters", "items", "epilogue",
+};
+COMPILE_CHECK(ARRAYSZ(builder_phase_names) == NUM_BUILDER_PHASES);
+
+// Build attempts by place, layout, outcome, veto message and the last map
+// tried, which is the likeliest culprit for a veto.
+typedef tuple<level_id, string, string, string, string> build_kind;
+struct build_times
+{
+    int attempts = 0;
+    double phase[NUM_BUILDER_PHASES] = { };
+};
+static map<build_kind, build_times> build_profile;
+
+// The build attempt being timed, if any.
+static bool timing_build = false;
+static int current_phase = BP_OTHER;
+static chrono::steady_clock::time_point phase_start;
+static double attempt_times[NUM_BUILDER_PHASES];
+static string attempt_veto;
+static string attempt_last_map;
+
+// For -levelgen-bench: the seconds builder() took for each level it built,
+// and the attempts thrown away before, by branch; Abyss shifts go under
+// BENCH_ABYSS_SHIFT.
+static map<string, vector<double>> bench_times;
+static map<string, int> bench_retries;
+// The most memory resident in any worker, in kilobytes.
+static long bench_worker_rss = 0;
+static const char *BENCH_ABYSS_SHIFT = "Abyss shift";
+// How many times to shift each Abyss level built.
+static const int BENCH_ABYSS_SHIFTS = 5;
+
+// For -levelgen-bench: the levels saved and loaded back, their size
+// uncompressed, and the seconds saving and loading them took.
+static int bench_saves = 0;
+static double bench_save_bytes = 0;
+static double bench_save_seconds = 0;
+static double bench_load_seconds = 0;
+// Where they're saved.
+static package *bench_save = nullptr;
+
+static double _seconds_since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+           .count();
+}
+
+static void _charge_phase()
+{
+    const auto now = chrono::steady_clock::now();
+    attempt_times[current_phase] +=
+        chrono::duration<double>(now - phase_start).count();
+    phase_start = now;
+}
+
+mapstat_phase_timer::mapstat_phase_timer(builder_phase phase)
+    : timing(timing_build), outer(current_phase)
+{
+    if (!timing)
+        return;
+    _charge_phase();
+    current_phase = phase;
+}
+
+mapstat_phase_timer::~mapstat_phase_timer()
+{
+    if (!timing || !timing_build)
+        return;
+    _charge_phase();
+    current_phase = outer;
+}
 
 void mapstat_report_map_build_start()
 {
     build_attempts++;
     map_builds[level_id::current()].first++;
+
+    if (crawl_state.map_stat_gen)
+    {
+        timing_build = true;
+        current_phase = BP_OTHER;
+        for (double &t : attempt_times)
+            t = 0;
+        attempt_veto.clear();
+        attempt_last_map.clear();
+        phase_start = chrono::steady_clock::now();
+    }
 }
 
 void mapstat_report_map_veto(const string &message)
@@ -57,6 +168,31 @@ void mapstat_report_map_veto(const string &message)
     level_vetoes++;
     ++veto_messages[message];
     map_builds[level_id::current()].second++;
+    attempt_veto = message;
+}
+
+void mapstat_report_map_build_end(bool built)
+{
+    if (!timing_build)
+        return;
+    _charge_phase();
+    timing_build = false;
+
+    const string layout =
+        env.properties.exists(LAYOUT_TYPE_KEY)
+            ? env.properties[LAYOUT_TYPE_KEY].get_string()
+            : comma_separated_line(env.level_layout_types.begin(),
+                                   env.level_layout_types.end(), ", ");
+    const string outcome = built ? "built"
+                         : attempt_veto.empty() ? "rejected"
+                         : "vetoed";
+    build_times &times =
+        build_profile[build_kind(level_id::current(), layout, outcome,
+                                 attempt_veto,
+                                 built ? "" : attempt_last_map)];
+    times.attempts++;
+    for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+        times.phase[i] += attempt_times[i];
 }
 
 static bool _is_disconnected_level()
@@ -71,6 +207,46 @@ static bool _is_disconnected_level()
     return dgn_count_disconnected_zones(true);
 }
 
+// Save the level just built and load it back, as leaving and returning to
+// it would, timing each.
+static void _bench_save_level()
+{
+    // Made here rather than up front, so that each worker has its own.
+    if (!bench_save)
+        bench_save = new package();
+
+    fix_item_coordinates();
+    const string chunk = level_id::current().describe();
+    auto start = chrono::steady_clock::now();
+    {
+        writer outf(bench_save, chunk);
+        marshallUByte(outf, TAG_MAJOR_VERSION);
+        marshallUByte(outf, TAG_MINOR_VERSION);
+        tag_write(TAG_LEVEL, outf);
+    }
+    bench_save_seconds += _seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    {
+        reader inf(bench_save, chunk);
+        unmarshallUByte(inf);
+        inf.setMinorVersion(unmarshallUByte(inf));
+        tag_read(inf, TAG_LEVEL);
+        inf.fail_if_not_eof(chunk);
+    }
+    bench_load_seconds += _seconds_since(start);
+
+    // The chunk can't be measured until the save is committed, so count
+    // the bytes by saving it again to memory.
+    vector<unsigned char> buf;
+    writer sized(&buf);
+    marshallUByte(sized, TAG_MAJOR_VERSION);
+    marshallUByte(sized, TAG_MINOR_VERSION);
+    tag_write(TAG_LEVEL, sized);
+    bench_save_bytes += buf.size();
+    ++bench_saves;
+}
+
 static bool _do_build_level()
 {
     clear_messages();
@@ -92,7 +268,17 @@ static bool _do_build_level()
     }
 
     ++levels_tried;
-    if (!builder())
+    const int attempts_before = build_attempts;
+    const auto build_start = chrono::steady_clock::now();
+    const bool built = builder();
+    if (crawl_state.levelgen_bench)
+    {
+        const string branch = branches[you.where_are_you].abbrevname;
+        bench_retries[branch] += max(build_attempts - attempts_before - 1, 0);
+        if (built)
+            bench_times[branch].push_back(_seconds_since(build_start));
+    }
+    if (!built)
     {
         ++levels_failed;
         // Abort level build failure in objstat since the statistics will be
@@ -108,6 +294,10 @@ static bool _do_build_level()
         return true;
     }
 
+    pair<int,int> &peaks = slot_high_water[level_id::current()];
+    peaks.first = max(peaks.first, mitm_slot_high_water());
+    peaks.second = max(peaks.second, env.mon_index.high_water());
+
     for (int y = 0; y < GYM; ++y)
         for (int x = 0; x < GXM; ++x)
         {
@@ -171,6 +361,20 @@ static bool _do_build_level()
 
         return false;
     }
+
+    if (crawl_state.levelgen_bench)
+        _bench_save_level();
+
+    if (crawl_state.levelgen_bench && player_in_branch(BRANCH_ABYSS))
+    {
+        for (int i = 0; i < BENCH_ABYSS_SHIFTS; ++i)
+        {
+            const auto shift_start = chrono::steady_clock::now();
+            abyss_teleport();
+            bench_times[BENCH_ABYSS_SHIFT].push_back(
+                _seconds_since(shift_start));
+        }
+    }
     return true;
 }
 
@@ -223,11 +427,400 @@ static bool _build_dungeon()
     return true;
 }
 
+/**
+ * Build every level of one iteration.
+ *
+ * The iteration starts from a clean slate, with its RNG seeded from
+ * iteration_seed and its own number, so that it builds the same dungeon
+ * whichever process runs it and whatever iterations that process ran before.
+ *
+ * @param i The number of the iteration, from 0.
+ * @returns False if the build has to be abandoned; see mapstat_build_levels().
+ */
+static bool _build_iteration(int i)
+{
+    clear_messages();
+    mprf("On %d of %d; %d g, %d fail, %u err%s, %u uniq, "
+         "%d try, %d (%.2f%%) vetoes",
+         i, SysEnv.map_gen_iters, levels_tried, levels_failed,
+         (unsigned int)errors.size(),
+         last_error.empty() ? "" : (" (" + last_error + ")").c_str(),
+         (unsigned int)use_count.size(), build_attempts, level_vetoes,
+         build_attempts ? level_vetoes * 100.0 / build_attempts : 0.0);
+    printf("%d..", i + 1);
+    fflush(stdout);
+
+    uint64_t seed[2] = { iteration_seed, (uint64_t) i };
+    seed_rng(seed, ARRAYSZ(seed));
+    dlua.callfn("dgn_clear_data", "");
+    you.uniq_map_tags.clear();
+    you.uniq_map_names.clear();
+    you.unique_creatures.reset();
+    you.unique_items.init(UNIQ_NOT_EXISTS);
+    initialise_branch_depths();
+    init_level_connectivity();
+    if (!_build_dungeon())
+        return false;
+    if (crawl_state.obj_stat_gen)
+        objstat_iteration_stats();
+    return true;
+}
+
+// The most memory this process has had resident, in kilobytes, or 0 if that
+// can't be found out.
+static long _peak_rss_kb()
+{
+#ifdef TARGET_OS_WINDOWS
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0)
+        return 0;
+# ifdef TARGET_OS_MACOSX
+    return usage.ru_maxrss / 1024;
+# else
+    return usage.ru_maxrss;
+# endif
+#endif
+}
+
+#ifndef TARGET_OS_WINDOWS
+// Records are lines of tab-separated fields; these keep tabs, newlines and
+// backslashes in map names and veto messages from breaking them up.
+static string _escape_field(const string &field)
+{
+    string escaped;
+    for (char c : field)
+    {
+        if (c == '\\')
+            escaped += "\\\\";
+        else if (c == '\t')
+            escaped += "\\t";
+        else if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static string _unescape_field(const string &field)
+{
+    string plain;
+    for (unsigned int i = 0; i < field.length(); ++i)
+    {
+        if (field[i] != '\\' || i + 1 == field.length())
+        {
+            plain += field[i];
+            continue;
+        }
+        const char c = field[++i];
+        plain += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+    }
+    return plain;
+}
+
+static void _write_level_record(FILE *outf, const char *tag,
+                                const level_id &lid)
+{
+    fprintf(outf, "%s\t%d\t%d", tag, lid.branch, lid.depth);
+}
+
+static level_id _record_level(const vector<string> &fields)
+{
+    return level_id(static_cast<branch_type>(atoi(fields[1].c_str())),
+                    atoi(fields[2].c_str()));
+}
+
+// Write out everything this process has tallied, for the parent to merge.
+static void _write_map_records(FILE *outf)
+{
+    fprintf(outf, "counts\t%d\t%d\t%d\t%d\n", levels_tried, levels_failed,
+            build_attempts, level_vetoes);
+    for (const auto &entry : try_count)
+        fprintf(outf, "try\t%s\t%d\n", _escape_field(entry.first).c_str(),
+                entry.second);
+    for (const auto &entry : use_count)
+        fprintf(outf, "use\t%s\t%d\n", _escape_field(entry.first).c_str(),
+                entry.second);
+    for (const auto &entry : success_count)
+    {
+        fprintf(outf, "success\t%s\t%d\n",
+                _escape_field(entry.first).c_str(), entry.second);
+    }
+    for (const auto &entry : level_mapcounts)
+    {
+        _write_level_record(outf, "mapcount", entry.first);
+        fprintf(outf, "\t%d\n", entry.second);
+    }
+    for (const auto &entry : map_builds)
+    {
+        _write_level_record(outf, "builds", entry.first);
+        fprintf(outf, "\t%d\t%d\n", entry.second.first, entry.second.second);
+    }
+    for (const auto &entry : slot_high_water)
+    {
+        _write_level_record(outf, "slots", entry.first);
+        fprintf(outf, "\t%d\t%d\n", entry.second.first, entry.second.second);
+    }
+    // map_levelsused is the same relation the other way round.
+    for (const auto &entry : level_mapsused)
+        for (const string &name : entry.second)
+        {
+            _write_level_record(outf, "mapused", entry.first);
+            fprintf(outf, "\t%s\n", _escape_field(name).c_str());
+        }
+    for (const auto &entry : veto_messages)
+    {
+        fprintf(outf, "veto\t%d\t%s\n", entry.second,
+                _escape_field(entry.first).c_str());
+    }
+    for (const auto &entry : errors)
+    {
+        fprintf(outf, "error\t%s\t%s\n", _escape_field(entry.first).c_str(),
+                _escape_field(entry.second).c_str());
+    }
+    if (!last_error.empty())
+        fprintf(outf, "lasterror\t%s\n", _escape_field(last_error).c_str());
+    fprintf(outf, "lua\t%d\t%d\n", dlua_chunk_loads.compiled,
+            dlua_chunk_loads.cached);
+    for (const auto &entry : build_profile)
+    {
+        _write_level_record(outf, "buildtime", get<0>(entry.first));
+        fprintf(outf, "\t%s\t%s\t%s\t%s\t%d",
+                _escape_field(get<1>(entry.first)).c_str(),
+                get<2>(entry.first).c_str(),
+                _escape_field(get<3>(entry.first)).c_str(),
+                _escape_field(get<4>(entry.first)).c_str(),
+                entry.second.attempts);
+        for (double t : entry.second.phase)
+            fprintf(outf, "\t%.9f", t);
+        fprintf(outf, "\n");
+    }
+    if (crawl_state.levelgen_bench)
+    {
+        for (const auto &entry : bench_times)
+            for (double t : entry.second)
+            {
+                fprintf(outf, "benchtime\t%s\t%.9f\n",
+                        _escape_field(entry.first).c_str(), t);
+            }
+        for (const auto &entry : bench_retries)
+        {
+            fprintf(outf, "benchretry\t%s\t%d\n",
+                    _escape_field(entry.first).c_str(), entry.second);
+        }
+        fprintf(outf, "benchsave\t%d\t%.0f\t%.9f\t%.9f\n", bench_saves,
+                bench_save_bytes, bench_save_seconds, bench_load_seconds);
+        fprintf(outf, "benchmem\t%ld\n", _peak_rss_kb());
+    }
+}
+
+// Merge one record from a worker. Workers are merged in the order of their
+// iterations, so that what comes last (the last error) matches a run in a
+// single process.
+static bool _merge_map_record(const vector<string> &f)
+{
+    const string &tag = f[0];
+    if (tag == "counts" && f.size() == 5)
+    {
+        levels_tried += atoi(f[1].c_str());
+        levels_failed += atoi(f[2].c_str());
+        build_attempts += atoi(f[3].c_str());
+        level_vetoes += atoi(f[4].c_str());
+    }
+    else if (tag == "try" && f.size() == 3)
+        try_count[f[1]] += atoi(f[2].c_str());
+    else if (tag == "use" && f.size() == 3)
+        use_count[f[1]] += atoi(f[2].c_str());
+    else if (tag == "success" && f.size() == 3)
+        success_count[f[1]] += atoi(f[2].c_str());
+    else if (tag == "mapcount" && f.size() == 4)
+        level_mapcounts[_record_level(f)] += atoi(f[3].c_str());
+    else if (tag == "builds" && f.size() == 5)
+    {
+        pair<int,int> &builds = map_builds[_record_level(f)];
+        builds.first += atoi(f[3].c_str());
+        builds.second += atoi(f[4].c_str());
+    }
+    else if (tag == "slots" && f.size() == 5)
+    {
+        pair<int,int> &peaks = slot_high_water[_record_level(f)];
+        peaks.first = max(peaks.first, atoi(f[3].c_str()));
+        peaks.second = max(peaks.second, atoi(f[4].c_str()));
+    }
+    else if (tag == "mapused" && f.size() == 4)
+    {
+        const level_id lid = _record_level(f);
+        level_mapsused[lid].insert(f[3]);
+        map_levelsused[f[3]].insert(lid);
+    }
+    else if (tag == "veto" && f.size() == 3)
+        veto_messages[f[2]] += atoi(f[1].c_str());
+    else if (tag == "error" && f.size() == 3)
+        errors[f[1]] = f[2];
+    else if (tag == "lasterror" && f.size() == 2)
+        last_error = f[1];
+    else if (tag == "lua" && f.size() == 3)
+    {
+        dlua_chunk_loads.compiled += atoi(f[1].c_str());
+        dlua_chunk_loads.cached += atoi(f[2].c_str());
+    }
+    else if (tag == "buildtime" && f.size() == 8 + NUM_BUILDER_PHASES)
+    {
+        build_times &times =
+            build_profile[build_kind(_record_level(f), f[3], f[4], f[5],
+                                     f[6])];
+        times.attempts += atoi(f[7].c_str());
+        for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+            times.phase[i] += strtod(f[8 + i].c_str(), nullptr);
+    }
+    else if (tag == "benchtime" && f.size() == 3)
+        bench_times[f[1]].push_back(strtod(f[2].c_str(), nullptr));
+    else if (tag == "benchretry" && f.size() == 3)
+        bench_retries[f[1]] += atoi(f[2].c_str());
+    else if (tag == "benchsave" && f.size() == 5)
+    {
+        bench_saves += atoi(f[1].c_str());
+        bench_save_bytes += strtod(f[2].c_str(), nullptr);
+        bench_save_seconds += strtod(f[3].c_str(), nullptr);
+        bench_load_seconds += strtod(f[4].c_str(), nullptr);
+    }
+    else if (tag == "benchmem" && f.size() == 2)
+        bench_worker_rss = max(bench_worker_rss, atol(f[1].c_str()));
+    else
+        return false;
+    return true;
+}
+
+static bool _read_record(FILE *inf, vector<string> &fields)
+{
+    string line;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), inf))
+    {
+        line += buf;
+        if (line.back() == '\n')
+            break;
+    }
+    if (line.empty())
+        return false;
+    if (line.back() == '\n')
+        line.pop_back();
+
+    fields = split_string("\t", line, false, true);
+    for (string &field : fields)
+        field = _unescape_field(field);
+    return true;
+}
+
+/**
+ * Merge everything a worker tallied into this process's statistics.
+ *
+ * @returns True if the worker built all its iterations.
+ */
+static bool _merge_worker(FILE *inf, int worker)
+{
+    bool finished = false;
+    vector<string> fields;
+    while (_read_record(inf, fields))
+    {
+        if (fields[0] == "done" && fields.size() == 2)
+            finished = atoi(fields[1].c_str());
+        else if (!_merge_map_record(fields)
+                 && !(crawl_state.obj_stat_gen && objstat_merge_record(fields)))
+        {
+            fprintf(stderr, "Bad record from worker %d: %s\n", worker,
+                    fields[0].c_str());
+        }
+    }
+    return finished;
+}
+
+/**
+ * Build the iterations in worker processes, and merge what they tallied.
+ *
+ * Each worker takes a run of consecutive iterations; as every iteration is
+ * seeded on its own, the merged statistics are the same as if they'd all
+ * been built here.
+ *
+ * @param workers The number of worker processes.
+ * @returns True if every worker built all its iterations.
+ */
+static bool _build_levels_in_workers(int workers)
+{
+    printf("Iteration (%d workers): ", workers);
+    fflush(stdout);
+
+    vector<pid_t> pids;
+    vector<FILE *> results;
+    for (int w = 0; w < workers; ++w)
+    {
+        const int first = SysEnv.map_gen_iters * w / workers;
+        const int last = SysEnv.map_gen_iters * (w + 1) / workers;
+
+        int fds[2];
+        if (pipe(fds) < 0)
+            die("Couldn't make a pipe for mapstat worker: %s", strerror(errno));
+        fflush(stdout);
+        fflush(stderr);
+
+        const pid_t pid = fork();
+        if (pid < 0)
+            die("Couldn't fork mapstat worker: %s", strerror(errno));
+        if (!pid)
+        {
+            close(fds[0]);
+            for (FILE *inf : results)
+                fclose(inf);
+            // Only what this worker loads goes back to be added in.
+            dlua_chunk_loads = dlua_chunk_counts();
+
+            bool built = true;
+            for (int i = first; built && i < last; ++i)
+                built = _build_iteration(i);
+
+            FILE *outf = fdopen(fds[1], "w");
+            _write_map_records(outf);
+            if (crawl_state.obj_stat_gen)
+                objstat_write_records(outf);
+            fprintf(outf, "done\t%d\n", built);
+            fclose(outf);
+            fflush(stdout);
+            _exit(built ? 0 : 1);
+        }
+
+        close(fds[1]);
+        pids.push_back(pid);
+        results.push_back(fdopen(fds[0], "r"));
+    }
+
+    bool built = true;
+    for (int w = 0; w < workers; ++w)
+    {
+        if (!_merge_worker(results[w], w))
+            built = false;
+        fclose(results[w]);
+
+        int status;
+        if (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status))
+        {
+            fprintf(stderr, "Mapstat worker %d died.\n", w);
+            built = false;
+        }
+    }
+    printf("Finished.\n");
+    fflush(stdout);
+    return built;
+}
+#endif
+
 /**
  * Build dungeon levels for mapstat or objstat.
  *
  * The exact branches/levels built and number of build iterations is set by the
- * command-line options for mapstat/objstat.
+ * command-line options for mapstat/objstat. With -workers, the iterations are
+ * shared out between that many forked processes.
 
  * @returns True if all iterations built successfully. For mapstat, this can
  * return false if an iteration produced a disconnected level, since for
@@ -240,31 +833,20 @@ bool mapstat_build_levels()
 {
     if (!generated_levels.size())
         _dungeon_places();
+    // Drawn from the game RNG, so -seed fixes every iteration.
+    iteration_seed = get_uint64();
+
+#ifndef TARGET_OS_WINDOWS
+    const int workers = min(SysEnv.map_gen_workers, SysEnv.map_gen_iters);
+    if (workers > 1)
+        return _build_levels_in_workers(workers);
+#endif
+
     printf("Iteration: ");
     fflush(stdout);
     for (int i = 0; i < SysEnv.map_gen_iters; ++i)
-    {
-        clear_messages();
-        mprf("On %d of %d; %d g, %d fail, %u err%s, %u uniq, "
-             "%d try, %d (%.2f%%) vetoes",
-             i, SysEnv.map_gen_iters, levels_tried, levels_failed,
-             (unsigned int)errors.size(),
-             last_error.empty() ? "" : (" (" + last_error + ")").c_str(),
-             (unsigned int)use_count.size(), build_attempts, level_vetoes,
-             build_attempts ? level_vetoes * 100.0 / build_attempts : 0.0);
-        printf("%d..", i + 1);
-        fflush(stdout);
-        dlua.callfn("dgn_clear_data", "");
-        you.uniq_map_tags.clear();
-        you.uniq_map_names.clear();
-        you.unique_creatures.reset();
-        initialise_branch_depths();
-        init_level_connectivity();
-        if (!_build_dungeon())
+        if (!_build_iteration(i))
             return false;
-        if (crawl_state.obj_stat_gen)
-            objstat_iteration_stats();
-    }
     printf("Finished.\n");
     fflush(stdout);
     return true;
@@ -273,6 +855,7 @@ bool mapstat_build_levels()
 void mapstat_report_map_try(const map_def &map)
 {
     try_count[map.name]++;
+    attempt_last_map = map.name;
 }
 
 void mapstat_report_map_use(const map_def &map)
@@ -320,6 +903,48 @@ static void _check_mapless(const level_id &lid, vector<level_id> &mapless)
         mapless.push_back(lid);
 }
 
+static string _csv_field(const string &field)
+{
+    if (field.find_first_of(",\"\n") == string::npos)
+        return field;
+    return "\"" + replace_all(field, "\"", "\"\"") + "\"";
+}
+
+// One line for each kind of build attempt: where, with what layout, how it
+// ended, and the seconds spent in each phase of the builder.
+static void _write_build_profile()
+{
+    const char *out_file = "mapstat-phases.csv";
+    FILE *outf = fopen(out_file, "w");
+    if (!outf)
+    {
+        fprintf(stderr, "Couldn't write %s\n", out_file);
+        return;
+    }
+    printf("Writing builder phase times to %s...", out_file);
+    fflush(stdout);
+
+    fprintf(outf, "place,layout,outcome,veto,last_map,attempts");
+    for (const char *name : builder_phase_names)
+        fprintf(outf, ",%s", name);
+    fprintf(outf, "\n");
+    for (const auto &entry : build_profile)
+    {
+        fprintf(outf, "%s,%s,%s,%s,%s,%d",
+                _csv_field(get<0>(entry.first).describe()).c_str(),
+                _csv_field(get<1>(entry.first)).c_str(),
+                get<2>(entry.first).c_str(),
+                _csv_field(get<3>(entry.first)).c_str(),
+                _csv_field(get<4>(entry.first)).c_str(),
+                entry.second.attempts);
+        for (double t : entry.second.phase)
+            fprintf(outf, ",%.6f", t);
+        fprintf(outf, "\n");
+    }
+    fclose(outf);
+    printf("\n");
+}
+
 static void _write_map_stats()
 {
     const char *out_file = "mapstat.log";
@@ -330,6 +955,8 @@ static void _write_map_stats()
     fprintf(outf, "Levels attempted: %d, built: %d, failed: %d\n",
             levels_tried, levels_tried - levels_failed,
             levels_failed);
+    fprintf(outf, "Lua chunks compiled: %d, loaded as bytecode: %d\n",
+            dlua_chunk_loads.compiled, dlua_chunk_loads.cached);
     if (!errors.empty())
     {
         fprintf(outf, "\n\nMap errors:\n");
@@ -413,6 +1040,29 @@ static void _write_map_stats()
             fprintf(outf, "%3d) %s\n", i + 1, unused_maps[i].c_str());
     }
 
+    fprintf(outf, "\n\nPeak slot usage by level (items / %d, monsters / %d):"
+                  "\n\n", MAX_ITEMS, MAX_MONSTERS);
+    for (const auto &entry : slot_high_water)
+    {
+        fprintf(outf, "%-10s %5d %5d\n", entry.first.describe().c_str(),
+                entry.second.first, entry.second.second);
+    }
+
+    double kept[NUM_BUILDER_PHASES] = { }, discarded[NUM_BUILDER_PHASES] = { };
+    for (const auto &entry : build_profile)
+        for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+        {
+            (get<2>(entry.first) == "built" ? kept : discarded)[i]
+                += entry.second.phase[i];
+        }
+    fprintf(outf, "\n\nBuild time by phase (seconds in kept, discarded "
+                  "attempts):\n\n");
+    for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+    {
+        fprintf(outf, "%-15s %10.3f %10.3f\n", builder_phase_names[i],
+                kept[i], discarded[i]);
+    }
+
     fprintf(outf, "\n\nMaps by level:\n\n");
     for (const auto &entry : level_mapsused)
     {
@@ -479,7 +1129,8 @@ static void _write_map_stats()
     printf("\n");
 }
 
-void mapstat_generate_stats()
+// Get ready to build levels outside a game.
+static void _prepare_level_builds()
 {
     // Warn assertions about possible oddities like the artefact list being
     // cleared.
@@ -494,6 +1145,11 @@ void mapstat_generate_stats()
     run_map_local_preludes();
 
     _dungeon_places();
+}
+
+void mapstat_generate_stats()
+{
+    _prepare_level_builds();
     clear_messages();
     mpr("Generating dungeon map stats");
     printf("Generating map stats for %d iteration(s) of %d level(s) over "
@@ -504,7 +1160,183 @@ void mapstat_generate_stats()
     // build.
     mapstat_build_levels();
     _write_map_stats();
+    _write_build_profile();
     printf("Map stats complete.\n");
 }
 
+// The time in sorted below which a fraction p of the times fall, in ms.
+static double _percentile_ms(const vector<double> &sorted, double p)
+{
+    const int rank = max((int)ceil(p * sorted.size()), 1);
+    return sorted[rank - 1] * 1000;
+}
+
+static void _write_bench_report(bool built, double wall_seconds)
+{
+    const char *out_file = "levelgen-bench.json";
+    FILE *outf = fopen(out_file, "w");
+    if (!outf)
+    {
+        fprintf(stderr, "Couldn't write %s\n", out_file);
+        return;
+    }
+
+    int levels = 0, retries = 0;
+    double build_seconds = 0;
+    JsonNode *places(json_mkobject());
+    set<string> names;
+    for (const auto &entry : bench_times)
+        names.insert(entry.first);
+    for (const auto &entry : bench_retries)
+        names.insert(entry.first);
+    for (const string &name : names)
+    {
+        vector<double> times = bench_times[name];
+        sort(times.begin(), times.end());
+        JsonNode *place(json_mkobject());
+        json_append_member(place, "levels", json_mknumber(times.size()));
+        json_append_member(place, "retries",
+                           json_mknumber(bench_retries[name]));
+        if (!times.empty())
+        {
+            double total = 0;
+            for (double t : times)
+                total += t;
+            json_append_member(place, "mean_ms",
+                               json_mknumber(total * 1000 / times.size()));
+            json_append_member(place, "p50_ms",
+                               json_mknumber(_percentile_ms(times, 0.5)));
+            json_append_member(place, "p99_ms",
+                               json_mknumber(_percentile_ms(times, 0.99)));
+            json_append_member(place, "max_ms",
+                               json_mknumber(times.back() * 1000));
+            // Shifts aren't levels built.
+            if (name != BENCH_ABYSS_SHIFT)
+            {
+                levels += times.size();
+                build_seconds += total;
+            }
+        }
+        retries += bench_retries[name];
+        json_append_member(places, name.c_str(), place);
+    }
+
+    JsonNode *report(json_mkobject());
+    json_append_member(report, "version", json_mkstring(Version::Long));
+    json_append_member(report, "seed", json_mknumber(Options.seed));
+    json_append_member(report, "iterations",
+                       json_mknumber(SysEnv.map_gen_iters));
+    json_append_member(report, "workers",
+                       json_mknumber(min(SysEnv.map_gen_workers,
+                                         SysEnv.map_gen_iters)));
+    json_append_member(report, "built", json_mkbool(built));
+    json_append_member(report, "levels", json_mknumber(levels));
+    json_append_member(report, "failed", json_mknumber(levels_failed));
+    json_append_member(report, "retries", json_mknumber(retries));
+    json_append_member(report, "wall_seconds", json_mknumber(wall_seconds));
+    json_append_member(report, "build_seconds",
+                       json_mknumber(build_seconds));
+    json_append_member(report, "levels_per_second",
+                       json_mknumber(wall_seconds > 0 ? levels / wall_seconds
+                                                      : 0));
+    json_append_member(report, "peak_rss_kb",
+                       json_mknumber(max(_peak_rss_kb(), bench_worker_rss)));
+    json_append_member(report, "branches", places);
+
+    // Where the time went, over every attempt, kept or not; the layout
+    // phase by layout type is what speeding up a layout script changes.
+    double phase_total[NUM_BUILDER_PHASES] = { };
+    map<string, build_times> by_layout;
+    for (const auto &entry : build_profile)
+    {
+        build_times &times = by_layout[get<1>(entry.first)];
+        times.attempts += entry.second.attempts;
+        for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+        {
+            phase_total[i] += entry.second.phase[i];
+            times.phase[i] += entry.second.phase[i];
+        }
+    }
+    JsonNode *phases(json_mkobject());
+    for (int i = 0; i < NUM_BUILDER_PHASES; ++i)
+    {
+        json_append_member(phases, builder_phase_names[i],
+                           json_mknumber(phase_total[i]));
+    }
+    json_append_member(report, "phase_seconds", phases);
+    JsonNode *layouts(json_mkobject());
+    for (const auto &entry : by_layout)
+    {
+        JsonNode *layout(json_mkobject());
+        json_append_member(layout, "attempts",
+                           json_mknumber(entry.second.attempts));
+        json_append_member(layout, "layout_ms",
+                           json_mknumber(entry.second.attempts
+                                         ? entry.second.phase[BP_LAYOUT] * 1000
+                                           / entry.second.attempts
+                                         : 0));
+        json_append_member(layouts, entry.first.empty() ? "none"
+                                                        : entry.first.c_str(),
+                           layout);
+    }
+    json_append_member(report, "layouts", layouts);
+
+    JsonNode *saves(json_mkobject());
+    json_append_member(saves, "levels", json_mknumber(bench_saves));
+    json_append_member(saves, "bytes", json_mknumber(bench_save_bytes));
+    json_append_member(saves, "save_seconds",
+                       json_mknumber(bench_save_seconds));
+    json_append_member(saves, "load_seconds",
+                       json_mknumber(bench_load_seconds));
+    json_append_member(saves, "save_bytes_per_second",
+                       json_mknumber(bench_save_seconds > 0
+                                     ? bench_save_bytes / bench_save_seconds
+                                     : 0));
+    json_append_member(saves, "load_bytes_per_second",
+                       json_mknumber(bench_load_seconds > 0
+                                     ? bench_save_bytes / bench_load_seconds
+                                     : 0));
+    json_append_member(report, "saves", saves);
+
+    char *json = json_stringify(report, "  ");
+    fprintf(outf, "%s\n", json);
+    free(json);
+    json_delete(report);
+    fclose(outf);
+    printf("Benchmark report written to %s.\n", out_file);
+}
+
+/**
+ * Time building a fixed, seeded set of levels, with no UI, and write the
+ * results to levelgen-bench.json.
+ *
+ * The levels are those mapstat would build, by default every level of every
+ * branch (Pandemonium and the Abyss included), and each Abyss level is also
+ * shifted to new areas a few times. Unless -seed is given, the same seed is
+ * used every run, so that the reports of two versions can be compared.
+ */
+void mapstat_run_benchmark()
+{
+    _prepare_level_builds();
+    clear_messages();
+    if (!Options.seed)
+        Options.seed = 1;
+    seed_rng(Options.seed);
+    printf("Benchmarking %d iteration(s) of %d level(s) over %d branch(es) "
+           "with seed %x.\n", SysEnv.map_gen_iters,
+           (int) generated_levels.size(), branch_count, Options.seed);
+    fflush(stdout);
+
+    const auto start = chrono::steady_clock::now();
+    const bool built = mapstat_build_levels();
+    _write_bench_report(built, _seconds_since(start));
+
+    if (bench_save)
+    {
+        bench_save->abort();
+        delete bench_save;
+        bench_save = nullptr;
+    }
+}
+
 #endif // DEBUG_STATISTICS
@@ -15,8 +15,44 @@ void mapstat_report_map_success(const string &map_name);
 void mapstat_report_error(const map_def &map, const string &err);
 void mapstat_report_map_build_start();
 void mapstat_report_map_veto(const string &message);
+void mapstat_report_map_build_end(bool built);
 void mapstat_generate_stats();
+void mapstat_run_benchmark();
 bool mapstat_build_levels();
+
+// The parts of a level build that mapstat times.
+enum builder_phase
+{
+    BP_OTHER,           // Whatever isn't in one of the others.
+    BP_LAYOUT,
+    BP_PRIMARY_VAULT,
+    BP_MINIVAULTS,      // Branch entries, chance, mini and extra vaults.
+    BP_CONNECTIVITY,
+    BP_MONSTERS,
+    BP_ITEMS,
+    BP_EPILOGUE,        // Lua epilogues and post-place hooks.
+    NUM_BUILDER_PHASES
+};
+
+/**
+ * Charges the wall time until it goes out of scope to a phase of the level
+ * build being timed, less the time of any phase timed inside it. Does
+ * nothing outside mapstat.
+ */
+class mapstat_phase_timer
+{
+public:
+    mapstat_phase_timer(builder_phase phase);
+    ~mapstat_phase_timer();
+
+private:
+    bool timing;
+    int outer;
+};
+
+# define MAPSTAT_PHASE(phase) mapstat_phase_timer mapstat_phase(phase)
+#else
+# define MAPSTAT_PHASE(phase)
 #endif
 
 #endif
@@ -872,6 +872,173 @@ void objstat_iteration_stats()
     }
 }
 
+// What a stat holds before anything is tallied into it.
+static double _stat_initial_value(const string &field)
+{
+    if (field == "NumMin" || field == "AllNumMin")
+        return INFINITY;
+    else if (field == "NumMax" || field == "AllNumMax")
+        return -1;
+    return 0;
+}
+
+// Fold a worker's value for a stat into ours: minima and maxima over the
+// iterations combine as such, everything else is a sum over them.
+static void _merge_stat(map<string, double> &stats, const string &field,
+                        double value)
+{
+    if (field == "NumMin" || field == "AllNumMin")
+        stats[field] = min(stats[field], value);
+    else if (field == "NumMax" || field == "AllNumMax")
+        stats[field] = max(stats[field], value);
+    else
+        stats[field] += value;
+}
+
+static void _write_brand_records(FILE *outf, const char *tag,
+                                 const brand_records &brands)
+{
+    for (const auto &entry : brands)
+        for (unsigned int st = 0; st < entry.second.size(); st++)
+            for (unsigned int aq = 0; aq < entry.second[st].size(); aq++)
+                for (unsigned int b = 0; b < entry.second[st][aq].size(); b++)
+                {
+                    const int num = entry.second[st][aq][b];
+                    if (!num)
+                        continue;
+                    fprintf(outf, "%s\t%d\t%d\t%u\t%u\t%u\t%d\n", tag,
+                            entry.first.branch, entry.first.depth, st, aq, b,
+                            num);
+                }
+}
+
+/**
+ * Write out the item and monster stats tallied by a mapstat worker, as
+ * tab-separated records for objstat_merge_record(). Stats still at their
+ * initial value are left out.
+ *
+ * Every tally is a whole number or a half, so the sums come out exactly the
+ * same however the iterations were shared out.
+ */
+void objstat_write_records(FILE *outf)
+{
+    for (const auto &entry : item_recs)
+        for (unsigned int i = 0; i < entry.second.size(); i++)
+            for (unsigned int j = 0; j < entry.second[i].size(); j++)
+                for (const auto &stat : entry.second[i][j])
+                {
+                    if (stat.second == _stat_initial_value(stat.first))
+                        continue;
+                    fprintf(outf, "item\t%d\t%d\t%u\t%u\t%s\t%.17g\n",
+                            entry.first.branch, entry.first.depth, i, j,
+                            stat.first.c_str(), stat.second);
+                }
+
+    _write_brand_records(outf, "weaponbrand", weapon_brands);
+    _write_brand_records(outf, "armourbrand", armour_brands);
+
+    for (const auto &entry : missile_brands)
+        for (unsigned int st = 0; st < entry.second.size(); st++)
+            for (unsigned int b = 0; b < entry.second[st].size(); b++)
+            {
+                if (!entry.second[st][b])
+                    continue;
+                fprintf(outf, "missilebrand\t%d\t%d\t%u\t%u\t%d\n",
+                        entry.first.branch, entry.first.depth, st, b,
+                        entry.second[st][b]);
+            }
+
+    for (const auto &entry : monster_recs)
+        for (const auto &mentry : entry.second)
+            for (const auto &stat : mentry.second)
+            {
+                if (stat.second == _stat_initial_value(stat.first))
+                    continue;
+                fprintf(outf, "monster\t%d\t%d\t%d\t%s\t%.17g\n",
+                        entry.first.branch, entry.first.depth, mentry.first,
+                        stat.first.c_str(), stat.second);
+            }
+}
+
+// The entry at index i, if there is one.
+template <typename T>
+static T *_record_entry(vector<T> &entries, const string &i)
+{
+    const int index = atoi(i.c_str());
+    if (index < 0 || index >= (int) entries.size())
+        return nullptr;
+    return &entries[index];
+}
+
+static bool _merge_brand_record(brand_records &brands,
+                                const vector<string> &fields)
+{
+    if (fields.size() != 7)
+        return false;
+    const level_id lev(static_cast<branch_type>(atoi(fields[1].c_str())),
+                       atoi(fields[2].c_str()));
+    if (!brands.count(lev))
+        return false;
+    vector<vector<int>> *sub = _record_entry(brands[lev], fields[3]);
+    vector<int> *antiq = sub ? _record_entry(*sub, fields[4]) : nullptr;
+    int *num = antiq ? _record_entry(*antiq, fields[5]) : nullptr;
+    if (!num)
+        return false;
+    *num += atoi(fields[6].c_str());
+    return true;
+}
+
+/**
+ * Merge one record written by objstat_write_records() in a worker into this
+ * process's stats, which must have been set up for the same levels.
+ *
+ * @returns False if the record isn't an objstat one, or doesn't fit.
+ */
+bool objstat_merge_record(const vector<string> &fields)
+{
+    if (fields.size() < 3)
+        return false;
+    const string &tag = fields[0];
+    const level_id lev(static_cast<branch_type>(atoi(fields[1].c_str())),
+                       atoi(fields[2].c_str()));
+
+    if (tag == "item" && fields.size() == 7)
+    {
+        if (!item_recs.count(lev))
+            return false;
+        auto *base = _record_entry(item_recs[lev], fields[3]);
+        map<string, double> *stats = base ? _record_entry(*base, fields[4])
+                                          : nullptr;
+        if (!stats)
+            return false;
+        _merge_stat(*stats, fields[5], strtod(fields[6].c_str(), nullptr));
+    }
+    else if (tag == "weaponbrand")
+        return _merge_brand_record(weapon_brands, fields);
+    else if (tag == "armourbrand")
+        return _merge_brand_record(armour_brands, fields);
+    else if (tag == "missilebrand" && fields.size() == 6)
+    {
+        if (!missile_brands.count(lev))
+            return false;
+        vector<int> *sub = _record_entry(missile_brands[lev], fields[3]);
+        int *num = sub ? _record_entry(*sub, fields[4]) : nullptr;
+        if (!num)
+            return false;
+        *num += atoi(fields[5].c_str());
+    }
+    else if (tag == "monster" && fields.size() == 6)
+    {
+        if (!monster_recs.count(lev))
+            return false;
+        _merge_stat(monster_recs[lev][atoi(fields[3].c_str())], fields[4],
+                    strtod(fields[5].c_str(), nullptr));
+    }
+    else
+        return false;
+    return true;
+}
+
 static void _write_stat_headers(const vector<string> &fields, bool items = true)
 {
     fprintf(stat_outf, "%s\tLevel", items ? "Item" : "Monster");
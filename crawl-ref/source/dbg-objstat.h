@@ -11,6 +11,8 @@ void objstat_record_item(const item_def &item);
 void objstat_generate_stats();
 void objstat_record_monster(const monster *mons);
 void objstat_iteration_stats();
+void objstat_write_records(FILE *outf);
+bool objstat_merge_record(const vector<string> &fields);
 #endif
 
 #endif //DBGOBJSTAT_H
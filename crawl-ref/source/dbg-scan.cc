@@ -372,6 +372,13 @@ void debug_mons_scan()
                               m->type, pos.x, pos.y, i);
         }
 
+        if (!env.mon_index.covers(i))
+        {
+            mprf(MSGCH_ERROR, "Monster index out of date for %s at (%d, %d), "
+                              "midx = %d",
+                 m->full_name(DESC_PLAIN, true).c_str(), pos.x, pos.y, i);
+        }
+
         if (!in_bounds(pos))
         {
             mprf(MSGCH_ERROR, "Out of bounds monster: %s at (%d, %d), "
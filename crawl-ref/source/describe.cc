@@ -2033,7 +2033,7 @@ string get_item_description(const item_def &item, bool verbose,
 
 void get_feature_desc(const coord_def &pos, describe_info &inf)
 {
-    dungeon_feature_type feat = env.map_knowledge(pos).feat();
+    dungeon_feature_type feat = env.map_knowledge.get(pos).feat();
 
     string desc      = feature_description_at(pos, false, DESC_A, false);
     string db_name   = feat == DNGN_ENTER_SHOP ? "a shop" : desc;
@@ -2073,7 +2073,7 @@ void get_feature_desc(const coord_def &pos, describe_info &inf)
 
     inf.body << long_desc;
 
-    if (const cloud_type cloud = env.map_knowledge(pos).cloud())
+    if (const cloud_type cloud = env.map_knowledge.get(pos).cloud())
     {
         const string cl_name = cloud_type_name(cloud);
         const string cl_desc = getLongDescription(cl_name + " cloud");
@@ -31,6 +31,55 @@ static dungeon_feature_type _pick_pseudorandom_wall(uint64_t val)
     return features[val%9];
 }
 
+vector<ProceduralSample>
+ProceduralLayout::sample_points(const vector<coord_def> &points,
+                                const uint32_t offset) const
+{
+    vector<ProceduralSample> samples;
+    samples.reserve(points.size());
+    for (const coord_def &p : points)
+        samples.push_back((*this)(p, offset));
+    return samples;
+}
+
+// Sample where[i] from layouts[which[i]] into samples[i], for each i with
+// which[i] >= 0, as a batch for each layout.
+static void _sample_with(const vector<const ProceduralLayout*> &layouts,
+                         const vector<int> &which,
+                         const vector<coord_def> &where,
+                         const uint32_t offset,
+                         vector<ProceduralSample> &samples)
+{
+    for (int l = 0, size = layouts.size(); l < size; ++l)
+    {
+        vector<coord_def> batch;
+        vector<int> index;
+        for (int i = 0, n = which.size(); i < n; ++i)
+            if (which[i] == l)
+            {
+                batch.push_back(where[i]);
+                index.push_back(i);
+            }
+        if (batch.empty())
+            continue;
+
+        const vector<ProceduralSample> got =
+            layouts[l]->sample_points(batch, offset);
+        for (int j = 0, n = index.size(); j < n; ++j)
+            samples[index[j]] = got[j];
+    }
+}
+
+// Worley noise at each (xs[i], ys[i], z), in one batch.
+static vector<worley::noise_datum> _worley_batch(const vector<double> &xs,
+                                                 const vector<double> &ys,
+                                                 double z)
+{
+    vector<worley::noise_datum> noise(xs.size());
+    worley::noise(xs.data(), ys.data(), z, xs.size(), noise.data());
+    return noise;
+}
+
 ProceduralSample
 ColumnLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -65,29 +114,71 @@ static uint32_t _get_changepoint(const worley::noise_datum &n, const double scal
     return max(1, (int) floor((n.distance[1] - n.distance[0]) * scale) - 5);
 }
 
+static const double WORLEY_OFFSET_SCALE = 5000.0;
+
+// Which of its layouts a WorleyLayout uses at a point, and where in it.
+static int _worley_choice(const worley::noise_datum &n, uint32_t seed,
+                          int size, const coord_def &p, coord_def &pd)
+{
+    bool parity = n.id[0] % 4;
+    uint32_t id = n.id[0] / 4;
+    const uint8_t choice = parity
+        ? id % size
+        : min(id % size, (id / size) % size);
+    pd = p + id;
+    return (choice + seed) % size;
+}
+
 ProceduralSample
 WorleyLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
-    const double offset_scale = 5000.0;
     double x = p.x / scale;
     double y = p.y / scale;
-    double z = offset / offset_scale;
+    double z = offset / WORLEY_OFFSET_SCALE;
     worley::noise_datum n = worley::noise(x, y, z + seed);
 
-    const uint32_t changepoint = offset + _get_changepoint(n, offset_scale);
-    const uint8_t size = layouts.size();
-    bool parity = n.id[0] % 4;
-    uint32_t id = n.id[0] / 4;
-    const uint8_t choice = parity
-        ? id % size
-        : min(id % size, (id / size) % size);
-    const coord_def pd = p + id;
-    ProceduralSample sample = (*layouts[(choice + seed) % size])(pd, offset);
+    const uint32_t changepoint =
+        offset + _get_changepoint(n, WORLEY_OFFSET_SCALE);
+    coord_def pd;
+    const int which = _worley_choice(n, seed, layouts.size(), p, pd);
+    ProceduralSample sample = (*layouts[which])(pd, offset);
 
     return ProceduralSample(p, sample.feat(),
                 min(changepoint, sample.changepoint()));
 }
 
+vector<ProceduralSample>
+WorleyLayout::sample_points(const vector<coord_def> &points,
+                            const uint32_t offset) const
+{
+    vector<double> xs, ys;
+    for (const coord_def &p : points)
+    {
+        xs.push_back(p.x / scale);
+        ys.push_back(p.y / scale);
+    }
+    double z = offset / WORLEY_OFFSET_SCALE;
+    const vector<worley::noise_datum> noise = _worley_batch(xs, ys, z + seed);
+
+    vector<int> which(points.size());
+    vector<coord_def> where(points.size());
+    for (int i = 0, n = points.size(); i < n; ++i)
+        which[i] = _worley_choice(noise[i], seed, layouts.size(), points[i],
+                                  where[i]);
+    vector<ProceduralSample> samples(points.size());
+    _sample_with(layouts, which, where, offset, samples);
+
+    for (int i = 0, n = points.size(); i < n; ++i)
+    {
+        const uint32_t changepoint =
+            offset + _get_changepoint(noise[i], WORLEY_OFFSET_SCALE);
+        samples[i] = ProceduralSample(points[i], samples[i].feat(),
+                                      min(changepoint,
+                                          samples[i].changepoint()));
+    }
+    return samples;
+}
+
 ProceduralSample
 ChaosLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -111,6 +202,33 @@ RoilingChaosLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, sample.feat(), min(sample.changepoint(), changepoint));
 }
 
+vector<ProceduralSample>
+RoilingChaosLayout::sample_points(const vector<coord_def> &points,
+                                  const uint32_t offset) const
+{
+    const double scale = (density - 350) + 4800;
+    vector<double> xs, ys;
+    for (const coord_def &p : points)
+    {
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    double z = offset / scale;
+    const vector<worley::noise_datum> noise = _worley_batch(xs, ys, z);
+
+    vector<ProceduralSample> samples;
+    for (int i = 0, n = points.size(); i < n; ++i)
+    {
+        const coord_def &p = points[i];
+        const uint32_t changepoint = offset + _get_changepoint(noise[i], scale);
+        ProceduralSample sample =
+            ChaosLayout(noise[i].id[0] + seed, density)(p, offset);
+        samples.emplace_back(p, sample.feat(),
+                             min(sample.changepoint(), changepoint));
+    }
+    return samples;
+}
+
 ProceduralSample
 WastesLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -125,6 +243,32 @@ WastesLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, min(sample.changepoint(), changepoint));
 }
 
+vector<ProceduralSample>
+WastesLayout::sample_points(const vector<coord_def> &points,
+                            const uint32_t offset) const
+{
+    vector<double> xs, ys;
+    for (const coord_def &p : points)
+    {
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    double z = offset / 3;
+    const vector<worley::noise_datum> noise = _worley_batch(xs, ys, z);
+
+    vector<ProceduralSample> samples;
+    for (int i = 0, n = points.size(); i < n; ++i)
+    {
+        const coord_def &p = points[i];
+        const uint32_t changepoint = offset + _get_changepoint(noise[i], 3);
+        ProceduralSample sample = ChaosLayout(noise[i].id[0], 10)(p, offset);
+        dungeon_feature_type feat = feat_is_solid(sample.feat())
+            ? DNGN_ROCK_WALL : DNGN_FLOOR;
+        samples.emplace_back(p, feat, min(sample.changepoint(), changepoint));
+    }
+    return samples;
+}
+
 ProceduralSample
 RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -151,6 +295,48 @@ RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
     return layout(p, offset);
 }
 
+vector<ProceduralSample>
+RiverLayout::sample_points(const vector<coord_def> &points,
+                           const uint32_t offset) const
+{
+    const double scale = 10000;
+    const double scalar = 90.0;
+    vector<double> xs, ys;
+    for (const coord_def &p : points)
+    {
+        xs.push_back((p.x + perlin::fBM(p.x/4.0, p.y/4.0, seed, 5) * 3) / scalar);
+        ys.push_back((p.y + perlin::fBM(p.x/4.0 + 3.7, p.y/4.0 + 1.9, seed + 4, 5) * 3) / scalar);
+    }
+    const vector<worley::noise_datum> noise =
+        _worley_batch(xs, ys, offset / scale + seed);
+
+    vector<ProceduralSample> samples(points.size());
+    // Points off the rivers come from the layout underneath, as a batch.
+    vector<int> which(points.size(), -1);
+    for (int i = 0, size = points.size(); i < size; ++i)
+    {
+        const coord_def &p = points[i];
+        const worley::noise_datum &n = noise[i];
+        const uint32_t changepoint = offset + _get_changepoint(n, scale);
+        double delta = n.distance[1] - n.distance[0];
+        if ((n.id[0] ^ n.id[1] ^ seed) % 4 || delta >= 1.5/scalar)
+        {
+            which[i] = 0;
+            continue;
+        }
+
+        dungeon_feature_type feat = DNGN_SHALLOW_WATER;
+        uint64_t hash = hash3(p.x, p.y, n.id[0] + seed);
+        if (!(hash % 5))
+            feat = DNGN_DEEP_WATER;
+        if (!(hash % 23))
+            feat = DNGN_TREE;
+        samples[i] = ProceduralSample(p, feat, changepoint);
+    }
+    _sample_with({ &layout }, which, points, offset, samples);
+    return samples;
+}
+
 ProceduralSample
 NewAbyssLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
@@ -181,6 +367,49 @@ NewAbyssLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, offset + delta);
 }
 
+vector<ProceduralSample>
+NewAbyssLayout::sample_points(const vector<coord_def> &points,
+                              const uint32_t offset) const
+{
+    const double scale = 1.0 / 3.2;
+    vector<double> xs, ys;
+    for (const coord_def &p : points)
+    {
+        xs.push_back(p.x * scale);
+        ys.push_back(p.y * scale);
+    }
+    const vector<worley::noise_datum> noise =
+        _worley_batch(xs, ys, offset / 1000.0);
+
+    vector<ProceduralSample> samples;
+    samples.reserve(points.size());
+    for (int i = 0, size = points.size(); i < size; ++i)
+    {
+        const coord_def &p = points[i];
+        uint64_t base = hash3(p.x, p.y, seed);
+        dungeon_feature_type feat = DNGN_FLOOR;
+
+        int dist = noise[i].distance[0] * 100;
+        bool isWall = (dist > 118 || dist < 30);
+        int delta = min(abs(dist - 118), abs(30 - dist));
+
+        if ((noise[i].id[0] + noise[i].id[1]) % 6 == 0)
+            isWall = false;
+
+        if (base % 3 == 0)
+            isWall = !isWall;
+
+        if (isWall)
+        {
+            int fuzz = (base / 3) % 3 ? 0 : (base / 9) % 3 - 1;
+            feat = _pick_pseudorandom_wall(noise[i].id[0] + fuzz);
+        }
+
+        samples.emplace_back(p, feat, offset + delta);
+    }
+    return samples;
+}
+
 dungeon_feature_type sanitize_feature(dungeon_feature_type feature, bool strict)
 {
     if (feat_is_gate(feature) || feature == DNGN_TELEPORTER)
@@ -273,6 +502,24 @@ LevelLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, offset + 4096);
 }
 
+vector<ProceduralSample>
+LevelLayout::sample_points(const vector<coord_def> &points,
+                           const uint32_t offset) const
+{
+    vector<ProceduralSample> samples(points.size());
+    vector<int> which(points.size(), -1);
+    for (int i = 0, size = points.size(); i < size; ++i)
+    {
+        const dungeon_feature_type feat = grid(clip(points[i]));
+        if (feat == DNGN_UNSEEN)
+            which[i] = 0;
+        else
+            samples[i] = ProceduralSample(points[i], feat, offset + 4096);
+    }
+    _sample_with({ &layout }, which, points, offset, samples);
+    return samples;
+}
+
 ProceduralSample
 NoiseLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
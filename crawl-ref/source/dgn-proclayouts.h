@@ -17,6 +17,8 @@ dungeon_feature_type sanitize_feature(dungeon_feature_type feature,
 class ProceduralSample
 {
     public:
+        // A placeholder, for filling in samples taken as a batch.
+        ProceduralSample() : c(), ft(DNGN_FLOOR), cp(0), m(MMT_NONE) { }
         ProceduralSample(const coord_def _c, const dungeon_feature_type _ft,
                          const uint32_t _cp, map_mask_type _m = MMT_NONE)
             : c(_c), ft(_ft), cp(_cp), m(_m)
@@ -55,6 +57,10 @@ class ProceduralLayout
     public:
         virtual ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const = 0;
+        // Sample each of the points, exactly as operator() would. Layouts
+        // that can share work between nearby points override this.
+        virtual vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points, const uint32_t offset = 0) const;
         virtual ~ProceduralLayout() { }
 };
 
@@ -98,6 +104,9 @@ class WorleyLayout : public ProceduralLayout
             seed(_seed), layouts(_layouts), scale(_scale) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
     private:
         const uint32_t seed;
         const vector<const ProceduralLayout*> layouts;
@@ -130,6 +139,9 @@ class RoilingChaosLayout : public ProceduralLayout
             seed(_seed), density(_density) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
     private:
         const uint32_t seed;
         const uint32_t density;
@@ -142,6 +154,9 @@ class WastesLayout : public ProceduralLayout
         WastesLayout() { };
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
 };
 
 class RiverLayout : public ProceduralLayout
@@ -151,6 +166,9 @@ class RiverLayout : public ProceduralLayout
             seed(_seed), layout(_layout) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
     private:
         const uint32_t seed;
         const ProceduralLayout &layout;
@@ -163,6 +181,9 @@ class NewAbyssLayout : public ProceduralLayout
         NewAbyssLayout(uint32_t _seed) : seed(_seed) {}
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
     private:
         const uint32_t seed;
 };
@@ -176,6 +197,9 @@ class LevelLayout : public ProceduralLayout
             const ProceduralLayout &_layout);
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
+        vector<ProceduralSample> sample_points(
+            const vector<coord_def> &points,
+            const uint32_t offset = 0) const override;
     private:
         feature_grid grid;
         uint32_t seed;
@@ -0,0 +1,415 @@
+/**
+ * @file
+ * @brief Building the level below the stairs ahead of time.
+ *
+ * While the player sits at the command prompt on stairs down to a new
+ * level, a forked helper goes straight to loading the level below, which
+ * builds it; it runs nothing else of the game. When it reaches the builder,
+ * it notes everything the new level could depend on -- the RNG state and
+ * everything saved with the player, uniques included -- builds the level
+ * and sends it all back, and the game keeps it in memory as a pending
+ * level. When the player really arrives, the level is taken only if the
+ * helper has finished and the state matches to the byte; otherwise it is
+ * built afresh, so the game plays out the same either way.
+**/
+
+#include "AppHdr.h"
+
+#include "dgn-speculate.h"
+
+#include "dungeon.h"
+#include "files.h"
+#include "macro.h"
+#include "options.h"
+#include "package.h"
+#include "random.h"
+#include "stairs.h"
+#include "state.h"
+#include "stringutil.h"
+#include "tag-version.h"
+#include "tags.h"
+#include "terrain.h"
+#include "unwind.h"
+#include "version.h"
+
+// The helper is a fork of the game; it can't share a tiles display.
+#if defined(UNIX) && !defined(USE_TILE)
+# define CAN_SPECULATE
+# include <cerrno>
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+#ifdef CAN_SPECULATE
+static pid_t helper_pid = 0;
+static int helper_fd = -1;
+static bool helper_done = false;
+// The level the helper is building, and the level and stairs it was forked
+// for, so as to fork only one for them.
+static string helper_level;
+static string helper_key;
+// What the helper has sent so far of the pending level.
+static string helper_output;
+// Levels helpers have finished, by name, as sent. They're never saved: the
+// interpreter state they were built from is gone once the game is.
+static map<string, vector<unsigned char>> pending;
+// How many pending levels have been taken this game.
+static int levels_adopted = 0;
+
+static void _marshall_blob(writer &outf, const string &blob)
+{
+    marshallInt(outf, blob.size());
+    outf.write(blob.data(), blob.size());
+}
+
+static string _unmarshall_blob(reader &inf)
+{
+    string blob(unmarshallInt(inf), '\0');
+    inf.read(&blob[0], blob.size());
+    return blob;
+}
+
+// Everything the level about to be built depends on. Levels are built from
+// the RNG state, the player, uniques and the Lua persist data (all saved in
+// TAG_YOU), and where and how they're entered.
+static string _fingerprint(dungeon_feature_type stair_taken)
+{
+    vector<unsigned char> buf;
+    writer outf(&buf);
+    marshallString(outf, Version::Long);
+    marshall_level_id(outf, level_id::current());
+    marshallShort(outf, stair_taken);
+    _marshall_blob(outf, rng_state());
+    {
+        // Real time played has no part in it, and differs by however long
+        // the player took to press the key.
+        unwind_var<int> real_time(you.real_time, 0);
+        unwind_var<time_t> keypress(you.last_keypress_time, time(nullptr));
+        tag_write(TAG_YOU, outf);
+    }
+    return string(buf.begin(), buf.end());
+}
+
+// The level the stairs underfoot lead to, if it's new and a helper can
+// build it. Only stone stairs within a branch: entering a branch changes
+// the player on the way, so a level built ahead of time wouldn't be taken.
+static level_id _level_below()
+{
+    // Abyss levels are made from the level left behind, and Pandemonium
+    // is made afresh every time.
+    const dungeon_feature_type feat = orig_terrain(you.pos());
+    if (!feat_is_stone_stair(feat)
+        || feat_stair_direction(feat) != CMD_GO_DOWNSTAIRS
+        || player_in_branch(BRANCH_ABYSS)
+        || player_in_branch(BRANCH_PANDEMONIUM))
+    {
+        return level_id();
+    }
+
+    const level_id below = stair_destination(you.pos(), false);
+    if (!below.is_valid()
+        || below.branch != you.where_are_you
+        || is_existing_level(below))
+    {
+        return level_id();
+    }
+    return below;
+}
+
+// Read what the helper's sent until there's at least want bytes, it's
+// done, or timeout_ms have gone by (never, if negative).
+static void _read_helper(size_t want, int timeout_ms)
+{
+    char buf[65536];
+    while (!helper_done && helper_output.size() < want)
+    {
+        pollfd pfd = { helper_fd, POLLIN, 0 };
+        const int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            return;
+
+        const ssize_t got = read(helper_fd, buf, sizeof(buf));
+        if (got < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (got <= 0)
+            helper_done = true;
+        else
+            helper_output.append(buf, got);
+    }
+}
+
+// Reap the helper; if keep, keep the level it finished as pending.
+static void _finish_helper(bool keep)
+{
+    if (!helper_done)
+        kill(helper_pid, SIGKILL);
+
+    int status = 0;
+    while (waitpid(helper_pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    close(helper_fd);
+
+    if (keep && helper_done && WIFEXITED(status) && !WEXITSTATUS(status)
+        && !helper_output.empty())
+    {
+        pending[helper_level].assign(helper_output.begin(),
+                                     helper_output.end());
+        dprf("Speculatively built %s.", helper_level.c_str());
+    }
+
+    helper_pid = 0;
+    helper_fd = -1;
+    helper_done = false;
+    helper_level.clear();
+    helper_output.clear();
+}
+
+// In the helper: go down the stairs underfoot to below, as
+// floor_transition() does once the player is on their way, and load it.
+// That builds it, and sends it back; nothing else of the game is run.
+NORETURN static void _descend_in_helper(const level_id &below)
+{
+    const level_id old_level = level_id::current();
+    const dungeon_feature_type stair = orig_terrain(you.pos());
+
+    you.prev_targ = MHITNOT;
+    if (you.pet_target != MHITYOU)
+        you.pet_target = MHITNOT;
+    you.prev_grd_targ.reset();
+    you.depth = below.depth;
+    you.where_are_you = below.branch;
+
+    load_level(stair, LOAD_ENTER_LEVEL, old_level);
+    // The level wasn't new after all.
+    _exit(1);
+}
+
+static void _fork_helper(const level_id &below)
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+        return;
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+
+    if (pid)
+    {
+        close(fds[1]);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        helper_pid = pid;
+        helper_fd = fds[0];
+        helper_level = below.describe();
+        return;
+    }
+
+    close(fds[0]);
+    helper_fd = fds[1];
+    crawl_state.speculating = true;
+
+    // Keep off the terminal.
+    const int null = open("/dev/null", O_RDWR);
+    if (null < 0)
+        _exit(1);
+    dup2(null, STDIN_FILENO);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    if (null > STDERR_FILENO)
+        close(null);
+
+    // Leave the save alone too: the level left behind is saved to a
+    // scratch package instead, holding empty chunks of the same names so
+    // that checks for which levels exist come out the same.
+    package *scratch = new package();
+    for (const string &name : you.save->list_chunks())
+        delete scratch->writer(name);
+    you.save = scratch;
+
+    _descend_in_helper(below);
+}
+
+static void _send(int fd, const void *data, size_t size)
+{
+    const char *at = static_cast<const char *>(data);
+    while (size)
+    {
+        const ssize_t put = write(fd, at, size);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            _exit(1);
+        at += put;
+        size -= put;
+    }
+}
+
+NORETURN static void _build_in_helper(dungeon_feature_type stair_taken)
+{
+    const string print = _fingerprint(stair_taken);
+    builder(true, stair_taken);
+
+    // Epilogues run in the environments the maps' Lua left behind in the
+    // interpreter, which can't be sent back with the level.
+    for (const auto &vault : env.level_vaults)
+        if (!vault->map.epilogue.empty())
+            _exit(1);
+
+    vector<unsigned char> buf;
+    writer outf(&buf);
+    marshallUByte(outf, TAG_MAJOR_VERSION);
+    marshallUByte(outf, TAG_MINOR_VERSION);
+    _marshall_blob(outf, print);
+    _marshall_blob(outf, rng_state());
+    tag_write(TAG_YOU, outf);
+    tag_write(TAG_LEVEL, outf);
+    _send(helper_fd, buf.data(), buf.size());
+    _exit(0);
+}
+
+// Take a pending level, if it was built from the state we're in now.
+static bool _adopt_pending(const string &level, const string &print)
+{
+    reader inf(pending[level]);
+    const int major = unmarshallUByte(inf);
+    const int minor = unmarshallUByte(inf);
+    if (major != TAG_MAJOR_VERSION || minor != TAG_MINOR_VERSION)
+        return false;
+    inf.setMinorVersion(minor);
+
+    if (_unmarshall_blob(inf) != print)
+    {
+        dprf("Discarding %s, built from a different state.", level.c_str());
+        return false;
+    }
+    const string state = _unmarshall_blob(inf);
+
+    const int real_time = you.real_time;
+    const time_t keypress = you.last_keypress_time;
+    tag_read(inf, TAG_YOU);
+    tag_read(inf, TAG_LEVEL);
+    inf.fail_if_not_eof(level);
+    set_rng_state(state);
+    you.real_time = real_time;
+    you.last_keypress_time = keypress;
+
+    dprf("Adopted %s.", level.c_str());
+    levels_adopted++;
+    return true;
+}
+
+static bool _adopt_level(dungeon_feature_type stair_taken)
+{
+    const string level = level_id::current().describe();
+
+    // A helper still at work is too late: build the level here instead.
+    if (helper_pid)
+    {
+        _read_helper(SIZE_MAX, 0);
+        _finish_helper(helper_level == level);
+    }
+
+    const bool adopted = pending.count(level)
+                         && _adopt_pending(level, _fingerprint(stair_taken));
+
+    // Whatever else is pending was for stairs not taken.
+    pending.clear();
+    helper_key.clear();
+
+    return adopted;
+}
+#endif
+
+void speculate_level_below()
+{
+#ifdef CAN_SPECULATE
+    if (helper_pid)
+    {
+        _read_helper(SIZE_MAX, 0);
+        if (helper_done)
+            _finish_helper(true);
+    }
+
+    // Don't fork while a save is being committed in the background: the
+    // helper would inherit the save mid-write, and the commit thread not at
+    // all.
+    if (!Options.speculative_levelgen
+        || has_pending_input()
+        || crawl_state.game_is_arena()
+        || crawl_state.game_is_tutorial()
+        || crawl_state.is_replaying_keys()
+        || you.save->commit_in_progress())
+    {
+        return;
+    }
+
+    const level_id below = _level_below();
+    if (!below.is_valid())
+    {
+        abandon_speculation();
+        return;
+    }
+
+    // One helper for each level and stairs to it, however long the player
+    // stands there: if the game has moved on by the time they're taken,
+    // the level is built afresh.
+    const string key = make_stringf("%s %d,%d", below.describe().c_str(),
+                                    you.pos().x, you.pos().y);
+    if (key == helper_key)
+        return;
+
+    abandon_speculation();
+    helper_key = key;
+    _fork_helper(below);
+#endif
+}
+
+void speculative_builder(dungeon_feature_type stair_taken)
+{
+#ifdef CAN_SPECULATE
+    if (crawl_state.speculating)
+        _build_in_helper(stair_taken);
+    if (_adopt_level(stair_taken))
+        return;
+#endif
+    builder(true, stair_taken);
+}
+
+void abandon_speculation()
+{
+#ifdef CAN_SPECULATE
+    if (helper_pid)
+        _finish_helper(false);
+#endif
+}
+
+#ifdef DEBUG_TESTS
+void finish_speculation()
+{
+# ifdef CAN_SPECULATE
+    if (helper_pid)
+    {
+        _read_helper(SIZE_MAX, -1);
+        _finish_helper(true);
+    }
+# endif
+}
+
+int speculative_levels_adopted()
+{
+# ifdef CAN_SPECULATE
+    return levels_adopted;
+# else
+    return 0;
+# endif
+}
+#endif
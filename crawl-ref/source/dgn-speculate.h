@@ -0,0 +1,28 @@
+/**
+ * @file
+ * @brief Building the level below the stairs ahead of time.
+**/
+
+#ifndef DGN_SPECULATE_H
+#define DGN_SPECULATE_H
+
+// Called while waiting for a command: collect the level a helper finished,
+// and fork a new helper if the player stands on stairs leading down to a
+// level not yet made.
+void speculate_level_below();
+
+// Make the new current level: take it from a helper that built it from
+// exactly the same state, or build it here.
+void speculative_builder(dungeon_feature_type stair_taken);
+
+// Stop any helper still at work, before the save goes away.
+void abandon_speculation();
+
+#ifdef DEBUG_TESTS
+// Wait for the helper at work, if any, to finish, and keep its level.
+void finish_speculation();
+// How many levels built ahead of time have been taken this game.
+int speculative_levels_adopted();
+#endif
+
+#endif
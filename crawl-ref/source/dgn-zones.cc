@@ -0,0 +1,139 @@
+/**
+ * @file
+ * @brief Connected zones of a level, found a row of cells at a time.
+**/
+
+#include "AppHdr.h"
+
+#include "dgn-zones.h"
+
+#include "bitary.h"
+#include "travel.h"
+
+static const int ROW_WORDS = (GXM + 63) / 64;
+typedef uint64_t row_bits[ROW_WORDS];
+
+// The first x at or after from whose bit is set (or clear, if !set), or GXM
+// if there's none.
+static int _next_bit(const row_bits &row, int from, bool set)
+{
+    for (int i = from / 64; i < ROW_WORDS; ++i)
+    {
+        uint64_t word = set ? row[i] : ~row[i];
+        if (i == from / 64)
+            word &= ~0ULL << (from % 64);
+        if (word)
+            return min(i * 64 + lowest_bit(word), GXM);
+    }
+    return GXM;
+}
+
+static int _find_root(vector<int> &parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void _join(vector<int> &parent, int a, int b)
+{
+    a = _find_root(parent, a);
+    b = _find_root(parent, b);
+    // Keep the earlier run as the root, so roots are the first runs of
+    // their zones.
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+dgn_zone_map::dgn_zone_map(bool (*passable)(const coord_def &))
+    : nzones(0)
+{
+    vector<int> parent;
+    int above = 0; // The first run of the row above.
+    for (int y = 0; y < GYM; ++y)
+    {
+        row_bits row = { };
+        for (int x = 0; x < GXM; ++x)
+            if (passable(coord_def(x, y)))
+                row[x / 64] |= 1ULL << (x % 64);
+
+        const int first = runs.size();
+        for (int x = _next_bit(row, 0, true); x < GXM;
+             x = _next_bit(row, x, true))
+        {
+            const int end = _next_bit(row, x, false);
+            runs.push_back({ y, x, end - 1, 0 });
+            parent.push_back(parent.size());
+            x = end;
+        }
+
+        // Runs touch, diagonals included, if they overlap once the one
+        // above is widened by a cell on either side.
+        int i = above, j = first;
+        while (y > 0 && i < first && j < (int)runs.size())
+        {
+            if (runs[i].x1 <= runs[j].x2 + 1 && runs[j].x1 <= runs[i].x2 + 1)
+                _join(parent, i, j);
+            if (runs[i].x2 < runs[j].x2)
+                ++i;
+            else
+                ++j;
+        }
+        above = first;
+    }
+
+    for (int i = 0, size = runs.size(); i < size; ++i)
+    {
+        const int root = _find_root(parent, i);
+        runs[i].zone = root == i ? ++nzones : runs[root].zone;
+    }
+
+    zone_start.assign(nzones + 1, 0);
+    for (const run &r : runs)
+        zone_start[r.zone]++;
+    for (int z = 1; z <= nzones; ++z)
+        zone_start[z] += zone_start[z - 1];
+    zone_runs.resize(runs.size());
+    vector<int> next(zone_start.begin(), zone_start.end() - 1);
+    for (int i = 0, size = runs.size(); i < size; ++i)
+        zone_runs[next[runs[i].zone - 1]++] = i;
+}
+
+vector<coord_def> dgn_zone_map::cells(int zone) const
+{
+    ASSERT_RANGE(zone, 1, nzones + 1);
+    vector<coord_def> where;
+    for (int i = zone_start[zone - 1]; i < zone_start[zone]; ++i)
+    {
+        const run &r = runs[zone_runs[i]];
+        for (int x = r.x1; x <= r.x2; ++x)
+            where.emplace_back(x, r.y);
+    }
+    return where;
+}
+
+bool dgn_zone_map::any(int zone, bool (*test)(const coord_def &)) const
+{
+    ASSERT_RANGE(zone, 1, nzones + 1);
+    for (int i = zone_start[zone - 1]; i < zone_start[zone]; ++i)
+    {
+        const run &r = runs[zone_runs[i]];
+        for (int x = r.x1; x <= r.x2; ++x)
+            if (test(coord_def(x, r.y)))
+                return true;
+    }
+    return false;
+}
+
+void dgn_zone_map::label_travel_distances() const
+{
+    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
+    for (const run &r : runs)
+        for (int x = r.x1; x <= r.x2; ++x)
+            travel_point_distance[x][r.y] = r.zone;
+}
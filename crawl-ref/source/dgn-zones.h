@@ -0,0 +1,49 @@
+/**
+ * @file
+ * @brief Connected zones of a level, found a row of cells at a time.
+**/
+
+#ifndef DGN_ZONES_H
+#define DGN_ZONES_H
+
+#include <vector>
+
+/**
+ * The 8-connected zones of the cells of the level that pass a test,
+ * numbered from 1 in the order of their first cell, reading along each row
+ * from the top: the order a cell by cell flood fill started from each
+ * unfilled cell in turn would number them in.
+ *
+ * Each row is turned into a bitmask and split into runs of passable cells,
+ * and runs touching a run of the row above are joined with a union-find:
+ * each cell is tested just once, and there's no flood fill cell by cell.
+ */
+class dgn_zone_map
+{
+public:
+    dgn_zone_map(bool (*passable)(const coord_def &));
+
+    int count() const { return nzones; }
+
+    // The cells of a zone, in row order.
+    vector<coord_def> cells(int zone) const;
+    // Whether any cell of the zone passes the test.
+    bool any(int zone, bool (*test)(const coord_def &)) const;
+    // Set travel_point_distance to the zone of each cell, or 0.
+    void label_travel_distances() const;
+
+private:
+    struct run
+    {
+        int y, x1, x2;
+        int zone;
+    };
+    vector<run> runs;
+    // Runs by zone: those of zone z are zone_runs[zone_start[z - 1]] up to
+    // zone_runs[zone_start[z]].
+    vector<int> zone_runs;
+    vector<int> zone_start;
+    int nzones;
+};
+
+#endif
@@ -1883,7 +1883,7 @@ void direction_chooser::move_to_you()
 
 void direction_chooser::describe_target()
 {
-    if (!map_bounds(target()) || !env.map_knowledge(target()).known())
+    if (!map_bounds(target()) || !env.map_knowledge.get(target()).known())
         return;
     full_describe_square(target());
     need_all_redraw = true;
@@ -2128,7 +2128,7 @@ string get_terse_square_desc(const coord_def &gc)
         desc = unseen_desc;
     else if (!you.see_cell(gc))
     {
-        if (env.map_knowledge(gc).seen())
+        if (env.map_knowledge.get(gc).seen())
         {
             desc = "[" + feature_description_at(gc, false, DESC_PLAIN, false)
                        + "]";
@@ -2161,7 +2161,7 @@ void get_square_desc(const coord_def &c, describe_info &inf)
 {
     // NOTE: Keep this function in sync with full_describe_square.
 
-    const dungeon_feature_type feat = env.map_knowledge(c).feat();
+    const dungeon_feature_type feat = env.map_knowledge.get(c).feat();
 
     if (const monster_info *mi = env.map_knowledge(c).monsterinfo())
     {
@@ -2193,7 +2193,7 @@ void get_square_desc(const coord_def &c, describe_info &inf)
         get_feature_desc(c, inf);
     }
 
-    const cloud_type cloud = env.map_knowledge(c).cloud();
+    const cloud_type cloud = env.map_knowledge.get(c).cloud();
     if (cloud != CLOUD_NONE)
     {
         inf.prefix = "There is a cloud of " + cloud_type_name(cloud)
@@ -2258,7 +2258,7 @@ static void _describe_oos_square(const coord_def& where)
 {
     mprf(MSGCH_EXAMINE_FILTER, "You can't see that place.");
 
-    if (!in_bounds(where) || !env.map_knowledge(where).seen())
+    if (!in_bounds(where) || !env.map_knowledge.get(where).seen())
     {
 #ifdef DEBUG_DIAGNOSTICS
         if (!in_bounds(where))
@@ -2546,7 +2546,7 @@ static bool _find_feature(const coord_def& where, int mode,
         return false;
 
     // The stair need not be in LOS if the square is mapped.
-    if (!you.see_cell(where) && !env.map_knowledge(where).seen())
+    if (!you.see_cell(where) && !env.map_knowledge.get(where).seen())
         return false;
 
     return is_feature(mode, where);
@@ -2853,10 +2853,10 @@ static bool _find_square_wrapper(coord_def& mfp, int direction,
 
 static void _describe_oos_feature(const coord_def& where)
 {
-    if (!env.map_knowledge(where).seen())
+    if (!env.map_knowledge.get(where).seen())
         return;
 
-    string desc = feature_description(env.map_knowledge(where).feat());
+    string desc = feature_description(env.map_knowledge.get(where).feat());
 
     if (!desc.empty())
         mprf(MSGCH_EXAMINE_FILTER, "[%s]", desc.c_str());
@@ -2885,7 +2885,7 @@ vector<dungeon_feature_type> features_by_desc(const base_pattern &pattern)
 
 void describe_floor()
 {
-    dungeon_feature_type grid = env.map_knowledge(you.pos()).feat();
+    dungeon_feature_type grid = env.map_knowledge.get(you.pos()).feat();
 
     const char* prefix = "There is ";
     string feat;
@@ -2976,8 +2976,8 @@ static bool _interesting_feature(dungeon_feature_type feat)
 string feature_description_at(const coord_def& where, bool covering,
                               description_level_type dtype, bool add_stop)
 {
-    dungeon_feature_type grid = env.map_knowledge(where).feat();
-    trap_type trap = env.map_knowledge(where).trap();
+    dungeon_feature_type grid = env.map_knowledge.get(where).feat();
+    trap_type trap = env.map_knowledge.get(where).trap();
 
     string marker_desc = env.markers.property_at(where, MAT_ANY,
                                                  "feature_description");
@@ -9,9 +9,12 @@
 
 #include <sstream>
 
+#include "hash.h"
 #include "l_libs.h"
 #include "stringutil.h"
 
+dlua_chunk_counts dlua_chunk_loads;
+
 static int dlua_compiled_chunk_writer(lua_State *ls, const void *p,
                                       size_t sz, void *ud)
 {
@@ -63,6 +66,7 @@ string dlua_chunk::describe(const string &name) const
                         name.c_str(), chunk.c_str());
 }
 
+// Saves get the source, or the bytecode only if there is no source.
 void dlua_chunk::write(writer& outf) const
 {
     if (empty())
@@ -71,17 +75,39 @@ void dlua_chunk::write(writer& outf) const
         return;
     }
 
-    if (!compiled.empty())
+    if (!chunk.empty())
+    {
+        marshallByte(outf, CT_SOURCE);
+        marshallString4(outf, chunk);
+    }
+    else
     {
         marshallByte(outf, CT_COMPILED);
         marshallString4(outf, compiled);
     }
-    else
+
+    marshallString4(outf, file);
+    marshallInt(outf, first);
+}
+
+// The map database gets the bytecode along with the source, so that loading
+// it needn't compile the source again.
+void dlua_chunk::write_cached(writer& outf) const
+{
+    if (compiled.empty() || chunk.empty())
     {
-        marshallByte(outf, CT_SOURCE);
-        marshallString4(outf, chunk);
+        write(outf);
+        return;
     }
 
+    // The bytecode is only good for the Lua that made it, from this very
+    // source; keep what's needed to tell.
+    marshallByte(outf, CT_CACHED);
+    marshallString4(outf, chunk);
+    marshallInt(outf, LUA_VERSION_NUM);
+    marshallInt(outf, hash32(chunk.data(), chunk.size()));
+    marshallString4(outf, compiled);
+
     marshallString4(outf, file);
     marshallInt(outf, first);
 }
@@ -100,6 +126,19 @@ void dlua_chunk::read(reader& inf)
     case CT_COMPILED:
         unmarshallString4(inf, compiled);
         break;
+    case CT_CACHED:
+    {
+        unmarshallString4(inf, chunk);
+        const int version = unmarshallInt(inf);
+        const uint32_t hash = unmarshallInt(inf);
+        unmarshallString4(inf, compiled);
+        if (version != LUA_VERSION_NUM
+            || hash != hash32(chunk.data(), chunk.size()))
+        {
+            compiled.clear();
+        }
+        break;
+    }
     }
     unmarshallString4(inf, file);
     first = unmarshallInt(inf);
@@ -150,9 +189,17 @@ int dlua_chunk::load(CLua &interp)
 {
     if (!compiled.empty())
     {
-        return check_op(interp,
-                         interp.loadbuffer(compiled.c_str(), compiled.length(),
-                                           context.c_str()));
+        const int err =
+            check_op(interp, interp.loadbuffer(compiled.c_str(),
+                                               compiled.length(),
+                                               context.c_str()));
+        if (!err)
+            dlua_chunk_loads.cached++;
+        // Bytecode this Lua won't load can still be compiled again from the
+        // source, if there is any.
+        if (!err || trimmed_string(chunk).empty())
+            return err;
+        compiled.clear();
     }
 
     if (empty())
@@ -165,6 +212,7 @@ int dlua_chunk::load(CLua &interp)
                         interp.loadstring(chunk.c_str(), context.c_str()));
     if (err)
         return err;
+    dlua_chunk_loads.compiled++;
     ostringstream out;
     err = lua_dump(interp, dlua_compiled_chunk_writer, &out);
     if (err)
@@ -177,6 +225,18 @@ int dlua_chunk::load(CLua &interp)
     return err;
 }
 
+// Compile the chunk, if it hasn't been, so that its bytecode is written out
+// with it. Errors are left for when the chunk is run.
+void dlua_chunk::precompile(CLua &interp)
+{
+    if (!compiled.empty() || empty())
+        return;
+
+    lua_stack_cleaner cln(interp);
+    load(interp);
+    error.clear();
+}
+
 int dlua_chunk::run(CLua &interp)
 {
     int err = load(interp);
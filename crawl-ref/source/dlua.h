@@ -34,7 +34,8 @@ private:
     {
         CT_EMPTY,
         CT_SOURCE,
-        CT_COMPILED
+        CT_COMPILED,
+        CT_CACHED,   // Source, with the bytecode compiled from it.
     };
 
 private:
@@ -57,6 +58,7 @@ public:
     void set_chunk(const string &s);
 
     int load(CLua &interp);
+    void precompile(CLua &interp);
     int run(CLua &interp);
     int load_call(CLua &interp, const char *function);
     void set_file(const string &s);
@@ -70,9 +72,19 @@ public:
     const string &compiled_chunk() const { return compiled; }
 
     void write(writer&) const;
+    void write_cached(writer&) const;
     void read(reader&);
 };
 
+// How many times chunks were compiled from their source, and how many times
+// bytecode compiled earlier (or cached in the map database) was used instead.
+struct dlua_chunk_counts
+{
+    int compiled = 0;
+    int cached = 0;
+};
+extern dlua_chunk_counts dlua_chunk_loads;
+
 void init_dungeon_lua();
 
 #endif
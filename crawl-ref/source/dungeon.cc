@@ -35,6 +35,7 @@
 #include "dgn-labyrinth.h"
 #include "dgn-overview.h"
 #include "dgn-shoals.h"
+#include "dgn-zones.h"
 #include "end.h"
 #include "english.h"
 #include "files.h"
@@ -305,7 +306,12 @@ bool builder(bool enable_random_maps, dungeon_feature_type dest_stairs_type)
 
         try
         {
-            if (_build_level_vetoable(enable_random_maps, dest_stairs_type))
+            const bool built = _build_level_vetoable(enable_random_maps,
+                                                     dest_stairs_type);
+#ifdef DEBUG_STATISTICS
+            mapstat_report_map_build_end(built);
+#endif
+            if (built)
             {
                 for (monster_iterator mi; mi; ++mi)
                     gozag_set_bribe(*mi);
@@ -315,6 +321,9 @@ bool builder(bool enable_random_maps, dungeon_feature_type dest_stairs_type)
         }
         catch (map_load_exception &mload)
         {
+#ifdef DEBUG_STATISTICS
+            mapstat_report_map_build_end(false);
+#endif
             mprf(MSGCH_ERROR, "Failed to load map, reloading all maps (%s).",
                  mload.what());
             reread_maps();
@@ -409,6 +418,8 @@ static bool _build_level_vetoable(bool enable_random_maps,
 
     // Call the branch epilogue, if any.
     if (!branch_epilogues[you.where_are_you].empty())
+    {
+        MAPSTAT_PHASE(BP_EPILOGUE);
         if (!dlua.callfn(branch_epilogues[you.where_are_you].c_str(), 0, 0))
         {
             mprf(MSGCH_ERROR, "branch epilogue for %s failed: %s",
@@ -416,6 +427,7 @@ static bool _build_level_vetoable(bool enable_random_maps,
                               dlua.error.c_str());
             return false;
         }
+    }
 
     // Discard any Lua chunks we loaded.
     strip_all_maps();
@@ -666,52 +678,6 @@ static bool _dgn_square_is_passable(const coord_def &c)
     return !(env.level_map_mask(c) & MMT_OPAQUE) && dgn_square_travel_ok(c);
 }
 
-static inline void _dgn_point_record_stub(const coord_def &) { }
-
-template <class point_record>
-static bool _dgn_fill_zone(
-    const coord_def &start, int zone,
-    point_record &record_point,
-    bool (*passable)(const coord_def &) = _dgn_square_is_passable,
-    bool (*iswanted)(const coord_def &) = nullptr)
-{
-    bool ret = false;
-    list<coord_def> points[2];
-    int cur = 0;
-
-    // No bounds checks, assuming the level has at least one layer of
-    // rock border.
-
-    for (points[cur].push_back(start); !points[cur].empty();)
-    {
-        for (const auto &c : points[cur])
-        {
-            travel_point_distance[c.x][c.y] = zone;
-
-            if (iswanted && iswanted(c))
-                ret = true;
-
-            for (adjacent_iterator ai(c); ai; ++ai)
-            {
-                const coord_def& cp = *ai;
-                if (!map_bounds(cp)
-                    || travel_point_distance[cp.x][cp.y] || !passable(cp))
-                {
-                    continue;
-                }
-
-                travel_point_distance[cp.x][cp.y] = zone;
-                record_point(cp);
-                points[!cur].push_back(cp);
-            }
-        }
-
-        points[cur].clear();
-        cur = !cur;
-    }
-    return ret;
-}
-
 static bool _is_perm_down_stair(const coord_def &c)
 {
     switch (grd(c))
@@ -819,79 +785,45 @@ static bool _is_exit_stair(const coord_def &c)
 //
 // If fill is non-zero, it fills any disconnected regions with fill.
 //
-static int _process_disconnected_zones(int x1, int y1, int x2, int y2,
-                                       bool choose_stairless,
+static int _process_disconnected_zones(bool choose_stairless,
                                        dungeon_feature_type fill)
 {
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
-    int ngood = 0;
-    for (int y = y1; y <= y2 ; ++y)
-    {
-        for (int x = x1; x <= x2; ++x)
-        {
-            if (!map_bounds(x, y)
-                || travel_point_distance[x][y]
-                || !_dgn_square_is_passable(coord_def(x, y)))
-            {
-                continue;
-            }
+    const dgn_zone_map zones(_dgn_square_is_passable);
+    zones.label_travel_distances();
 
-            const bool found_exit_stair =
-                _dgn_fill_zone(coord_def(x, y), ++nzones,
-                               _dgn_point_record_stub,
-                               _dgn_square_is_passable,
-                               choose_stairless ? (at_branch_bottom() ?
-                                                   _is_upwards_exit_stair :
-                                                   _is_exit_stair) : nullptr);
-
-            // If we want only stairless zones, screen out zones that did
-            // have stairs.
-            if (choose_stairless && found_exit_stair)
-                ++ngood;
-            else if (fill)
+    bool (*iswanted)(const coord_def &) =
+        at_branch_bottom() ? _is_upwards_exit_stair : _is_exit_stair;
+    int ngood = 0;
+    for (int zone = 1; zone <= zones.count(); ++zone)
+    {
+        // If we want only stairless zones, screen out zones that did
+        // have stairs.
+        if (choose_stairless && zones.any(zone, iswanted))
+            ++ngood;
+        else if (fill)
+        {
+            // Don't fill in areas connected to vaults.
+            // We want vaults to be accessible; if the area is disconneted
+            // from the rest of the level, this will cause the level to be
+            // vetoed later on.
+            const vector<coord_def> coords = zones.cells(zone);
+            if (none_of(coords.begin(), coords.end(),
+                        [](const coord_def &c)
+                        { return map_masked(c, MMT_VAULT); }))
             {
-                // Don't fill in areas connected to vaults.
-                // We want vaults to be accessible; if the area is disconneted
-                // from the rest of the level, this will cause the level to be
-                // vetoed later on.
-                bool veto = false;
-                vector<coord_def> coords;
-                for (int fy = y1; fy <= y2 ; ++fy)
-                {
-                    for (int fx = x1; fx <= x2; ++fx)
-                    {
-                        if (travel_point_distance[fx][fy] == nzones)
-                        {
-                            if (map_masked(coord_def(fx, fy), MMT_VAULT))
-                            {
-                                veto = true;
-                                break;
-                            }
-                            else
-                                coords.emplace_back(fx, fy);
-                        }
-                    }
-                    if (veto)
-                        break;
-                }
-                if (!veto)
-                {
-                    for (auto c : coords)
-                        _set_grd(c, fill);
-                }
+                for (auto c : coords)
+                    _set_grd(c, fill);
             }
         }
     }
 
-    return nzones - ngood;
+    return zones.count() - ngood;
 }
 
 int dgn_count_disconnected_zones(bool choose_stairless,
                                  dungeon_feature_type fill)
 {
-    return _process_disconnected_zones(0, 0, GXM-1, GYM-1, choose_stairless,
-                                       fill);
+    return _process_disconnected_zones(choose_stairless, fill);
 }
 
 static void _fixup_hell_stairs()
@@ -1109,6 +1041,7 @@ static bool _is_level_stair_connected(dungeon_feature_type feat)
 
 static bool _valid_dungeon_level()
 {
+    MAPSTAT_PHASE(BP_CONNECTIVITY);
     // D:1 only.
     // Also, what's the point of this check?  Regular connectivity should
     // do that already.
@@ -1166,10 +1099,12 @@ void dgn_reset_level(bool enable_random_maps)
     // Initialise all items.
     for (int i = 0; i < MAX_ITEMS; i++)
         init_item(i);
+    reset_mitm_slots();
 
     // Reset all monsters.
     reset_all_monsters();
     init_anon();
+    env.mon_index.reset_high_water();
 
     // ... and Pan/regular spawn lists.
     env.mons_alloc.init(MONS_NO_MONSTER);
@@ -1349,6 +1284,7 @@ void fixup_misplaced_items()
         item.base_type = OBJ_UNASSIGNED;
         item.quantity = 0;
         item.pos.reset();
+        mitm_slot_emptied(item);
     }
 }
 
@@ -1648,86 +1584,74 @@ static bool _fixup_stone_stairs(bool preserve_vault_stairs)
 static bool _add_feat_if_missing(bool (*iswanted)(const coord_def &),
                                  dungeon_feature_type feat)
 {
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
-    for (int y = 0; y < GYM; ++y)
-        for (int x = 0; x < GXM; ++x)
-        {
-            // [ds] Use dgn_square_is_passable instead of
-            // dgn_square_travel_ok here, for we'll otherwise
-            // fail on floorless isolated pocket in vaults (like the
-            // altar surrounded by deep water), and trigger the assert
-            // downstairs.
-            const coord_def gc(x, y);
-            if (!map_bounds(x, y)
-                || travel_point_distance[x][y] // already covered previously
-                || !_dgn_square_is_passable(gc))
-            {
-                continue;
-            }
+    // [ds] Use dgn_square_is_passable instead of
+    // dgn_square_travel_ok here, for we'll otherwise
+    // fail on floorless isolated pocket in vaults (like the
+    // altar surrounded by deep water), and trigger the assert
+    // downstairs.
+    const dgn_zone_map zones(_dgn_square_is_passable);
+    zones.label_travel_distances();
+    for (int zone = 1; zone <= zones.count(); ++zone)
+    {
+        if (zones.any(zone, iswanted))
+            continue;
 
-            if (_dgn_fill_zone(gc, ++nzones, _dgn_point_record_stub,
-                               _dgn_square_is_passable, iswanted))
+        bool found_feature = false;
+        for (rectangle_iterator ri(0); ri; ++ri)
+        {
+            if (grd(*ri) == feat
+                && travel_point_distance[ri->x][ri->y] == zone)
             {
-                continue;
+                found_feature = true;
+                break;
             }
+        }
 
-            bool found_feature = false;
-            for (rectangle_iterator ri(0); ri; ++ri)
-            {
-                if (grd(*ri) == feat
-                    && travel_point_distance[ri->x][ri->y] == nzones)
-                {
-                    found_feature = true;
-                    break;
-                }
-            }
+        if (found_feature)
+            continue;
 
-            if (found_feature)
+        int i = 0;
+        while (i++ < 2000)
+        {
+            coord_def rnd(random2(GXM), random2(GYM));
+            if (grd(rnd) != DNGN_FLOOR)
                 continue;
 
-            int i = 0;
-            while (i++ < 2000)
-            {
-                coord_def rnd(random2(GXM), random2(GYM));
-                if (grd(rnd) != DNGN_FLOOR)
-                    continue;
+            if (travel_point_distance[rnd.x][rnd.y] != zone)
+                continue;
 
-                if (travel_point_distance[rnd.x][rnd.y] != nzones)
-                    continue;
+            _set_grd(rnd, feat);
+            found_feature = true;
+            break;
+        }
 
-                _set_grd(rnd, feat);
-                found_feature = true;
-                break;
-            }
+        if (found_feature)
+            continue;
 
-            if (found_feature)
+        for (rectangle_iterator ri(0); ri; ++ri)
+        {
+            if (grd(*ri) != DNGN_FLOOR)
                 continue;
 
-            for (rectangle_iterator ri(0); ri; ++ri)
-            {
-                if (grd(*ri) != DNGN_FLOOR)
-                    continue;
-
-                if (travel_point_distance[ri->x][ri->y] != nzones)
-                    continue;
+            if (travel_point_distance[ri->x][ri->y] != zone)
+                continue;
 
-                _set_grd(*ri, feat);
-                found_feature = true;
-                break;
-            }
+            _set_grd(*ri, feat);
+            found_feature = true;
+            break;
+        }
 
-            if (found_feature)
-                continue;
+        if (found_feature)
+            continue;
 
 #ifdef DEBUG_DIAGNOSTICS
-            dump_map("debug.map", true, true);
+        dump_map("debug.map", true, true);
 #endif
-            // [ds] Too many normal cases trigger this ASSERT, including
-            // rivers that surround a stair with deep water.
-            // die("Couldn't find region.");
-            return false;
-        }
+        // [ds] Too many normal cases trigger this ASSERT, including
+        // rivers that surround a stair with deep water.
+        // die("Couldn't find region.");
+        return false;
+    }
 
     return true;
 }
@@ -1787,6 +1711,7 @@ static bool _branch_needs_stairs()
 
 static void _dgn_verify_connectivity(unsigned nvaults)
 {
+    MAPSTAT_PHASE(BP_CONNECTIVITY);
     // After placing vaults, make sure parts of the level have not been
     // disconnected.
     if (dgn_zones && nvaults != env.level_vaults.size())
@@ -2230,6 +2155,7 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
     {
         if (place_vaults)
         {
+            MAPSTAT_PHASE(BP_MINIVAULTS);
             // Moved branch entries to place first so there's a good
             // chance of having room for a vault
             _place_branch_entrances(true);
@@ -2239,6 +2165,7 @@ static void _build_dungeon_level(dungeon_feature_type dest_stairs_type)
         }
         else
         {
+            MAPSTAT_PHASE(BP_MINIVAULTS);
             // Place any branch entries vaultlessly
             _place_branch_entrances(false);
             // Still place chance vaults - important things like Abyss,
@@ -2508,6 +2435,7 @@ static bool _pan_level()
 // to place more vaults after this
 static bool _builder_by_type()
 {
+    MAPSTAT_PHASE(BP_LAYOUT);
     if (player_in_branch(BRANCH_LABYRINTH))
     {
         dgn_build_labyrinth_level();
@@ -3390,6 +3318,7 @@ static void _place_extra_vaults()
 // Return the number of uniques placed.
 static int _place_uniques()
 {
+    MAPSTAT_PHASE(BP_MONSTERS);
 #ifdef DEBUG_UNIQUE_PLACEMENT
     FILE *ostat = fopen("unique_placement.log", "a");
     fprintf(ostat, "--- Looking to place uniques on %s\n",
@@ -3602,6 +3531,7 @@ bool door_vetoed(const coord_def pos)
 
 static void _builder_monsters()
 {
+    MAPSTAT_PHASE(BP_MONSTERS);
     if (player_in_branch(BRANCH_TEMPLE))
         return;
 
@@ -3673,6 +3603,7 @@ static void _randomly_place_item(int item)
  */
 static void _builder_items()
 {
+    MAPSTAT_PHASE(BP_ITEMS);
     int i = 0;
     object_class_type specif_type = OBJ_RANDOM;
     int items_levels = env.absdepth0;
@@ -3955,6 +3886,8 @@ static const vault_placement *_build_secondary_vault(const map_def *vault,
 //
 static const vault_placement *_build_primary_vault(const map_def *vault)
 {
+    // Layouts are placed as primary vaults too.
+    MAPSTAT_PHASE(vault->has_tag("layout") ? BP_LAYOUT : BP_PRIMARY_VAULT);
     return _build_vault_impl(vault);
 }
 
@@ -4059,7 +3992,7 @@ static const vault_placement *_build_vault_impl(const map_def *vault,
     if (!build_only && (placed_vault_orientation != MAP_ENCOMPASS || is_layout)
         && player_in_branch(BRANCH_SWAMP))
     {
-        _process_disconnected_zones(0, 0, GXM-1, GYM-1, true, DNGN_TREE);
+        _process_disconnected_zones(true, DNGN_TREE);
     }
 
     if (!make_no_exits)
@@ -4077,10 +4010,13 @@ static const vault_placement *_build_vault_impl(const map_def *vault,
     // Fire any post-place hooks defined for this map; any failure
     // here is an automatic veto. Note that the post-place hook must
     // be run only after _build_postvault_level.
-    if (!place.map.run_postplace_hook())
     {
-        throw dgn_veto_exception("Post-place hook failed for: "
-                                 + place.map.name);
+        MAPSTAT_PHASE(BP_EPILOGUE);
+        if (!place.map.run_postplace_hook())
+        {
+            throw dgn_veto_exception("Post-place hook failed for: "
+                                     + place.map.name);
+        }
     }
 
     return saved_place;
@@ -5016,7 +4952,7 @@ void dgn_replace_area(const coord_def& p1, const coord_def& p2,
         if (grd(*ri) == replace && !map_masked(*ri, mapmask))
         {
             grd(*ri) = feature;
-            if (needs_update && env.map_knowledge(*ri).seen())
+            if (needs_update && env.map_knowledge.get(*ri).seen())
             {
                 env.map_knowledge(*ri).set_feature(feature, 0,
                                                    get_trap_type(*ri));
@@ -6240,20 +6176,7 @@ static bool _fixup_interlevel_connectivity()
     has_down[0] = has_down[1] = has_down[2] = false;
 
     // Find up stairs and down stairs on the current level.
-    memset(travel_point_distance, 0, sizeof(travel_distance_grid_t));
-    int nzones = 0;
-    for (rectangle_iterator ri(0); ri; ++ri)
-    {
-        if (!map_bounds(ri->x, ri->y)
-            || travel_point_distance[ri->x][ri->y]
-            || !dgn_square_travel_ok(*ri))
-        {
-            continue;
-        }
-
-        _dgn_fill_zone(*ri, ++nzones, _dgn_point_record_stub,
-                       dgn_square_travel_ok, nullptr);
-    }
+    dgn_zone_map(dgn_square_travel_ok).label_travel_distances();
 
     int max_region = 0;
     for (rectangle_iterator ri(0); ri; ++ri)
@@ -6840,3 +6763,28 @@ static void _mark_solid_squares()
         if (feat_is_solid(grd(*ri)))
             env.pgrid(*ri) |= FPROP_NO_TELE_INTO;
 }
+
+#ifdef DEBUG_TESTS
+/**
+ * Find the current level's zones as the dungeon builder's connectivity
+ * checks do.
+ *
+ * @param travel        Whether to go by what travel counts as passable,
+ *                      rather than what the builder does.
+ * @param[out] zones    The zone of each cell, or 0.
+ * @param[out] passable Whether each cell is passable.
+ * @return How many zones there are.
+ */
+int dgn_find_zones(bool travel, travel_distance_grid_t &zones,
+                   FixedArray<bool, GXM, GYM> &passable)
+{
+    bool (*const test)(const coord_def &) =
+        travel ? dgn_square_travel_ok : _dgn_square_is_passable;
+    const dgn_zone_map zone_map(test);
+    zone_map.label_travel_distances();
+    memcpy(zones, travel_point_distance, sizeof(zones));
+    for (rectangle_iterator ri(0); ri; ++ri)
+        passable(*ri) = test(*ri);
+    return zone_map.count();
+}
+#endif
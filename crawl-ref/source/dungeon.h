@@ -259,6 +259,10 @@ const vault_placement *dgn_register_place(const vault_placement &place,
 int dgn_count_disconnected_zones(
     bool choose_stairless,
     dungeon_feature_type fill = DNGN_UNSEEN);
+#ifdef DEBUG_TESTS
+int dgn_find_zones(bool travel, travel_distance_grid_t &zones,
+                   FixedArray<bool, GXM, GYM> &passable);
+#endif
 
 void dgn_replace_area(const coord_def& p1, const coord_def& p2,
                       dungeon_feature_type replace,
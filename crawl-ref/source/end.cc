@@ -8,6 +8,9 @@
 #include "end.h"
 
 #include <cerrno>
+#ifndef TARGET_COMPILER_VC
+# include <unistd.h>
+#endif
 
 #include "abyss.h"
 #include "chardump.h"
@@ -15,6 +18,7 @@
 #include "crash.h"
 #include "database.h"
 #include "describe.h"
+#include "dgn-speculate.h"
 #include "dungeon.h"
 #include "hints.h"
 #include "invent.h"
@@ -106,6 +110,11 @@ bool CrawlIsCrashing = false;
 
 NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 {
+    // A helper building a level ahead of time just gives up, leaving the
+    // terminal and the save to the game.
+    if (crawl_state.speculating)
+        _exit(1);
+
     bool need_pause = true;
     disable_other_crashes();
 
@@ -192,6 +201,7 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 static void _delete_files()
 {
     crawl_state.need_save = false;
+    abandon_speculation();
     you.save->unlink();
     delete you.save;
     you.save = 0;
@@ -4,7 +4,9 @@
 #include <set>
 #include <memory> // unique_ptr
 
+#include "cloud-grid.h"
 #include "map_knowledge.h"
+#include "mon-index.h"
 #include "monster.h"
 #include "trap_def.h"
 
@@ -16,8 +18,6 @@ typedef set<string> string_set;
 struct vault_placement;
 typedef vector<unique_ptr<vault_placement>> vault_placement_refv;
 
-typedef FixedArray< map_cell, GXM, GYM > MapKnowledge;
-
 class final_effect;
 struct crawl_environment
 {
@@ -71,7 +71,7 @@ struct crawl_environment
     tile_flavour tile_default;
     vector<string> tile_names;
 
-    map<coord_def, cloud_struct> cloud;
+    cloud_grid cloud;
 
     map<coord_def, shop_struct> shop; // shop list
     map<coord_def, trap_def> trap; // trap list
@@ -117,6 +117,9 @@ struct crawl_environment
     // Mapping mid->mindex until the transition is finished.
     map<mid_t, unsigned short> mid_cache;
 
+    // Occupied slots of mons, rebuilt when the level is loaded.
+    monster_index mon_index;
+
     // Things to happen when the current attack/etc finishes.
     vector<final_effect *> final_effects;
 
@@ -523,7 +523,7 @@ void set_exclude(const coord_def &p, int radius, bool autoexcl, bool vaultexcl,
         {
             // Don't list a monster in the exclusion annotation if the
             // exclusion was triggered by e.g. the flamethrowers' lua check.
-            const map_cell& cell = env.map_knowledge(p);
+            const map_cell& cell = env.map_knowledge.get(p);
             if (cell.monster() != MONS_NO_MONSTER)
             {
                 desc = mons_type_name(cell.monster(), DESC_PLAIN);
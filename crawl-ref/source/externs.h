@@ -604,10 +604,7 @@ public:
 
     bool launched_by(const item_def &launcher) const;
 
-    void clear()
-    {
-        *this = item_def();
-    }
+    void clear();
 
     /**
      * Sets this item as being held by a given monster.
@@ -34,6 +34,7 @@
 #include "coordit.h"
 #include "dactions.h"
 #include "dgn-overview.h"
+#include "dgn-speculate.h"
 #include "directn.h"
 #include "dungeon.h"
 #include "end.h"
@@ -1121,7 +1122,7 @@ static void _make_level(dungeon_feature_type stair_taken,
                              dummy));
 
     _clear_env_map();
-    builder(true, stair_type);
+    speculative_builder(stair_type);
 
     if (!crawl_state.game_is_tutorial()
         && !Options.seed
@@ -1524,12 +1525,37 @@ static void _save_level(const level_id& lid)
         savefn(w);                              \
     } while (false)
 
+// The change generation of its subsystem each chunk was last written at.
+// Cleared on restoring a game, when the chunks come from disk instead.
+static map<string, unsigned int> saved_generations;
+
+// Is the chunk in the save already as it would be written now?
+static bool _chunk_is_clean(const string &chunk, unsigned int generation)
+{
+    const unsigned int *saved = map_find(saved_generations, chunk);
+    return saved && *saved == generation && you.save->has_chunk(chunk);
+}
+
+// Save a chunk only if its subsystem has changed since it was last written,
+// leaving it untouched in the package otherwise.
+#define SAVEFILE_IF_CHANGED(short, long, savefn, generation)     \
+    do                                                           \
+    {                                                            \
+        const unsigned int gen = (generation);                   \
+        if (!_chunk_is_clean(CHUNK(short, long), gen))           \
+        {                                                        \
+            SAVEFILE(short, long, savefn);                       \
+            saved_generations[CHUNK(short, long)] = gen;         \
+        }                                                        \
+    } while (false)
+
 // Stack allocated string's go in separate function, so Valgrind doesn't
 // complain.
 static void _save_game_base()
 {
     /* Stashes */
-    SAVEFILE("st", "stashes", StashTrack.save);
+    SAVEFILE_IF_CHANGED("st", "stashes", StashTrack.save,
+                        StashTrack.generation());
 
 #ifdef CLUA_BINDINGS
     /* lua */
@@ -1537,20 +1563,23 @@ static void _save_game_base()
 #endif
 
     /* kills */
-    SAVEFILE("kil", "kills", you.kills.save);
+    SAVEFILE_IF_CHANGED("kil", "kills", you.kills.save,
+                        you.kills.change_generation());
 
     /* travel cache */
-    SAVEFILE("tc", "travel_cache", travel_cache.save);
+    SAVEFILE_IF_CHANGED("tc", "travel_cache", travel_cache.save,
+                        travel_cache.change_generation());
 
     /* notes */
-    SAVEFILE("nts", "notes", save_notes);
+    SAVEFILE_IF_CHANGED("nts", "notes", save_notes, notes_generation());
 
     /* tutorial/hints mode */
     if (crawl_state.game_is_hints_tutorial())
         SAVEFILE("tut", "tutorial", save_hints);
 
     /* messages */
-    SAVEFILE("msg", "messages", save_messages);
+    SAVEFILE_IF_CHANGED("msg", "messages", save_messages,
+                        messages_generation());
 
     /* tile dolls (empty for ASCII)*/
 #ifdef USE_TILE
@@ -1589,6 +1618,7 @@ static void _save_game_exit()
     tiles.send_exit_reason("saved");
 #endif
 
+    abandon_speculation();
     delete you.save;
     you.save = 0;
 }
@@ -1620,7 +1650,7 @@ void save_game(bool leave_game, const char *farewellmsg)
     if (!leave_game)
     {
         if (!crawl_state.disables[DIS_SAVE_CHECKPOINTS])
-            you.save->commit();
+            you.save->commit(true);
         return;
     }
 
@@ -1843,6 +1873,7 @@ static bool _restore_game(const string& filename)
         return false;
 
     you.save = new package((_get_savefile_directory() + filename).c_str(), true);
+    saved_generations.clear();
 
     if (!_read_char_chunk(you.save))
     {
@@ -2456,3 +2487,44 @@ vector<string> get_title_files()
                 titles.push_back(file);
     return titles;
 }
+
+#ifdef DEBUG_TESTS
+/**
+ * Save the game's own chunks into save as save_game() does, times over,
+ * with a message before every other time so that some change; or, if
+ * rewrite, writing every chunk each time. The generations the chunks were
+ * written at are kept apart from you.save's.
+ *
+ * @return How many times each chunk that can be left alone was.
+ */
+map<string, int> save_game_chunks(package &save, int times, bool rewrite)
+{
+    unwind_var<package *> scratch(you.save, &save);
+    unwind_var<map<string, unsigned int>> generations(saved_generations);
+    saved_generations.clear();
+
+    map<string, int> left_alone;
+    for (int i = 0; i < times; ++i)
+    {
+        if (rewrite)
+            saved_generations.clear();
+        if (i % 2)
+            mprf("Saving chunks, time %d.", i + 1);
+
+        map<string, unsigned int> before;
+        for (const auto &entry : saved_generations)
+            if (save.has_chunk(entry.first))
+                before.insert(entry);
+        _save_game_base();
+        save.commit();
+
+        // A chunk that was rewritten has moved on a generation.
+        for (const auto &entry : saved_generations)
+        {
+            const unsigned int *gen = map_find(before, entry.first);
+            left_alone[entry.first] += gen && *gen == entry.second;
+        }
+    }
+    return left_alone;
+}
+#endif
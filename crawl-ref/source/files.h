@@ -81,6 +81,11 @@ bool restore_game(const string& filename);
 
 bool is_existing_level(const level_id &level);
 
+#ifdef DEBUG_TESTS
+class package;
+map<string, int> save_game_chunks(package &save, int times, bool rewrite);
+#endif
+
 class level_excursion
 {
 protected:
@@ -520,7 +520,7 @@ static bool is_ash_portal(dungeon_feature_type feat)
 static bool _check_portal(coord_def where)
 {
     const dungeon_feature_type feat = grd(where);
-    if (feat != env.map_knowledge(where).feat() && is_ash_portal(feat))
+    if (feat != env.map_knowledge.get(where).feat() && is_ash_portal(feat))
     {
         env.map_knowledge(where).set_feature(feat);
         set_terrain_mapped(where);
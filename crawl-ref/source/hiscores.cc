@@ -2876,6 +2876,7 @@ void mark_milestone(const string &type, const string &milestone,
 
     if (crawl_state.game_is_arena()
         || !crawl_state.need_save
+        || crawl_state.speculating
         // Suppress duplicate milestones on the same turn.
         || (lastturn == you.num_turns
             && lasttype == type
@@ -15,6 +15,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <set>
@@ -879,6 +880,7 @@ void game_options::reset_options()
     use_fake_cursor        = false;
 #endif
     use_fake_player_cursor = true;
+    speculative_levelgen   = false;
     show_player_species    = false;
     explore_stop           = (ES_ITEM | ES_STAIR | ES_PORTAL | ES_BRANCH
                               | ES_SHOP | ES_ALTAR | ES_RUNED_DOOR
@@ -3392,6 +3394,7 @@ void game_options::read_option_line(const string &str, bool runscript)
     }
     else BOOL_OPTION(use_fake_cursor);
     else BOOL_OPTION(use_fake_player_cursor);
+    else BOOL_OPTION(speculative_levelgen);
     else BOOL_OPTION(show_player_species);
     else if (key == "force_more_message" || key == "flash_screen_message")
     {
@@ -4212,6 +4215,8 @@ enum commandline_option_type
     CLO_MAPSTAT,
     CLO_OBJSTAT,
     CLO_ITERATIONS,
+    CLO_WORKERS,
+    CLO_LEVELGEN_BENCH,
     CLO_ARENA,
     CLO_DUMP_MAPS,
     CLO_TEST,
@@ -4249,7 +4254,8 @@ static const char *cmd_ops[] =
 {
     "scores", "name", "species", "background", "dir", "rc",
     "rcdir", "tscores", "vscores", "scorefile", "morgue", "macro",
-    "mapstat", "objstat", "iters", "arena", "dump-maps", "test", "script",
+    "mapstat", "objstat", "iters", "workers",
+    "levelgen-bench", "arena", "dump-maps", "test", "script",
     "builddb", "help", "version", "seed", "save-version", "sprint",
     "extra-opt-first", "extra-opt-last", "sprint-map", "edit-save",
     "print-charset", "tutorial", "wizard", "explore", "no-save",
@@ -4331,6 +4337,7 @@ enum es_command_type
     ES_PUT,
     ES_REPACK,
     ES_INFO,
+    ES_BENCH,
     NUM_ES
 };
 
@@ -4348,8 +4355,78 @@ static struct es_command
     { ES_RM,      "rm",      true,  1, 1, },
     { ES_REPACK,  "repack",  false, 0, 0, },
     { ES_INFO,    "info",    false, 0, 0, },
+    { ES_BENCH,   "bench",   false, 0, 1, },
 };
 
+// Write every chunk of the save into a scratch save with each codec, and
+// with the codecs the game would pick, and report the space they took and
+// how long saving and loading them all took.
+static void _bench_save_codecs(package &save, int iterations)
+{
+    vector<pair<string, vector<char>>> chunks;
+    size_t total = 0;
+    for (const string &name : save.list_chunks())
+    {
+        chunk_reader in(&save, name);
+        chunks.emplace_back(name, vector<char>());
+        in.read_all(chunks.back().second);
+        total += chunks.back().second.size();
+    }
+    printf("%u chunks, %u bytes uncompressed, %d iteration(s)\n",
+           (unsigned int)chunks.size(), (unsigned int)total, iterations);
+    printf("%-8s %10s %6s %10s %10s %9s %9s\n", "codec", "stored", "ratio",
+           "save ms", "load ms", "save MB/s", "load MB/s");
+
+    // One past the codecs is the game's choice for each chunk.
+    for (int c = 0; c <= NUM_CODECS; ++c)
+    {
+        package scratch;
+        double save_seconds = 0, load_seconds = 0;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = chrono::steady_clock::now();
+            for (const auto &chunk : chunks)
+            {
+                chunk_writer out(&scratch, chunk.first,
+                                 c == NUM_CODECS ? codec_for_chunk(chunk.first)
+                                                 : (chunk_codec)c);
+                if (!chunk.second.empty())
+                    out.write(&chunk.second[0], chunk.second.size());
+            }
+            scratch.commit();
+            save_seconds += chrono::duration<double>(
+                                chrono::steady_clock::now() - start).count();
+
+            start = chrono::steady_clock::now();
+            for (const auto &chunk : chunks)
+            {
+                vector<char> data;
+                chunk_reader in(&scratch, chunk.first);
+                in.read_all(data);
+                if (data != chunk.second)
+                {
+                    fprintf(stderr, "Chunk %s came back different!\n",
+                            chunk.first.c_str());
+                }
+            }
+            load_seconds += chrono::duration<double>(
+                                chrono::steady_clock::now() - start).count();
+        }
+
+        plen_t stored = 0;
+        for (const auto &chunk : chunks)
+            stored += scratch.get_chunk_compressed_length(chunk.first);
+        const double mb = total * (double)iterations / (1024 * 1024);
+        printf("%-8s %10u %6.3f %10.2f %10.2f %9.1f %9.1f\n",
+               c == NUM_CODECS ? "by chunk" : codec_name((chunk_codec)c),
+               stored, total ? (double)stored / total : 0,
+               save_seconds * 1000 / iterations,
+               load_seconds * 1000 / iterations,
+               save_seconds > 0 ? mb / save_seconds : 0,
+               load_seconds > 0 ? mb / load_seconds : 0);
+    }
+}
+
 #define FAIL(...) do { fprintf(stderr, __VA_ARGS__); return; } while (0)
 static void _edit_save(int argc, char **argv)
 {
@@ -4362,6 +4439,9 @@ static void _edit_save(int argc, char **argv)
                "     <chunkfile> defaults to \"chunk\"; use \"-\" for stdout/stdin\n"
                "  rm <chunk>                  delete a chunk\n"
                "  repack                      defrag and reclaim unused space\n"
+               "  info                        list the chunks with their sizes\n"
+               "  bench [<iterations>]        time saving and loading the chunks\n"
+               "                              with each compression codec\n"
              );
         return;
     }
@@ -4487,7 +4567,8 @@ static void _edit_save(int argc, char **argv)
             plen_t frag = save.get_chunk_fragmentation("");
             plen_t flen = save.get_size();
             plen_t slack = save.get_slack();
-            printf("Chunks: (size compressed/uncompressed, fragments, name)\n");
+            printf("Chunks: (size compressed/uncompressed, fragments, codec, "
+                   "name)\n");
             for (const string &chunk : list)
             {
                 int cfrag = save.get_chunk_fragmentation(chunk);
@@ -4499,7 +4580,8 @@ static void _edit_save(int argc, char **argv)
                 plen_t clen = 0;
                 while (plen_t s = in.read(buf, sizeof(buf)))
                     clen += s;
-                printf("%7d/%7d %3u %s\n", cclen, clen, cfrag, chunk.c_str());
+                printf("%7d/%7d %3u %-4s %s\n", cclen, clen, cfrag,
+                       codec_name(save.get_chunk_codec(chunk)), chunk.c_str());
             }
             // the directory is not a chunk visible from the outside
             printf("Fragmentation:    %u/%u (%4.2f)\n", frag, nchunks + 1,
@@ -4509,6 +4591,13 @@ static void _edit_save(int argc, char **argv)
             // there's also wasted space due to fragmentation, but since
             // it's linear, there's no need to print it
         }
+        else if (cmd == ES_BENCH)
+        {
+            const int iterations = argc == 3 ? atoi(argv[2]) : 10;
+            if (iterations < 1)
+                FAIL("Invalid number of iterations \"%s\".\n", argv[2]);
+            _bench_save_codecs(save, iterations);
+        }
     }
     catch (ext_fail_exception &fe)
     {
@@ -4684,6 +4773,7 @@ bool parse_args(int argc, char **argv, bool rc_only)
 
     SysEnv.rcdirs.clear();
     SysEnv.map_gen_iters = 0;
+    SysEnv.map_gen_workers = 0;
 
     if (argc < 2)           // no args!
         return true;
@@ -4808,17 +4898,22 @@ bool parse_args(int argc, char **argv, bool rc_only)
 
         case CLO_MAPSTAT:
         case CLO_OBJSTAT:
+        case CLO_LEVELGEN_BENCH:
 #ifdef DEBUG_STATISTICS
-            if (o == CLO_MAPSTAT)
-                crawl_state.map_stat_gen = true;
-            else
+            if (o == CLO_OBJSTAT)
                 crawl_state.obj_stat_gen = true;
+            else
+                crawl_state.map_stat_gen = true;
+            // The benchmark builds levels just as mapstat does, but only
+            // reports how long they took.
+            if (o == CLO_LEVELGEN_BENCH)
+                crawl_state.levelgen_bench = true;
 #ifdef USE_TILE_LOCAL
             crawl_state.tiles_disabled = true;
 #endif
 
             if (!SysEnv.map_gen_iters)
-                SysEnv.map_gen_iters = 100;
+                SysEnv.map_gen_iters = o == CLO_LEVELGEN_BENCH ? 5 : 100;
             if (next_is_param)
             {
                 SysEnv.map_gen_range.reset(new depth_ranges);
@@ -4844,8 +4939,27 @@ bool parse_args(int argc, char **argv, bool rc_only)
                 SysEnv.map_gen_iters = atoi(next_arg);
                 if (SysEnv.map_gen_iters < 1)
                     SysEnv.map_gen_iters = 1;
-                else if (SysEnv.map_gen_iters > 10000)
-                    SysEnv.map_gen_iters = 10000;
+                else if (SysEnv.map_gen_iters > 100000)
+                    SysEnv.map_gen_iters = 100000;
+                nextUsed = true;
+            }
+#else
+            fprintf(stderr, "mapstat and objstat are available only in "
+                    "DEBUG_STATISTICS builds.\n");
+            end(1);
+#endif
+            break;
+
+        case CLO_WORKERS:
+#ifdef DEBUG_STATISTICS
+            if (!next_is_param || !isadigit(*next_arg))
+            {
+                fprintf(stderr, "Integer argument required for -%s\n", arg);
+                end(1);
+            }
+            else
+            {
+                SysEnv.map_gen_workers = max(1, atoi(next_arg));
                 nextUsed = true;
             }
 #else
@@ -57,6 +57,7 @@ public:
     vector<string> cmd_args;
 
     int map_gen_iters;
+    int map_gen_workers;           // Processes to share the iterations.
     unique_ptr<depth_ranges> map_gen_range;
 
     vector<string> extra_opts_first;
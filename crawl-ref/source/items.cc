@@ -411,6 +411,81 @@ void init_item(int item)
     mitm[item].clear();
 }
 
+// Slots of mitm that might be free. This is a superset of the undefined
+// items: item_def::clear() and mitm_slot_emptied() mark the slot, and
+// get_mitm_slot() unmarks any it finds to be in use again.
+static uint64_t _mitm_maybe_free[(MAX_ITEMS + 63) / 64];
+// One past the highest slot handed out since the level was reset or loaded.
+static int _mitm_high_water = 0;
+
+static void _mark_mitm_slot(int item, bool maybe_free)
+{
+    const uint64_t bit = 1ULL << (item & 63);
+    if (maybe_free)
+        _mitm_maybe_free[item >> 6] |= bit;
+    else
+        _mitm_maybe_free[item >> 6] &= ~bit;
+}
+
+static void _rescan_mitm_slots()
+{
+    for (int i = 0; i < MAX_ITEMS; ++i)
+        _mark_mitm_slot(i, !mitm[i].defined());
+}
+
+/**
+ * Resynchronise the free item slots with mitm, and start a new high-water
+ * mark. Called once the items of a level have been reset or loaded.
+ */
+void reset_mitm_slots()
+{
+    _rescan_mitm_slots();
+
+    _mitm_high_water = 0;
+    for (int i = MAX_ITEMS - 1; i >= 0; --i)
+        if (mitm[i].defined())
+        {
+            _mitm_high_water = i + 1;
+            break;
+        }
+}
+
+int mitm_slot_high_water()
+{
+    return _mitm_high_water;
+}
+
+/**
+ * Note that an item has been emptied other than by item_def::clear(), so
+ * that its slot can be handed out again if it's in mitm.
+ */
+void mitm_slot_emptied(const item_def &item)
+{
+    if (&item >= mitm.buffer() && &item < mitm.buffer() + MAX_ITEMS)
+        _mark_mitm_slot(&item - mitm.buffer(), true);
+}
+
+// The lowest free slot below limit, or NON_ITEM if there is none.
+static int _find_free_mitm_slot(int limit)
+{
+    for (int w = 0; w * 64 < limit; ++w)
+    {
+        uint64_t word = _mitm_maybe_free[w];
+        while (word)
+        {
+            const int item = w * 64 + lowest_bit(word);
+            if (item >= limit)
+                return NON_ITEM;
+            if (!mitm[item].defined())
+                return item;
+
+            word &= word - 1;
+            _mark_mitm_slot(item, false);
+        }
+    }
+    return NON_ITEM;
+}
+
 // Returns an unused mitm slot, or NON_ITEM if none available.
 // The reserve is the number of item slots to not check.
 // Items may be culled if a reserve <= 10 is specified.
@@ -421,13 +496,28 @@ int get_mitm_slot(int reserve)
     if (crawl_state.game_is_arena())
         reserve = 0;
 
-    int item = NON_ITEM;
+    int item = _find_free_mitm_slot(MAX_ITEMS - reserve);
 
-    for (item = 0; item < (MAX_ITEMS - reserve); item++)
-        if (!mitm[item].defined())
+#ifdef DEBUG_ITEM_SCAN
+    for (int i = 0; i < (item == NON_ITEM ? MAX_ITEMS - reserve : item); ++i)
+        if (!mitm[i].defined())
+        {
+            mprf(MSGCH_ERROR, "Item slot %d was emptied without being "
+                              "marked free.", i);
+            item = NON_ITEM;
             break;
+        }
+#endif
 
-    if (item >= MAX_ITEMS - reserve)
+    // Should anything have emptied an item without saying so, look for it
+    // before resorting to culling.
+    if (item == NON_ITEM)
+    {
+        _rescan_mitm_slots();
+        item = _find_free_mitm_slot(MAX_ITEMS - reserve);
+    }
+
+    if (item == NON_ITEM)
     {
         if (crawl_state.game_is_arena())
         {
@@ -447,6 +537,7 @@ int get_mitm_slot(int reserve)
     ASSERT(item != NON_ITEM);
 
     init_item(item);
+    _mitm_high_water = max(_mitm_high_water, item + 1);
 
     return item;
 }
@@ -544,6 +635,7 @@ void unlink_item(int dest)
     mitm[dest].link      = NON_ITEM;
     mitm[dest].pos.reset();
     mitm[dest].props.clear();
+    mitm_slot_emptied(mitm[dest]);
 
     // Look through all items for links to this item.
     for (auto &item : mitm)
@@ -3272,6 +3364,14 @@ bool item_def::defined() const
 {
     return base_type != OBJ_UNASSIGNED && quantity > 0;
 }
+
+void item_def::clear()
+{
+    *this = item_def();
+
+    // Clearing a floor item frees its slot.
+    mitm_slot_emptied(*this);
+}
 /**
  * Has this item's appearance been initialized?
  */
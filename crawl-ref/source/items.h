@@ -64,6 +64,9 @@ void link_items();
 void fix_item_coordinates();
 
 int get_mitm_slot(int reserve = 50);
+void reset_mitm_slots();
+int mitm_slot_high_water();
+void mitm_slot_emptied(const item_def &item);
 
 void unlink_item(int dest);
 void destroy_item(item_def &item, bool never_created = false);
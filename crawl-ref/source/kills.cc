@@ -72,6 +72,7 @@ void KillMaster::save(writer& outf) const
 
 void KillMaster::load(reader& inf)
 {
+    ++generation;
     int major = unmarshallByte(inf),
         minor = unmarshallByte(inf);
     if (major != KILLS_MAJOR_VERSION
@@ -95,6 +96,7 @@ void KillMaster::record_kill(const monster* mon, int killer, bool ispet)
         ispet            ? KC_FRIENDLY :
                            KC_OTHER;
     categorized_kills[kc].record_kill(mon);
+    ++generation;
 }
 
 int KillMaster::total_kills() const
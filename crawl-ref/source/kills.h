@@ -158,6 +158,8 @@ private:
 class KillMaster
 {
 public:
+    KillMaster() : generation(0) { }
+
     void record_kill(const monster* mon, int killer, bool ispet);
 
     bool empty() const;
@@ -174,10 +176,14 @@ public:
     int total_kills() const;
 
     string kill_info() const;
+
+    // Bumped by every kill recorded, and on load.
+    unsigned int change_generation() const { return generation; }
 private:
     const char *category_name(kill_category kc) const;
 
     Kills categorized_kills[KC_NCATEGORIES];
+    unsigned int generation;
 private:
     void add_kill_info(string &, vector<kill_exp> &,
                        int count, const char *c, bool separator) const;
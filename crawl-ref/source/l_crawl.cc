@@ -688,14 +688,8 @@ LUARET1(crawl_div_rand_round, number, div_rand_round(luaL_checkint(ls, 1),
 LUARET1(crawl_random_real, number, random_real())
 LUARET1(crawl_weapon_check, boolean, wielded_weapon_check(you.weapon()))
 
-// Get the full worley noise datum for a given point
-static int crawl_worley(lua_State *ls)
+static void _push_worley(lua_State *ls, const worley::noise_datum &n)
 {
-    double px = lua_tonumber(ls,1);
-    double py = lua_tonumber(ls,2);
-    double pz = lua_tonumber(ls,3);
-
-    worley::noise_datum n = worley::noise(px,py,pz);
     lua_pushnumber(ls, n.distance[0]);
     lua_pushnumber(ls, n.distance[1]);
     lua_pushnumber(ls, n.id[0]);
@@ -706,6 +700,50 @@ static int crawl_worley(lua_State *ls)
     lua_pushnumber(ls, n.pos[1][0]);
     lua_pushnumber(ls, n.pos[1][1]);
     lua_pushnumber(ls, n.pos[1][2]);
+}
+
+// Get the full worley noise datum for a given point; or, given tables of x
+// and y, a table of the data for each of those points, found together.
+static int crawl_worley(lua_State *ls)
+{
+    double pz = lua_tonumber(ls,3);
+
+    if (lua_istable(ls, 1))
+    {
+        luaL_checktype(ls, 2, LUA_TTABLE);
+        const int n = lua_objlen(ls, 1);
+        if ((int)lua_objlen(ls, 2) != n)
+            luaL_argerror(ls, 2, "Need as many y as x.");
+        vector<double> xs(n), ys(n);
+        for (int i = 0; i < n; ++i)
+        {
+            lua_rawgeti(ls, 1, i + 1);
+            xs[i] = lua_tonumber(ls, -1);
+            lua_rawgeti(ls, 2, i + 1);
+            ys[i] = lua_tonumber(ls, -1);
+            lua_pop(ls, 2);
+        }
+        vector<worley::noise_datum> data(n);
+        if (n)
+            worley::noise(&xs[0], &ys[0], pz, n, &data[0]);
+
+        lua_newtable(ls);
+        for (int i = 0; i < n; ++i)
+        {
+            lua_newtable(ls);
+            _push_worley(ls, data[i]);
+            for (int f = 10; f > 0; --f)
+                lua_rawseti(ls, -1 - f, f);
+            lua_rawseti(ls, -2, i + 1);
+        }
+        return 1;
+    }
+
+    double px = lua_tonumber(ls,1);
+    double py = lua_tonumber(ls,2);
+
+    worley::noise_datum n = worley::noise(px,py,pz);
+    _push_worley(ls, n);
     return 10;
 }
 
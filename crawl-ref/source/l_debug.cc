@@ -12,22 +12,41 @@
 #include "chardump.h"
 #include "cluautil.h"
 #include "coordit.h"
+#include "dgn-speculate.h"
 #include "dungeon.h"
+#include "errors.h"
 #include "files.h"
 #include "godwrath.h"
 #include "los.h"
+#include "maps.h"
 #include "message.h"
 #include "mon-act.h"
 #include "mon-death.h"
 #include "mon-poly.h"
+#include "package.h"
+#include "random.h"
 #include "religion.h"
+#include "shout.h"
 #include "stairs.h"
 #include "state.h"
 #include "stringutil.h"
+#include "syscalls.h"
+#include "tags.h"
 #include "tileview.h"
 #include "view.h"
 #include "wiz-dgn.h"
 
+#ifdef DEBUG_TESTS
+// A forked game can't share a tiles display.
+# if defined(UNIX) && !defined(USE_TILE)
+#  define CAN_FORK_GAME
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+# endif
+#endif
+
 // WARNING: This is a very low-level call.
 //
 // Usage: goto_place("placename", <bind_entrance>)
@@ -117,6 +136,456 @@ LUAFN(debug_los_changed)
     return 0;
 }
 
+#ifdef DEBUG_TESTS
+// Usage: propagate_noise(x1, y1, loudness1, x2, y2, loudness2, ...)
+// Propagates these noises as apply_noises() does, without telling anyone.
+// Returns a table of the cells that heard a noise, in the order they did,
+// each as { x, y, intensity in millis, noise index, distance travelled }.
+LUAFN(debug_propagate_noise)
+{
+    noise_grid grid;
+    vector<noise_heard> heard;
+    grid.heard = &heard;
+    for (int arg = 1; lua_gettop(ls) >= arg + 2; arg += 3)
+    {
+        const coord_def p(luaL_checkint(ls, arg), luaL_checkint(ls, arg + 1));
+        if (!in_bounds(p))
+            luaL_argerror(ls, arg, "Point isn't in bounds.");
+        grid.register_noise(
+            noise_t(p, "", (luaL_checkint(ls, arg + 2) + 1) * 1000));
+    }
+    grid.propagate_noise();
+
+    lua_newtable(ls);
+    for (size_t i = 0; i < heard.size(); ++i)
+    {
+        const int fields[] =
+        {
+            heard[i].pos.x, heard[i].pos.y, heard[i].noise_intensity_millis,
+            heard[i].noise_id, heard[i].noise_travel_distance
+        };
+        lua_newtable(ls);
+        for (size_t f = 0; f < ARRAYSZ(fields); ++f)
+        {
+            lua_pushnumber(ls, fields[f]);
+            lua_rawseti(ls, -2, f + 1);
+        }
+        lua_rawseti(ls, -2, i + 1);
+    }
+    return 1;
+}
+
+// Usage: eligible_maps(place, pick, scan)
+// Returns the names of the maps a pick for place would choose among, in the
+// order it would consider them, found through the map index or, if scan, by
+// looking at every map. pick is a table: its "by" is "place", "depth",
+// "chance" or "tag"; "mini" and "extra" (true, false, or nil for either)
+// qualify all but tag picks; "tag" and "check_depth" qualify tag picks.
+LUAFN(debug_eligible_maps)
+{
+    map_pick pick;
+    pick.place = dlua_level_id(ls, 1);
+    luaL_checktype(ls, 2, LUA_TTABLE);
+
+    lua_getfield(ls, 2, "by");
+    const string by = luaL_checkstring(ls, -1);
+    if (by == "place")
+        pick.by = map_pick::PLACE;
+    else if (by == "depth")
+        pick.by = map_pick::DEPTH;
+    else if (by == "chance")
+        pick.by = map_pick::CHANCE;
+    else if (by == "tag")
+        pick.by = map_pick::TAG;
+    else
+        luaL_argerror(ls, 2, ("No way to pick maps by " + by).c_str());
+
+    lua_getfield(ls, 2, "mini");
+    pick.mini = lua_toboolean(ls, -1);
+    lua_getfield(ls, 2, "extra");
+    pick.extra = lua_isnil(ls, -1)       ? MB_MAYBE :
+                 lua_toboolean(ls, -1) ? MB_TRUE
+                                       : MB_FALSE;
+    lua_getfield(ls, 2, "tag");
+    pick.tag = lua_isstring(ls, -1) ? lua_tostring(ls, -1) : "";
+    lua_getfield(ls, 2, "check_depth");
+    pick.check_depth = lua_toboolean(ls, -1);
+
+    return clua_stringtable(ls, eligible_map_names(pick, lua_toboolean(ls, 3)));
+}
+
+// Usage: map_tags()
+// Returns every tag in the map index.
+LUAFN(debug_map_tags)
+{
+    return clua_stringtable(ls, map_index_tags());
+}
+
+// Usage: find_zones(travel)
+// Finds the current level's zones as the dungeon builder's connectivity
+// checks do, going by what travel counts as passable if travel, else by
+// what the builder does. Returns how many zones there are, the zone of each
+// cell (0 for none) and whether each cell is passable, both indexed [x][y].
+LUAFN(debug_find_zones)
+{
+    travel_distance_grid_t zones;
+    FixedArray<bool, GXM, GYM> passable;
+    const int nzones = dgn_find_zones(lua_toboolean(ls, 1), zones, passable);
+
+    lua_pushnumber(ls, nzones);
+    lua_newtable(ls);
+    lua_newtable(ls);
+    for (int x = 0; x < GXM; ++x)
+    {
+        lua_newtable(ls);
+        lua_newtable(ls);
+        for (int y = 0; y < GYM; ++y)
+        {
+            lua_pushnumber(ls, zones[x][y]);
+            lua_rawseti(ls, -3, y);
+            lua_pushboolean(ls, passable[x][y]);
+            lua_rawseti(ls, -2, y);
+        }
+        lua_rawseti(ls, -3, x);
+        lua_rawseti(ls, -3, x);
+    }
+    return 3;
+}
+
+// Usage: level_data()
+// Returns the current level as it's written to a save, before compression.
+LUAFN(debug_level_data)
+{
+    vector<unsigned char> level;
+    writer outf(&level);
+    tag_write(TAG_LEVEL, outf);
+    lua_pushlstring(ls, (const char *)level.data(), level.size());
+    return 1;
+}
+
+// Push the whole of a chunk of save, as a string.
+static void _push_chunk(lua_State *ls, package &save, const string &name)
+{
+    vector<char> data;
+    chunk_reader in(&save, name);
+    in.read_all(data);
+    lua_pushlstring(ls, data.data(), data.size());
+}
+
+// Usage: codec_round_trip(codec, data)
+// Writes data, in uneven pieces so that some straddle blocks, into a chunk
+// of a scratch save through codec ("zlib" or "lz4"), and commits it. Then
+// opens the save read-only, so mapped as saves are, and reads the chunk
+// back. Returns the codec it was saved with, what it read back as all at
+// once, and what it read back as through a reader, which takes it in place
+// where it can; or nil and why, if that failed.
+LUAFN(debug_codec_round_trip)
+{
+    const string want = luaL_checkstring(ls, 1);
+    size_t len;
+    const char *data = luaL_checklstring(ls, 2, &len);
+    int codec = 0;
+    while (codec < NUM_CODECS
+           && want != codec_name(static_cast<chunk_codec>(codec)))
+    {
+        ++codec;
+    }
+    if (codec == NUM_CODECS)
+        luaL_argerror(ls, 1, ("No such codec: " + want).c_str());
+
+    const string filename = get_savedir_filename("codec-test");
+    {
+        package save(filename.c_str(), true, true);
+        chunk_writer out(&save, "data", static_cast<chunk_codec>(codec));
+        for (size_t at = 0, piece = 1; at < len;
+             at += piece, piece = piece * 7 % 10007)
+        {
+            out.write(data + at, min(piece, len - at));
+        }
+        save.commit();
+    }
+
+    int results;
+    {
+        package save(filename.c_str(), false);
+        lua_pushstring(ls, codec_name(save.get_chunk_codec("data")));
+        _push_chunk(ls, save, "data");
+
+        vector<char> viewed(len);
+        try
+        {
+            reader inf(&save, "data");
+            inf.set_safe_read(true);
+            inf.read(viewed.data(), viewed.size());
+            inf.fail_if_not_eof("data");
+            lua_pushlstring(ls, viewed.data(), viewed.size());
+            results = 3;
+        }
+        catch (short_read_exception &E)
+        {
+            lua_pushnil(ls);
+            lua_pushstring(ls, "it read back short");
+            results = 4;
+        }
+        catch (ext_fail_exception &fe)
+        {
+            lua_pushnil(ls);
+            lua_pushstring(ls, fe.what());
+            results = 4;
+        }
+    }
+    unlink_u(filename.c_str());
+    return results;
+}
+
+// Write the chunks in a table of name to contents, or to false to delete
+// the chunk, at index ndx into save.
+static void _write_chunks(lua_State *ls, int ndx, package &save)
+{
+    luaL_checktype(ls, ndx, LUA_TTABLE);
+    lua_pushnil(ls);
+    while (lua_next(ls, ndx))
+    {
+        const string name = luaL_checkstring(ls, -2);
+        if (!lua_toboolean(ls, -1))
+            save.delete_chunk(name);
+        else
+        {
+            size_t len;
+            const char *data = luaL_checklstring(ls, -1, &len);
+            chunk_writer out(&save, name);
+            out.write(data, len);
+        }
+        lua_pop(ls, 1);
+    }
+}
+
+// Usage: save_chunks(times, rewrite)
+// Saves the game's own chunks times over into a scratch save, leaving the
+// unchanged ones alone as save_game() does, unless rewrite; then once into
+// a fresh save. Returns how many times each chunk that can be left alone
+// was, then the chunks of the scratch save and of the fresh one, all as
+// tables by chunk name.
+LUAFN(debug_save_chunks)
+{
+    const int times = luaL_checkint(ls, 1);
+    const bool rewrite = lua_toboolean(ls, 2);
+    const string names[] = { get_savedir_filename("chunks-test"),
+                             get_savedir_filename("chunks-fresh") };
+
+    for (int fresh = 0; fresh < 2; ++fresh)
+    {
+        package save(names[fresh].c_str(), true, true);
+        const map<string, int> left_alone =
+            save_game_chunks(save, fresh ? 1 : times, fresh || rewrite);
+        if (!fresh)
+        {
+            lua_newtable(ls);
+            for (const auto &entry : left_alone)
+            {
+                lua_pushnumber(ls, entry.second);
+                lua_setfield(ls, -2, entry.first.c_str());
+            }
+        }
+
+        lua_newtable(ls);
+        for (const string &name : save.list_chunks())
+        {
+            _push_chunk(ls, save, name);
+            lua_setfield(ls, -2, name.c_str());
+        }
+    }
+    for (const string &name : names)
+        unlink_u(name.c_str());
+    return 3;
+}
+
+// Usage: crash_commit(fault, async, first, second, third)
+// Writes first into a scratch save and commits it; then writes second and
+// commits that, in the background if async, crashing at fault ("before
+// sync", "before header", "after header", or nil for no crash). If the save
+// is still open, as it is after a commit in the background or one that
+// didn't crash, then writes third, and commits it unless there was a crash.
+// Each of first, second and third is a table of chunk name to contents, or
+// to false to delete the chunk. Returns the chunks of the save as it is
+// opened again, as a table of name to contents; or nil and why, if it won't
+// open.
+LUAFN(debug_crash_commit)
+{
+    commit_fault fault = COMMIT_FAULT_NONE;
+    if (!lua_isnil(ls, 1))
+    {
+        const string at = luaL_checkstring(ls, 1);
+        if (at == "before sync")
+            fault = COMMIT_FAULT_BEFORE_SYNC;
+        else if (at == "before header")
+            fault = COMMIT_FAULT_BEFORE_HEADER;
+        else if (at == "after header")
+            fault = COMMIT_FAULT_AFTER_HEADER;
+        else
+            luaL_argerror(ls, 1, ("No way to crash " + at).c_str());
+    }
+    const bool async = lua_toboolean(ls, 2);
+
+    const string filename = get_savedir_filename("commit-test");
+    {
+        package save(filename.c_str(), true, true);
+        _write_chunks(ls, 3, save);
+        save.commit();
+        _write_chunks(ls, 4, save);
+        save.inject_commit_fault(fault);
+        save.commit(async);
+        if (async || fault == COMMIT_FAULT_NONE)
+            _write_chunks(ls, 5, save);
+        // Any crash ends it here; otherwise, this is committed.
+        if (fault != COMMIT_FAULT_NONE)
+            save.abort();
+    }
+
+    int results = 1;
+    try
+    {
+        // Opened writeable to trace all the chunks' blocks, which finds any
+        // that overlap.
+        package save(filename.c_str(), true);
+        lua_newtable(ls);
+        for (const string &name : save.list_chunks())
+        {
+            _push_chunk(ls, save, name);
+            lua_setfield(ls, -2, name.c_str());
+        }
+    }
+    catch (ext_fail_exception &fe)
+    {
+        lua_pushnil(ls);
+        lua_pushstring(ls, fe.what());
+        results = 2;
+    }
+    unlink_u(filename.c_str());
+    return results;
+}
+#endif
+
+#ifdef DEBUG_TESTS
+// Usage: forked(fn)
+// Calls fn in a forked copy of the game, thrown away afterwards, so that fn
+// can do what it likes to the game. Returns the string fn returns; nil if
+// fn failed; or nothing, if games can't be forked here.
+LUAFN(debug_forked)
+{
+    luaL_checktype(ls, 1, LUA_TFUNCTION);
+#ifdef CAN_FORK_GAME
+    int fds[2];
+    if (pipe(fds) < 0)
+        return 0;
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+
+    if (!pid)
+    {
+        close(fds[0]);
+        // Keep off the terminal.
+        const int null = open("/dev/null", O_RDWR);
+        if (null >= 0)
+        {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+
+        lua_pushvalue(ls, 1);
+        if (lua_pcall(ls, 0, 1, 0) || !lua_isstring(ls, -1))
+            _exit(1);
+        size_t len;
+        const char *out = lua_tolstring(ls, -1, &len);
+        while (len)
+        {
+            const ssize_t put = write(fds[1], out, len);
+            if (put < 0 && errno == EINTR)
+                continue;
+            if (put <= 0)
+                _exit(1);
+            out += put;
+            len -= put;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string sent;
+    char buf[65536];
+    ssize_t got;
+    while ((got = read(fds[0], buf, sizeof(buf))) != 0)
+    {
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0)
+            break;
+        sent.append(buf, got);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    if (WIFEXITED(status) && !WEXITSTATUS(status))
+        lua_pushlstring(ls, sent.data(), sent.size());
+    else
+        lua_pushnil(ls);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+// Usage: seeded_game(seed)
+// Starts this game afresh on D:1 from seed, in a save kept in memory. Only
+// for games debug.forked() will throw away.
+LUAFN(debug_seeded_game)
+{
+    seed_rng(static_cast<uint32_t>(luaL_checkint(ls, 1)));
+    you.save = new package();
+    init_level_connectivity();
+    you.where_are_you = BRANCH_DUNGEON;
+    you.depth = 1;
+    load_level(DNGN_STONE_STAIRS_DOWN_I, LOAD_START_GAME, level_id());
+    return 0;
+}
+
+// Usage: speculate()
+// Builds the level below the stairs underfoot ahead of time, as the game
+// does while waiting for a command, and waits for it to be built.
+LUAFN(debug_speculate)
+{
+    unwind_bool speculating(Options.speculative_levelgen, true);
+    speculate_level_below();
+    finish_speculation();
+    return 0;
+}
+
+// Usage: levels_adopted()
+// Returns how many levels built ahead of time have been taken this game.
+LUAFN(debug_levels_adopted)
+{
+    lua_pushnumber(ls, speculative_levels_adopted());
+    return 1;
+}
+
+// Usage: rng_state()
+// Returns the state of every random number generator, as a string.
+LUAFN(debug_rng_state)
+{
+    const string state = rng_state();
+    lua_pushlstring(ls, state.data(), state.size());
+    return 1;
+}
+#endif
+
 LUAFN(debug_dump_map)
 {
     const int pos = lua_isuserdata(ls, 1) ? 2 : 1;
@@ -133,6 +602,21 @@ LUAFN(_debug_test_explore)
     return 0;
 }
 
+// Usage: send_map(<whole_snapshot>)
+// Sends the map to webtiles clients, as a redraw would, and returns the size
+// of the message. If whole_snapshot is true, all of the map is copied for
+// diffing against afterwards, as it was before map knowledge kept a journal
+// of its changes. Returns nothing in builds without webtiles.
+LUAFN(debug_send_map)
+{
+#if defined(USE_TILE_WEB) && defined(WIZARD)
+    lua_pushnumber(ls, tiles.bench_send_map(lua_toboolean(ls, 1)));
+    return 1;
+#else
+    return 0;
+#endif
+}
+
 LUAFN(debug_bouncy_beam)
 {
     coord_def source;
@@ -377,7 +861,23 @@ const struct luaL_reg debug_dlib[] =
 { "reveal_mimics", debug_reveal_mimics },
 { "los_changed", debug_los_changed },
 { "dump_map", debug_dump_map },
+#ifdef DEBUG_TESTS
+{ "forked", debug_forked },
+{ "seeded_game", debug_seeded_game },
+{ "speculate", debug_speculate },
+{ "levels_adopted", debug_levels_adopted },
+{ "rng_state", debug_rng_state },
+{ "propagate_noise", debug_propagate_noise },
+{ "save_chunks", debug_save_chunks },
+{ "eligible_maps", debug_eligible_maps },
+{ "map_tags", debug_map_tags },
+{ "find_zones", debug_find_zones },
+{ "level_data", debug_level_data },
+{ "codec_round_trip", debug_codec_round_trip },
+{ "crash_commit", debug_crash_commit },
+#endif
 { "test_explore", _debug_test_explore },
+{ "send_map", debug_send_map },
 { "bouncy_beam", debug_bouncy_beam },
 { "cull_monsters", debug_cull_monsters},
 { "dismiss_adjacent", debug_dismiss_adjacent},
@@ -94,6 +94,8 @@ static int dgn_default_depth(lua_State *ls)
 static int dgn_depth(lua_State *ls)
 {
     MAP(ls, 1, map);
+    if (lua_gettop(ls) > 1)
+        note_map_changed(*map);
     return dgn_depth_proc(ls, map->depths, 2);
 }
 
@@ -102,6 +104,7 @@ static int dgn_place(lua_State *ls)
     MAP(ls, 1, map);
     if (lua_gettop(ls) > 1)
     {
+        note_map_changed(*map);
         if (lua_isnil(ls, 2))
             map->place.clear();
         else
@@ -144,6 +147,7 @@ static int dgn_tags(lua_State *ls)
     MAP(ls, 1, map);
     if (lua_gettop(ls) > 1)
     {
+        note_map_changed(*map);
         if (lua_isnil(ls, 2))
             map->tags.clear();
         else
@@ -166,6 +170,8 @@ static int dgn_tags_remove(lua_State *ls)
     MAP(ls, 1, map);
 
     const int top = lua_gettop(ls);
+    if (top > 1)
+        note_map_changed(*map);
     for (int i = 2; i <= top; ++i)
     {
         const string axee = luaL_checkstring(ls, i);
@@ -7,7 +7,9 @@
 
 #include "l_libs.h"
 
+#include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <vector>
 
 #include "cluautil.h"
@@ -2250,6 +2252,351 @@ LUAFN(dgn_farthest_from)
     return 2;
 }
 
+// Set every glyph in the box that is in mask (or, with invert, isn't) to
+// fill. Returns the number of glyphs set.
+LUAFN(dgn_fill_masked)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_STR(ls, mask, ".");
+    TABLE_CHAR(ls, fill, 'x');
+    TABLE_BOOL(ls, invert, false);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+
+    int count = 0;
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+            if ((strchr(mask, lines(x, y)) != nullptr) != invert)
+            {
+                lines(x, y) = fill;
+                ++count;
+            }
+
+    PLUARET(number, count);
+}
+
+// Run a cellular automaton over the wall and floor glyphs in the box. Each
+// step, a floor glyph with at least birth neighbours in solid (by default
+// just the wall glyph; cells off the map count too) becomes a wall, and a
+// wall glyph with fewer than survive such neighbours becomes floor. Other
+// glyphs are left as they are.
+LUAFN(dgn_cellular_step)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_CHAR(ls, wall, 'x');
+    TABLE_CHAR(ls, floor, '.');
+    TABLE_STR(ls, solid, nullptr);
+    TABLE_INT(ls, birth, 5);
+    TABLE_INT(ls, survive, 4);
+    TABLE_INT(ls, iterations, 1);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+
+    const string solids = solid ? solid : string(1, wall);
+    const int width = x2 - x1 + 1;
+    vector<char> next(width * (y2 - y1 + 1));
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (int y = y1; y <= y2; ++y)
+            for (int x = x1; x <= x2; ++x)
+            {
+                const char glyph = lines(x, y);
+                char &result = next[(y - y1) * width + x - x1];
+                result = glyph;
+                if (glyph != wall && glyph != floor)
+                    continue;
+
+                int walls = 0;
+                for (adjacent_iterator ai(coord_def(x, y)); ai; ++ai)
+                    if (!lines.in_map(*ai)
+                        || solids.find(lines(*ai)) != string::npos)
+                        ++walls;
+
+                if (glyph == floor && walls >= birth)
+                    result = wall;
+                else if (glyph == wall && walls < survive)
+                    result = floor;
+            }
+
+        for (int y = y1; y <= y2; ++y)
+            for (int x = x1; x <= x2; ++x)
+                lines(x, y) = next[(y - y1) * width + x - x1];
+    }
+
+    return 0;
+}
+
+// The distance in moves from the nearest glyph in from to each passable
+// glyph in the box that can be reached, as a table indexed like mapgrd,
+// along with the greatest distance (or -1 if there is no glyph in from).
+LUAFN(dgn_distance_map)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_STR(ls, from, "@");
+    TABLE_STR(ls, passable, traversable_glyphs);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+
+    ASSERT(lines.width() <= GXM);
+    ASSERT(lines.height() <= GYM);
+    FixedArray<int, GXM, GYM> dist;
+    dist.init(-1);
+    vector<coord_def> queue;
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+            if (strchr(from, lines(x, y)))
+            {
+                dist(coord_def(x, y)) = 0;
+                queue.emplace_back(x, y);
+            }
+
+    int farthest = queue.empty() ? -1 : 0;
+    for (unsigned int i = 0; i < queue.size(); ++i)
+    {
+        const coord_def c = queue[i];
+        for (adjacent_iterator ai(c); ai; ++ai)
+        {
+            if (ai->x < x1 || ai->x > x2 || ai->y < y1 || ai->y > y2
+                || dist(*ai) >= 0 || !strchr(passable, lines(*ai)))
+            {
+                continue;
+            }
+            dist(*ai) = dist(c) + 1;
+            farthest = dist(*ai);
+            queue.push_back(*ai);
+        }
+    }
+
+    lua_newtable(ls);
+    for (int x = x1; x <= x2; ++x)
+    {
+        lua_newtable(ls);
+        for (int y = y1; y <= y2; ++y)
+            if (dist(coord_def(x, y)) >= 0)
+            {
+                lua_pushnumber(ls, dist(coord_def(x, y)));
+                lua_rawseti(ls, -2, y);
+            }
+        lua_rawseti(ls, -2, x);
+    }
+    lua_pushnumber(ls, farthest);
+    return 2;
+}
+
+// The directions zonify.walk() tries, in its order.
+static const coord_def _zonify_directions[8] =
+{
+    coord_def(0, -1), coord_def(-1, 0), coord_def(0, 1), coord_def(1, 0),
+    coord_def(-1, -1), coord_def(-1, 1), coord_def(1, 1), coord_def(1, -1),
+};
+
+struct glyph_zone
+{
+    bool wall;
+    vector<coord_def> cells;
+    // Cells of the other kind next to this zone, in the order they were
+    // come across; some may be listed more than once.
+    vector<coord_def> borders;
+};
+
+// The 8-connected zones of wall and non-wall glyphs in the box, in the
+// order zonify.map() would find them walking from the top left corner: the
+// cells of a zone depth first, in the order of _zonify_directions, then
+// each new zone next to it before any other.
+static vector<glyph_zone> _glyph_zones(const map_lines &lines,
+                                       const coord_def &tl,
+                                       const coord_def &br,
+                                       const char *wall)
+{
+    ASSERT(lines.width() <= GXM);
+    ASSERT(lines.height() <= GYM);
+    FixedArray<bool, GXM, GYM> seen;
+    seen.init(false);
+
+    auto walkable = [&](const coord_def &c)
+    {
+        return c.x >= tl.x && c.x <= br.x && c.y >= tl.y && c.y <= br.y
+               && !seen(c);
+    };
+    auto is_wall = [&](const coord_def &c)
+    {
+        return strchr(wall, lines(c)) != nullptr;
+    };
+
+    vector<glyph_zone> zones;
+    // The cells of the zone being found, and the next direction to try
+    // from each; and the zones whose borders are being walked, and the
+    // next border of each.
+    vector<pair<coord_def, int>> cell_stack;
+    vector<pair<int, unsigned int>> zone_stack;
+
+    auto start_zone = [&](const coord_def start)
+    {
+        if (!walkable(start))
+            return;
+
+        zones.push_back({ is_wall(start), { }, { } });
+        glyph_zone &zone = zones.back();
+        zone.cells.push_back(start);
+        seen(start) = true;
+        cell_stack.emplace_back(start, 0);
+        while (!cell_stack.empty())
+        {
+            pair<coord_def, int> &top = cell_stack.back();
+            if (top.second == 8)
+            {
+                cell_stack.pop_back();
+                continue;
+            }
+
+            const coord_def c = top.first + _zonify_directions[top.second++];
+            if (!walkable(c))
+                continue;
+            if (is_wall(c) != zone.wall)
+            {
+                zone.borders.push_back(c);
+                continue;
+            }
+            zone.cells.push_back(c);
+            seen(c) = true;
+            cell_stack.emplace_back(c, 0);
+        }
+        zone_stack.emplace_back(zones.size() - 1, 0);
+    };
+
+    start_zone(tl);
+    while (!zone_stack.empty())
+    {
+        const int zone = zone_stack.back().first;
+        const unsigned int border = zone_stack.back().second++;
+        if (border < zones[zone].borders.size())
+            start_zone(zones[zone].borders[border]);
+        else
+            zone_stack.pop_back();
+    }
+    return zones;
+}
+
+// Fill all but the keep largest 8-connected zones of the glyphs in the box
+// that aren't in wall, keeping only zones of more than min_size glyphs. As
+// with zonify.fill_smallest_zones(), of zones the same size the one
+// zonify.map() would find first is kept. Returns the number of zones
+// filled.
+LUAFN(dgn_fill_small_zones)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_STR(ls, wall, "wlxcvbtg");
+    TABLE_CHAR(ls, fill, 'x');
+    TABLE_INT(ls, keep, 1);
+    TABLE_INT(ls, min_size, 1);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+    if (keep <= 0)
+        PLUARET(number, 0);
+
+    vector<glyph_zone> zones =
+        _glyph_zones(lines, coord_def(x1, y1), coord_def(x2, y2), wall);
+    zones.erase(remove_if(zones.begin(), zones.end(),
+                          [](const glyph_zone &z) { return z.wall; }),
+                zones.end());
+
+    vector<int> order(zones.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&zones](int a, int b)
+                { return zones[a].cells.size() > zones[b].cells.size(); });
+
+    vector<bool> kept(zones.size(), false);
+    for (int i = 0; i < keep && i < (int)order.size(); ++i)
+        if ((int)zones[order[i]].cells.size() > min_size)
+            kept[order[i]] = true;
+
+    int filled = 0;
+    for (unsigned int i = 0; i < zones.size(); ++i)
+    {
+        if (kept[i])
+            continue;
+        for (const coord_def &c : zones[i].cells)
+            lines(c) = fill;
+        ++filled;
+    }
+
+    PLUARET(number, filled);
+}
+
+// Pick a glyph in the box at random, weighting each by weights[glyph] or,
+// without weights, choosing evenly from those in glyphs. Returns its x and
+// y, or nil if there's nothing to pick.
+LUAFN(dgn_random_point)
+{
+    LINES(ls, 1, lines);
+
+    TABLE_STR(ls, glyphs, traversable_glyphs);
+
+    int weight[256] = { };
+    lua_getfield(ls, -1, "weights");
+    if (lua_istable(ls, -1))
+    {
+        lua_pushnil(ls);
+        while (lua_next(ls, -2))
+        {
+            const char *glyph = lua_tostring(ls, -2);
+            if (!glyph || !glyph[0] || glyph[1] || !lua_isnumber(ls, -1))
+                return luaL_error(ls, "weights must map glyphs to numbers");
+            weight[(unsigned char)glyph[0]] = max((int)lua_tointeger(ls, -1), 0);
+            lua_pop(ls, 1);
+        }
+    }
+    else
+    {
+        for (const char *g = glyphs; *g; ++g)
+            weight[(unsigned char)*g] = 1;
+    }
+    lua_pop(ls, 1);
+
+    int x1, y1, x2, y2;
+    if (!_coords(ls, lines, x1, y1, x2, y2))
+        return 0;
+
+    int total = 0;
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+            total += weight[(unsigned char)lines(x, y)];
+
+    if (!total)
+    {
+        lua_pushnil(ls);
+        lua_pushnil(ls);
+        return 2;
+    }
+
+    int pick = random2(total);
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+        {
+            pick -= weight[(unsigned char)lines(x, y)];
+            if (pick < 0)
+            {
+                lua_pushnumber(ls, x);
+                lua_pushnumber(ls, y);
+                return 2;
+            }
+        }
+
+    die("random_point overran its weights");
+}
+
 /* Wrappers for C++ layouts, to facilitate choosing of layouts by weight and
  * depth */
 
@@ -2324,6 +2671,11 @@ const struct luaL_reg dgn_build_dlib[] =
     { "delve", &dgn_delve },
     { "width", dgn_width },
     { "farthest_from", &dgn_farthest_from },
+    { "fill_masked", &dgn_fill_masked },
+    { "cellular_step", &dgn_cellular_step },
+    { "distance_map", &dgn_distance_map },
+    { "fill_small_zones", &dgn_fill_small_zones },
+    { "random_point", &dgn_random_point },
 
     { "layout_basic", &dgn_layout_basic },
     { "layout_bigger_room", &dgn_layout_bigger_room },
@@ -29,7 +29,7 @@ LUAFN(view_feature_at)
         lua_pushnil(ls);
         return 1;
     }
-    dungeon_feature_type f = env.map_knowledge(p).feat();
+    dungeon_feature_type f = env.map_knowledge.get(p).feat();
     lua_pushstring(ls, dungeon_feature_name(f));
     return 1;
 }
@@ -43,7 +43,7 @@ LUAFN(view_cloud_at)
         lua_pushnil(ls);
         return 1;
     }
-    cloud_type c = env.map_knowledge(p).cloud();
+    cloud_type c = env.map_knowledge.get(p).cloud();
     if (c == CLOUD_NONE)
     {
         lua_pushnil(ls);
@@ -62,14 +62,14 @@ LUAFN(view_is_safe_square)
         PLUARET(boolean, false);
         return 1;
     }
-    cloud_type c = env.map_knowledge(p).cloud();
+    cloud_type c = env.map_knowledge.get(p).cloud();
     if (c != CLOUD_NONE
         && is_damaging_cloud(c, true, YOU_KILL(env.map_knowledge(p).cloudinfo()->killer)))
     {
         PLUARET(boolean, false);
         return 1;
     }
-    trap_type t = env.map_knowledge(p).trap();
+    trap_type t = env.map_knowledge.get(p).trap();
     if (t != TRAP_UNASSIGNED)
     {
         trap_def trap;
@@ -78,7 +78,7 @@ LUAFN(view_is_safe_square)
         PLUARET(boolean, trap.is_safe());
         return 1;
     }
-    dungeon_feature_type f = env.map_knowledge(p).feat();
+    dungeon_feature_type f = env.map_knowledge.get(p).feat();
     if (f != DNGN_UNSEEN && !feat_is_traversable_now(f)
         || f == DNGN_RUNED_DOOR)
     {
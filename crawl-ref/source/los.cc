@@ -30,10 +30,10 @@
  *
  * == Overview ==
  *
- * At first use, the LOS code makes some precomputations,
- * filling a list of all relevant rays in one quadrant,
- * and filling data structures that allow calculating LOS
- * in a quadrant without checking each ray.
+ * The list of all relevant rays in one quadrant, and data
+ * structures that allow calculating LOS in a quadrant without
+ * checking each ray, are precomputed at build time (losrays.cc,
+ * util/gen-losrays) and set up from losray-data.h at first use.
  *
  * The code provides functions for filling LOS information
  * around a given center efficiently, and for querying rays
@@ -52,18 +52,13 @@
 #include "coordit.h"
 #include "env.h"
 #include "losglobal.h"
-
-// These determine what rays are cast in the precomputation,
-// and affect start-up time significantly.
-// XXX: Argue that these values are sufficient.
-#define LOS_MAX_ANGLE (2*LOS_MAX_RANGE-2)
-#define LOS_INTERCEPT_MULT (2)
+#include "losray-data.h"
+#include "losrays.h"
 
 // These store all unique (in terms of footprint) full rays.
 // The footprint of ray=fullray[i] consists of ray.length cells,
 // stored in ray_coords[ray.start..ray.length-1].
-// These are filled during precomputation (_register_ray).
-// XXX: fullrays is not needed anymore after precomputation.
+// These are set up from the tables of losrays.cc (_use_ray_tables).
 struct los_ray;
 static vector<los_ray> fullrays;
 static vector<coord_def> ray_coords;
@@ -83,9 +78,15 @@ static blockrays_t blockrays;
 struct cellray;
 static FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellrays;
 
+// For each cell p of the quadrant, the ends of all minimal cellrays that
+// pass through p, i.e. the cells an opaque p might hide from the origin.
+// Cell (x, y) is bit x * (LOS_MAX_RANGE+1) + y.
+typedef FixedArray<uint64_t, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> shadows_t;
+static shadows_t shadows;
+
 // Temporary arrays used in losight() to track which rays
 // are blocked or have seen a smoke cloud.
-// Allocated when doing the precomputations.
+// Allocated in _use_ray_tables().
 static bit_vector *dead_rays     = nullptr;
 static bit_vector *smoke_rays    = nullptr;
 
@@ -120,11 +121,6 @@ void set_los_radius(int r)
     _handle_los_change();
 }
 
-bool double_is_zero(const double x)
-{
-    return x > -EPSILON_VALUE && x < EPSILON_VALUE;
-}
-
 struct los_ray : public ray_def
 {
     // The footprint of this ray is stored in
@@ -132,41 +128,11 @@ struct los_ray : public ray_def
     unsigned int start;
     unsigned int length;
 
-    los_ray(geom::ray _r)
-        : ray_def(_r), start(0), length(0)
+    los_ray(const los_fullray &fr)
+        : ray_def(fr.r), start(fr.start), length(fr.length)
     {
     }
 
-    // Shoot a ray from the given start point (accx, accy) with the given
-    // slope, bounded by the pre-calc bounds shape.
-    // Returns the cells it travels through, excluding the origin.
-    // Returns an empty vector if this was a bad ray.
-    vector<coord_def> footprint()
-    {
-        vector<coord_def> cs;
-        los_ray copy = *this;
-        coord_def c;
-        coord_def old;
-        int cellnum;
-        for (cellnum = 0; true; ++cellnum)
-        {
-            old = c;
-            if (!copy.advance())
-            {
-//                dprf("discarding corner ray (%f,%f) + t*(%f,%f)",
-//                     r.start.x, r.start.y, r.dir.x, r.dir.y);
-                cs.clear();
-                break;
-            }
-            c = copy.pos();
-            if (c.rdist() > LOS_RADIUS)
-                break;
-            cs.push_back(c);
-            ASSERT((c - old).rdist() == 1);
-        }
-        return cs;
-    }
-
     coord_def operator[](unsigned int i)
     {
         ASSERT(i < length);
@@ -174,26 +140,6 @@ struct los_ray : public ray_def
     }
 };
 
-// Check if the passed rays have identical footprint.
-static bool _is_same_ray(los_ray ray, vector<coord_def> newray)
-{
-    if (ray.length != newray.size())
-        return false;
-    for (unsigned int i = 0; i < ray.length; i++)
-        if (ray[i] != newray[i])
-            return false;
-    return true;
-}
-
-// Check if the passed ray has already been created.
-static bool _is_duplicate_ray(vector<coord_def> newray)
-{
-    for (los_ray lray : fullrays)
-        if (_is_same_ray(lray, newray))
-            return true;
-    return false;
-}
-
 // A cellray given by fullray and index of end-point.
 struct cellray
 {
@@ -202,337 +148,94 @@ struct cellray
     unsigned int end; // Relative index (inside ray) of end cell.
 
     cellray(const los_ray& r, unsigned int e)
-        : ray(r), end(e), imbalance(-1), first_diag(false)
+        : ray(r), end(e)
     {
     }
 
-    // The end-point's index inside ray_coord.
-    int index() const { return ray.start + end; }
-
-    // The end-point.
-    coord_def target() const { return ray_coords[index()]; }
-
     // XXX: Currently ray/cellray[0] is the first point outside the origin.
     coord_def operator[](unsigned int i)
     {
         ASSERT(i <= end);
         return ray_coords[ray.start+i];
     }
-
-    // Parameters used in find_ray. These need to be calculated
-    // only for the minimal cellrays.
-    int imbalance;
-    bool first_diag;
-
-    void calc_params();
 };
 
-// Compare two cellrays to the same target.
-// This determines which ray is considered better by find_ray,
-// used with list::sort.
-// Returns true if a is strictly better than b, false else.
-static bool _is_better(const cellray& a, const cellray& b)
-{
-    // Only compare cellrays with equal target.
-    ASSERT(a.target() == b.target());
-    // calc_params() has been called.
-    ASSERT(a.imbalance >= 0);
-    ASSERT(b.imbalance >= 0);
-    if (a.imbalance < b.imbalance)
-        return true;
-    else if (a.imbalance > b.imbalance)
-        return false;
-    else
-        return a.first_diag && !b.first_diag;
-}
-
-enum compare_type
-{
-    C_SUBRAY,
-    C_SUPERRAY,
-    C_NEITHER,
-};
-
-// Check whether one of the passed cellrays is a subray of the
-// other in terms of footprint.
-static compare_type _compare_cellrays(const cellray& a, const cellray& b)
-{
-    if (a.target() != b.target())
-        return C_NEITHER;
-
-    int cura = a.ray.start;
-    int curb = b.ray.start;
-    int enda = cura + a.end;
-    int endb = curb + b.end;
-    bool maybe_sub = true;
-    bool maybe_super = true;
-
-    while (cura < enda && curb < endb && (maybe_sub || maybe_super))
-    {
-        coord_def pa = ray_coords[cura];
-        coord_def pb = ray_coords[curb];
-        if (pa.x > pb.x || pa.y > pb.y)
-        {
-            maybe_super = false;
-            curb++;
-        }
-        if (pa.x < pb.x || pa.y < pb.y)
-        {
-            maybe_sub = false;
-            cura++;
-        }
-        if (pa == pb)
-        {
-            cura++;
-            curb++;
-        }
-    }
-    maybe_sub = maybe_sub && cura == enda;
-    maybe_super = maybe_super && curb == endb;
-
-    if (maybe_sub)
-        return C_SUBRAY;    // includes equality
-    else if (maybe_super)
-        return C_SUPERRAY;
-    else
-        return C_NEITHER;
-}
-
-// Determine all minimal cellrays.
-// They're stored globally by target in min_cellrays,
-// and returned as a list of indices into ray_coords.
-static vector<int> _find_minimal_cellrays()
-{
-    FixedArray<list<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> minima;
-    list<cellray>::iterator min_it;
-
-    for (los_ray ray : fullrays)
-    {
-        for (unsigned int i = 0; i < ray.length; ++i)
-        {
-            // Is the cellray ray[0..i] duplicated so far?
-            bool dup = false;
-            cellray c(ray, i);
-            list<cellray>& min = minima(c.target());
-
-            bool erased = false;
-            for (min_it = min.begin();
-                 min_it != min.end() && !dup;)
-            {
-                switch (_compare_cellrays(*min_it, c))
-                {
-                case C_SUBRAY:
-                    dup = true;
-                    break;
-                case C_SUPERRAY:
-                    min_it = min.erase(min_it);
-                    erased = true;
-                    // clear this should be added, but might have
-                    // to erase more
-                    break;
-                case C_NEITHER:
-                default:
-                    break;
-                }
-                if (!erased)
-                    ++min_it;
-                else
-                    erased = false;
-            }
-            if (!dup)
-                min.push_back(c);
-        }
-    }
-
-    vector<int> result;
-    for (quadrant_iterator qi; qi; ++qi)
-    {
-        list<cellray>& min = minima(*qi);
-        for (min_it = min.begin(); min_it != min.end(); ++min_it)
-        {
-            // Calculate imbalance and slope difference for sorting.
-            min_it->calc_params();
-            result.push_back(min_it->index());
-        }
-        min.sort(_is_better);
-        min_cellrays(*qi) = vector<cellray>(min.begin(), min.end());
-    }
-    return result;
-}
-
-// Create and register the ray defined by the arguments.
-static void _register_ray(geom::ray r)
+// Set up the structures above from the rays of losrays.cc.
+static void _use_ray_tables(const los_ray_tables &tables)
 {
-    los_ray ray = los_ray(r);
-    vector<coord_def> coords = ray.footprint();
-
-    if (coords.empty() || _is_duplicate_ray(coords))
-        return;
-
-    ray.start = ray_coords.size();
-    ray.length = coords.size();
-    for (coord_def c : coords)
-        ray_coords.push_back(c);
-    fullrays.push_back(ray);
-}
-
-static void _create_blockrays()
-{
-    // First, we calculate blocking information for all cell rays.
-    // Cellrays are numbered according to the index of their end
-    // cell in ray_coords.
-    const int n_cellrays = ray_coords.size();
-    blockrays_t all_blockrays;
-    for (quadrant_iterator qi; qi; ++qi)
-        all_blockrays(*qi) = new bit_vector(n_cellrays);
-
-    for (los_ray ray : fullrays)
-    {
-        for (unsigned int i = 0; i < ray.length; ++i)
-        {
-            // Every cell is contained in (thus blocks)
-            // all following cellrays.
-            for (unsigned int j = i + 1; j < ray.length; ++j)
-                all_blockrays(ray[i])->set(ray.start + j);
-        }
-    }
+    ray_coords = tables.ray_coords;
+    for (const los_fullray &ray : tables.fullrays)
+        fullrays.emplace_back(ray);
 
-    // We've built the basic blockray array; now compress it, keeping
-    // only the nonduplicated cellrays.
-
-    // Determine minimal cellrays and store their indices in ray_coords.
-    vector<int> min_indices = _find_minimal_cellrays();
-    const int n_min_rays    = min_indices.size();
+    const int n_min_rays = tables.min_ends.size();
     cellray_ends.resize(n_min_rays);
     for (int i = 0; i < n_min_rays; ++i)
-        cellray_ends[i] = ray_coords[min_indices[i]];
+        cellray_ends[i] = ray_coords[tables.min_ends[i]];
 
-    // Compress blockrays accordingly.
     for (quadrant_iterator qi; qi; ++qi)
     {
+        const vector<uint64_t> &words = tables.blockrays(*qi);
         blockrays(*qi) = new bit_vector(n_min_rays);
         for (int i = 0; i < n_min_rays; ++i)
-        {
-            blockrays(*qi)->set(i, all_blockrays(*qi)
-                                   ->get(min_indices[i]));
-        }
+            blockrays(*qi)->set(i, words[i >> 6] & (1ULL << (i & 63)));
+
+        for (const los_cellray &c : tables.target_rays(*qi))
+            min_cellrays(*qi).emplace_back(fullrays[c.ray], c.end);
     }
 
-    // We can throw away all_blockrays now.
+    COMPILE_CHECK((LOS_MAX_RANGE+1) * (LOS_MAX_RANGE+1) <= 64);
     for (quadrant_iterator qi; qi; ++qi)
-        delete all_blockrays(*qi);
+    {
+        uint64_t shadow = 0;
+        for (int i = 0; i < n_min_rays; ++i)
+            if (blockrays(*qi)->get(i))
+            {
+                shadow |= 1ULL << (cellray_ends[i].x * (LOS_MAX_RANGE+1)
+                                   + cellray_ends[i].y);
+            }
+        shadows(*qi) = shadow;
+    }
 
     dead_rays  = new bit_vector(n_min_rays);
     smoke_rays = new bit_vector(n_min_rays);
 
-    dprf("Cellrays: %d Fullrays: %u Minimal cellrays: %u",
-          n_cellrays, (unsigned int)fullrays.size(), n_min_rays);
-}
-
-static int _gcd(int x, int y)
-{
-    int tmp;
-    while (y != 0)
-    {
-        x %= y;
-        tmp = x;
-        x = y;
-        y = tmp;
-    }
-    return x;
+    dprf("Fullrays: %u Minimal cellrays: %u",
+         (unsigned int)fullrays.size(), n_min_rays);
 }
 
-static bool _complexity_lt(const pair<int,int>& lhs, const pair<int,int>& rhs)
-{
-    return lhs.first * lhs.second < rhs.first * rhs.second;
-}
-
-// Cast all rays
+// Set up the rays of the first quadrant, on first use.
 static void raycast()
 {
     static bool done_raycast = false;
     if (done_raycast)
         return;
-
-    // Creating all rays for first quadrant
-    // We have a considerable amount of overkill.
     done_raycast = true;
 
-    // register perpendiculars FIRST, to make them top choice
-    // when selecting beams
-    _register_ray(geom::ray(0.5, 0.5, 0.0, 1.0));
-    _register_ray(geom::ray(0.5, 0.5, 1.0, 0.0));
-
-    // For a slope of M = y/x, every x we move on the X axis means
-    // that we move y on the y axis. We want to look at the resolution
-    // of x/y: in that case, every step on the X axis means an increase
-    // of 1 in the Y axis at the intercept point. We can assume gcd(x,y)=1,
-    // so we look at steps of 1/y.
-
-    // Changing the order a bit. We want to order by the complexity
-    // of the beam, which is log(x) + log(y) ~ xy.
-    vector<pair<int,int> > xyangles;
-    for (int xangle = 1; xangle <= LOS_MAX_ANGLE; ++xangle)
-        for (int yangle = 1; yangle <= LOS_MAX_ANGLE; ++yangle)
-        {
-            if (_gcd(xangle, yangle) == 1)
-                xyangles.emplace_back(xangle, yangle);
-        }
-
-    sort(xyangles.begin(), xyangles.end(), _complexity_lt);
-    for (auto xyangle : xyangles)
-    {
-        const int xangle = xyangle.first;
-        const int yangle = xyangle.second;
-
-        for (int intercept = 1; intercept < LOS_INTERCEPT_MULT*yangle; ++intercept)
-        {
-            double xstart = ((double)intercept) / (LOS_INTERCEPT_MULT*yangle);
-            double ystart = 0.5;
-
-            _register_ray(geom::ray(xstart, ystart, xangle, yangle));
-            // also draw the identical ray in octant 2
-            _register_ray(geom::ray(ystart, xstart, yangle, xangle));
-        }
-    }
-
-    // Now create the appropriate blockrays array
-    _create_blockrays();
+    los_ray_tables tables;
+#ifdef DEBUG_LOS_RAYCAST
+    // Cast the rays the slow way, and check that the build got them right.
+    los_cast_rays(tables);
+    los_ray_tables embedded;
+    los_load_ray_tables(embedded);
+    ASSERTM(tables == embedded, "%s", "losray-data.h is out of date");
+#else
+    los_load_ray_tables(tables);
+#endif
+    _use_ray_tables(tables);
 }
 
-static int _imbalance(ray_def ray, const coord_def& target)
-{
-    int imb = 0;
-    int diags = 0, straights = 0;
-    while (ray.pos() != target)
-    {
-        coord_def old = ray.pos();
-        if (!ray.advance())
-            die("can't advance ray");
-        switch ((ray.pos() - old).abs())
-        {
-        case 1:
-            diags = 0;
-            if (++straights > imb)
-                imb = straights;
-            break;
-        case 2:
-            straights = 0;
-            if (++diags > imb)
-                imb = diags;
-            break;
-        default:
-            die("ray imbalance out of range");
-        }
-    }
-    return imb;
-}
-
-void cellray::calc_params()
+/**
+ * Which cells could an opaque cell hide from the origin?
+ *
+ * @param p A cell in the first quadrant, i.e. with 0 <= x, y <= LOS_MAX_RANGE.
+ * @return  A mask of cells of the first quadrant, with cell (x, y) as bit
+ *          x * (LOS_MAX_RANGE+1) + y. Whether the origin sees any other cell
+ *          doesn't depend on the opacity of p.
+ */
+uint64_t los_shadow_mask(const coord_def& p)
 {
-    coord_def trg = target();
-    imbalance = _imbalance(ray, trg);
-    first_diag = ((*this)[0].abs() == 2);
+    raycast();
+    return shadows(p);
 }
 
 // Find ray in positive quadrant.
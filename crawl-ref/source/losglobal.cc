@@ -2,25 +2,56 @@
 
 #include "losglobal.h"
 
+#include "bitary.h"
 #include "coord.h"
 #include "coordit.h"
 #include "libutil.h"
 #include "los_def.h"
 
-#define LOS_KNOWN 4
+// Whether p and q see each other is stored just once, with whichever of
+// them comes first in coord_def order, at the offset (dx, dy) of the other.
+// Those offsets have dx > 0, or dx == 0 and dy >= 0, and are numbered
+// dx * HALFLOS_ROW + dy.
+#define HALFLOS_ROW (2*LOS_MAX_RANGE+1)
+#define HALFLOS_SIZE (LOS_MAX_RANGE*HALFLOS_ROW + LOS_MAX_RANGE+1)
+#define HALFLOS_WORDS ((HALFLOS_SIZE + 63) / 64)
 
-typedef uint8_t losfield_t;
-typedef losfield_t halflos_t[LOS_MAX_RANGE+1][2*LOS_MAX_RANGE+1];
-static const int o_half_x = 0;
-static const int o_half_y = LOS_MAX_RANGE;
+// Each LOS type has a plane of its own, with two bits per pair of cells:
+// whether it's known, and whether they see each other.
+#define NUM_LOS_PLANES 4
+
+struct halflos_t
+{
+    uint64_t known[HALFLOS_WORDS];
+    uint64_t seen[HALFLOS_WORDS];
+};
 typedef halflos_t globallos_t[GXM][GYM];
 
-static globallos_t globallos;
+static globallos_t globallos[NUM_LOS_PLANES];
+
+// For a change of opacity at c, the pairs to forget: those stored with
+// c + (dx, dy) are the bits of invalid_pairs[dx + LOS_MAX_RANGE]
+// [dy + LOS_MAX_RANGE].
+typedef uint64_t halflos_mask[HALFLOS_WORDS];
+static halflos_mask invalid_pairs[2*LOS_MAX_RANGE+1][2*LOS_MAX_RANGE+1];
+static bool invalid_pairs_done = false;
 
-static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
+static int _los_plane(los_type l)
 {
-    COMPILE_CHECK(LOS_KNOWN * 2 <= sizeof(losfield_t) * 8);
+    switch (l)
+    {
+    case LOS_DEFAULT:   return 0;
+    case LOS_NO_TRANS:  return 1;
+    case LOS_SOLID:     return 2;
+    case LOS_SOLID_SEE: return 3;
+    default:
+        die("invalid opacity");
+    }
+}
 
+static halflos_t* _lookup_globallos(const coord_def& p, const coord_def& q,
+                                    los_type l, int &index)
+{
     if (!map_bounds(p) || !map_bounds(q))
         return nullptr;
     coord_def diff = q - p;
@@ -28,9 +59,15 @@ static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
         return nullptr;
     // p < q iff p.x < q.x || p.x == q.x && p.y < q.y
     if (diff < coord_def(0, 0))
-        return &globallos[q.x][q.y][-diff.x + o_half_x][-diff.y + o_half_y];
+    {
+        index = -diff.x * HALFLOS_ROW - diff.y;
+        return &globallos[_los_plane(l)][q.x][q.y];
+    }
     else
-        return &globallos[p.x][p.y][ diff.x + o_half_x][ diff.y + o_half_y];
+    {
+        index = diff.x * HALFLOS_ROW + diff.y;
+        return &globallos[_los_plane(l)][p.x][p.y];
+    }
 }
 
 static void _save_los(los_def* los, los_type l)
@@ -47,34 +84,88 @@ static void _save_los(los_def* los, los_type l)
                 continue;
 
             coord_def ri(x, y);
-            losfield_t* flags = _lookup_globallos(o, ri);
-            if (!flags)
+            int index;
+            halflos_t* half = _lookup_globallos(o, ri, l, index);
+            if (!half)
                 continue;
-            *flags |= l << LOS_KNOWN;
+            const uint64_t bit = 1ULL << (index & 63);
+            half->known[index >> 6] |= bit;
             if (los->see_cell(ri))
-                *flags |= l;
+                half->seen[index >> 6] |= bit;
             else
-                *flags &= ~l;
+                half->seen[index >> 6] &= ~bit;
         }
 }
 
-// Opacity at p has changed.
+// Work out which pairs of cells an opaque cell could come between, from
+// the shadows cast in los.cc. A pair counts if either of them could lose
+// sight of the other, so this holds however the pair was filled in.
+static void _init_invalid_pairs()
+{
+    memset(invalid_pairs, 0, sizeof(invalid_pairs));
+
+    // The changed cell is at the origin, and the viewer at -d.
+    for (int dx = -LOS_MAX_RANGE; dx <= LOS_MAX_RANGE; ++dx)
+        for (int dy = -LOS_MAX_RANGE; dy <= LOS_MAX_RANGE; ++dy)
+            for (int sx = -1; sx <= 1; sx += 2)
+                for (int sy = -1; sy <= 1; sy += 2)
+                {
+                    if (dx * sx < 0 || dy * sy < 0)
+                        continue;
+
+                    const coord_def viewer(-dx, -dy);
+                    uint64_t shadow = los_shadow_mask(coord_def(abs(dx),
+                                                                abs(dy)));
+                    while (shadow)
+                    {
+                        const int b = lowest_bit(shadow);
+                        shadow &= shadow - 1;
+
+                        const coord_def target =
+                            viewer + coord_def(sx * (b / (LOS_MAX_RANGE+1)),
+                                               sy * (b % (LOS_MAX_RANGE+1)));
+                        const bool swap = target < viewer;
+                        const coord_def owner = swap ? target : viewer;
+                        const coord_def half = swap ? viewer - target
+                                                    : target - viewer;
+                        ASSERT(owner.rdist() <= LOS_MAX_RANGE);
+                        ASSERT(half.rdist() <= LOS_MAX_RANGE);
+
+                        const int index = half.x * HALFLOS_ROW + half.y;
+                        invalid_pairs[owner.x + LOS_MAX_RANGE]
+                                     [owner.y + LOS_MAX_RANGE][index >> 6]
+                            |= 1ULL << (index & 63);
+                    }
+                }
+
+    invalid_pairs_done = true;
+}
+
+// Opacity at p has changed. Only pairs of cells with a ray between them
+// through p are forgotten; the first of such a pair can't be right of p.
 void invalidate_los_around(const coord_def& p)
 {
+    if (!invalid_pairs_done)
+        _init_invalid_pairs();
+
     int x1 = max(p.x - LOS_MAX_RANGE, 0);
     int y1 = max(p.y - LOS_MAX_RANGE, 0);
     int x2 = min(p.x, GXM - 1);
     int y2 = min(p.y + LOS_MAX_RANGE, GYM - 1);
-    for (int y = y1; y <= y2; y++)
-        for (int x = x1; x <= x2; x++)
-            if (max(abs(p.x - x), abs(p.y - y)) <= LOS_MAX_RANGE)
-                memset(globallos[x][y], 0, sizeof(halflos_t));
+    for (int x = x1; x <= x2; x++)
+        for (int y = y1; y <= y2; y++)
+        {
+            const halflos_mask &mask =
+                invalid_pairs[x - p.x + LOS_MAX_RANGE][y - p.y + LOS_MAX_RANGE];
+            for (int l = 0; l < NUM_LOS_PLANES; l++)
+                for (int w = 0; w < HALFLOS_WORDS; w++)
+                    globallos[l][x][y].known[w] &= ~mask[w];
+        }
 }
 
 void invalidate_los()
 {
-    for (rectangle_iterator ri(0); ri; ++ri)
-        memset(globallos[ri->x][ri->y], 0, sizeof(halflos_t));
+    memset(globallos, 0, sizeof(globallos));
 }
 
 static void _update_globallos_at(const coord_def& p, los_type l)
@@ -119,17 +210,18 @@ bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
     if (l == LOS_NONE)
         return true;
 
-    losfield_t* flags = _lookup_globallos(p, q);
+    int index;
+    halflos_t* half = _lookup_globallos(p, q, l, index);
 
-    if (!flags)
+    if (!half)
         return false; // outside range
 
-    if (!(*flags & (l << LOS_KNOWN)))
+    const int w = index >> 6;
+    const uint64_t bit = 1ULL << (index & 63);
+    if (!(half->known[w] & bit))
         _update_globallos_at(p, l);
 
-    //if (!(*flags & (l << LOS_KNOWN)))
-    //    die("cell_see_cell %d,%d %d,%d", p.x,p.y,q.x,q.y);
-    ASSERT(*flags & (l << LOS_KNOWN));
+    ASSERT(half->known[w] & bit);
 
-    return *flags & l;
+    return half->seen[w] & bit;
 }
@@ -0,0 +1,481 @@
+/**
+ * @file
+ * @brief Casting the rays of the first quadrant for los.cc.
+ *
+ * Every relevant ray is cast, duplicates (in terms of footprint) are thrown
+ * away, and the minimal cellrays are picked out from the prefixes of the
+ * rest; see los.cc for the terminology. None of this depends on the game,
+ * so it's done once at build time by util/gen-losrays, which writes the
+ * result out as losray-data.h.
+**/
+
+#include "AppHdr.h"
+
+#include "losrays.h"
+
+#include <algorithm>
+#include <list>
+
+#include "los.h"
+
+// These determine what rays are cast in the precomputation.
+// XXX: Argue that these values are sufficient.
+#define LOS_MAX_ANGLE (2*LOS_MAX_RANGE-2)
+#define LOS_INTERCEPT_MULT (2)
+
+// Where the footprints of the rays cast so far are kept.
+static vector<coord_def> ray_coords;
+
+bool double_is_zero(const double x)
+{
+    return x > -EPSILON_VALUE && x < EPSILON_VALUE;
+}
+
+// The cells of the quadrant, in the order of los.cc's quadrant_iterator.
+// (util/gen-losrays links this file without coordit.cc.)
+static vector<coord_def> _quadrant_cells()
+{
+    vector<coord_def> cells;
+    for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+            cells.emplace_back(x, y);
+    return cells;
+}
+
+struct los_ray : public ray_def
+{
+    // The footprint of this ray is stored in
+    // ray_coords[start..start+length-1].
+    unsigned int start;
+    unsigned int length;
+
+    los_ray(geom::ray _r)
+        : ray_def(_r), start(0), length(0)
+    {
+    }
+
+    // Shoot a ray from the given start point (accx, accy) with the given
+    // slope, bounded by the pre-calc bounds shape.
+    // Returns the cells it travels through, excluding the origin.
+    // Returns an empty vector if this was a bad ray.
+    vector<coord_def> footprint()
+    {
+        vector<coord_def> cs;
+        los_ray copy = *this;
+        coord_def c;
+        coord_def old;
+        int cellnum;
+        for (cellnum = 0; true; ++cellnum)
+        {
+            old = c;
+            if (!copy.advance())
+            {
+                cs.clear();
+                break;
+            }
+            c = copy.pos();
+            if (c.rdist() > LOS_RADIUS)
+                break;
+            cs.push_back(c);
+            ASSERT((c - old).rdist() == 1);
+        }
+        return cs;
+    }
+
+    coord_def operator[](unsigned int i)
+    {
+        ASSERT(i < length);
+        return ray_coords[start+i];
+    }
+};
+
+static vector<los_ray> fullrays;
+
+// Check if the passed rays have identical footprint.
+static bool _is_same_ray(los_ray ray, vector<coord_def> newray)
+{
+    if (ray.length != newray.size())
+        return false;
+    for (unsigned int i = 0; i < ray.length; i++)
+        if (ray[i] != newray[i])
+            return false;
+    return true;
+}
+
+// Check if the passed ray has already been created.
+static bool _is_duplicate_ray(vector<coord_def> newray)
+{
+    for (los_ray lray : fullrays)
+        if (_is_same_ray(lray, newray))
+            return true;
+    return false;
+}
+
+// A cellray given by fullray and index of end-point.
+struct cellray
+{
+    // A cellray passes through cells ray_coords[ray.start..ray.start+end].
+    los_ray ray;
+    unsigned int ray_index; // Index of ray in fullrays.
+    unsigned int end; // Relative index (inside ray) of end cell.
+
+    cellray(const los_ray& r, unsigned int ri, unsigned int e)
+        : ray(r), ray_index(ri), end(e), imbalance(-1), first_diag(false)
+    {
+    }
+
+    // The end-point's index inside ray_coord.
+    int index() const { return ray.start + end; }
+
+    // The end-point.
+    coord_def target() const { return ray_coords[index()]; }
+
+    // XXX: Currently ray/cellray[0] is the first point outside the origin.
+    coord_def operator[](unsigned int i)
+    {
+        ASSERT(i <= end);
+        return ray_coords[ray.start+i];
+    }
+
+    // Parameters used in find_ray. These need to be calculated
+    // only for the minimal cellrays.
+    int imbalance;
+    bool first_diag;
+
+    void calc_params();
+};
+
+// Compare two cellrays to the same target.
+// This determines which ray is considered better by find_ray,
+// used with list::sort.
+// Returns true if a is strictly better than b, false else.
+static bool _is_better(const cellray& a, const cellray& b)
+{
+    // Only compare cellrays with equal target.
+    ASSERT(a.target() == b.target());
+    // calc_params() has been called.
+    ASSERT(a.imbalance >= 0);
+    ASSERT(b.imbalance >= 0);
+    if (a.imbalance < b.imbalance)
+        return true;
+    else if (a.imbalance > b.imbalance)
+        return false;
+    else
+        return a.first_diag && !b.first_diag;
+}
+
+enum compare_type
+{
+    C_SUBRAY,
+    C_SUPERRAY,
+    C_NEITHER,
+};
+
+// Check whether one of the passed cellrays is a subray of the
+// other in terms of footprint.
+static compare_type _compare_cellrays(const cellray& a, const cellray& b)
+{
+    if (a.target() != b.target())
+        return C_NEITHER;
+
+    int cura = a.ray.start;
+    int curb = b.ray.start;
+    int enda = cura + a.end;
+    int endb = curb + b.end;
+    bool maybe_sub = true;
+    bool maybe_super = true;
+
+    while (cura < enda && curb < endb && (maybe_sub || maybe_super))
+    {
+        coord_def pa = ray_coords[cura];
+        coord_def pb = ray_coords[curb];
+        if (pa.x > pb.x || pa.y > pb.y)
+        {
+            maybe_super = false;
+            curb++;
+        }
+        if (pa.x < pb.x || pa.y < pb.y)
+        {
+            maybe_sub = false;
+            cura++;
+        }
+        if (pa == pb)
+        {
+            cura++;
+            curb++;
+        }
+    }
+    maybe_sub = maybe_sub && cura == enda;
+    maybe_super = maybe_super && curb == endb;
+
+    if (maybe_sub)
+        return C_SUBRAY;    // includes equality
+    else if (maybe_super)
+        return C_SUPERRAY;
+    else
+        return C_NEITHER;
+}
+
+static int _imbalance(ray_def ray, const coord_def& target)
+{
+    int imb = 0;
+    int diags = 0, straights = 0;
+    while (ray.pos() != target)
+    {
+        coord_def old = ray.pos();
+        if (!ray.advance())
+            die("can't advance ray");
+        switch ((ray.pos() - old).abs())
+        {
+        case 1:
+            diags = 0;
+            if (++straights > imb)
+                imb = straights;
+            break;
+        case 2:
+            straights = 0;
+            if (++diags > imb)
+                imb = diags;
+            break;
+        default:
+            die("ray imbalance out of range");
+        }
+    }
+    return imb;
+}
+
+void cellray::calc_params()
+{
+    coord_def trg = target();
+    imbalance = _imbalance(ray, trg);
+    first_diag = ((*this)[0].abs() == 2);
+}
+
+// Determine all minimal cellrays.
+// They're stored by target in target_rays, and returned as a list of
+// indices into ray_coords.
+static vector<int> _find_minimal_cellrays(los_target_rays_t &target_rays)
+{
+    FixedArray<list<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> minima;
+    list<cellray>::iterator min_it;
+
+    for (unsigned int r = 0; r < fullrays.size(); ++r)
+    {
+        const los_ray &ray = fullrays[r];
+        for (unsigned int i = 0; i < ray.length; ++i)
+        {
+            // Is the cellray ray[0..i] duplicated so far?
+            bool dup = false;
+            cellray c(ray, r, i);
+            list<cellray>& min = minima(c.target());
+
+            bool erased = false;
+            for (min_it = min.begin();
+                 min_it != min.end() && !dup;)
+            {
+                switch (_compare_cellrays(*min_it, c))
+                {
+                case C_SUBRAY:
+                    dup = true;
+                    break;
+                case C_SUPERRAY:
+                    min_it = min.erase(min_it);
+                    erased = true;
+                    // clear this should be added, but might have
+                    // to erase more
+                    break;
+                case C_NEITHER:
+                default:
+                    break;
+                }
+                if (!erased)
+                    ++min_it;
+                else
+                    erased = false;
+            }
+            if (!dup)
+                min.push_back(c);
+        }
+    }
+
+    vector<int> result;
+    for (coord_def qi : _quadrant_cells())
+    {
+        list<cellray>& min = minima(qi);
+        for (min_it = min.begin(); min_it != min.end(); ++min_it)
+        {
+            // Calculate imbalance and slope difference for sorting.
+            min_it->calc_params();
+            result.push_back(min_it->index());
+        }
+        min.sort(_is_better);
+        target_rays(qi).clear();
+        for (const cellray &c : min)
+            target_rays(qi).push_back({ (int)c.ray_index, (int)c.end });
+    }
+    return result;
+}
+
+// Create and register the ray defined by the arguments.
+static void _register_ray(geom::ray r)
+{
+    los_ray ray = los_ray(r);
+    vector<coord_def> coords = ray.footprint();
+
+    if (coords.empty() || _is_duplicate_ray(coords))
+        return;
+
+    ray.start = ray_coords.size();
+    ray.length = coords.size();
+    for (coord_def c : coords)
+        ray_coords.push_back(c);
+    fullrays.push_back(ray);
+}
+
+static void _create_blockrays(los_ray_tables &tables)
+{
+    // First, we calculate blocking information for all cell rays.
+    // Cellrays are numbered according to the index of their end
+    // cell in ray_coords.
+    const int n_cellrays = ray_coords.size();
+    FixedArray<vector<bool>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> all_blockrays;
+    for (coord_def qi : _quadrant_cells())
+        all_blockrays(qi).assign(n_cellrays, false);
+
+    for (los_ray ray : fullrays)
+    {
+        for (unsigned int i = 0; i < ray.length; ++i)
+        {
+            // Every cell is contained in (thus blocks)
+            // all following cellrays.
+            for (unsigned int j = i + 1; j < ray.length; ++j)
+                all_blockrays(ray[i])[ray.start + j] = true;
+        }
+    }
+
+    // We've built the basic blockray array; now compress it, keeping
+    // only the nonduplicated cellrays.
+    tables.min_ends = _find_minimal_cellrays(tables.target_rays);
+    const int n_min_rays = tables.min_ends.size();
+    for (coord_def qi : _quadrant_cells())
+    {
+        vector<uint64_t> &words = tables.blockrays(qi);
+        words.assign((n_min_rays + 63) / 64, 0);
+        for (int i = 0; i < n_min_rays; ++i)
+            if (all_blockrays(qi)[tables.min_ends[i]])
+                words[i >> 6] |= 1ULL << (i & 63);
+    }
+}
+
+static int _gcd(int x, int y)
+{
+    int tmp;
+    while (y != 0)
+    {
+        x %= y;
+        tmp = x;
+        x = y;
+        y = tmp;
+    }
+    return x;
+}
+
+static bool _complexity_lt(const pair<int,int>& lhs, const pair<int,int>& rhs)
+{
+    return lhs.first * lhs.second < rhs.first * rhs.second;
+}
+
+void los_cast_rays(los_ray_tables &tables)
+{
+    fullrays.clear();
+    ray_coords.clear();
+
+    // Creating all rays for first quadrant
+    // We have a considerable amount of overkill.
+
+    // register perpendiculars FIRST, to make them top choice
+    // when selecting beams
+    _register_ray(geom::ray(0.5, 0.5, 0.0, 1.0));
+    _register_ray(geom::ray(0.5, 0.5, 1.0, 0.0));
+
+    // For a slope of M = y/x, every x we move on the X axis means
+    // that we move y on the y axis. We want to look at the resolution
+    // of x/y: in that case, every step on the X axis means an increase
+    // of 1 in the Y axis at the intercept point. We can assume gcd(x,y)=1,
+    // so we look at steps of 1/y.
+
+    // Changing the order a bit. We want to order by the complexity
+    // of the beam, which is log(x) + log(y) ~ xy.
+    vector<pair<int,int> > xyangles;
+    for (int xangle = 1; xangle <= LOS_MAX_ANGLE; ++xangle)
+        for (int yangle = 1; yangle <= LOS_MAX_ANGLE; ++yangle)
+        {
+            if (_gcd(xangle, yangle) == 1)
+                xyangles.emplace_back(xangle, yangle);
+        }
+
+    sort(xyangles.begin(), xyangles.end(), _complexity_lt);
+    for (auto xyangle : xyangles)
+    {
+        const int xangle = xyangle.first;
+        const int yangle = xyangle.second;
+
+        for (int intercept = 1; intercept < LOS_INTERCEPT_MULT*yangle; ++intercept)
+        {
+            double xstart = ((double)intercept) / (LOS_INTERCEPT_MULT*yangle);
+            double ystart = 0.5;
+
+            _register_ray(geom::ray(xstart, ystart, xangle, yangle));
+            // also draw the identical ray in octant 2
+            _register_ray(geom::ray(ystart, xstart, yangle, xangle));
+        }
+    }
+
+    // Now create the appropriate blockrays array
+    _create_blockrays(tables);
+
+    tables.ray_coords = ray_coords;
+    tables.fullrays.clear();
+    for (const los_ray &ray : fullrays)
+        tables.fullrays.push_back({ ray.r, (int)ray.start, (int)ray.length });
+}
+
+static bool _same_ray(const geom::ray &a, const geom::ray &b)
+{
+    return a.start.x == b.start.x && a.start.y == b.start.y
+           && a.dir.x == b.dir.x && a.dir.y == b.dir.y;
+}
+
+bool los_ray_tables::operator==(const los_ray_tables &other) const
+{
+    if (fullrays.size() != other.fullrays.size()
+        || ray_coords != other.ray_coords
+        || min_ends != other.min_ends)
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < fullrays.size(); ++i)
+    {
+        const los_fullray &a = fullrays[i];
+        const los_fullray &b = other.fullrays[i];
+        if (!_same_ray(a.r, b.r) || a.start != b.start || a.length != b.length)
+            return false;
+    }
+
+    for (coord_def qi : _quadrant_cells())
+    {
+        if (blockrays(qi) != other.blockrays(qi))
+            return false;
+
+        const vector<los_cellray> &a = target_rays(qi);
+        const vector<los_cellray> &b = other.target_rays(qi);
+        if (a.size() != b.size())
+            return false;
+        for (unsigned int i = 0; i < a.size(); ++i)
+            if (a[i].ray != b[i].ray || a[i].end != b[i].end)
+                return false;
+    }
+
+    return true;
+}
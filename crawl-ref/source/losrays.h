@@ -0,0 +1,55 @@
+/**
+ * @file
+ * @brief The rays of the first quadrant that los.cc works with.
+**/
+
+#ifndef LOSRAYS_H
+#define LOSRAYS_H
+
+#include "ray.h"
+
+// A full ray, whose footprint is ray_coords[start..start+length-1].
+struct los_fullray
+{
+    geom::ray r;
+    int start;
+    int length;
+};
+
+// A minimal cellray: the first end+1 cells of fullrays[ray].
+struct los_cellray
+{
+    int ray;
+    int end;
+};
+
+typedef FixedArray<vector<uint64_t>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1>
+    los_blockrays_t;
+typedef FixedArray<vector<los_cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1>
+    los_target_rays_t;
+
+struct los_ray_tables
+{
+    // All unique (in terms of footprint) full rays, and their footprints.
+    vector<los_fullray> fullrays;
+    vector<coord_def> ray_coords;
+
+    // The minimal cellrays, numbered by the order they appear in here, as
+    // the indices into ray_coords of their ends.
+    vector<int> min_ends;
+
+    // Bit i of blockrays(p) is set iff an opaque cell p blocks minimal
+    // cellray i.
+    los_blockrays_t blockrays;
+
+    // The minimal cellrays to each cell, best first for find_ray.
+    los_target_rays_t target_rays;
+
+    bool operator==(const los_ray_tables &other) const;
+};
+
+// Cast all the rays from scratch. This is slow; the game itself uses the
+// tables in losray-data.h, which util/gen-losrays makes with this.
+void los_cast_rays(los_ray_tables &tables);
+
+#endif
@@ -62,6 +62,7 @@
 #endif
 #include "dgn-overview.h"
 #include "dgn-shoals.h"
+#include "dgn-speculate.h"
 #include "directn.h"
 #include "dlua.h"
 #include "dungeon.h"
@@ -551,8 +552,16 @@ static void _show_commandline_options_help()
     puts("  -objstat [<levels>] run monster and item stats on the given range "
          "of levels");
     puts("      Defaults to entire dungeon; same level syntax as -mapstat.");
+    puts("  -levelgen-bench [<levels>] time building the given range of "
+         "levels, with");
+    puts("                      a fixed seed unless -seed is given, and "
+         "write the");
+    puts("                      timings to levelgen-bench.json");
     puts("  -iters <num>        For -mapstat and -objstat, set the number of "
          "iterations");
+    puts("  -workers <num>      For -mapstat and -objstat, build the iterations "
+         "in <num>");
+    puts("                      processes at once");
 #endif
     puts("");
     puts("Miscellaneous options:");
@@ -1475,6 +1484,9 @@ static void _input()
         // Flush messages and display message window.
         msgwin_new_cmd();
 
+        if (!you.turn_is_over)
+            speculate_level_below();
+
         crawl_state.waiting_for_command = true;
         c_input_reset(true);
 
@@ -33,10 +33,10 @@ int count_detected_mons()
         // Note: assumptions are being made here about how
         // terrain can change (eg it used to be solid, and
         // thus monster/item free).
-        if (env.map_knowledge(*ri).changed())
+        if (env.map_knowledge.get(*ri).changed())
             continue;
 
-        if (env.map_knowledge(*ri).detected_monster())
+        if (env.map_knowledge.get(*ri).detected_monster())
             count++;
     }
 
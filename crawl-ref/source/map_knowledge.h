@@ -310,6 +310,92 @@ private:
     monster_info* _mons;
 };
 
+/**
+ * What the player knows of each cell of the level, along with a journal of
+ * which cells have changed.
+ *
+ * Every cell fetched for writing is stamped with the current version, so
+ * anything keeping its own copy of the map (such as the webtiles view) can
+ * bring it up to date by copying only the cells changed_since() it last
+ * looked, rather than the whole level. Reads that go through get() or
+ * operator[] don't count as changes.
+ */
+class MapKnowledge
+{
+public:
+    typedef FixedArray<map_cell, GXM, GYM>::Column Column;
+
+    MapKnowledge() : m_version(1)
+    {
+        m_stamp.init(m_version);
+    }
+
+    MapKnowledge(const MapKnowledge &other) = default;
+
+    MapKnowledge &operator=(const MapKnowledge &other)
+    {
+        if (this != &other)
+        {
+            m_cells = other.m_cells;
+            touch_all();
+        }
+        return *this;
+    }
+
+    // The cell at c, which is assumed to be about to change.
+    map_cell &operator()(const coord_def &c)
+    {
+        m_stamp(c) = m_version;
+        return m_cells(c);
+    }
+
+    const map_cell &operator()(const coord_def &c) const
+    {
+        return m_cells(c);
+    }
+
+    // The cell at c, for reading only.
+    const map_cell &get(const coord_def &c) const
+    {
+        return m_cells(c);
+    }
+
+    const Column &operator[](int x) const
+    {
+        return m_cells[x];
+    }
+
+    void init(const map_cell &cell)
+    {
+        m_cells.init(cell);
+        touch_all();
+    }
+
+    // Mark every cell as changed.
+    void touch_all()
+    {
+        m_stamp.init(m_version);
+    }
+
+    // Start a new version, returning it. Cells written from now on are
+    // changed_since() it.
+    unsigned int next_version()
+    {
+        return ++m_version;
+    }
+
+    // Has c been written since the given version was started?
+    bool changed_since(const coord_def &c, unsigned int version) const
+    {
+        return m_stamp(c) >= version;
+    }
+
+private:
+    FixedArray<map_cell, GXM, GYM> m_cells;
+    FixedArray<unsigned int, GXM, GYM> m_stamp;
+    unsigned int m_version;
+};
+
 void set_terrain_mapped(const coord_def c);
 void set_terrain_seen(const coord_def c);
 
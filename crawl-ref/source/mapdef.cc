@@ -2147,6 +2147,16 @@ bool depth_ranges::is_usable_in(const level_id &lid) const
     return any_matched;
 }
 
+// Whether some level of the branch might be usable, whatever the branch's
+// depth and place in the dungeon turn out to be.
+bool depth_ranges::may_include_branch(branch_type br) const
+{
+    for (const level_range &lr : depths)
+        if (!lr.deny && (lr.branch == br || lr.branch == NUM_BRANCHES))
+            return true;
+    return false;
+}
+
 void depth_ranges::add_depths(const depth_ranges &other_depths)
 {
     depths.insert(depths.end(),
@@ -2312,23 +2322,20 @@ void map_def::write_full(writer& outf) const
     marshallUByte(outf, TAG_MAJOR_VERSION);
     marshallUByte(outf, TAG_MINOR_VERSION);
     marshallString4(outf, name);
-    prelude.write(outf);
-    mapchunk.write(outf);
-    main.write(outf);
-    validate.write(outf);
-    veto.write(outf);
-    epilogue.write(outf);
+    prelude.write_cached(outf);
+    mapchunk.write_cached(outf);
+    main.write_cached(outf);
+    validate.write_cached(outf);
+    veto.write_cached(outf);
+    epilogue.write_cached(outf);
 }
 
 void map_def::read_full(reader& inf, bool check_cache_version)
 {
-    // There's a potential race-condition here:
-    // - If someone modifies a .des file while there are games in progress,
-    // - a new Crawl process will overwrite the .dsc.
-    // - older Crawl processes trying to reading the new .dsc will be hosed.
-    // We could try to recover from the condition (by locking and
-    // reloading the index), but it's easier to save the game at this
-    // point and let the player reload.
+    // The map database is replaced, never rewritten in place, so a running
+    // game keeps reading the one it started with. Still, if it's been
+    // damaged, it's easier to save the game at this point and let the
+    // player reload.
 
     const uint8_t major = unmarshallUByte(inf);
     const uint8_t minor = unmarshallUByte(inf);
@@ -2406,18 +2413,27 @@ void map_def::load()
     if (!index_only)
         return;
 
-    const string descache_base = get_descache_path(cache_name, "");
-    file_lock deslock(descache_base + ".lk", "rb", false);
-    const string loadfile = descache_base + ".dsc";
+    // Decode the body straight from the mapped map database.
+    size_t avail = 0;
+    const unsigned char *body = map_db_at(cache_offset, &avail);
+    if (!body)
+    {
+        throw map_load_exception(
+                make_stringf("Map is not in the map database: %s",
+                             name.c_str()));
+    }
 
-    reader inf(loadfile, TAG_MINOR_VERSION);
-    if (!inf.valid())
+    reader inf(body, avail, TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+    try
+    {
+        read_full(inf, true);
+    }
+    catch (short_read_exception &E)
     {
         throw map_load_exception(
-                make_stringf("Map inf is invalid: %s", name.c_str()));
+                make_stringf("Map is truncated: %s", name.c_str()));
     }
-    inf.advance(cache_offset);
-    read_full(inf, true);
 
     index_only = false;
 }
@@ -2454,7 +2470,7 @@ static map_chance _unmarshall_map_chance(reader &th)
     return chance;
 }
 
-void map_def::write_index(writer& outf) const
+void map_def::write_index(writer& outf, bool cache_lua) const
 {
     if (!cache_offset)
     {
@@ -2473,7 +2489,10 @@ void map_def::write_index(writer& outf) const
     marshallString4(outf, tags);
     place.write(outf);
     depths.write(outf);
-    prelude.write(outf);
+    if (cache_lua)
+        prelude.write_cached(outf);
+    else
+        prelude.write(outf);
 }
 
 void map_def::read_maplines(reader &inf)
@@ -2510,7 +2529,17 @@ void map_def::set_file(const string &s)
     veto.set_file(s);
     epilogue.set_file(s);
     file = get_base_filename(s);
-    cache_name = get_cache_name(s);
+}
+
+// Compile the map's Lua, so that it goes into the map database as bytecode.
+void map_def::precompile_lua()
+{
+    prelude.precompile(dlua);
+    mapchunk.precompile(dlua);
+    main.precompile(dlua);
+    validate.precompile(dlua);
+    veto.precompile(dlua);
+    epilogue.precompile(dlua);
 }
 
 string map_def::run_lua(bool run_main)
@@ -3247,16 +3276,40 @@ void map_def::fixup()
     }
 }
 
+// Whether the space-separated list holds the tag [tag, tag + len).
+static bool _has_single_tag(const string &tags, const char *tag, size_t len)
+{
+    for (size_t pos = tags.find(tag, 0, len); pos != string::npos;
+         pos = tags.find(tag, pos + 1, len))
+    {
+        if (pos > 0 && tags[pos - 1] == ' '
+            && pos + len < tags.length() && tags[pos + len] == ' ')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool map_def::has_tag(const string &tagwanted) const
 {
     if (tags.empty() || tagwanted.empty())
         return false;
 
-    vector<string> wanted_tags = split_string(" ", tagwanted);
-
-    for (const string &tag : wanted_tags)
-        if (tags.find(" " + tag + " ") == string::npos)
-            return false;
+    // Every space-separated tag wanted must be present; don't make strings
+    // for them, as this is called for every map considered for a level.
+    const char *wanted = tagwanted.c_str();
+    const char *end = wanted + tagwanted.length();
+    while (wanted < end)
+    {
+        const char *tag_end = find(wanted, end, ' ');
+        if (tag_end != wanted)
+        {
+            if (!_has_single_tag(tags, wanted, tag_end - wanted))
+                return false;
+        }
+        wanted = tag_end + 1;
+    }
 
     return true;
 }
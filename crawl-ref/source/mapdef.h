@@ -47,8 +47,8 @@ static const int INVALID_HEIGHT = -31999;
 
 static const int BRANCH_END = 100;
 
-// Exception thrown when a map cannot be loaded from its .dsc file
-// because the .dsc file has changed under it.
+// Exception thrown when a map's body cannot be loaded from the map
+// database.
 struct map_load_exception : public runtime_error
 {
     // g++ 4.7 doesn't have inherited constructors, sadly
@@ -973,6 +973,7 @@ public:
     void clear() { depths.clear(); }
     bool empty() const { return depths.empty(); }
     bool is_usable_in(const level_id &lid) const;
+    bool may_include_branch(branch_type br) const;
     void add_depth(const level_range &range) { depths.push_back(range); }
     void add_depths(const depth_ranges &other_ranges);
     string describe() const;
@@ -1156,7 +1157,6 @@ private:
     bool            index_only;
     mutable long    cache_offset;
     string          file;
-    string          cache_name;
 
     typedef Matrix<bool> subvault_mask;
     subvault_mask *svmask;
@@ -1189,7 +1189,7 @@ public:
     coord_def find_first_glyph(int glyph) const;
     coord_def find_first_glyph(const string &glyphs) const;
 
-    void write_index(writer&) const;
+    void write_index(writer&, bool cache_lua = false) const;
     void write_full(writer&) const;
     void write_maplines(writer &) const;
 
@@ -1199,6 +1199,7 @@ public:
 
     void set_file(const string &s);
     string run_lua(bool skip_main);
+    void precompile_lua();
     bool run_hook(const string &hook_name, bool die_on_lua_error = false);
     bool run_postplace_hook(bool die_on_lua_error = false);
     void copy_hooks_from(const map_def &other_map, const string &hook_name);
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <unordered_map>
 #include <cstring>
 #include <sys/param.h>
 #include <sys/types.h>
@@ -16,6 +17,7 @@
 #include <unistd.h>
 #endif
 
+#include "bitary.h"
 #include "branch.h"
 #include "coord.h"
 #include "coordit.h"
@@ -26,6 +28,7 @@
 #include "files.h"
 #include "mapmark.h"
 #include "message.h"
+#include "player.h"
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
@@ -655,6 +658,168 @@ static map_section_type _apply_vault_definition(
     return orient == MAP_NONE ? MAP_NORTH : orient;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Map index
+
+// A set of maps, as a bitset over vdefs.
+typedef vector<uint64_t> map_bitset;
+
+/**
+ * Which maps could be picked for what, made when first needed after the maps
+ * change. Selection looks only at the maps in the sets that matter to it, in
+ * vdefs order, and still checks every map it looks at: the index only rules
+ * out maps that can't be accepted, so what's picked is unchanged.
+ */
+struct map_index
+{
+    bool built;
+    // Interned tags, and the maps with each.
+    unordered_map<string, int> tag_ids;
+    vector<map_bitset> tagged;
+    // Maps with a DEPTH: or PLACE: that might include some level of the
+    // branch.
+    map_bitset depth_in[NUM_BRANCHES];
+    map_bitset place_in[NUM_BRANCHES];
+    map_bitset no_depth;
+
+    map_index() : built(false) { }
+};
+
+static map_index vindex;
+
+static void _set_map_bit(map_bitset &bits, unsigned int i)
+{
+    bits[i / 64] |= (uint64_t) 1 << (i % 64);
+}
+
+static void _build_map_index()
+{
+    const unsigned int words = (vdefs.size() + 63) / 64;
+    vindex.tag_ids.clear();
+    vindex.tagged.clear();
+    for (int br = 0; br < NUM_BRANCHES; ++br)
+    {
+        vindex.depth_in[br].assign(words, 0);
+        vindex.place_in[br].assign(words, 0);
+    }
+    vindex.no_depth.assign(words, 0);
+
+    for (unsigned int i = 0; i < vdefs.size(); ++i)
+    {
+        const map_def &mapdef = vdefs[i];
+        for (const string &tag : mapdef.get_tags())
+        {
+            auto id = vindex.tag_ids.emplace(tag, vindex.tagged.size());
+            if (id.second)
+                vindex.tagged.emplace_back(words, 0);
+            _set_map_bit(vindex.tagged[id.first->second], i);
+        }
+
+        for (int br = 0; br < NUM_BRANCHES; ++br)
+        {
+            const branch_type branch = static_cast<branch_type>(br);
+            if (mapdef.depths.may_include_branch(branch))
+                _set_map_bit(vindex.depth_in[br], i);
+            if (mapdef.place.may_include_branch(branch))
+                _set_map_bit(vindex.place_in[br], i);
+        }
+        if (!mapdef.has_depth())
+            _set_map_bit(vindex.no_depth, i);
+    }
+    vindex.built = true;
+}
+
+static const map_index &_map_index()
+{
+    if (!vindex.built)
+        _build_map_index();
+    return vindex;
+}
+
+// The maps with every one of the space-separated tags, as has_tag() sees it.
+static map_bitset _maps_with_tags(const string &tags)
+{
+    const map_index &index = _map_index();
+    const vector<string> wanted = split_string(" ", tags);
+    if (wanted.empty())
+    {
+        // Leave has_tag() to make what it will of that.
+        return map_bitset(index.no_depth.size(), ~(uint64_t) 0);
+    }
+
+    map_bitset bits;
+    for (const string &tag : wanted)
+    {
+        auto id = index.tag_ids.find(tag);
+        if (id == index.tag_ids.end())
+            return map_bitset(index.no_depth.size(), 0);
+        const map_bitset &tagged = index.tagged[id->second];
+        if (bits.empty())
+            bits = tagged;
+        else
+            for (unsigned int w = 0; w < bits.size(); ++w)
+                bits[w] &= tagged[w];
+    }
+    return bits;
+}
+
+// Keep (or, if !with, drop) only the maps with the tag.
+static void _filter_by_tag(map_bitset &bits, const string &tag, bool with)
+{
+    const map_index &index = _map_index();
+    auto id = index.tag_ids.find(tag);
+    if (id == index.tag_ids.end())
+    {
+        if (with)
+            bits.assign(bits.size(), 0);
+        return;
+    }
+    const map_bitset &tagged = index.tagged[id->second];
+    for (unsigned int w = 0; w < bits.size(); ++w)
+        bits[w] &= with ? tagged[w] : ~tagged[w];
+}
+
+static void _filter_by_extra(map_bitset &bits, maybe_bool want_extra)
+{
+    if (want_extra != MB_MAYBE)
+        _filter_by_tag(bits, "extra", want_extra == MB_TRUE);
+}
+
+// Keep only maps usable somewhere in the branch, or with no DEPTH at all.
+static void _filter_by_depth(map_bitset &bits, const level_id &place,
+                             bool allow_no_depth)
+{
+    if (place.branch < 0 || place.branch >= NUM_BRANCHES)
+        return;
+    const map_index &index = _map_index();
+    for (unsigned int w = 0; w < bits.size(); ++w)
+    {
+        bits[w] &= index.depth_in[place.branch][w]
+                   | (allow_no_depth ? index.no_depth[w] : 0);
+    }
+}
+
+// Call f with the index of each map in the set, in vdefs order.
+template <typename F>
+static void _for_each_map(const map_bitset &bits, F f)
+{
+    for (unsigned int w = 0; w < bits.size(); ++w)
+        for (uint64_t word = bits[w]; word; word &= word - 1)
+            f(w * 64 + lowest_bit(word));
+}
+
+// The maps are being changed; forget what the index knows of them.
+static void _invalidate_map_index()
+{
+    vindex.built = false;
+}
+
+void note_map_changed(const map_def &map)
+{
+    if (!vdefs.empty() && &map >= &vdefs.front() && &map <= &vdefs.back())
+        _invalidate_map_index();
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Map lookups
 
@@ -697,7 +862,7 @@ const map_def *find_map_by_name(const string &name)
 }
 
 // Discards Lua code loaded by all maps to reduce memory use. If any stripped
-// map is reused, its data will be reloaded from the .dsc
+// map is reused, its data will be reloaded from the map database
 void strip_all_maps()
 {
     for (map_def &mapdef : vdefs)
@@ -721,8 +886,14 @@ mapref_vector find_maps_for_tag(const string &tag,
     mapref_vector maps;
     level_id place = level_id::current();
 
-    for (const map_def &mapdef : vdefs)
+    map_bitset candidates = _maps_with_tags(tag);
+    _filter_by_tag(candidates, "dummy", false);
+    if (check_depth)
+        _filter_by_depth(candidates, place, true);
+
+    _for_each_map(candidates, [&](unsigned int i)
     {
+        const map_def &mapdef = vdefs[i];
         if (mapdef.has_tag(tag)
             && !mapdef.has_tag("dummy")
             && (!check_depth || !mapdef.has_depth()
@@ -731,7 +902,7 @@ mapref_vector find_maps_for_tag(const string &tag,
         {
             maps.push_back(&mapdef);
         }
-    }
+    });
     return maps;
 }
 
@@ -749,6 +920,7 @@ private:
 public:
     bool accept(const map_def &md) const;
     void announce(const map_def *map) const;
+    map_bitset candidates() const;
 
     bool valid() const
     {
@@ -890,6 +1062,48 @@ bool map_selector::accept(const map_def &mapdef) const
     }
 }
 
+// The maps accept() might take, leaving out those the index shows it won't.
+map_bitset map_selector::candidates() const
+{
+    const map_index &index = _map_index();
+    map_bitset bits;
+
+    switch (sel)
+    {
+    case PLACE:
+        if (place.branch < 0 || place.branch >= NUM_BRANCHES)
+            return map_bitset(index.no_depth.size(), 0);
+        bits = index.place_in[place.branch];
+        _filter_by_tag(bits, "minivault", mini);
+        _filter_by_extra(bits, extra);
+        break;
+
+    case DEPTH:
+    case DEPTH_AND_CHANCE:
+        bits.assign(index.no_depth.size(), ~(uint64_t) 0);
+        _filter_by_depth(bits, place, false);
+        if (sel == DEPTH)
+            _filter_by_tag(bits, "minivault", mini);
+        _filter_by_extra(bits, extra);
+        // As in depth_selectable().
+        _filter_by_tag(bits, "unrand", false);
+        _filter_by_tag(bits, "place_unique", false);
+        _filter_by_tag(bits, "tutorial", false);
+        break;
+
+    case TAG:
+        bits = _maps_with_tags(tag);
+        if (check_depth)
+            _filter_by_depth(bits, place, true);
+        break;
+
+    default:
+        bits.assign(index.no_depth.size(), ~(uint64_t) 0);
+        break;
+    }
+    return bits;
+}
+
 void map_selector::announce(const map_def *vault) const
 {
 #ifdef DEBUG_DIAGNOSTICS
@@ -936,9 +1150,11 @@ static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 
     if (sel.valid())
     {
-        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
-            if (sel.accept(vdefs[i]))
+        _for_each_map(sel.candidates(), [&](unsigned int i)
+        {
+            if (i < vdefs.size() && sel.accept(vdefs[i]))
                 eligible.push_back(i);
+        });
     }
 
     return eligible;
@@ -1212,206 +1428,258 @@ static void _check_des_index_dir()
     checked_des_index_dir = true;
 }
 
-string get_descache_path(const string &file, const string &ext)
+////////////////////////////////////////////////////////////////////////////
+// The compiled map database.
+//
+// Every .des file's global prelude, map index entries and map bodies are
+// kept together in des/maps.db, which is mapped read-only into memory and
+// so shared by every Crawl process using it. A map's body is decoded from
+// the mapping only when the map is used.
+//
+// When a .des file has changed, the whole database is written out again to
+// a new file which is renamed over the old one: processes that have the old
+// one mapped carry on with it undisturbed.
+//
+// Layout, marshalled as in save files:
+//   major, minor and word length, then the offset of the file table (Int);
+//   for each .des file, its global prelude, then the body of each of its
+//   maps (map_def::write_full()), then each map's index entry;
+//   the file table: the number of .des files, then for each its cache name,
+//   modification time, prelude offset, number of maps and the offset of
+//   each map's index entry.
+
+// Where a .des file's maps are in the database.
+struct map_db_entry
+{
+    int64_t mtime;
+    uint32_t prelude;
+    vector<uint32_t> indices;
+};
+
+static unique_ptr<mapped_file> map_db;
+static map<string, map_db_entry> map_db_files;
+
+// The .des files read since the maps were last (re)read, in order, for
+// writing the database out again.
+struct des_file_maps
 {
-    const string basename = change_file_extension(get_base_filename(file), ext);
-    return _des_cache_dir(basename);
-}
+    string cache_name;
+    int64_t mtime;
+    dlua_chunk prelude;
+    size_t first_map, last_map;
+};
+static vector<des_file_maps> des_files_read;
+// Some .des file wasn't in the database, or has changed since.
+static bool map_db_stale = false;
+static bool reading_maps = false;
+
+static const int MAP_DB_HEADER_SIZE = 7;
 
-static bool verify_file_version(const string &file, time_t mtime)
+static string _map_db_path()
 {
-    FILE *fp = fopen_u(file.c_str(), "rb");
-    if (!fp)
-        return false;
-    try
-    {
-        reader inf(fp);
-        const uint8_t major = unmarshallUByte(inf);
-        const uint8_t minor = unmarshallUByte(inf);
-        const int8_t word = unmarshallByte(inf);
-        const int64_t t = unmarshallSigned(inf);
-        fclose(fp);
-        return major == TAG_MAJOR_VERSION
-               && minor <= TAG_MINOR_VERSION
-               && word == WORD_LEN
-               && t == mtime;
-    }
-    catch (short_read_exception &E)
-    {
-        fclose(fp);
-        return false;
-    }
+    return _des_cache_dir("maps.db");
 }
 
-static bool _verify_map_index(const string &base, time_t mtime)
+// The reader for the database from offset on, which must be in it.
+static reader _map_db_reader(size_t offset)
 {
-    return verify_file_version(base + ".idx", mtime);
+    if (!map_db || offset >= map_db->size())
+        throw short_read_exception();
+    reader inf(map_db->data() + offset, map_db->size() - offset,
+               TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+    return inf;
 }
 
-static bool _verify_map_full(const string &base, time_t mtime)
+const unsigned char *map_db_at(size_t offset, size_t *avail)
 {
-    return verify_file_version(base + ".dsc", mtime);
+    if (!map_db || !offset || offset >= map_db->size())
+        return nullptr;
+    *avail = map_db->size() - offset;
+    return map_db->data() + offset;
 }
 
-static bool _load_map_index(const string& cache, const string &base,
-                            time_t mtime)
+static bool _read_map_db_table()
 {
-    // If there's a global prelude, load that first.
-    if (FILE *fp = fopen_u((base + ".lux").c_str(), "rb"))
-    {
-        reader inf(fp, TAG_MINOR_VERSION);
-        uint8_t major = unmarshallUByte(inf);
-        uint8_t minor = unmarshallUByte(inf);
-        int8_t word = unmarshallByte(inf);
-        int64_t t = unmarshallSigned(inf);
-        if (major != TAG_MAJOR_VERSION || minor > TAG_MINOR_VERSION
-            || word != WORD_LEN || t != mtime)
-        {
-            return false;
-        }
-
-        lc_global_prelude.read(inf);
-        fclose(fp);
-
-        global_preludes.push_back(lc_global_prelude);
-    }
-
-    FILE* fp = fopen_u((base + ".idx").c_str(), "rb");
-    if (!fp)
-        end(1, true, "Unable to read %s", (base + ".idx").c_str());
-
-    reader inf(fp, TAG_MINOR_VERSION);
-    // Re-check version, might have been modified in the meantime.
-    uint8_t major = unmarshallUByte(inf);
-    uint8_t minor = unmarshallUByte(inf);
-    int8_t word = unmarshallByte(inf);
-    int64_t t = unmarshallSigned(inf);
+    reader inf = _map_db_reader(0);
+    const uint8_t major = unmarshallUByte(inf);
+    const uint8_t minor = unmarshallUByte(inf);
+    const int8_t word = unmarshallByte(inf);
     if (major != TAG_MAJOR_VERSION || minor > TAG_MINOR_VERSION
-        || word != WORD_LEN || t != mtime)
+        || word != WORD_LEN)
     {
         return false;
     }
-
 #if TAG_MAJOR_VERSION == 34
     // Throw out pre-ORDER: indices entirely.
     if (minor < TAG_MINOR_MAP_ORDER)
         return false;
+    // And rebuild databases from before chunks kept their bytecode.
+    if (minor < TAG_MINOR_LUA_BYTECODE)
+        return false;
 #endif
 
-    const int nmaps = unmarshallShort(inf);
-    const int nexist = vdefs.size();
-    vdefs.resize(nexist + nmaps, map_def());
-    for (int i = 0; i < nmaps; ++i)
+    reader table = _map_db_reader((uint32_t) unmarshallInt(inf));
+    const int nfiles = unmarshallInt(table);
+    for (int i = 0; i < nfiles; ++i)
     {
-        map_def &vdef(vdefs[nexist + i]);
-        vdef.read_index(inf);
-        vdef.description = unmarshallString(inf);
-        vdef.order = unmarshallInt(inf);
-
-        vdef.set_file(cache);
-        lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
-        vdef.place_loaded_from.clear();
+        string cache_name;
+        unmarshallString4(table, cache_name);
+        map_db_entry &entry = map_db_files[cache_name];
+        entry.mtime = unmarshallSigned(table);
+        entry.prelude = unmarshallInt(table);
+        const int nmaps = unmarshallInt(table);
+        for (int j = 0; j < nmaps; ++j)
+            entry.indices.push_back(unmarshallInt(table));
     }
-    fclose(fp);
-
     return true;
 }
 
-static bool _load_map_cache(const string &filename, const string &cachename)
+static void _open_map_db()
 {
-    _check_des_index_dir();
-    const string descache_base = get_descache_path(cachename, "");
-
-    file_lock deslock(descache_base + ".lk", "rb", false);
+    map_db_files.clear();
+    map_db.reset(new mapped_file(_map_db_path().c_str()));
 
-    time_t mtime = file_modtime(filename);
-    string file_idx = descache_base + ".idx";
-    string file_dsc = descache_base + ".dsc";
-
-    // What's the point in checking these twice (here and in load_ma_index)?
-    if (!_verify_map_index(descache_base, mtime)
-        || !_verify_map_full(descache_base, mtime))
+    bool ok = false;
+    try
+    {
+        ok = map_db->valid() && _read_map_db_table();
+    }
+    catch (short_read_exception &E)
     {
-        return false;
     }
 
-    return _load_map_index(cachename, descache_base, mtime);
+    if (!ok)
+    {
+        map_db.reset();
+        map_db_files.clear();
+    }
 }
 
-static void _write_map_prelude(const string &filebase, time_t mtime)
+// Load the index entries of a .des file's maps, and its global prelude, from
+// the database, if it has them for this version of the file.
+static bool _load_map_db_entry(const string &cache_name, time_t mtime)
 {
-    const string luafile = filebase + ".lux";
-    if (lc_global_prelude.empty())
+    auto entry = map_db_files.find(cache_name);
+    if (entry == map_db_files.end() || entry->second.mtime != mtime)
+        return false;
+
+    const size_t nexist = vdefs.size();
+    try
     {
-        unlink_u(luafile.c_str());
-        return;
+        reader pinf = _map_db_reader(entry->second.prelude);
+        lc_global_prelude.read(pinf);
+
+        _invalidate_map_index();
+        vdefs.resize(nexist + entry->second.indices.size(), map_def());
+        for (unsigned int i = 0; i < entry->second.indices.size(); ++i)
+        {
+            map_def &vdef(vdefs[nexist + i]);
+            reader inf = _map_db_reader(entry->second.indices[i]);
+            vdef.read_index(inf);
+            vdef.description = unmarshallString(inf);
+            vdef.order = unmarshallInt(inf);
+
+            vdef.set_file(cache_name);
+            lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
+        }
+    }
+    catch (short_read_exception &E)
+    {
+        vdefs.resize(nexist);
+        lc_global_prelude.clear();
+        return false;
     }
 
-    FILE *fp = fopen_u(luafile.c_str(), "wb");
-    writer outf(luafile, fp);
-    marshallUByte(outf, TAG_MAJOR_VERSION);
-    marshallUByte(outf, TAG_MINOR_VERSION);
-    marshallByte(outf, WORD_LEN);
-    marshallSigned(outf, mtime);
-    lc_global_prelude.write(outf);
-    fclose(fp);
+    return true;
 }
 
-static void _write_map_full(const string &filebase, size_t vs, size_t ve,
-                            time_t mtime)
+static void _write_map_db_file(const string &path,
+                               const vector<unsigned char> &buf)
 {
-    const string cfile = filebase + ".dsc";
-    FILE *fp = fopen_u(cfile.c_str(), "wb");
+    FILE *fp = fopen_replace(path.c_str());
     if (!fp)
-        end(1, true, "Unable to open %s for writing", cfile.c_str());
-
-    writer outf(cfile, fp);
-    marshallUByte(outf, TAG_MAJOR_VERSION);
-    marshallUByte(outf, TAG_MINOR_VERSION);
-    marshallByte(outf, WORD_LEN);
-    marshallSigned(outf, mtime);
-    for (size_t i = vs; i < ve; ++i)
-        vdefs[i].write_full(outf);
-    fclose(fp);
+        end(1, true, "Unable to open %s for writing", path.c_str());
+    if (fwrite(buf.data(), 1, buf.size(), fp) != buf.size())
+        end(1, true, "Unable to write %s", path.c_str());
+    if (fclose(fp))
+        end(1, true, "Unable to write %s", path.c_str());
 }
 
-static void _write_map_index(const string &filebase, size_t vs, size_t ve,
-                             time_t mtime)
+// Write the database out again if it's missing any of the maps read, and
+// switch to it.
+static void _flush_map_db()
 {
-    const string cfile = filebase + ".idx";
-    FILE *fp = fopen_u(cfile.c_str(), "wb");
-    if (!fp)
-        end(1, true, "Unable to open %s for writing", cfile.c_str());
+    if (!map_db_stale)
+        return;
 
-    writer outf(cfile, fp);
+    _check_des_index_dir();
+    const string path = _map_db_path();
+    file_lock dblock(path + ".lk", "wb");
+
+    vector<unsigned char> buf;
+    writer outf(&buf);
     marshallUByte(outf, TAG_MAJOR_VERSION);
     marshallUByte(outf, TAG_MINOR_VERSION);
     marshallByte(outf, WORD_LEN);
-    marshallSigned(outf, mtime);
-    marshallShort(outf, ve > vs? ve - vs : 0);
-    for (size_t i = vs; i < ve; ++i)
+    marshallInt(outf, 0); // The file table's offset, filled in below.
+    ASSERT(buf.size() == MAP_DB_HEADER_SIZE);
+
+    map<string, map_db_entry> files;
+    for (const des_file_maps &file : des_files_read)
     {
-        vdefs[i].write_index(outf);
-        marshallString(outf, vdefs[i].description);
-        marshallInt(outf, vdefs[i].order);
-        vdefs[i].place_loaded_from.clear();
-        vdefs[i].strip();
+        map_db_entry &entry = files[file.cache_name];
+        entry.mtime = file.mtime;
+        entry.prelude = outf.tell();
+        dlua_chunk prelude = file.prelude;
+        prelude.precompile(dlua);
+        prelude.write_cached(outf);
+
+        // Maps from the old database have to be read from it before it goes;
+        // writing them out again points them at the new one.
+        for (size_t i = file.first_map; i < file.last_map; ++i)
+        {
+            vdefs[i].load();
+            vdefs[i].precompile_lua();
+            vdefs[i].write_full(outf);
+        }
+        for (size_t i = file.first_map; i < file.last_map; ++i)
+        {
+            map_def &vdef(vdefs[i]);
+            entry.indices.push_back(outf.tell());
+            vdef.write_index(outf, true);
+            marshallString(outf, vdef.description);
+            marshallInt(outf, vdef.order);
+            vdef.strip();
+        }
     }
-    fclose(fp);
-}
 
-static void _write_map_cache(const string &filename, size_t vs, size_t ve,
-                             time_t mtime)
-{
-    _check_des_index_dir();
+    const uint32_t table = outf.tell();
+    marshallInt(outf, files.size());
+    for (const auto &file : files)
+    {
+        marshallString4(outf, file.first);
+        marshallSigned(outf, file.second.mtime);
+        marshallInt(outf, file.second.prelude);
+        marshallInt(outf, file.second.indices.size());
+        for (uint32_t index : file.second.indices)
+            marshallInt(outf, index);
+    }
 
-    const string descache_base = get_descache_path(filename, "");
+    vector<unsigned char> offset;
+    writer offset_out(&offset);
+    marshallInt(offset_out, table);
+    copy(offset.begin(), offset.end(), buf.begin() + 3);
 
-    file_lock deslock(descache_base + ".lk", "wb");
+    const string tmp = path + ".new";
+    _write_map_db_file(tmp, buf);
+    if (rename_u(tmp.c_str(), path.c_str()))
+        end(1, true, "Unable to replace %s", path.c_str());
 
-    _write_map_prelude(descache_base, mtime);
-    _write_map_full(descache_base, vs, ve, mtime);
-    _write_map_index(descache_base, vs, ve, mtime);
+    map_db_stale = false;
+    _open_map_db();
+    if (!map_db)
+        end(1, false, "Unable to read back %s", path.c_str());
 }
 
 static void _parse_maps(const string &s)
@@ -1422,36 +1690,47 @@ static void _parse_maps(const string &s)
 
     map_files_read.insert(cache_name);
 
-    if (_load_map_cache(s, cache_name))
-        return;
+    des_file_maps file;
+    file.cache_name = cache_name;
+    file.mtime = file_modtime(s);
+    file.first_map = vdefs.size();
 
-    FILE *dat = fopen_u(s.c_str(), "r");
-    if (!dat)
-        end(1, true, "Failed to open %s for reading", s.c_str());
+    lc_global_prelude.clear();
+    if (!_load_map_db_entry(cache_name, file.mtime))
+    {
+        FILE *dat = fopen_u(s.c_str(), "r");
+        if (!dat)
+            end(1, true, "Failed to open %s for reading", s.c_str());
 
 #ifdef DEBUG_DIAGNOSTICS
-    printf("Regenerating des: %s\n", s.c_str());
+        printf("Regenerating des: %s\n", s.c_str());
 #endif
 
-    time_t mtime = file_modtime(dat);
-    _reset_map_parser();
+        _reset_map_parser();
 
-    extern int yyparse();
-    extern FILE *yyin;
-    yyin = dat;
+        extern int yyparse();
+        extern FILE *yyin;
+        yyin = dat;
 
-    const size_t file_start = vdefs.size();
-    yyparse();
-    fclose(dat);
+        yyparse();
+        fclose(dat);
+
+        map_db_stale = true;
+    }
 
     global_preludes.push_back(lc_global_prelude);
 
-    _write_map_cache(cache_name, file_start, vdefs.size(), mtime);
+    file.prelude = lc_global_prelude;
+    file.last_map = vdefs.size();
+    des_files_read.push_back(file);
 }
 
 void read_map(const string &file)
 {
     _parse_maps(lc_desfile = datafile_path(file));
+    // Maps read on their own, not by read_maps(), go into the database now.
+    if (!reading_maps)
+        _flush_map_db();
     _dgn_flush_map_environments();
     // Force GC to prevent heap from swelling unnecessarily.
     dlua.gc();
@@ -1459,8 +1738,14 @@ void read_map(const string &file)
 
 void read_maps()
 {
-    if (dlua.execfile("dlua/loadmaps.lua", true, true, true))
-        end(1, false, "Lua error: %s", dlua.error.c_str());
+    _open_map_db();
+
+    {
+        unwind_bool reading(reading_maps, true);
+        if (dlua.execfile("dlua/loadmaps.lua", true, true, true))
+            end(1, false, "Lua error: %s", dlua.error.c_str());
+    }
+    _flush_map_db();
 
     lc_loaded_maps.clear();
 
@@ -1473,7 +1758,7 @@ void read_maps()
     }
 }
 
-// If a .dsc file has been changed under the running Crawl, discard
+// If the map database has been changed under the running Crawl, discard
 // all map knowledge and reload maps. This will not affect maps that
 // have already been used, but it might trigger exciting happenings if
 // the new maps fail sanity checks or remove maps that the game
@@ -1485,7 +1770,10 @@ void reread_maps()
 
     // BOOM!
     vdefs.clear();
+    _invalidate_map_index();
     map_files_read.clear();
+    des_files_read.clear();
+    global_preludes.clear();
     read_maps();
 }
 
@@ -1504,6 +1792,7 @@ void add_parsed_map(const map_def &md)
 
     map.fixup();
     vdefs.push_back(map);
+    _invalidate_map_index();
 }
 
 void run_map_global_preludes()
@@ -1620,3 +1909,52 @@ void mapstat_report_random_maps(FILE *outf, const level_id &place)
 }
 
 #endif //DEBUG_STATISTICS
+
+#ifdef DEBUG_TESTS
+/**
+ * The maps a pick would choose among, in the order it would consider them.
+ *
+ * @param pick How to pick them, and for where.
+ * @param scan Whether to look at every map rather than go through the map
+ *             index, as picking maps did before there was one.
+ * @return The maps' names.
+ */
+vector<string> eligible_map_names(const map_pick &pick, bool scan)
+{
+    unwind_var<branch_type> branch(you.where_are_you, pick.place.branch);
+    unwind_var<int> depth(you.depth, pick.place.depth);
+
+    const map_selector sel =
+        pick.by == map_pick::PLACE
+            ? map_selector::by_place(pick.place, pick.mini, pick.extra) :
+        pick.by == map_pick::DEPTH
+            ? map_selector::by_depth(pick.place, pick.mini, pick.extra) :
+        pick.by == map_pick::CHANCE
+            ? map_selector::by_depth_chance(pick.place, pick.extra)
+            : map_selector::by_tag(pick.tag, pick.check_depth, false,
+                                   MB_MAYBE, pick.place);
+
+    vector<string> names;
+    if (!scan)
+    {
+        for (unsigned int i : _eligible_maps_for_selector(sel))
+            names.push_back(vdefs[i].name);
+    }
+    else if (sel.valid())
+    {
+        for (const map_def &map : vdefs)
+            if (sel.accept(map))
+                names.push_back(map.name);
+    }
+    return names;
+}
+
+// Every tag in the map index.
+vector<string> map_index_tags()
+{
+    vector<string> tags;
+    for (const auto &entry : _map_index().tag_ids)
+        tags.push_back(entry.first);
+    return tags;
+}
+#endif
@@ -48,6 +48,22 @@ mapref_vector random_chance_maps_in_depth(const level_id &place,
 
 void dump_map(const map_def &map);
 void add_parsed_map(const map_def &md);
+void note_map_changed(const map_def &map);
+#ifdef DEBUG_TESTS
+// A way of picking maps, as random_map_for_place(), random_map_in_depth(),
+// random_chance_maps_in_depth() and random_map_for_tag() do.
+struct map_pick
+{
+    enum { PLACE, DEPTH, CHANCE, TAG } by;
+    level_id place;
+    bool mini;          // PLACE and DEPTH
+    maybe_bool extra;   // all but TAG
+    string tag;         // TAG
+    bool check_depth;   // TAG
+};
+vector<string> eligible_map_names(const map_pick &pick, bool scan);
+vector<string> map_index_tags();
+#endif
 
 vector<string> find_map_matches(const string &name);
 
@@ -60,7 +76,7 @@ void reread_maps();
 void read_map(const string &file);
 void run_map_global_preludes();
 void run_map_local_preludes();
-string get_descache_path(const string &file, const string &ext);
+const unsigned char *map_db_at(size_t offset, size_t *avail);
 
 typedef map<string, map_file_place> map_load_info_t;
 
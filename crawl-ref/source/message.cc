@@ -655,6 +655,7 @@ class message_store
     message_item prev_msg;
     bool last_of_turn;
     int temp; // number of temporary messages
+    unsigned int generation; // bumped whenever msgs changes
 
 #ifdef USE_TILE_WEB
     int unsent; // number of messages not yet sent to the webtiles client
@@ -663,7 +664,7 @@ class message_store
 #endif
 
 public:
-    message_store() : last_of_turn(false), temp(0)
+    message_store() : last_of_turn(false), temp(0), generation(0)
 #ifdef USE_TILE_WEB
                       , unsent(0), client_rollback(0), send_ignore_one(false)
 #endif
@@ -688,6 +689,7 @@ public:
     {
         prefix_type p = P_NONE;
         msgs.push_back(msg);
+        ++generation;
         if (_temporary)
             temp++;
         else
@@ -710,6 +712,8 @@ public:
         unsent = max(0, unsent - temp);
 #endif
         msgs.roll_back(temp);
+        if (temp)
+            ++generation;
         temp = 0;
     }
 
@@ -752,9 +756,15 @@ public:
         return msgs;
     }
 
+    unsigned int change_generation() const
+    {
+        return generation;
+    }
+
     void clear()
     {
         msgs.clear();
+        ++generation;
         prev_msg = message_item();
         last_of_turn = false;
         temp = 0;
@@ -1813,6 +1823,11 @@ void save_messages(writer& outf)
     }
 }
 
+unsigned int messages_generation()
+{
+    return buffer.change_generation();
+}
+
 void load_messages(reader& inf)
 {
     unwind_bool save_more(crawl_state.show_more_prompt, false);
@@ -106,6 +106,8 @@ void webtiles_send_last_messages(int n = 20);
 
 void save_messages(writer& outf);
 void load_messages(reader& inf);
+// Bumped whenever what save_messages() writes changes.
+unsigned int messages_generation();
 void clear_message_store();
 
 // Have any messages been printed since the last clear?
@@ -2175,7 +2175,7 @@ static bool _seal_doors_and_stairs(const monster* warden,
             {
                 for (const auto &dc : all_door)
                 {
-                    if (env.map_knowledge(dc).seen())
+                    if (env.map_knowledge.get(dc).seen())
                     {
                         env.map_knowledge(dc).set_feature(DNGN_CLOSED_DOOR);
 #ifdef USE_TILE
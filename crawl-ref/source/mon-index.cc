@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief Index of occupied monster slots, with a coarse spatial grid.
+**/
+
+#include "AppHdr.h"
+
+#include "mon-index.h"
+
+#include "bitary.h"
+#include "env.h"
+
+static int _bucket_at(const coord_def &pos)
+{
+    const int x = max(0, min(pos.x, GXM - 1)) / MON_BUCKET_SIZE;
+    const int y = max(0, min(pos.y, GYM - 1)) / MON_BUCKET_SIZE;
+    return x * MON_BUCKETS_Y + y;
+}
+
+// The menv slot holding mon, or -1 for the anonymous monsters and for
+// monster objects living outside menv (temporary copies and the like).
+static int _slot_of(const monster *mon)
+{
+    if (mon < menv.buffer() || mon >= menv.buffer() + MAX_MONSTERS)
+        return -1;
+    return mon - menv.buffer();
+}
+
+monster_index::monster_index()
+{
+    clear();
+}
+
+void monster_index::clear()
+{
+    memset(live, 0, sizeof(live));
+    memset(buckets, 0, sizeof(buckets));
+    memset(bucket_of, 0, sizeof(bucket_of));
+    peak = 0;
+}
+
+// Resynchronise with menv wholesale, after a level has been loaded.
+void monster_index::rebuild()
+{
+    clear();
+    for (int i = 0; i < MAX_MONSTERS; ++i)
+        if (menv[i].type != MONS_NO_MONSTER)
+            add(i);
+}
+
+void monster_index::place_in_bucket(int mindex, const coord_def &pos)
+{
+    const uint64_t bit = 1ULL << (mindex & 63);
+    const int w = mindex >> 6;
+
+    // A slot that isn't live has no bucket bit, so this is harmless then.
+    buckets[bucket_of[mindex]][w] &= ~bit;
+    bucket_of[mindex] = _bucket_at(pos);
+    buckets[bucket_of[mindex]][w] |= bit;
+}
+
+void monster_index::add(int mindex)
+{
+    ASSERT_RANGE(mindex, 0, MAX_MONSTERS);
+    live[mindex >> 6] |= 1ULL << (mindex & 63);
+    place_in_bucket(mindex, menv[mindex].pos());
+    peak = max(peak, mindex + 1);
+}
+
+void monster_index::remove(const monster *mon)
+{
+    const int mindex = _slot_of(mon);
+    if (mindex < 0)
+        return;
+
+    const uint64_t bit = 1ULL << (mindex & 63);
+    live[mindex >> 6] &= ~bit;
+    buckets[bucket_of[mindex]][mindex >> 6] &= ~bit;
+}
+
+void monster_index::update(const monster *mon)
+{
+    const int mindex = _slot_of(mon);
+    if (mindex >= 0)
+        update(mindex);
+}
+
+// The monster in this slot has moved, or might have come into being.
+void monster_index::update(int mindex)
+{
+    ASSERT_RANGE(mindex, 0, MAX_MONSTERS);
+    if (live[mindex >> 6] & (1ULL << (mindex & 63)))
+        place_in_bucket(mindex, menv[mindex].pos());
+    else if (menv[mindex].type != MONS_NO_MONSTER)
+        add(mindex);
+}
+
+// Is this slot indexed, in the bucket its monster is really standing in?
+bool monster_index::covers(int mindex) const
+{
+    ASSERT_RANGE(mindex, 0, MAX_MONSTERS);
+    const uint64_t bit = 1ULL << (mindex & 63);
+    const int b = _bucket_at(menv[mindex].pos());
+    return (live[mindex >> 6] & bit)
+           && bucket_of[mindex] == b
+           && (buckets[b][mindex >> 6] & bit);
+}
+
+int monster_index::first_free() const
+{
+    for (int w = 0; w < MON_INDEX_WORDS; ++w)
+        if (~live[w])
+            return min((w << 6) + lowest_bit(~live[w]), (int)MAX_MONSTERS);
+    return MAX_MONSTERS;
+}
+
+// Start counting afresh from the slots currently in use.
+void monster_index::reset_high_water()
+{
+    peak = 0;
+    for (int w = MON_INDEX_WORDS - 1; w >= 0 && !peak; --w)
+        for (int b = 63; b >= 0; --b)
+            if (live[w] & (1ULL << b))
+            {
+                peak = (w << 6) + b + 1;
+                break;
+            }
+}
+
+int monster_index::next(int after) const
+{
+    const int start = after + 1;
+    if (start >= MAX_MONSTERS)
+        return MAX_MONSTERS;
+
+    int w = start >> 6;
+    uint64_t word = live[w] & (~0ULL << (start & 63));
+    while (!word)
+    {
+        if (++w >= MON_INDEX_WORDS)
+            return MAX_MONSTERS;
+        word = live[w];
+    }
+    return (w << 6) + lowest_bit(word);
+}
+
+int monster_index::next_near(int after, const coord_def &center) const
+{
+    const int start = after + 1;
+    if (start >= MAX_MONSTERS)
+        return MAX_MONSTERS;
+
+    const int x1 = max(center.x - LOS_MAX_RANGE, 0);
+    const int x2 = min(center.x + LOS_MAX_RANGE, GXM - 1);
+    const int y1 = max(center.y - LOS_MAX_RANGE, 0);
+    const int y2 = min(center.y + LOS_MAX_RANGE, GYM - 1);
+    if (x1 > x2 || y1 > y2)
+        return MAX_MONSTERS;
+
+    const int bx1 = x1 / MON_BUCKET_SIZE, bx2 = x2 / MON_BUCKET_SIZE;
+    const int by1 = y1 / MON_BUCKET_SIZE, by2 = y2 / MON_BUCKET_SIZE;
+
+    uint64_t mask = ~0ULL << (start & 63);
+    for (int w = start >> 6; w < MON_INDEX_WORDS; ++w)
+    {
+        uint64_t word = 0;
+        for (int bx = bx1; bx <= bx2; ++bx)
+            for (int by = by1; by <= by2; ++by)
+                word |= buckets[bx * MON_BUCKETS_Y + by][w];
+
+        word &= mask;
+        if (word)
+            return (w << 6) + lowest_bit(word);
+        mask = ~0ULL;
+    }
+    return MAX_MONSTERS;
+}
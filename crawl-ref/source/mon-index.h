@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief Index of occupied monster slots, with a coarse spatial grid.
+**/
+
+#ifndef MON_INDEX_H
+#define MON_INDEX_H
+
+class monster;
+
+// Side length of a square spatial bucket, in cells.
+#define MON_BUCKET_SIZE 8
+#define MON_BUCKETS_X ((GXM + MON_BUCKET_SIZE - 1) / MON_BUCKET_SIZE)
+#define MON_BUCKETS_Y ((GYM + MON_BUCKET_SIZE - 1) / MON_BUCKET_SIZE)
+#define MON_INDEX_WORDS ((MAX_MONSTERS + 63) / 64)
+
+/**
+ * Which menv slots hold a monster, and which bucket of the map each of them
+ * is standing in.
+ *
+ * The set of slots is a superset of the living monsters (a slot is entered
+ * as soon as get_free_monster() hands it out), so iterators still have to
+ * check alive(). Slots are always visited in ascending index order, exactly
+ * like a plain walk over menv, so seeded games are unaffected.
+ */
+class monster_index
+{
+public:
+    monster_index();
+
+    void clear();
+    void rebuild();
+
+    void add(int mindex);
+    void remove(const monster *mon);
+    void update(const monster *mon);
+    void update(int mindex);
+
+    bool covers(int mindex) const;
+
+    // Lowest slot not in the index, or MAX_MONSTERS if there is none.
+    int first_free() const;
+    // One past the highest slot entered since the last reset.
+    int high_water() const { return peak; }
+    void reset_high_water();
+
+    // First slot after the given one, or MAX_MONSTERS if there is none.
+    int next(int after) const;
+    // As next(), but only slots in buckets within LOS_MAX_RANGE of center.
+    int next_near(int after, const coord_def &center) const;
+
+private:
+    uint64_t live[MON_INDEX_WORDS];
+    uint64_t buckets[MON_BUCKETS_X * MON_BUCKETS_Y][MON_INDEX_WORDS];
+    uint8_t bucket_of[MAX_MONSTERS];
+    int peak;
+
+    void place_in_bucket(int mindex, const coord_def &pos);
+};
+
+#endif
@@ -169,27 +169,30 @@ static bool _blocked_ray(const coord_def &where,
     return true;
 }
 
-static bool _is_public_key(string key)
+// The props monster_info copies from the monster: interned, since every prop
+// of every monster in view is checked against these every turn.
+static const vector<prop_key> _public_keys =
 {
-    if (key == "helpless"
-     || key == "wand_known"
-     || key == "feat_type"
-     || key == "glyph"
-     || key == "dbname"
-     || key == "monster_tile"
+    prop_key("helpless"),
+    prop_key("wand_known"),
+    prop_key("feat_type"),
+    prop_key("glyph"),
+    prop_key("dbname"),
+    prop_key("monster_tile"),
 #ifdef USE_TILE
-     || key == TILE_NUM_KEY
+    prop_key(TILE_NUM_KEY),
 #endif
-     || key == "tile_idx"
-     || key == CUSTOM_SPELLS_KEY
-     || key == ELVEN_IS_ENERGIZED_KEY
-     || key == MUTANT_BEAST_FACETS
-     || key == MUTANT_BEAST_TIER)
-    {
-        return true;
-    }
+    prop_key("tile_idx"),
+    prop_key(CUSTOM_SPELLS_KEY),
+    prop_key(ELVEN_IS_ENERGIZED_KEY),
+    prop_key(MUTANT_BEAST_FACETS),
+    prop_key(MUTANT_BEAST_TIER),
+};
 
-    return false;
+static bool _is_public_key(const prop_key &key)
+{
+    return find(_public_keys.begin(), _public_keys.end(), key)
+           != _public_keys.end();
 }
 
 static int quantise(int value, int stepsize)
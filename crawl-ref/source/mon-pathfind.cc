@@ -18,17 +18,157 @@
 // The pathfinding is an implementation of the A* algorithm. Beginning at the
 // monster position we check all neighbours of a given grid, estimate the
 // distance needed for any shortest path including this grid and push the
-// result into a hash. We can then easily access all points with the shortest
-// distance estimates and then check _their_ neighbours and so on.
+// result into a bucket queue. We can then easily access all points with the
+// shortest distance estimates and then check _their_ neighbours and so on.
 // The algorithm terminates once we reach the destination since - because
-// of the sorting of grids by shortest distance in the hash - there can be no
+// of the sorting of grids by shortest distance in the queue - there can be no
 // path between start and target that is shorter than the current one. There
 // could be other paths that have the same length but that has no real impact.
-// If the hash has been cleared and the start grid has not been encountered,
+// If the queue has been emptied and the start grid has not been encountered,
 // then there's no path that matches the requirements fed into monster_pathfind.
 // (These requirements are usually preference of habitat of a specific monster
 // or a limit of the distance between start and any grid on the path.)
 
+// Estimated total path lengths are always below this.
+#define PATHFIND_BUCKETS (GXM * GYM)
+
+static inline int _cell_index(const coord_def &p)
+{
+    return p.x * GYM + p.y;
+}
+
+static inline coord_def _cell_at(int c)
+{
+    return coord_def(c / GYM, c % GYM);
+}
+
+// The working state of a search. At well over 100KB it's far too big to set
+// up for every monster that wants a path, so contexts are pooled and reused,
+// and per-cell and per-bucket data only counts as set when its stamp matches
+// the generation of the current search.
+struct pathfind_context
+{
+    uint32_t generation;
+
+    uint32_t cell_stamp[GXM * GYM];
+    // Distance from start to any already tried point.
+    int dist[GXM * GYM];
+    // Where we came from on a given shortest path.
+    int8_t prev[GXM * GYM];
+    // Whether the point is waiting in the queue.
+    bool queued[GXM * GYM];
+    // Links of the doubly linked list of points in the same bucket.
+    int16_t link_prev[GXM * GYM];
+    int16_t link_next[GXM * GYM];
+
+    // Points are bucketed by estimated total path length, and within a
+    // bucket taken from the tail, i.e. the most recently added first.
+    uint32_t bucket_stamp[PATHFIND_BUCKETS];
+    int16_t bucket_head[PATHFIND_BUCKETS];
+    int16_t bucket_tail[PATHFIND_BUCKETS];
+
+    pathfind_context() : generation(0)
+    {
+        memset(cell_stamp, 0, sizeof(cell_stamp));
+        memset(bucket_stamp, 0, sizeof(bucket_stamp));
+    }
+
+    void new_search()
+    {
+        if (++generation == 0)
+        {
+            memset(cell_stamp, 0, sizeof(cell_stamp));
+            memset(bucket_stamp, 0, sizeof(bucket_stamp));
+            generation = 1;
+        }
+    }
+
+    void touch(int c)
+    {
+        if (cell_stamp[c] != generation)
+        {
+            cell_stamp[c] = generation;
+            dist[c]       = INFINITE_DISTANCE;
+            queued[c]     = false;
+        }
+    }
+
+    int distance(int c) const
+    {
+        return cell_stamp[c] == generation ? dist[c] : INFINITE_DISTANCE;
+    }
+
+    bool bucket_empty(int b) const
+    {
+        return bucket_stamp[b] != generation || bucket_head[b] < 0;
+    }
+
+    void push(int b, int c)
+    {
+        ASSERT_RANGE(b, 0, PATHFIND_BUCKETS);
+        if (bucket_stamp[b] != generation)
+        {
+            bucket_stamp[b] = generation;
+            bucket_head[b] = bucket_tail[b] = -1;
+        }
+
+        link_prev[c] = bucket_tail[b];
+        link_next[c] = -1;
+        if (bucket_tail[b] >= 0)
+            link_next[bucket_tail[b]] = c;
+        else
+            bucket_head[b] = c;
+        bucket_tail[b] = c;
+        queued[c] = true;
+    }
+
+    void unlink(int b, int c)
+    {
+        if (link_prev[c] >= 0)
+            link_next[link_prev[c]] = link_next[c];
+        else
+            bucket_head[b] = link_next[c];
+
+        if (link_next[c] >= 0)
+            link_prev[link_next[c]] = link_prev[c];
+        else
+            bucket_tail[b] = link_prev[c];
+
+        queued[c] = false;
+    }
+
+    int pop(int b)
+    {
+        const int c = bucket_tail[b];
+        unlink(b, c);
+        return c;
+    }
+};
+
+// Searches are hardly ever nested more than this deep, so no more contexts
+// than this are kept for reuse; any others are freed when done with.
+#define PATHFIND_POOL_SIZE 2
+
+static vector<unique_ptr<pathfind_context>> _pathfind_pool;
+
+static pathfind_context *_lease_pathfind_context()
+{
+    if (_pathfind_pool.empty())
+        return new pathfind_context;
+
+    pathfind_context *ctx = _pathfind_pool.back().release();
+    _pathfind_pool.pop_back();
+    return ctx;
+}
+
+static void _return_pathfind_context(pathfind_context *ctx)
+{
+    if (_pathfind_pool.size() < PATHFIND_POOL_SIZE)
+        _pathfind_pool.emplace_back(ctx);
+    else
+        delete ctx;
+}
+
 int mons_tracking_range(const monster* mon)
 {
     int range = 0;
@@ -68,12 +208,13 @@ int mons_tracking_range(const monster* mon)
 monster_pathfind::monster_pathfind()
     : mons(nullptr), start(), target(), pos(), allow_diagonals(true),
       traverse_unmapped(false), range(0), min_length(0), max_length(0),
-      dist(), prev(), hash()
+      ctx(_lease_pathfind_context())
 {
 }
 
 monster_pathfind::~monster_pathfind()
 {
+    _return_pathfind_context(ctx);
 }
 
 void monster_pathfind::set_range(int r)
@@ -89,7 +230,7 @@ void monster_pathfind::set_monster(const monster *mon)
 
 coord_def monster_pathfind::next_pos(const coord_def &c) const
 {
-    return c + Compass[prev[c.x][c.y]];
+    return c + Compass[ctx->prev[_cell_index(c)]];
 }
 
 // The main method in the monster_pathfind class.
@@ -145,11 +286,10 @@ bool monster_pathfind::start_pathfind(bool msg)
     //       a wall.
 
     max_length = min_length = grid_distance(pos, target);
-    for (int i = 0; i < GXM; i++)
-        for (int j = 0; j < GYM; j++)
-            dist[i][j] = INFINITE_DISTANCE;
 
-    dist[pos.x][pos.y] = 0;
+    ctx->new_search();
+    ctx->touch(_cell_index(pos));
+    ctx->dist[_cell_index(pos)] = 0;
 
     bool success = false;
     do
@@ -219,8 +359,8 @@ bool monster_pathfind::calc_path_to_neighbours()
         if (range && estimated_cost(npos) > range)
             continue;
 
-        distance = dist[pos.x][pos.y] + travel_cost(npos);
-        old_dist = dist[npos.x][npos.y];
+        distance = distance_at(pos) + travel_cost(npos);
+        old_dist = distance_at(npos);
 
         // Also bail out if this would make the path longer than twice the
         // allowed distance from the target. (This factor may need tuning.)
@@ -266,7 +406,9 @@ bool monster_pathfind::calc_path_to_neighbours()
             }
 
             // Update distance start->pos.
-            dist[npos.x][npos.y] = distance;
+            const int c = _cell_index(npos);
+            ctx->touch(c);
+            ctx->dist[c] = distance;
 
             // Set backtracking information.
             // Converts the Compass direction to its counterpart.
@@ -274,7 +416,7 @@ bool monster_pathfind::calc_path_to_neighbours()
             //      7  .  3   ==>   3  .  7       e.g. (3 + 4) % 8          = 7
             //      6  5  4         2  1  0            (7 + 4) % 8 = 11 % 8 = 3
 
-            prev[npos.x][npos.y] = (dir + 4) % 8;
+            ctx->prev[c] = (dir + 4) % 8;
 
             // Are we finished?
             if (npos == target)
@@ -290,22 +432,20 @@ bool monster_pathfind::calc_path_to_neighbours()
 }
 
 // Starting at known min_length (minimum total estimated path distance), check
-// the hash for existing vectors, then pick the last entry of the first vector
-// that matches. Update min_length, if necessary.
+// the queue for non-empty buckets, then pick the last entry of the first
+// bucket that matches. Update min_length, if necessary.
 bool monster_pathfind::get_best_position()
 {
     for (int i = min_length; i <= max_length; i++)
     {
-        if (!hash[i].empty())
+        if (!ctx->bucket_empty(i))
         {
             if (i > min_length)
                 min_length = i;
 
-            vector<coord_def> &vec = hash[i];
-            // Pick the last position pushed into the vector as it's most
+            // Pick the last position pushed into the bucket as it's most
             // likely to be close to the target.
-            pos = vec[vec.size()-1];
-            vec.pop_back();
+            pos = _cell_at(ctx->pop(i));
 
 #ifdef DEBUG_PATHFIND
             mprf("Returning (%d, %d) as best pos with total dist %d.",
@@ -340,7 +480,7 @@ vector<coord_def> monster_pathfind::backtrack()
     int dir;
     do
     {
-        dir = prev[pos.x][pos.y];
+        dir = ctx->prev[_cell_index(pos)];
         pos = pos + Compass[dir];
         ASSERT_IN_BOUNDS(pos);
 #ifdef DEBUG_PATHFIND
@@ -504,26 +644,25 @@ int monster_pathfind::estimated_cost(coord_def p)
     return grid_distance(p, target);
 }
 
+int monster_pathfind::distance_at(const coord_def &p) const
+{
+    return ctx->distance(_cell_index(p));
+}
+
 void monster_pathfind::add_new_pos(coord_def npos, int total)
 {
-    hash[total].push_back(npos);
+    const int c = _cell_index(npos);
+    ctx->touch(c);
+    ctx->push(total, c);
 }
 
 void monster_pathfind::update_pos(coord_def npos, int total)
 {
-    // Find hash position of old distance and delete it,
-    // then call_add_new_pos.
-    int old_total = dist[npos.x][npos.y] + estimated_cost(npos);
-
-    vector<coord_def> &vec = hash[old_total];
-    for (unsigned int i = 0; i < vec.size(); i++)
-    {
-        if (vec[i] == npos)
-        {
-            vec.erase(vec.begin() + i);
-            break;
-        }
-    }
+    // Take the position out of the bucket for its old distance (unless it
+    // has already been looked at), then call add_new_pos.
+    const int c = _cell_index(npos);
+    if (ctx->queued[c])
+        ctx->unlink(distance_at(npos) + estimated_cost(npos), c);
 
     add_new_pos(npos, total);
 }
@@ -2,6 +2,7 @@
 #define MON_PATHFIND_H
 
 class monster;
+struct pathfind_context;
 
 int mons_tracking_range(const monster* mon);
 
@@ -11,6 +12,9 @@ public:
     monster_pathfind();
     virtual ~monster_pathfind();
 
+    monster_pathfind(const monster_pathfind &) = delete;
+    monster_pathfind &operator=(const monster_pathfind &) = delete;
+
     // public methods
     void set_range(int r);
     void set_monster(const monster *mon);
@@ -32,6 +36,7 @@ protected:
     bool mons_traversable(const coord_def& p);
     int  mons_travel_cost(coord_def npos);
     int  estimated_cost(coord_def npos);
+    int  distance_at(const coord_def &p) const;
     void add_new_pos(coord_def pos, int total);
     void update_pos(coord_def pos, int total);
     bool get_best_position();
@@ -61,12 +66,9 @@ protected:
     int min_length;
     int max_length;
 
-    // The array of distances from start to any already tried point.
-    int dist[GXM][GYM];
-    // An array to store where we came from on a given shortest path.
-    int prev[GXM][GYM];
-
-    FixedVector<vector<coord_def>, GXM * GYM> hash;
+    // Distances, backtracking information and the queue of positions to
+    // look at, borrowed from a pool shared by all searches.
+    pathfind_context *ctx;
 };
 
 #endif
@@ -1166,14 +1166,45 @@ monster* place_monster(mgen_data mg, bool force_pos, bool dont_place)
     return mon;
 }
 
+// The slot last handed out by get_free_monster(), in case the caller gave
+// up on it without ever putting a monster there.
+static int _last_free_monster = NON_MONSTER;
+
 monster* get_free_monster()
 {
+    if (!invalid_monster_index(_last_free_monster)
+        && menv[_last_free_monster].type == MONS_NO_MONSTER)
+    {
+        env.mon_index.remove(&menv[_last_free_monster]);
+    }
+
+    const int free = env.mon_index.first_free();
+    if (free < MAX_MONSTERS && menv[free].type == MONS_NO_MONSTER)
+    {
+        menv[free].reset();
+        env.mon_index.add(free);
+        _last_free_monster = free;
+        return &menv[free];
+    }
+
+    // Either every slot is taken, or the index lost track of a monster:
+    // fall back to looking at each slot, including the anonymous ones.
     for (auto &mons : menv)
-        if (mons.type == MONS_NO_MONSTER)
+    {
+        if (mons.type != MONS_NO_MONSTER)
+        {
+            env.mon_index.update(&mons);
+            continue;
+        }
+
+        mons.reset();
+        if (!invalid_monster_index(mons.mindex()))
         {
-            mons.reset();
-            return &mons;
+            env.mon_index.add(mons.mindex());
+            _last_free_monster = mons.mindex();
         }
+        return &mons;
+    }
 
     return nullptr;
 }
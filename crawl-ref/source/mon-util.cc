@@ -3090,13 +3090,16 @@ int mons_class_zombie_base_speed(monster_type zombie_base_mc)
  */
 int mons_base_speed(const monster* mon, bool known)
 {
+    // Every monster's speed is asked for every turn.
+    static const prop_key speed_key(MON_SPEED_KEY);
+
     if (mon->ghost.get())
         return mon->ghost->speed;
 
-    if (mon->props.exists(MON_SPEED_KEY)
+    if (mon->props.exists(speed_key)
         && (!known || mon->type == MONS_MUTANT_BEAST))
     {
-        return mon->props[MON_SPEED_KEY];
+        return mon->props[speed_key];
     }
 
     if (mon->type == MONS_SPECTRAL_THING)
@@ -141,6 +141,7 @@ void monster::reset()
     unseen_pos = coord_def(0, 0);
 
     mons_remove_from_grid(this);
+    env.mon_index.remove(this);
     target.reset();
     position.reset();
     firing_pos.reset();
@@ -202,6 +203,8 @@ void monster::init_with(const monster& mon)
         ghost.reset(new ghost_demon(*mon.ghost));
     else
         ghost.reset(nullptr);
+
+    env.mon_index.update(this);
 }
 
 uint32_t monster::last_client_id = 0;
@@ -2753,6 +2756,12 @@ void monster::set_hit_dice(int new_hit_dice)
     }
 }
 
+void monster::set_position(const coord_def &c)
+{
+    actor::set_position(c);
+    env.mon_index.update(this);
+}
+
 void monster::moveto(const coord_def& c, bool clear_net)
 {
     if (clear_net && c != pos() && in_bounds(pos()))
@@ -108,6 +108,36 @@ struct noise_cell
     int turn_angle(const coord_def &next_delta) const;
 };
 
+// The noise_cell of every cell of the map. The cells are kept from one
+// propagation to the next: one whose stamp isn't the current generation
+// hasn't been reached yet, so starting afresh doesn't touch the whole map.
+class noise_cells
+{
+public:
+    noise_cells();
+
+    void clear();
+
+    noise_cell &operator () (const coord_def &p);
+    const noise_cell &operator () (const coord_def &p) const;
+
+private:
+    FixedArray<noise_cell, GXM, GYM> cells;
+    FixedArray<uint32_t, GXM, GYM> stamps;
+    uint32_t generation;
+};
+
+#ifdef DEBUG_TESTS
+// One cell hearing a noise, in the order propagate_noise() got to them.
+struct noise_heard
+{
+    coord_def pos;
+    int noise_intensity_millis;
+    int noise_id;
+    int noise_travel_distance;
+};
+#endif
+
 class noise_grid
 {
 public:
@@ -147,9 +177,15 @@ private:
                                        const noise_t &noise) const;
 
 private:
-    FixedArray<noise_cell, GXM, GYM> cells;
     vector<noise_t> noises;
     int affected_actor_count;
+
+#ifdef DEBUG_TESTS
+public:
+    // If set, cells hearing a noise are noted here instead of their
+    // occupants being told.
+    vector<noise_heard> *heard;
+#endif
 };
 
 #endif
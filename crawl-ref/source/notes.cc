@@ -442,6 +442,8 @@ void Note::load(reader& inf)
 }
 
 static bool notes_active = false;
+// Bumped whenever note_list changes.
+static unsigned int notes_changes = 0;
 
 bool notes_are_active()
 {
@@ -453,6 +455,7 @@ void take_note(const Note& note, bool force)
     if (notes_active && (force || _is_noteworthy(note)))
     {
         note_list.push_back(note);
+        ++notes_changes;
         note.check_milestone();
     }
 }
@@ -472,6 +475,7 @@ void save_notes(writer& outf)
 
 void load_notes(reader& inf)
 {
+    ++notes_changes;
     if (unmarshallInt(inf) != NOTES_VERSION_NUMBER)
         return;
 
@@ -484,6 +488,11 @@ void load_notes(reader& inf)
     }
 }
 
+unsigned int notes_generation()
+{
+    return notes_changes;
+}
+
 void make_user_note()
 {
     char buf[400];
@@ -86,6 +86,7 @@ bool notes_are_active();
 void take_note(const Note& note, bool force = false);
 void save_notes(writer&);
 void load_notes(reader&);
+unsigned int notes_generation();
 void make_user_note();
 
 /**
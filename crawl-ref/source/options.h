@@ -401,6 +401,9 @@ public:
                                     // on the term's own cursor.
     bool        use_fake_player_cursor;
 
+    bool        speculative_levelgen; // Build the level below the stairs
+                                      // while waiting for a command.
+
     bool        show_player_species;
 
     int         level_map_cursor_step;  // The cursor increment in the level
@@ -16,6 +16,10 @@ Notes:
 * Readers always get the last complete (but not necessarily committed) write
   (ie, READ_UNCOMMITTED) at the time they started; it is safe to continue
   reading even if the chunk has been changed since.
+* An asynchronous commit is only durable once the next commit (or closing
+  the package) has waited for it; until then, a crash returns the save to
+  the commit before. Blocks unlinked by a commit aren't reused until it's
+  done, so both directories stay intact in the meantime.
 */
 
 #include "AppHdr.h"
@@ -27,6 +31,7 @@ Notes:
 #include <cstring>
 #include <sstream>
 #include <fcntl.h>
+#include <lz4.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -36,6 +41,9 @@ Notes:
 #include "syscalls.h"
 #include "libutil.h" // map_find
 
+// How much of a zlib chunk view() inflates at a time.
+#define ZLIB_VIEW_SIZE 65536
+
 // debugging defines
 #undef  FSCK_VERBOSE
 #undef  COSTLY_ASSERTS
@@ -56,7 +64,8 @@ static plen_t htole(plen_t x)
 #define dprintf(...) do {} while (0)
 #endif
 
-#define PACKAGE_VERSION 1
+// 2: directory entries give the chunk's codec
+#define PACKAGE_VERSION 2
 #define PACKAGE_MAGIC   0x53534344 /* "DCSS" */
 
 struct file_header
@@ -73,16 +82,57 @@ struct block_header
     plen_t next;
 };
 
+// Blocks of an LZ4 chunk are each preceded by their length, and the length
+// they're stored in: the same, if they didn't compress. A block of length 0
+// ends the chunk.
+struct lz4_block_header
+{
+    uint32_t len;
+    uint32_t stored_len;
+};
+
 typedef map<string, plen_t> directory_t;
 typedef pair<plen_t, plen_t> bm_p;
 typedef map<plen_t, bm_p> bm_t;
 typedef map<plen_t, plen_t> fb_t;
 
+const char *codec_name(chunk_codec codec)
+{
+    switch (codec)
+    {
+    case CODEC_ZLIB: return "zlib";
+    case CODEC_LZ4:  return "lz4";
+    default:         return "unknown";
+    }
+}
+
+// Levels (and the player) are written on every change of level and read
+// back on every return, so they're compressed fast. The rest of the chunks
+// files.cc writes are read back only when the game is restored, and are
+// worth packing tighter; so is the directory, which must stay zlib to be
+// read before the codecs are known.
+chunk_codec codec_for_chunk(const string &name)
+{
+    static const set<string> cold =
+    {
+        "", "chr", "st", "stashes", "lua", "kil", "kills", "tc",
+        "travel_cache", "nts", "notes", "tut", "tutorial", "msg", "messages",
+        "tdl", "tiles_doll",
+    };
+    return cold.count(name) ? CODEC_ZLIB : CODEC_LZ4;
+}
+
 package::package(const char* file, bool writeable, bool empty)
   : n_users(0), dirty(false), aborted(false)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
+    , fault(COMMIT_FAULT_NONE), crashed(false), commit_errno(0),
+    commit_error(nullptr)
+#ifdef ASYNC_COMMIT
+    , committing(false)
+#endif
+    , mapping(nullptr)
 {
     dprintf("package: initializing file=\"%s\" rw=%d\n", file, writeable);
     ASSERT(writeable || !empty);
@@ -91,7 +141,9 @@ package::package(const char* file, bool writeable, bool empty)
 
     if (empty)
     {
-        fd = open_u(file, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+        // Truncate only once the save is locked: a read-only package may
+        // have the old one mapped.
+        fd = open_u(file, O_RDWR | O_CREAT | O_BINARY, 0666);
         if (fd == -1)
             sysfail("can't create save file (%s)", file);
 
@@ -100,6 +152,11 @@ package::package(const char* file, bool writeable, bool empty)
             close(fd);
             sysfail("failed to lock newly created save (%s)", file);
         }
+        if (ftruncate(fd, 0))
+        {
+            close(fd);
+            sysfail("can't create save file (%s)", file);
+        }
 
         dirty = true;
         file_len = sizeof(file_header);
@@ -119,6 +176,7 @@ package::package(const char* file, bool writeable, bool empty)
         }
         catch (exception &e)
         {
+            delete mapping;
             close(fd);
             throw;
         }
@@ -130,6 +188,12 @@ package::package()
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
+    , fault(COMMIT_FAULT_NONE), crashed(false), commit_errno(0),
+    commit_error(nullptr)
+#ifdef ASYNC_COMMIT
+    , committing(false)
+#endif
+    , mapping(nullptr)
 {
     dprintf("package: initializing tmp file\n");
     filename = "[tmp]";
@@ -174,6 +238,26 @@ void package::load()
     if (len == -1)
         sysfail("save file (%s) is not seekable", filename.c_str());
     file_len = len;
+
+#ifndef TARGET_OS_WINDOWS
+    // Not on Windows, where the whole file would be read in, when often
+    // only a chunk or two of it is wanted.
+    //
+    // Touching a mapping past the end of a file that has been cut short
+    // raises SIGBUS rather than a read error. Nothing shortens a save
+    // without a write lock, and our read lock is held until the mapping
+    // goes; but should the file not be the length we were just told, play
+    // safe and read() it instead.
+    if (!rw)
+    {
+        mapping = new mapped_file(fd);
+        if (!mapping->valid() || mapping->size() != file_len)
+        {
+            delete mapping;
+            mapping = nullptr;
+        }
+    }
+#endif
     read_directory(htole(head.start), head.version);
 
     if (rw)
@@ -208,6 +292,8 @@ package::~package()
         // catching missing manual deletes. The C++ exit handler is the
         // only place that can be legitimately call things in wrong order.
 
+    // This might find the last commit crashed, and abort.
+    finish_commit();
     if (rw && !aborted)
     {
         commit();
@@ -215,6 +301,8 @@ package::~package()
             sysfail("failed to update save file");
     }
 
+    delete mapping;
+
     // all errors here should be cached write errors
     if (fd != -1)
         if (close(fd) && !aborted)
@@ -225,9 +313,10 @@ package::~package()
     dprintf("package: closed\n");
 }
 
-void package::commit()
+void package::commit(bool async)
 {
     ASSERT(rw);
+    finish_commit();
     if (!dirty)
         return;
     ASSERT(!aborted);
@@ -236,27 +325,141 @@ void package::commit()
     fsck();
 #endif
 
+    const plen_t start = write_directory();
+    // What this commit unlinks is still the last commit's until the header
+    // points past it.
+    committing_blocks.swap(unlinked_blocks);
+    new_chunks.clear();
+    dirty = false;
+
+#ifdef ASYNC_COMMIT
+    if (async)
+    {
+        commit_start = start;
+        // If there's no thread to be had, just carry on without.
+        committing = !thread_create_joinable(&commit_thread,
+                                             commit_thread_main, this);
+        if (committing)
+            return;
+    }
+#else
+    UNUSED(async);
+#endif
+    write_header(start);
+    finish_commit();
+}
+
+void package::inject_commit_fault(commit_fault _fault)
+{
+    finish_commit();
+    fault = _fault;
+}
+
+bool package::commit_in_progress() const
+{
+#ifdef ASYNC_COMMIT
+    return committing;
+#else
+    return false;
+#endif
+}
+
+#ifdef ASYNC_COMMIT
+void *package::commit_thread_main(void *pkg)
+{
+    package *self = static_cast<package *>(pkg);
+    self->write_header(self->commit_start);
+    return nullptr;
+}
+#endif
+
+// Flush everything written so far, then point the header at the directory at
+// start. This may run on the commit thread, so it mustn't touch anything the
+// rest of the package does, nor throw: errors are left for finish_commit().
+void package::write_header(plen_t start)
+{
+    const commit_fault fault_here = fault;
+    fault = COMMIT_FAULT_NONE;
+    if (fault_here == COMMIT_FAULT_BEFORE_SYNC)
+    {
+        crashed = true;
+        return;
+    }
+#ifdef DO_FSYNC
+    // We need a barrier before updating the link to point at the new directory.
+    if (!tmp && fdatasync(fd))
+    {
+        commit_errno = errno;
+        commit_error = "flush error while saving";
+        return;
+    }
+#endif
+    if (fault_here == COMMIT_FAULT_BEFORE_HEADER)
+    {
+        crashed = true;
+        return;
+    }
+
     file_header head;
     head.magic = htole(PACKAGE_MAGIC);
     head.version = PACKAGE_VERSION;
     memset(&head.padding, 0, sizeof(head.padding));
-    head.start = htole(write_directory());
-#ifdef DO_FSYNC
-    // We need a barrier before updating the link to point at the new directory.
-    if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+    head.start = htole(start);
+#ifdef ASYNC_COMMIT
+    // Chunks may be being written at the same time; leave the offset alone.
+    const ssize_t res = pwrite(fd, &head, sizeof(head), 0);
+#else
+    const ssize_t res = lseek(fd, 0, SEEK_SET) ? -1
+                                               : write(fd, &head, sizeof(head));
 #endif
-    seek(0);
-    if (write(fd, &head, sizeof(head)) != sizeof(head))
-        sysfail("write error while saving");
+    if (res != sizeof(head))
+    {
+        commit_errno = errno;
+        commit_error = "write error while saving";
+        return;
+    }
+    if (fault_here == COMMIT_FAULT_AFTER_HEADER)
+    {
+        crashed = true;
+        return;
+    }
 #ifdef DO_FSYNC
     if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+    {
+        commit_errno = errno;
+        commit_error = "flush error while saving";
+    }
 #endif
+}
+
+// Wait for a commit still being written, then free the blocks only the
+// directory it replaced used.
+void package::finish_commit()
+{
+#ifdef ASYNC_COMMIT
+    if (committing)
+    {
+        thread_join(commit_thread);
+        committing = false;
+    }
+#endif
+    if (aborted)
+        return;
+
+    if (crashed)
+    {
+        // Stop as the crash would have: nothing more is written.
+        abort();
+        return;
+    }
+    if (const char *error = commit_error)
+    {
+        commit_error = nullptr;
+        errno = commit_errno;
+        sysfail("%s", error);
+    }
 
-    new_chunks.clear();
     collect_blocks();
-    dirty = false;
 
 #ifdef COSTLY_ASSERTS
     fsck();
@@ -278,10 +481,15 @@ chunk_writer* package::writer(const string &name)
     return new chunk_writer(this, name);
 }
 
+chunk_writer* package::writer(const string &name, chunk_codec codec)
+{
+    return new chunk_writer(this, name, codec);
+}
+
 chunk_reader* package::reader(const string &name)
 {
-    if (plen_t *ch = map_find(directory, name))
-        return new chunk_reader(this, *ch);
+    if (has_chunk(name))
+        return new chunk_reader(this, name);
     return 0;
 }
 
@@ -353,10 +561,11 @@ plen_t package::alloc_block(plen_t &size)
     return at;
 }
 
-void package::finish_chunk(const string &name, plen_t at)
+void package::finish_chunk(const string &name, plen_t at, chunk_codec codec)
 {
     free_chunk(name);
     directory[name] = at;
+    codecs[name] = codec;
     new_chunks.insert(at);
     dirty = true;
 }
@@ -380,6 +589,7 @@ void package::delete_chunk(const string &name)
 {
     free_chunk(name);
     directory.erase(name);
+    codecs.erase(name);
 }
 
 plen_t package::write_directory()
@@ -394,6 +604,8 @@ plen_t package::write_directory()
         dir.write(&entry.first[0], entry.first.length());
         plen_t start = htole(entry.second);
         dir.write((const char*)&start, sizeof(plen_t));
+        const uint8_t codec = get_chunk_codec(entry.first);
+        dir.write((const char*)&codec, sizeof(codec));
     }
 
     ASSERT(dir.str().size());
@@ -408,15 +620,11 @@ plen_t package::write_directory()
 
 void package::collect_blocks()
 {
-    for (ssize_t i = unlinked_blocks.size() - 1; i >= 0; --i)
-    {
-        plen_t at = unlinked_blocks[i];
-        // Blocks may be re-added onto the list if they're in use.
-        if (i != (ssize_t)unlinked_blocks.size() - 1)
-            unlinked_blocks[i] = unlinked_blocks[unlinked_blocks.size() - 1];
-        unlinked_blocks.pop_back();
+    vector<plen_t> blocks;
+    blocks.swap(committing_blocks);
+    // Blocks are put back onto unlinked_blocks if they're in use.
+    for (plen_t at : blocks)
         free_block_chain(at);
-    }
 }
 
 void package::free_block_chain(plen_t at)
@@ -534,6 +742,7 @@ void package::read_directory(plen_t start, uint8_t version)
         }
         break;
     case 1:
+    case 2:
         uint8_t name_len;
         plen_t bstart;
         while (plen_t res = rd.read(&name_len, sizeof(name_len)))
@@ -547,6 +756,19 @@ void package::read_directory(plen_t start, uint8_t version)
             if (rd.read(&bstart, sizeof(bstart)) != sizeof(bstart))
                 corrupted("save file corrupted -- truncated directory");
             directory[chname] = htole(bstart);
+            // Before version 2, every chunk was zlib.
+            uint8_t codec = CODEC_ZLIB;
+            if (version >= 2
+                && rd.read(&codec, sizeof(codec)) != sizeof(codec))
+            {
+                corrupted("save file corrupted -- truncated directory");
+            }
+            if (codec >= NUM_CODECS)
+            {
+                corrupted("save file (%s) uses an unknown codec %u",
+                          filename.c_str(), codec);
+            }
+            codecs[chname] = static_cast<chunk_codec>(codec);
             dprintf("* %s\n", chname.c_str());
         }
         break;
@@ -614,6 +836,8 @@ void package::abort()
     // this point are ignored (assuming we already failed). All writes since
     // the last commit() are lost.
     aborted = true;
+    // A commit in flight is left to finish, and mustn't outlive the file.
+    finish_commit();
 }
 
 void package::unlink()
@@ -667,8 +891,30 @@ plen_t package::get_chunk_compressed_length(const string &name)
     return len;
 }
 
+// The len bytes of the file at at, in the mapping.
+const unsigned char *package::map_view(plen_t at, plen_t len)
+{
+    ASSERT(mapping);
+    if (at > mapping->size() || len > mapping->size() - at)
+        corrupted("save file corrupted -- block past eof");
+    return mapping->data() + at;
+}
+
+chunk_codec package::get_chunk_codec(const string &name)
+{
+    if (chunk_codec *codec = map_find(codecs, name))
+        return *codec;
+    return CODEC_ZLIB;
+}
+
 chunk_writer::chunk_writer(package *parent, const string &_name)
-    : first_block(0), cur_block(0), block_len(0)
+    : chunk_writer(parent, _name, codec_for_chunk(_name))
+{
+}
+
+chunk_writer::chunk_writer(package *parent, const string &_name,
+                           chunk_codec _codec)
+    : first_block(0), cur_block(0), block_len(0), codec(_codec)
 {
     ASSERT(parent);
     ASSERT(!parent->aborted);
@@ -681,6 +927,14 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
     pkg = parent;
     pkg->n_users++;
     name = _name;
+    // The directory is read before anything says how it's compressed.
+    ASSERT(codec == CODEC_ZLIB || !name.empty());
+
+    if (codec == CODEC_LZ4)
+    {
+        lz_in.reserve(MAX_LZ4_BLOCK);
+        return;
+    }
 
 #ifdef USE_ZLIB
     zs.data_type = Z_BINARY;
@@ -705,31 +959,44 @@ chunk_writer::~chunk_writer()
     {
 #ifdef USE_ZLIB
         // ignore errors, they're not relevant anymore
-        deflateEnd(&zs);
-        free(z_buffer);
+        if (codec == CODEC_ZLIB)
+        {
+            deflateEnd(&zs);
+            free(z_buffer);
+        }
 #endif
         return;
     }
 
+    if (codec == CODEC_LZ4)
+    {
+        if (!lz_in.empty())
+            lz4_flush();
+        // An empty block ends the chunk.
+        lz4_flush();
+    }
 #ifdef USE_ZLIB
-    zs.avail_in = 0;
-    int res;
-    do
+    else
     {
-        res = deflate(&zs, Z_FINISH);
-        if (res != Z_STREAM_END && res != Z_OK && res != Z_BUF_ERROR)
-            fail("save file compression failed: %s", zs.msg);
-        raw_write(z_buffer, zs.next_out - z_buffer);
-        zs.next_out = z_buffer;
-        zs.avail_out = ZB_SIZE;
-    } while (res != Z_STREAM_END);
-    if (deflateEnd(&zs) != Z_OK)
-        fail("save file compression failed during clean-up: %s", zs.msg);
-    free(z_buffer);
+        zs.avail_in = 0;
+        int res;
+        do
+        {
+            res = deflate(&zs, Z_FINISH);
+            if (res != Z_STREAM_END && res != Z_OK && res != Z_BUF_ERROR)
+                fail("save file compression failed: %s", zs.msg);
+            raw_write(z_buffer, zs.next_out - z_buffer);
+            zs.next_out = z_buffer;
+            zs.avail_out = ZB_SIZE;
+        } while (res != Z_STREAM_END);
+        if (deflateEnd(&zs) != Z_OK)
+            fail("save file compression failed during clean-up: %s", zs.msg);
+        free(z_buffer);
+    }
 #endif
     if (cur_block)
         finish_block(0);
-    pkg->finish_chunk(name, first_block);
+    pkg->finish_chunk(name, first_block, codec);
 }
 
 void chunk_writer::raw_write(const void *data, plen_t len)
@@ -776,6 +1043,12 @@ void chunk_writer::write(const void *data, plen_t len)
     ASSERT(data);
     ASSERT(!pkg->aborted);
 
+    if (codec == CODEC_LZ4)
+    {
+        lz4_write(data, len);
+        return;
+    }
+
 #ifdef USE_ZLIB
     zs.next_in  = (Bytef*)data;
     zs.avail_in = len;
@@ -796,17 +1069,64 @@ void chunk_writer::write(const void *data, plen_t len)
 #endif
 }
 
-void chunk_reader::init(plen_t start)
+void chunk_writer::lz4_write(const void *data, plen_t len)
+{
+    const unsigned char *in = (const unsigned char*)data;
+    while (len)
+    {
+        const plen_t s = min<plen_t>(len, MAX_LZ4_BLOCK - lz_in.size());
+        lz_in.insert(lz_in.end(), in, in + s);
+        in += s;
+        len -= s;
+        if (lz_in.size() == MAX_LZ4_BLOCK)
+            lz4_flush();
+    }
+}
+
+// Write out what's been gathered as one block.
+void chunk_writer::lz4_flush()
+{
+    const plen_t len = lz_in.size();
+    const int bound = LZ4_compressBound(len);
+    lz_out.resize(sizeof(lz4_block_header) + bound);
+    char *body = (char*)&lz_out[sizeof(lz4_block_header)];
+    plen_t stored_len = len ? LZ4_compress_default((const char*)&lz_in[0],
+                                                   body, len, bound)
+                            : 0;
+    // Blocks that don't compress (or, somehow, fail to) are stored as is.
+    if (!stored_len || stored_len >= len)
+    {
+        stored_len = len;
+        if (len)
+            memcpy(body, &lz_in[0], len);
+    }
+
+    lz4_block_header head;
+    head.len = htole32(len);
+    head.stored_len = htole32(stored_len);
+    memcpy(&lz_out[0], &head, sizeof(head));
+    raw_write(&lz_out[0], sizeof(head) + stored_len);
+    lz_in.clear();
+}
+
+void chunk_reader::init(plen_t start, chunk_codec _codec)
 {
     ASSERT(!pkg->aborted);
     pkg->n_users++;
     pkg->reader_count[start]++;
     first_block = next_block = start;
     block_left = 0;
+    codec = _codec;
+    eof = false;
+    lz_data = nullptr;
+    lz_len = lz_at = 0;
 
-#ifdef USE_ZLIB
     if (!start)
-        corrupted("save file corrupted -- zlib header missing");
+        corrupted("save file corrupted -- chunk header missing");
+    if (codec == CODEC_LZ4)
+        return;
+
+#ifdef USE_ZLIB
 
     zs.zalloc    = 0;
     zs.zfree     = 0;
@@ -815,7 +1135,6 @@ void chunk_reader::init(plen_t start)
     zs.avail_in  = 0;
     if (inflateInit(&zs))
         fail("save file decompression failed during init: %s", zs.msg);
-    eof = false;
 #endif
 }
 
@@ -824,7 +1143,8 @@ chunk_reader::chunk_reader(package *parent, plen_t start)
     ASSERT(parent);
     dprintf("chunk_reader[%u]: starting\n", start);
     pkg = parent;
-    init(start);
+    // Only the directory is read by where it starts.
+    init(start, CODEC_ZLIB);
 }
 
 chunk_reader::chunk_reader(package *parent, const string &_name)
@@ -834,7 +1154,7 @@ chunk_reader::chunk_reader(package *parent, const string &_name)
         corrupted("save file corrupted -- chunk \"%s\" missing", _name.c_str());
     dprintf("chunk_reader(%s): starting\n", _name.c_str());
     pkg = parent;
-    init(parent->directory[_name]);
+    init(parent->directory[_name], parent->get_chunk_codec(_name));
 }
 
 chunk_reader::~chunk_reader()
@@ -842,7 +1162,7 @@ chunk_reader::~chunk_reader()
     dprintf("chunk_reader: closing\n");
 
 #ifdef USE_ZLIB
-    if (inflateEnd(&zs) != Z_OK)
+    if (codec == CODEC_ZLIB && inflateEnd(&zs) != Z_OK)
         fail("save file decompression failed during clean-up: %s", zs.msg);
 #endif
     ASSERT(pkg->reader_count[first_block] > 0);
@@ -852,6 +1172,35 @@ chunk_reader::~chunk_reader()
     pkg->n_users--;
 }
 
+// Move on to the next block of the chunk, or return false if there are no
+// more. Unless the package is mapped, this leaves the file at its start.
+bool chunk_reader::next_raw_block()
+{
+    if (!next_block)
+        return false;
+
+    block_header bl;
+    if (pkg->mapping)
+        memcpy(&bl, pkg->map_view(next_block, sizeof(bl)), sizeof(bl));
+    else
+    {
+        pkg->seek(next_block);
+        ssize_t res = ::read(pkg->fd, &bl, sizeof(block_header));
+        if (res < 0)
+            sysfail("error reading the save file");
+        if (res != sizeof(block_header))
+            corrupted("save file corrupted -- block past eof");
+    }
+
+    off = next_block + sizeof(block_header);
+    block_left = htole(bl.len);
+    next_block = htole(bl.next);
+    // This reeks of on-disk corruption (zeroed data).
+    if (!block_left)
+        corrupted("save file corrupted -- empty block");
+    return true;
+}
+
 plen_t chunk_reader::raw_read(void *data, plen_t len)
 {
     void *buf = data;
@@ -859,35 +1208,25 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
     {
         if (!block_left)
         {
-            if (!next_block)
+            if (!next_raw_block())
                 return (char*)buf - (char*)data;
-
-            block_header bl;
-            pkg->seek(next_block);
-            ssize_t res = ::read(pkg->fd, &bl, sizeof(block_header));
-            if (res < 0)
-                sysfail("error reading the save file");
-            if (res != sizeof(block_header))
-                corrupted("save file corrupted -- block past eof");
-
-            off = next_block + sizeof(block_header);
-            block_left = htole(bl.len);
-            next_block = htole(bl.next);
-            // This reeks of on-disk corruption (zeroed data).
-            if (!block_left)
-                corrupted("save file corrupted -- empty block");
         }
-        else
+        else if (!pkg->mapping)
             pkg->seek(off);
 
         plen_t s = len;
         if (s > block_left)
             s = block_left;
-        ssize_t res = ::read(pkg->fd, buf, s);
-        if (res < 0)
-            sysfail("error reading the save file");
-        if ((plen_t)res != s)
-            corrupted("save file corrupted -- block past eof");
+        if (pkg->mapping)
+            memcpy(buf, pkg->map_view(off, s), s);
+        else
+        {
+            ssize_t res = ::read(pkg->fd, buf, s);
+            if (res < 0)
+                sysfail("error reading the save file");
+            if ((plen_t)res != s)
+                corrupted("save file corrupted -- block past eof");
+        }
 
         buf = (char*)buf + s;
         off += s;
@@ -898,12 +1237,32 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
     return (char*)buf - (char*)data;
 }
 
+// The next len bytes of the chunk, in place in the package's mapping; or
+// nullptr, with nothing read, if it isn't mapped or they straddle blocks.
+const unsigned char *chunk_reader::raw_view(plen_t len)
+{
+    if (!pkg->mapping || !len)
+        return nullptr;
+    if (!block_left && !next_raw_block())
+        return nullptr;
+    if (len > block_left)
+        return nullptr;
+
+    const unsigned char *data = pkg->map_view(off, len);
+    off += len;
+    block_left -= len;
+    return data;
+}
+
 plen_t chunk_reader::read(void *data, plen_t len)
 {
     ASSERT(data);
     if (pkg->aborted)
         return 0;
 
+    if (codec == CODEC_LZ4)
+        return lz4_read(data, len);
+
 #ifdef USE_ZLIB
     if (!len)
         return 0;
@@ -916,8 +1275,18 @@ plen_t chunk_reader::read(void *data, plen_t len)
     {
         if (!zs.avail_in)
         {
-            zs.next_in  = z_buffer;
-            zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            // Inflate from the mapping, a whole block at a time, if there
+            // is one.
+            if (pkg->mapping && (block_left || next_raw_block()))
+            {
+                zs.avail_in = block_left;
+                zs.next_in  = (Bytef*)raw_view(block_left);
+            }
+            else
+            {
+                zs.next_in  = z_buffer;
+                zs.avail_in = raw_read(z_buffer, sizeof(z_buffer));
+            }
             if (!zs.avail_in)
                 corrupted("save file corrupted -- block truncated");
         }
@@ -936,6 +1305,96 @@ plen_t chunk_reader::read(void *data, plen_t len)
 #endif
 }
 
+plen_t chunk_reader::lz4_read(void *data, plen_t len)
+{
+    unsigned char *out = (unsigned char*)data;
+    plen_t got = 0;
+    while (got < len)
+    {
+        if (lz_at == lz_len && !lz4_next_block())
+            break;
+        const plen_t s = min<plen_t>(len - got, lz_len - lz_at);
+        memcpy(out + got, lz_data + lz_at, s);
+        lz_at += s;
+        got += s;
+    }
+    return got;
+}
+
+// Read and decompress the next block, or return false at the end of the
+// chunk.
+bool chunk_reader::lz4_next_block()
+{
+    if (eof)
+        return false;
+
+    lz4_block_header head;
+    if (raw_read(&head, sizeof(head)) != sizeof(head))
+        corrupted("save file corrupted -- block truncated");
+    const plen_t len = htole32(head.len);
+    const plen_t stored_len = htole32(head.stored_len);
+    if (!len)
+    {
+        eof = true;
+        return false;
+    }
+    if (len > MAX_LZ4_BLOCK || stored_len > len)
+        corrupted("save file corrupted -- bad block length");
+
+    lz_len = len;
+    lz_at = 0;
+    // Blocks that didn't compress are used in place, if they can be.
+    const unsigned char *stored = raw_view(stored_len);
+    if (stored && stored_len == len)
+    {
+        lz_data = stored;
+        return true;
+    }
+
+    lz_block.resize(len);
+    lz_data = &lz_block[0];
+    if (stored_len == len)
+    {
+        if (raw_read(&lz_block[0], len) != len)
+            corrupted("save file corrupted -- block truncated");
+        return true;
+    }
+
+    if (!stored)
+    {
+        lz_packed.resize(stored_len);
+        if (stored_len && raw_read(&lz_packed[0], stored_len) != stored_len)
+            corrupted("save file corrupted -- block truncated");
+        stored = lz_packed.data();
+    }
+    if (LZ4_decompress_safe((const char*)stored, (char*)&lz_block[0],
+                            stored_len, len) != (int)len)
+    {
+        corrupted("save file decompression failed: bad LZ4 block");
+    }
+    return true;
+}
+
+plen_t chunk_reader::view(const unsigned char *&data)
+{
+    if (pkg->aborted)
+        return 0;
+
+    if (codec == CODEC_LZ4)
+    {
+        if (lz_at == lz_len && !lz4_next_block())
+            return 0;
+        data = lz_data + lz_at;
+        const plen_t len = lz_len - lz_at;
+        lz_at = lz_len;
+        return len;
+    }
+
+    lz_block.resize(ZLIB_VIEW_SIZE);
+    data = &lz_block[0];
+    return read(&lz_block[0], lz_block.size());
+}
+
 void chunk_reader::read_all(vector<char> &data)
 {
 #define SPACE 1024
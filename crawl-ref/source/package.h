@@ -14,10 +14,44 @@
 #define DO_FSYNC
 #endif
 
+// Commits can be finished by a thread of their own. Not on Windows, which
+// lacks pwrite(): the header can't be written without moving the file
+// offset chunks are being written at.
+#ifndef TARGET_OS_WINDOWS
+#define ASYNC_COMMIT
+#include "threads.h"
+#endif
+
 #define MAX_CHUNK_NAME_LENGTH 255
+// The largest LZ4 chunk block: matches reach back at most 64k, so no offset
+// within a block is ever too far.
+#define MAX_LZ4_BLOCK 65536
 
 typedef uint32_t plen_t;
 
+// How a chunk is compressed. Saved in the directory, so don't reorder.
+enum chunk_codec
+{
+    CODEC_ZLIB,   // deflate: smaller, for chunks that are seldom read back
+    CODEC_LZ4,    // LZ4 blocks: much faster, for chunks read back often
+    NUM_CODECS
+};
+
+const char *codec_name(chunk_codec codec);
+// The codec chunks of this name are written with.
+chunk_codec codec_for_chunk(const string &name);
+
+// Stages of a commit a crash can be simulated at, to test that the save
+// survives one there.
+enum commit_fault
+{
+    COMMIT_FAULT_NONE,
+    COMMIT_FAULT_BEFORE_SYNC,   // the directory written, nothing flushed
+    COMMIT_FAULT_BEFORE_HEADER, // flushed, but the header not yet updated
+    COMMIT_FAULT_AFTER_HEADER,  // the header updated, but not yet flushed
+};
+
+class mapped_file;
 class package;
 
 class chunk_writer
@@ -28,14 +62,20 @@ private:
     plen_t first_block;
     plen_t cur_block;
     plen_t block_len;
+    chunk_codec codec;
 #ifdef USE_ZLIB
     z_stream zs;
     Bytef *z_buffer;
 #endif
+    // LZ4: what's to go in the next block, and the block compressed.
+    vector<unsigned char> lz_in, lz_out;
     void raw_write(const void *data, plen_t len);
     void finish_block(plen_t next);
+    void lz4_write(const void *data, plen_t len);
+    void lz4_flush();
 public:
     chunk_writer(package *parent, const string &_name);
+    chunk_writer(package *parent, const string &_name, chunk_codec _codec);
     ~chunk_writer();
     void write(const void *data, plen_t len);
     friend class package;
@@ -45,20 +85,35 @@ class chunk_reader
 {
 private:
     chunk_reader(package *parent, plen_t start);
-    void init(plen_t start);
+    void init(plen_t start, chunk_codec _codec);
     package *pkg;
     plen_t first_block, next_block;
     plen_t off, block_left;
-#ifdef USE_ZLIB
+    chunk_codec codec;
     bool eof;
+#ifdef USE_ZLIB
     z_stream zs;
     Bytef z_buffer[32768];
 #endif
+    // LZ4: the block being read, which is in lz_block unless it could be
+    // read in place from the package's mapping, and how far into it we are.
+    // lz_packed holds blocks as stored, when they can't be decompressed in
+    // place. zlib: lz_block holds what view() last inflated.
+    const unsigned char *lz_data;
+    plen_t lz_len, lz_at;
+    vector<unsigned char> lz_block, lz_packed;
+    bool next_raw_block();
     plen_t raw_read(void *data, plen_t len);
+    const unsigned char *raw_view(plen_t len);
+    plen_t lz4_read(void *data, plen_t len);
+    bool lz4_next_block();
 public:
     chunk_reader(package *parent, const string &_name);
     ~chunk_reader();
     plen_t read(void *data, plen_t len);
+    // Hand out what's next in the chunk without copying it, and return how
+    // much that is, 0 at the end. data is good until the next read or view.
+    plen_t view(const unsigned char *&data);
     void read_all(vector<char> &data);
     friend class package;
 };
@@ -70,8 +125,19 @@ public:
     package();
     ~package();
     chunk_writer* writer(const string &name);
+    chunk_writer* writer(const string &name, chunk_codec codec);
     chunk_reader* reader(const string &name);
-    void commit();
+    // If async, only the chunks and directory are written before returning;
+    // flushing them and updating the header to point at the new directory
+    // is left to a thread. Until the next commit (which waits for it), the
+    // space the last directory used isn't reused, so a crash in between
+    // leaves the save as it was before this commit.
+    void commit(bool async = false);
+    // For tests: the next commit stops at fault as though the game crashed
+    // there, and leaves the package aborted.
+    void inject_commit_fault(commit_fault fault);
+    // Whether the last commit is still being finished in the background.
+    bool commit_in_progress() const;
     void delete_chunk(const string &name);
     bool has_chunk(const string &name);
     vector<string> list_chunks();
@@ -83,6 +149,7 @@ public:
     plen_t get_size() const { return file_len; };
     plen_t get_chunk_fragmentation(const string &name);
     plen_t get_chunk_compressed_length(const string &name);
+    chunk_codec get_chunk_codec(const string &name);
 private:
     string filename;
     bool rw;
@@ -93,18 +160,38 @@ private:
     bool aborted;
 #ifdef DO_FSYNC
     bool tmp;
+#endif
+    // Set by the commit thread, if there is one; read only after it's done.
+    commit_fault fault;
+    bool crashed;
+    int commit_errno;
+    const char *commit_error;
+#ifdef ASYNC_COMMIT
+    thread_t commit_thread;
+    bool committing;
+    plen_t commit_start;
+    static void *commit_thread_main(void *pkg);
 #endif
     map<string, plen_t> directory;
+    map<string, chunk_codec> codecs;
     map<plen_t, plen_t> free_blocks;
     vector<plen_t> unlinked_blocks;
+    // Unlinked by the commit in progress, so still in use until it's done.
+    vector<plen_t> committing_blocks;
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+    // Read-only packages are mapped into memory, and read from there without
+    // system calls; writeable ones change under the mapping.
+    mapped_file *mapping;
+    const unsigned char *map_view(plen_t at, plen_t len);
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
-    void finish_chunk(const string &name, plen_t at);
+    void finish_chunk(const string &name, plen_t at, chunk_codec codec);
     void free_chunk(const string &name);
     plen_t write_directory();
+    void write_header(plen_t start);
+    void finish_commit();
     void collect_blocks();
     void free_block_chain(plen_t at);
     void free_block(plen_t at, plen_t size);
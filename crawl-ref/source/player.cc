@@ -2477,7 +2477,7 @@ void forget_map(bool rot)
     for (rectangle_iterator ri(0); ri; ++ri)
     {
         const coord_def &p = *ri;
-        if (!env.map_knowledge(p).known() || you.see_cell(p))
+        if (!env.map_knowledge.get(p).known() || you.see_cell(p))
             continue;
 
         if (rot)
@@ -8243,7 +8243,7 @@ void player_open_door(coord_def doorpos)
         // Even if some of the door is out of LOS, we want the entire
         // door to be updated. Hitting this case requires a really big
         // door!
-        if (env.map_knowledge(dc).seen())
+        if (env.map_knowledge.get(dc).seen())
         {
             env.map_knowledge(dc).set_feature(DNGN_OPEN_DOOR);
 #ifdef USE_TILE
@@ -8403,7 +8403,7 @@ void player_close_door(coord_def doorpos)
         // Even if some of the door is out of LOS once it's closed
         // (or even if some of it is out of LOS when it's open), we
         // want the entire door to be updated.
-        if (env.map_knowledge(dc).seen())
+        if (env.map_knowledge.get(dc).seen())
         {
             env.map_knowledge(dc).set_feature(DNGN_CLOSED_DOOR);
 #ifdef USE_TILE
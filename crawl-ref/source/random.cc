@@ -24,6 +24,21 @@ uint64_t get_uint64(int generator)
     return rngs[generator].get_uint64();
 }
 
+string rng_state()
+{
+    string state;
+    for (const PcgRNG &rng : rngs)
+        state.append(reinterpret_cast<const char *>(&rng), sizeof(rng));
+    return state;
+}
+
+void set_rng_state(const string &state)
+{
+    ASSERT(state.size() == NUM_RNGS * sizeof(PcgRNG));
+    for (int i = 0; i < NUM_RNGS; ++i)
+        memcpy(&rngs[i], &state[i * sizeof(PcgRNG)], sizeof(PcgRNG));
+}
+
 static void _seed_rng(uint64_t seed_array[], int seed_len)
 {
     PcgRNG seeded(seed_array, seed_len);
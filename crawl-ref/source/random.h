@@ -14,6 +14,9 @@ void seed_rng(uint64_t[], int);
 
 uint32_t get_uint32(int generator = RNG_GAMEPLAY);
 uint64_t get_uint64(int generator = RNG_GAMEPLAY);
+// The state of every generator, to put back with set_rng_state().
+string rng_state();
+void set_rng_state(const string &state);
 bool coinflip();
 int div_rand_round(int num, int den);
 int div_round_up(int num, int den);
@@ -0,0 +1,106 @@
+-- Times the global LOS cache: cell_see_cell() on a quiet level, and then
+-- with smoke clouds appearing and vanishing around a point of the level the
+-- way they do in a fight, so that the cache keeps being invalidated.
+
+local args = script.simple_args()
+local place = args[1] or "D:12"
+local rounds = tonumber(args[2] or "50")
+
+if not rounds then
+  script.usage("Usage: los-bench [<place>] [<rounds>]")
+end
+
+local RANGE = 7
+local gxm, gym = dgn.max_bounds()
+
+local function open_cells()
+  local cells = { }
+  for x = 1, gxm - 2 do
+    for y = 1, gym - 2 do
+      if not feat.is_solid(x, y) then
+        table.insert(cells, dgn.point(x, y))
+      end
+    end
+  end
+  return cells
+end
+
+-- Every cell_see_cell() query between c and the cells in range of it.
+local function query_around(c)
+  local n = 0
+  for dx = -RANGE, RANGE do
+    for dy = -RANGE, RANGE do
+      if dgn.in_bounds(c.x + dx, c.y + dy) then
+        los.cell_see_cell(c.x, c.y, c.x + dx, c.y + dy)
+        n = n + 1
+      end
+    end
+  end
+  return n
+end
+
+local function report(what, count, ms)
+  local rate = ms > 0 and math.floor(count / ms) or count
+  crawl.stderr(string.format("%s: %d in %d ms (%d/ms)\n",
+                             what, count, ms, rate))
+end
+
+debug.goto_place(place)
+test.regenerate_level()
+
+local cells = open_cells()
+assert(#cells > 0, "No open cells on " .. place)
+
+-- Cold and warm queries.
+debug.los_changed()
+local queries = 0
+local start = crawl.millis()
+for _, c in ipairs(cells) do
+  queries = queries + query_around(c)
+end
+report("cold cell_see_cell", queries, crawl.millis() - start)
+
+queries = 0
+start = crawl.millis()
+for round = 1, rounds do
+  for _, c in ipairs(cells) do
+    queries = queries + query_around(c)
+  end
+end
+report("warm cell_see_cell", queries, crawl.millis() - start)
+
+-- Smoke coming and going: every change invalidates part of the cache,
+-- and the queries around it have to recompute what was lost.
+local changes = 0
+queries = 0
+start = crawl.millis()
+for round = 1, rounds do
+  for i = 1, #cells, 7 do
+    local c = cells[crawl.random2(#cells) + 1]
+    if dgn.cloud_at(c.x, c.y) then
+      dgn.delete_cloud(c.x, c.y)
+    else
+      dgn.place_cloud(c.x, c.y, "black smoke", 10)
+    end
+    changes = changes + 1
+    queries = queries + query_around(c)
+  end
+end
+local ms = crawl.millis() - start
+report("smoke changes", changes, ms)
+report("cell_see_cell with smoke", queries, ms)
+
+-- Invalidation alone.
+changes = 0
+start = crawl.millis()
+for round = 1, rounds do
+  for _, c in ipairs(cells) do
+    if dgn.cloud_at(c.x, c.y) then
+      dgn.delete_cloud(c.x, c.y)
+    else
+      dgn.place_cloud(c.x, c.y, "black smoke", 10)
+    end
+    changes = changes + 1
+  end
+end
+report("smoke changes, no queries", changes, crawl.millis() - start)
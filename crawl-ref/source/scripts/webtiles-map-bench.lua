@@ -0,0 +1,106 @@
+-- Times sending the map to webtiles clients, turn by turn, as the player
+-- wanders about a level full of monsters: once copying the whole map for
+-- the next turn's diff, as was done before map knowledge kept a journal of
+-- its changes, and once copying only the cells that changed.
+--
+-- Needs a webtiles build with wizard mode.
+
+local args = script.simple_args()
+local place = args[1] or "D:12"
+local turns = tonumber(args[2] or "500")
+
+if not turns then
+  script.usage("Usage: webtiles-map-bench [<place>] [<turns>]")
+end
+
+if not debug.send_map(false) then
+  script.usage("webtiles-map-bench needs a webtiles build.")
+end
+
+local RANGE = 8
+local MONSTERS = 60
+
+local function open_cells()
+  local gxm, gym = dgn.max_bounds()
+  local cells = { }
+  for x = 1, gxm - 2 do
+    for y = 1, gym - 2 do
+      if not feat.is_solid(x, y) then
+        table.insert(cells, dgn.point(x, y))
+      end
+    end
+  end
+  return cells
+end
+
+local function set_up_level()
+  debug.goto_place(place)
+  test.regenerate_level()
+  local cells = open_cells()
+  assert(#cells > 0, "No open cells on " .. place)
+  for i = 1, MONSTERS do
+    local c = cells[crawl.random2(#cells) + 1]
+    if not dgn.mons_at(c.x, c.y) then
+      dgn.create_monster(c.x, c.y, "orc / goblin / kobold / rat")
+    end
+  end
+  local start = cells[crawl.random2(#cells) + 1]
+  you.moveto(start.x, start.y)
+  debug.viewwindow(true)
+  debug.send_map(false)
+end
+
+local function wander()
+  local px, py = you.pos()
+  local steps = { }
+  for dx = -1, 1 do
+    for dy = -1, 1 do
+      local x, y = px + dx, py + dy
+      if (dx ~= 0 or dy ~= 0) and dgn.in_bounds(x, y)
+         and not feat.is_solid(x, y) and not dgn.mons_at(x, y) then
+        table.insert(steps, dgn.point(x, y))
+      end
+    end
+  end
+  if #steps > 0 then
+    local step = steps[crawl.random2(#steps) + 1]
+    you.moveto(step.x, step.y)
+  end
+end
+
+local function monsters_act()
+  local px, py = you.pos()
+  local nearby = { }
+  for dx = -RANGE, RANGE do
+    for dy = -RANGE, RANGE do
+      local x, y = px + dx, py + dy
+      local mons = dgn.in_bounds(x, y) and dgn.mons_at(x, y)
+      if mons then
+        table.insert(nearby, mons)
+      end
+    end
+  end
+  for _, mons in ipairs(nearby) do
+    debug.handle_monster_move(mons)
+  end
+end
+
+local function run(whole_snapshot)
+  set_up_level()
+  local bytes, ms = 0, 0
+  for turn = 1, turns do
+    wander()
+    monsters_act()
+    debug.viewwindow(true)
+    local start = crawl.millis()
+    bytes = bytes + debug.send_map(whole_snapshot)
+    ms = ms + crawl.millis() - start
+  end
+  crawl.stderr(string.format("%s: %d turns, %.1f bytes/turn, %.3f ms/turn\n",
+                             whole_snapshot and "whole map copied"
+                                            or "changed cells copied",
+                             turns, bytes / turns, ms / turns))
+end
+
+run(true)
+run(false)
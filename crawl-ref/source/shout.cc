@@ -14,6 +14,7 @@
 #include "artefact.h"
 #include "art-enum.h"
 #include "branch.h"
+#include "coordit.h"
 #include "database.h"
 #include "directn.h"
 #include "english.h"
@@ -34,6 +35,7 @@
 #include "state.h"
 #include "stringutil.h"
 #include "terrain.h"
+#include "unwind.h"
 #include "view.h"
 
 static noise_grid _noise_grid;
@@ -960,30 +962,71 @@ int noise_cell::turn_angle(const coord_def &next_delta) const
     return xdiff + ydiff;
 }
 
+noise_cells::noise_cells()
+    : cells(), stamps(), generation(1)
+{
+    stamps.init(0);
+}
+
+void noise_cells::clear()
+{
+    if (!++generation)
+    {
+        stamps.init(0);
+        generation = 1;
+    }
+}
+
+noise_cell &noise_cells::operator () (const coord_def &p)
+{
+    if (stamps(p) != generation)
+    {
+        cells(p) = noise_cell();
+        stamps(p) = generation;
+    }
+    return cells(p);
+}
+
+const noise_cell &noise_cells::operator () (const coord_def &p) const
+{
+    static const noise_cell unreached;
+    return stamps(p) == generation ? cells(p) : unreached;
+}
+
+// Shared by every noise_grid; only one is ever propagating at a time.
+static noise_cells _noise_cells;
+static vector<coord_def> _noise_perimeter[2];
+static bool _noise_propagating = false;
+
 noise_grid::noise_grid()
-    : cells(), noises(), affected_actor_count(0)
+    : noises(), affected_actor_count(0)
+#ifdef DEBUG_TESTS
+      , heard(nullptr)
+#endif
 {
 }
 
 void noise_grid::reset()
 {
-    cells.init(noise_cell());
     noises.clear();
     affected_actor_count = 0;
 }
 
 void noise_grid::register_noise(const noise_t &noise)
 {
-    noise_cell &target_cell(cells(noise.noise_source));
-    if (target_cell.can_apply_noise(noise.noise_intensity_millis))
+    // The cells aren't filled in until propagate_noise(), but the noise at
+    // the source is that of the last noise there: each one registered had to
+    // be louder than the one before it.
+    int intensity = 0;
+    for (const noise_t &other : noises)
+        if (other.noise_source == noise.noise_source)
+            intensity = other.noise_intensity_millis;
+
+    if (intensity < noise.noise_intensity_millis)
     {
         const int noise_index = noises.size();
         noises.push_back(noise);
         noises[noise_index].noise_id = noise_index;
-        cells(noise.noise_source).apply_noise(noise.noise_intensity_millis,
-                                              noise_index,
-                                              0,
-                                              coord_def(0, 0));
     }
 }
 
@@ -996,21 +1039,30 @@ void noise_grid::propagate_noise()
     dprf(DIAG_NOISE, "noise_grid: %u noises to apply",
          (unsigned int)noises.size());
 #endif
-    vector<coord_def> noise_perimeter[2];
+    ASSERT(!_noise_propagating);
+    unwind_bool propagating(_noise_propagating, true);
+
+    _noise_cells.clear();
     int circ_index = 0;
+    _noise_perimeter[0].clear();
+    _noise_perimeter[1].clear();
 
     for (const noise_t &noise : noises)
-        noise_perimeter[circ_index].push_back(noise.noise_source);
+    {
+        _noise_cells(noise.noise_source).apply_noise(
+            noise.noise_intensity_millis, noise.noise_id, 0, coord_def(0, 0));
+        _noise_perimeter[circ_index].push_back(noise.noise_source);
+    }
 
     int travel_distance = 0;
-    while (!noise_perimeter[circ_index].empty())
+    while (!_noise_perimeter[circ_index].empty())
     {
-        const vector<coord_def> &perimeter(noise_perimeter[circ_index]);
-        vector<coord_def> &next_perimeter(noise_perimeter[!circ_index]);
+        const vector<coord_def> &perimeter(_noise_perimeter[circ_index]);
+        vector<coord_def> &next_perimeter(_noise_perimeter[!circ_index]);
         ++travel_distance;
         for (const coord_def p : perimeter)
         {
-            const noise_cell &cell(cells(p));
+            const noise_cell &cell(_noise_cells(p));
 
             if (!cell.silent())
             {
@@ -1052,7 +1104,7 @@ void noise_grid::propagate_noise()
             }
         }
 
-        noise_perimeter[circ_index].clear();
+        _noise_perimeter[circ_index].clear();
         circ_index = !circ_index;
     }
 
@@ -1060,7 +1112,7 @@ void noise_grid::propagate_noise()
     if (affected_actor_count)
     {
         mprf(MSGCH_WARN, "Writing noise grid with %d noise sources",
-             noises.size());
+             (int)noises.size());
         dump_noise_grid("noise-grid.html");
     }
 #endif
@@ -1072,7 +1124,7 @@ bool noise_grid::propagate_noise_to_neighbour(int base_attenuation,
                                               const coord_def &current_pos,
                                               const coord_def &next_pos)
 {
-    noise_cell &neighbour(cells(next_pos));
+    noise_cell &neighbour(_noise_cells(next_pos));
     if (!neighbour.can_apply_noise(cell.noise_intensity_millis
                                    - base_attenuation))
     {
@@ -1105,6 +1157,15 @@ void noise_grid::apply_noise_effects(const coord_def &pos,
                                      const noise_t &noise,
                                      int noise_travel_distance)
 {
+#ifdef DEBUG_TESTS
+    if (heard)
+    {
+        heard->push_back({ pos, noise_intensity_millis, noise.noise_id,
+                           noise_travel_distance });
+        return;
+    }
+#endif
+
     if (you.pos() == pos)
     {
         _actor_apply_noise(&you, noise.noise_source,
@@ -1155,7 +1216,8 @@ coord_def noise_grid::noise_perceived_position(actor *act,
                                                const coord_def &affected_pos,
                                                const noise_t &noise) const
 {
-    const int noise_travel_distance = cells(affected_pos).noise_travel_distance;
+    const int noise_travel_distance =
+        _noise_cells(affected_pos).noise_travel_distance;
     if (!noise_travel_distance)
         return noise.noise_source;
 
@@ -1266,7 +1328,8 @@ static void _write_noise_grid_css(FILE *outf)
 
 void noise_grid::write_cell(FILE *outf, coord_def p, int ch) const
 {
-    const int intensity = min(25, cells(p).noise_intensity_millis / 1000);
+    const int intensity =
+        min(25, _noise_cells(p).noise_intensity_millis / 1000);
     if (intensity)
         fprintf(outf, "<span class='i%d'>&#%d;</span>", intensity, ch);
     else
@@ -513,7 +513,7 @@ void show_update_at(const coord_def &gp, layers_type layers)
 {
     if (you.see_cell(gp))
         env.map_knowledge(gp).clear_data();
-    else if (!env.map_knowledge(gp).known())
+    else if (!env.map_knowledge.get(gp).known())
         return;
     else
         env.map_knowledge(gp).clear_monster();
@@ -522,7 +522,7 @@ int detect_items(int pow)
         // Note: assumptions are being made here about how
         // terrain can change (eg it used to be solid, and
         // thus item free).
-        if (pow != -1 && env.map_knowledge(*ri).changed())
+        if (pow != -1 && env.map_knowledge.get(*ri).changed())
             continue;
 
         if (igrd(*ri) != NON_ITEM
@@ -577,12 +577,12 @@ static bool _mark_detected_creature(coord_def where, monster* mon,
                 continue;
 
             // Try not to overwrite another detected monster.
-            if (env.map_knowledge(place).detected_monster())
+            if (env.map_knowledge.get(place).detected_monster())
                 continue;
 
             // Don't print monsters on terrain they cannot pass through,
             // not even if said terrain has since changed.
-            if (!env.map_knowledge(place).changed()
+            if (!env.map_knowledge.get(place).changed()
                 && mon->can_pass_through_feat(grd(place)))
             {
                 found_good = true;
@@ -910,7 +910,7 @@ static bool _do_imprison(int pow, const coord_def& where, bool zin)
                 env.tile_flv(*ai).feat_idx =
                         store_tilename_get_index("dngn_silver_wall");
                 env.tile_flv(*ai).feat = TILE_DNGN_SILVER_WALL;
-                if (env.map_knowledge(*ai).seen())
+                if (env.map_knowledge.get(*ai).seen())
                 {
                     env.map_knowledge(*ai).set_feature(DNGN_METAL_WALL);
                     env.map_knowledge(*ai).clear_item();
@@ -158,7 +158,13 @@ static void _initialize()
         seed_rng(Options.seed);
 
 #ifdef DEBUG_STATISTICS
-    if (crawl_state.map_stat_gen)
+    if (crawl_state.levelgen_bench)
+    {
+        release_cli_signals();
+        mapstat_run_benchmark();
+        end(0, false);
+    }
+    else if (crawl_state.map_stat_gen)
     {
         release_cli_signals();
         mapstat_generate_stats();
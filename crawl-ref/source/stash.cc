@@ -165,14 +165,15 @@ static void _fully_identify_item(item_def *item)
 // Stash
 // ----------------------------------------------------------------------
 
-Stash::Stash(coord_def pos_) : items()
+Stash::Stash(coord_def pos_)
+    : verified(false), feat(DNGN_FLOOR), trap(NUM_TRAPS), items()
 {
     // First, fix what square we're interested in
     if (pos_.origin())
         pos_ = you.pos();
     pos = pos_;
 
-    update();
+    _update();
 }
 
 bool Stash::are_items_same(const item_def &a, const item_def &b, bool exact)
@@ -257,8 +258,56 @@ bool Stash::unmark_trapping_nets()
     return changed;
 }
 
+// Would this item be saved just as that one is? Properties are only written
+// out to compare when there are some.
+static bool _same_saved_item(const item_def &a, const item_def &b)
+{
+    if (a.base_type != b.base_type || a.sub_type != b.sub_type
+        || a.plus != b.plus || a.plus2 != b.plus2 || a.special != b.special
+        || a.quantity != b.quantity || a.rnd != b.rnd || a.pos != b.pos
+        || a.flags != b.flags || a.link != b.link || a.slot != b.slot
+        || !(a.orig_place == b.orig_place)
+        || a.orig_monnum != b.orig_monnum || a.inscription != b.inscription
+        || a.props.size() != b.props.size())
+    {
+        return false;
+    }
+    if (a.props.empty())
+        return true;
+
+    vector<unsigned char> abuf, bbuf;
+    writer aout(&abuf), bout(&bbuf);
+    a.props.write(aout);
+    b.props.write(bout);
+    return abuf == bbuf;
+}
+
+static bool _same_saved_items(const vector<item_def> &a,
+                              const vector<item_def> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (unsigned int i = 0; i < a.size(); ++i)
+        if (!_same_saved_item(a[i], b[i]))
+            return false;
+    return true;
+}
+
+// Stashes are updated every time they come into view, but seldom change;
+// only tell the tracker when what would be saved of this one has.
 void Stash::update()
 {
+    if (_update())
+        StashTrack.note_change();
+}
+
+// Returns whether anything that would be saved changed.
+bool Stash::_update()
+{
+    const dungeon_feature_type old_feat = feat;
+    const trap_type old_trap = trap;
+    const bool was_verified = verified;
+
     feat = grd(pos);
     trap = NUM_TRAPS;
 
@@ -272,22 +321,32 @@ void Stash::update()
             feat = DNGN_FLOOR, trap = TRAP_UNASSIGNED;
     }
 
-    if (feat == DNGN_FLOOR)
-        feat_desc = "";
-    else
-        feat_desc = feature_description_at(pos, false, DESC_A, false);
+    const string desc =
+        feat == DNGN_FLOOR ? ""
+                           : feature_description_at(pos, false, DESC_A, false);
+    bool changed = feat != old_feat || trap != old_trap || desc != feat_desc;
+    feat_desc = desc;
+
+    changed = _update_items() || changed;
+    return changed || verified != was_verified;
+}
 
+// Returns whether the items (not counting verified) changed.
+bool Stash::_update_items()
+{
     // If this is your position, you know what's on this square
     if (pos == you.pos())
     {
         // Zap existing items
-        items.clear();
+        vector<item_def> old_items;
+        old_items.swap(items);
 
         // Now, grab all items on that square and fill our vector
         for (stack_iterator si(pos, true); si; ++si)
             add_item(*si);
 
         verified = true;
+        return !_same_saved_items(old_items, items);
     }
     // If this is not your position, the only thing we can do is verify that
     // what the player sees on the square is the first item in this vector.
@@ -295,9 +354,10 @@ void Stash::update()
     {
         if (!_grid_has_perceived_item(pos))
         {
+            const bool had_items = !items.empty();
             items.clear();
             verified = true;
-            return;
+            return had_items;
         }
 
         // There's something on this square. Take a squint at it.
@@ -308,8 +368,9 @@ void Stash::update()
         maybe_identify_base_type(*pitem);
         const item_def& item = *pitem;
 
+        vector<item_def> old_items;
         if (!_grid_has_perceived_multiple_items(pos))
-            items.clear();
+            old_items.swap(items);
 
         // We knew of nothing on this square, so we'll assume this is the
         // only item here, but mark it as unverified unless we can see nothing
@@ -321,7 +382,7 @@ void Stash::update()
             // Note that we could be lying here, since we can have
             // a verified falsehood (if there's a mimic.)
             verified = !_grid_has_perceived_multiple_items(pos);
-            return;
+            return !_same_saved_items(old_items, items);
         }
 
         // There's more than one item in this pile. Check to see if
@@ -335,7 +396,9 @@ void Stash::update()
             {
                 items.erase(items.begin());
                 add_item(item, true);
+                return true;
             }
+            return false;
         }
         else
         {
@@ -353,7 +416,7 @@ void Stash::update()
 
                     // We don't set verified to true. If this stash was
                     // already unverified, it remains so.
-                    return;
+                    return true;
                 }
             }
 
@@ -366,6 +429,7 @@ void Stash::update()
             // vector, and mark this as unverified
             add_item(item, true);
             verified = false;
+            return true;
         }
     }
 }
@@ -1162,6 +1226,7 @@ void LevelStashes::move_stash(const coord_def& from, const coord_def& to)
 void LevelStashes::kill_stash(const Stash &s)
 {
     m_stashes.erase(s.pos);
+    StashTrack.note_change();
 }
 
 void LevelStashes::add_stash(coord_def p)
@@ -1177,7 +1242,10 @@ void LevelStashes::add_stash(coord_def p)
     {
         Stash new_stash(p);
         if (!new_stash.empty())
+        {
             m_stashes[new_stash.pos] = new_stash;
+            StashTrack.note_change();
+        }
     }
 }
 
@@ -1344,7 +1412,10 @@ void LevelStashes::remove_shop(const coord_def& c)
 
 LevelStashes &StashTracker::get_current_level()
 {
-    return levels[level_id::current()];
+    auto added = levels.emplace(level_id::current(), LevelStashes());
+    if (added.second)
+        ++change_generation;
+    return added.first->second;
 }
 
 LevelStashes *StashTracker::find_level(const level_id &id)
@@ -1373,20 +1444,29 @@ bool StashTracker::update_stash(const coord_def& c)
 void StashTracker::move_stash(const coord_def& from, const coord_def& to)
 {
     if (LevelStashes *lev = find_current_level())
+    {
         lev->move_stash(from, to);
+        ++change_generation;
+    }
 }
 
 bool StashTracker::unmark_trapping_nets(const coord_def &c)
 {
     if (LevelStashes *lev = find_current_level())
-        return lev->unmark_trapping_nets(c);
+    {
+        if (!lev->unmark_trapping_nets(c))
+            return false;
+        ++change_generation;
+        return true;
+    }
     else
         return false;
 }
 
 void StashTracker::remove_level(const level_id &place)
 {
-    levels.erase(place);
+    if (levels.erase(place))
+        ++change_generation;
 }
 
 void StashTracker::add_stash(coord_def p)
@@ -1448,6 +1528,7 @@ void StashTracker::load(reader& inf)
         if (st.has_stashes())
             levels[st.where()] = st;
     }
+    ++change_generation;
 }
 
 void StashTracker::update_visible_stashes()
@@ -1468,7 +1549,15 @@ void StashTracker::update_visible_stashes()
         }
 
         if (feat == DNGN_ENTER_SHOP)
-            get_shop(*ri);
+        {
+            if (!lev)
+                lev = &get_current_level();
+            if (!lev->find_shop(*ri))
+            {
+                lev->get_shop(*ri);
+                ++change_generation;
+            }
+        }
     }
 
     if (lev && !lev->has_stashes())
@@ -1504,7 +1593,10 @@ void StashTracker::remove_shop(const level_pos &pos)
 {
     LevelStashes *lev = find_level(pos.id);
     if (lev)
+    {
         lev->remove_shop(pos.pos);
+        ++change_generation;
+    }
 }
 
 class stash_search_reader : public line_reader
@@ -2002,6 +2094,7 @@ void StashTracker::update_corpses()
         (you.elapsed_time - last_corpse_update) / ROT_TIME_FACTOR;
 
     last_corpse_update = you.elapsed_time;
+    ++change_generation;
 
     for (auto &entry : levels)
         entry.second._update_corpses(rot_time);
@@ -2012,6 +2105,7 @@ void StashTracker::update_identification()
     if (!you_worship(GOD_ASHENZARI))
         return;
 
+    ++change_generation;
     for (auto &entry : levels)
         entry.second._update_identification();
 }
@@ -67,6 +67,8 @@ public:
     bool is_verified() const {  return verified; }
 
 private:
+    bool _update();
+    bool _update_items();
     void _update_corpses(int rot_time);
     void _update_identification();
     void add_item(const item_def &item, bool add_to_front = false);
@@ -269,7 +271,7 @@ private:
 class StashTracker
 {
 public:
-    StashTracker() : levels(), last_corpse_update(0)
+    StashTracker() : levels(), last_corpse_update(0), change_generation(0)
     {
     }
 
@@ -281,6 +283,7 @@ public:
 
     ShopInfo &get_shop(const coord_def& c)
     {
+        ++change_generation;
         return get_current_level().get_shop(c);
     }
 
@@ -309,6 +312,10 @@ public:
     void dump(const char *filename, bool identify = false) const;
 
     void remove_shop(const level_pos &pos);
+
+    // Bumped whenever what save() would write may have changed.
+    unsigned int generation() const { return change_generation; }
+    void note_change() { ++change_generation; }
 private:
     void get_matching_stashes(const base_pattern &search,
                               vector<stash_search_result> &results,
@@ -324,6 +331,7 @@ private:
     stash_levels_t levels;
 
     int last_corpse_update;
+    unsigned int change_generation;
 
     friend class ST_ItemIterator;
 };
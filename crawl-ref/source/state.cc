@@ -31,8 +31,10 @@ game_state::game_state()
       terminal_resized(false), last_winch(0), io_inited(false),
       need_save(false), saving_game(false), updating_scores(false),
       seen_hups(0), map_stat_gen(false), obj_stat_gen(false),
+      levelgen_bench(false),
       type(GAME_TYPE_NORMAL), last_type(GAME_TYPE_UNSPECIFIED),
-      arena_suspended(false), generating_level(false), dump_maps(false),
+      arena_suspended(false), generating_level(false), speculating(false),
+      dump_maps(false),
       test(false), script(false), build_db(false), tests_selected(),
 #ifdef DGAMELAUNCH
       throttle(true),
@@ -52,6 +52,7 @@ struct game_state
 
     bool map_stat_gen;      // Set if we're generating stats on maps.
     bool obj_stat_gen;      // Set if we're generating object stats.
+    bool levelgen_bench;    // Set if we're timing level generation.
 
     game_type type;
     game_type last_type;
@@ -59,6 +60,8 @@ struct game_state
     bool arena_suspended;   // Set if the arena has been temporarily
                             // suspended.
     bool generating_level;
+    bool speculating;       // Set in a helper building the next level
+                            // ahead of time.
 
     bool dump_maps;         // Dump map Lua to stderr on fresh parse.
     bool test;              // Set if we want to run self-tests and exit.
@@ -9,9 +9,10 @@
 #include "store.h"
 
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 #include "dlua.h"
-#include "libutil.h" // map_find
 #include "monster.h"
 #include "stringutil.h"
 
@@ -30,6 +31,25 @@ CrawlStoreValue::CrawlStoreValue()
     val.ptr = nullptr;
 }
 
+CrawlStoreValue::CrawlStoreValue(CrawlStoreValue &&other) noexcept
+    : type(other.type), flags(other.flags), val(other.val)
+{
+    other.type    = SV_NONE;
+    other.flags   = SFLAG_UNSET;
+    other.val.ptr = nullptr;
+}
+
+// Exchange contents with other, flags and all, without the checks
+// assignment makes: for moving values around inside a container.
+void CrawlStoreValue::swap(CrawlStoreValue &other)
+{
+    const store_val_type t = type;
+    type = other.type;
+    other.type = t;
+    std::swap(flags, other.flags);
+    std::swap(val, other.val);
+}
+
 CrawlStoreValue::CrawlStoreValue(const CrawlStoreValue &other)
 {
     ASSERT_RANGE(other.type, SV_NONE, NUM_STORE_VAL_TYPES);
@@ -1233,6 +1253,108 @@ string &CrawlStoreValue::operator += (const string &_val)
 ////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // Every name a prop_key is held for, its number, and how many keys
+    // hold it.
+    struct prop_key_registry
+    {
+        unordered_map<string, int> ids;
+        // A deque, so that references to names stay good as it grows.
+        deque<string> names;
+        vector<int> refs;
+        vector<int> free_ids;
+    };
+}
+
+// Never freed: tables in globals, like you.props, may outlive any static.
+static prop_key_registry &_prop_keys()
+{
+    static prop_key_registry *registry = new prop_key_registry;
+    return *registry;
+}
+
+static int _intern_prop_key(const string &name)
+{
+    prop_key_registry &keys = _prop_keys();
+    auto found = keys.ids.find(name);
+    if (found != keys.ids.end())
+    {
+        keys.refs[found->second]++;
+        return found->second;
+    }
+
+    int id;
+    if (!keys.free_ids.empty())
+    {
+        id = keys.free_ids.back();
+        keys.free_ids.pop_back();
+        keys.names[id] = name;
+        keys.refs[id] = 1;
+    }
+    else
+    {
+        id = keys.names.size();
+        keys.names.push_back(name);
+        keys.refs.push_back(1);
+    }
+    keys.ids[name] = id;
+    return id;
+}
+
+static void _release_prop_key(int id)
+{
+    prop_key_registry &keys = _prop_keys();
+    ASSERT(keys.refs[id] > 0);
+    if (--keys.refs[id])
+        return;
+
+    keys.ids.erase(keys.names[id]);
+    keys.names[id].clear();
+    keys.free_ids.push_back(id);
+}
+
+prop_key::prop_key(const string &name) : key_id(_intern_prop_key(name))
+{
+}
+
+prop_key::prop_key(const char *name) : key_id(_intern_prop_key(name))
+{
+}
+
+prop_key::prop_key(const prop_key &other) : key_id(other.key_id)
+{
+    _prop_keys().refs[key_id]++;
+}
+
+prop_key::~prop_key()
+{
+    _release_prop_key(key_id);
+}
+
+prop_key &prop_key::operator = (const prop_key &other)
+{
+    _prop_keys().refs[other.key_id]++;
+    _release_prop_key(key_id);
+    key_id = other.key_id;
+    return *this;
+}
+
+const string &prop_key::name() const
+{
+    return _prop_keys().names[key_id];
+}
+
+int prop_key::find(const string &name)
+{
+    const prop_key_registry &keys = _prop_keys();
+    auto found = keys.ids.find(name);
+    return found == keys.ids.end() ? -1 : found->second;
+}
+
+////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////
+
 CrawlHashTable::CrawlHashTable()
 {
     hash_map = nullptr;
@@ -1289,10 +1411,22 @@ void CrawlHashTable::write(writer &th) const
 
     marshallUnsigned(th, size());
 
-    for (const auto &entry : *hash_map)
+    // In order of name, as when this was a std::map, so that what is saved
+    // doesn't depend on the order names happened to be interned in.
+    vector<const value_type *> entries;
+    entries.reserve(hash_map->size());
+    for (int slot : hash_map->order)
+        entries.push_back(&hash_map->slots[slot]);
+    sort(entries.begin(), entries.end(),
+         [](const value_type *a, const value_type *b)
+         {
+             return a->first.name() < b->first.name();
+         });
+
+    for (const value_type *entry : entries)
     {
-        marshallString(th, entry.first);
-        entry.second.write(th);
+        marshallString(th, entry->first.name());
+        entry->second.write(th);
     }
 
     ASSERT_VALIDITY();
@@ -1347,7 +1481,108 @@ bool CrawlHashTable::exists(const string &key) const
 
     ACCESS(key);
     ASSERT_VALIDITY();
-    return hash_map->find(key) != hash_map->end();
+    const int id = prop_key::find(key);
+    return id >= 0 && find(id);
+}
+
+bool CrawlHashTable::exists(const prop_key &key) const
+{
+    if (!hash_map)
+        return false;
+
+    ACCESS(key.name());
+    ASSERT_VALIDITY();
+    return find(key.id());
+}
+
+vector<int>::const_iterator CrawlHashTable::lower_bound(int id) const
+{
+    const deque<value_type> &slots = hash_map->slots;
+    return std::lower_bound(hash_map->order.begin(), hash_map->order.end(),
+                            id,
+                            [&slots](int slot, int _id)
+                            {
+                                return slots[slot].first.id() < _id;
+                            });
+}
+
+const CrawlStoreValue *CrawlHashTable::find(int id) const
+{
+    if (!hash_map)
+        return nullptr;
+
+    auto it = lower_bound(id);
+    if (it == hash_map->order.end()
+        || hash_map->slots[*it].first.id() != id)
+    {
+        return nullptr;
+    }
+    return &hash_map->slots[*it].second;
+}
+
+CrawlStoreValue *CrawlHashTable::find(int id)
+{
+    const CrawlHashTable *table = this;
+    return const_cast<CrawlStoreValue *>(table->find(id));
+}
+
+CrawlStoreValue &CrawlHashTable::insert(vector<int>::const_iterator pos,
+                                        const prop_key &key)
+{
+    int slot;
+    if (!hash_map->free_slots.empty())
+    {
+        slot = hash_map->free_slots.back();
+        hash_map->free_slots.pop_back();
+        hash_map->slots[slot].first = key;
+    }
+    else
+    {
+        slot = hash_map->slots.size();
+        hash_map->slots.emplace_back(key, CrawlStoreValue());
+    }
+    hash_map->order.insert(hash_map->order.begin()
+                           + (pos - hash_map->order.begin()), slot);
+    return hash_map->slots[slot].second;
+}
+
+CrawlStoreValue &CrawlHashTable::find_or_insert(const prop_key &key)
+{
+    init_hash_map();
+
+    auto it = lower_bound(key.id());
+    if (it != hash_map->order.end() && hash_map->slots[*it].first == key)
+        return hash_map->slots[*it].second;
+
+    return insert(it, key);
+}
+
+void CrawlHashTable::erase_id(int id)
+{
+    ASSERT_VALIDITY();
+    init_hash_map();
+
+    auto it = lower_bound(id);
+    if (it == hash_map->order.end()
+        || hash_map->slots[*it].first.id() != id)
+    {
+        return;
+    }
+
+    const int slot = *it;
+    value_type &entry = hash_map->slots[slot];
+#ifdef ASSERTS
+    ASSERT(!(entry.second.flags & SFLAG_NO_ERASE));
+#endif
+
+    // Keep the slot for the next insert, but let go of what it held,
+    // name and all.
+    static const prop_key free_slot("");
+    entry.first = free_slot;
+    CrawlStoreValue().swap(entry.second);
+    hash_map->order.erase(hash_map->order.begin()
+                          + (it - hash_map->order.begin()));
+    hash_map->free_slots.push_back(slot);
 }
 
 void CrawlHashTable::assert_validity() const
@@ -1357,14 +1592,19 @@ void CrawlHashTable::assert_validity() const
         return;
 
     size_t actual_size = 0;
+    int last_id = -1;
 
-    for (const auto &entry : *hash_map)
+    for (int slot : hash_map->order)
     {
         actual_size++;
 
-        const string          &key = entry.first;
+        const value_type      &entry = hash_map->slots[slot];
+        const string          &key = entry.first.name();
         const CrawlStoreValue &val = entry.second;
 
+        ASSERT(entry.first.id() > last_id);
+        last_id = entry.first.id();
+
         ASSERT(!key.empty());
         string trimmed = trimmed_string(key);
         ASSERT(key == trimmed);
@@ -1417,13 +1657,25 @@ void CrawlHashTable::assert_validity() const
 // Accessors to contained values
 
 CrawlStoreValue& CrawlHashTable::get_value(const string &key)
+{
+    // Only intern the name if this adds it.
+    const int id = prop_key::find(key);
+    if (CrawlStoreValue *store = id >= 0 ? find(id) : nullptr)
+    {
+        ASSERT_VALIDITY();
+        ACCESS(key);
+        return *store;
+    }
+    return get_value(prop_key(key));
+}
+
+CrawlStoreValue& CrawlHashTable::get_value(const prop_key &key)
 {
     ASSERT_VALIDITY();
-    init_hash_map();
 
-    ACCESS(key);
+    ACCESS(key.name());
     // Inserts CrawlStoreValue() if the key was not found.
-    return (*hash_map)[key];
+    return find_or_insert(key);
 }
 
 const CrawlStoreValue& CrawlHashTable::get_value(const string &key) const
@@ -1433,7 +1685,8 @@ const CrawlStoreValue& CrawlHashTable::get_value(const string &key) const
     ASSERT_VALIDITY();
 
     ACCESS(key);
-    CrawlStoreValue *store = map_find(*hash_map, key);
+    const int id = prop_key::find(key);
+    const CrawlStoreValue *store = id >= 0 ? find(id) : nullptr;
 
     ASSERTM(store, "trying to read non-existent property \"%s\"", key.c_str());
     ASSERT(store->type != SV_NONE);
@@ -1442,6 +1695,23 @@ const CrawlStoreValue& CrawlHashTable::get_value(const string &key) const
     return *store;
 }
 
+const CrawlStoreValue& CrawlHashTable::get_value(const prop_key &key) const
+{
+    ASSERTM(hash_map, "trying to read non-existent property \"%s\"",
+            key.name().c_str());
+    ASSERT_VALIDITY();
+
+    ACCESS(key.name());
+    const CrawlStoreValue *store = find(key.id());
+
+    ASSERTM(store, "trying to read non-existent property \"%s\"",
+            key.name().c_str());
+    ASSERT(store->type != SV_NONE);
+    ASSERT(!(store->flags & SFLAG_UNSET));
+
+    return *store;
+}
+
 ///////////////////////////
 // std::map style interface
 unsigned int CrawlHashTable::size() const
@@ -1462,21 +1732,16 @@ bool CrawlHashTable::empty() const
 
 void CrawlHashTable::erase(const string& key)
 {
-    ASSERT_VALIDITY();
-    init_hash_map();
-
     ACCESS(key);
-    iterator i = hash_map->find(key);
-
-    if (i != hash_map->end())
-    {
-#ifdef ASSERTS
-        CrawlStoreValue &val = i->second;
-        ASSERT(!(val.flags & SFLAG_NO_ERASE));
-#endif
+    const int id = prop_key::find(key);
+    if (id >= 0)
+        erase_id(id);
+}
 
-        hash_map->erase(i);
-    }
+void CrawlHashTable::erase(const prop_key &key)
+{
+    ACCESS(key.name());
+    erase_id(key.id());
 }
 
 void CrawlHashTable::clear()
@@ -1494,7 +1759,7 @@ CrawlHashTable::iterator CrawlHashTable::begin()
     ASSERT_VALIDITY();
     init_hash_map();
 
-    return hash_map->begin();
+    return iterator(&hash_map->slots, hash_map->order.begin());
 }
 
 CrawlHashTable::iterator CrawlHashTable::end()
@@ -1502,7 +1767,7 @@ CrawlHashTable::iterator CrawlHashTable::end()
     ASSERT_VALIDITY();
     init_hash_map();
 
-    return hash_map->end();
+    return iterator(&hash_map->slots, hash_map->order.end());
 }
 
 CrawlHashTable::const_iterator CrawlHashTable::begin() const
@@ -1510,7 +1775,7 @@ CrawlHashTable::const_iterator CrawlHashTable::begin() const
     ASSERT(hash_map != nullptr);
     ASSERT_VALIDITY();
 
-    return hash_map->begin();
+    return const_iterator(&hash_map->slots, hash_map->order.begin());
 }
 
 CrawlHashTable::const_iterator CrawlHashTable::end() const
@@ -1518,7 +1783,7 @@ CrawlHashTable::const_iterator CrawlHashTable::end() const
     ASSERT(hash_map != nullptr);
     ASSERT_VALIDITY();
 
-    return hash_map->end();
+    return const_iterator(&hash_map->slots, hash_map->order.end());
 }
 
 void CrawlHashTable::init_hash_map()
@@ -8,6 +8,8 @@
 #define STORE_H
 
 #include <climits>
+#include <deque>
+#include <iterator>
 #include <map>
 #include <string>
 #include <vector>
@@ -78,6 +80,7 @@ class CrawlStoreValue
 public:
     CrawlStoreValue();
     CrawlStoreValue(const CrawlStoreValue &other);
+    CrawlStoreValue(CrawlStoreValue &&other) noexcept;
 
     ~CrawlStoreValue();
 
@@ -238,11 +241,53 @@ protected:
     void read(reader &);
 
     void unset(bool force = false);
+    void swap(CrawlStoreValue &other);
 
     friend class CrawlHashTable;
     friend class CrawlVector;
 };
 
+// The name of a hash table entry, interned: every name in use is given a
+// small number, and a table keeps its entries sorted by those numbers.
+// Looking up a prop_key costs a binary search on ints, while looking up a
+// string costs a lookup of the string's number first; so hot code should
+// make its keys once, as statics, and use those.
+//
+// Only making a prop_key interns a name, and a table only makes them for
+// entries it adds: looking a name up never does. A name is let go, and its
+// number used again, once the last prop_key for it is gone.
+//
+// Numbers are only good for the one run of the game: save files and
+// everything else outside go by the name.
+class prop_key
+{
+public:
+    explicit prop_key(const string &name);
+    explicit prop_key(const char *name);
+    prop_key(const prop_key &other);
+    ~prop_key();
+
+    prop_key &operator = (const prop_key &other);
+
+    const string &name() const;
+    operator const string &() const { return name(); }
+    int id() const { return key_id; }
+
+    bool operator == (const prop_key &other) const
+    { return key_id == other.key_id; }
+    bool operator != (const prop_key &other) const
+    { return key_id != other.key_id; }
+    bool operator < (const prop_key &other) const
+    { return key_id < other.key_id; }
+
+    // The number of a name that is interned, or -1 if it isn't: in which
+    // case no table can have it.
+    static int find(const string &name);
+
+private:
+    int key_id;
+};
+
 // By default a hash table's value data types are heterogeneous. To
 // make it homogeneous (which causes dynamic type checking) you have
 // to give a type to the hash table constructor; once it's been
@@ -255,9 +300,59 @@ public:
 
     ~CrawlHashTable();
 
-    typedef map<string, CrawlStoreValue>  hash_map_type;
-    typedef hash_map_type::iterator       iterator;
-    typedef hash_map_type::const_iterator const_iterator;
+    typedef pair<prop_key, CrawlStoreValue> value_type;
+
+    // Entries live in a deque, which never moves them: so, as with a map,
+    // references to the values in a table stay good while other entries
+    // are added and erased. order holds their slots sorted by key number,
+    // for lookup and iteration; erased slots are kept for reuse.
+    struct hash_map_type
+    {
+        deque<value_type> slots;
+        vector<int> order;
+        vector<int> free_slots;
+
+        size_t size() const { return order.size(); }
+        bool empty() const { return order.empty(); }
+    };
+
+    template <typename Value, typename Slots>
+    class entry_iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef ptrdiff_t difference_type;
+        typedef Value value_type;
+        typedef Value *pointer;
+        typedef Value &reference;
+
+        entry_iterator(Slots *_slots, vector<int>::const_iterator _pos)
+            : slots(_slots), pos(_pos) { }
+
+        Value &operator*() const { return (*slots)[*pos]; }
+        Value *operator->() const { return &(*slots)[*pos]; }
+
+        entry_iterator &operator++() { ++pos; return *this; }
+        entry_iterator operator++(int)
+        {
+            entry_iterator old = *this;
+            ++pos;
+            return old;
+        }
+
+        bool operator == (const entry_iterator &other) const
+        { return pos == other.pos; }
+        bool operator != (const entry_iterator &other) const
+        { return pos != other.pos; }
+
+    private:
+        Slots *slots;
+        vector<int>::const_iterator pos;
+    };
+
+    typedef entry_iterator<value_type, deque<value_type>> iterator;
+    typedef entry_iterator<const value_type, const deque<value_type>>
+        const_iterator;
 
 protected:
     // NOTE: Not using auto_ptr because making hash_map an auto_ptr
@@ -266,6 +361,14 @@ protected:
 
     void init_hash_map();
 
+    const CrawlStoreValue *find(int id) const;
+    CrawlStoreValue *find(int id);
+    vector<int>::const_iterator lower_bound(int id) const;
+    CrawlStoreValue &insert(vector<int>::const_iterator pos,
+                            const prop_key &key);
+    CrawlStoreValue &find_or_insert(const prop_key &key);
+    void erase_id(int id);
+
     friend class CrawlStoreValue;
 
 public:
@@ -275,15 +378,19 @@ public:
     void read(reader &);
 
     bool exists(const string &key) const;
+    bool exists(const prop_key &key) const;
     void assert_validity() const;
 
     // NOTE: If the const versions of get_value() or [] are given a
     // key which doesn't exist, they will assert.
     const CrawlStoreValue& get_value(const string &key) const;
+    const CrawlStoreValue& get_value(const prop_key &key) const;
     const CrawlStoreValue& get_value(const char *key) const
     { return get_value(string(key)); }
     const CrawlStoreValue& operator[] (const string &key) const
     { return get_value(key); }
+    const CrawlStoreValue& operator[] (const prop_key &key) const
+    { return get_value(key); }
     const CrawlStoreValue& operator[] (const char *key) const
     { return get_value(string(key)); }
 
@@ -295,10 +402,13 @@ public:
     // then trying to assign a different type to the CrawlStoreValue
     // will assert.
     CrawlStoreValue& get_value(const string &key);
+    CrawlStoreValue& get_value(const prop_key &key);
     CrawlStoreValue& get_value(const char *key)
     { return get_value(string(key)); }
     CrawlStoreValue& operator[] (const string &key)
     { return get_value(key); }
+    CrawlStoreValue& operator[] (const prop_key &key)
+    { return get_value(key); }
     CrawlStoreValue& operator[] (const char *key)
     { return get_value(string(key)); }
 
@@ -307,6 +417,7 @@ public:
     bool      empty() const;
 
     void      erase(const string& key);
+    void      erase(const prop_key &key);
     void      erase(const char *key) { erase(string(key)); }
     void      clear();
 
@@ -19,6 +19,7 @@
 # include <dirent.h>
 # include <unistd.h>
 # include <fcntl.h>
+# include <sys/mman.h>
 # include <sys/types.h>
 # include <sys/stat.h>
 #endif
@@ -532,3 +533,76 @@ int open_u(const char *pathname, int flags, mode_t mode)
     return open(OUTS(pathname), flags, mode);
 #endif
 }
+
+mapped_file::mapped_file(const char *path)
+    : _data(nullptr), _size(0)
+{
+#ifdef TARGET_OS_WINDOWS
+    FILE *fp = fopen_u(path, "rb");
+    if (!fp)
+        return;
+    const off_t size = file_size(fp);
+    if (size > 0)
+    {
+        unsigned char *buf = new unsigned char[size];
+        if (fread(buf, 1, size, fp) == (size_t)size)
+        {
+            _data = buf;
+            _size = size;
+        }
+        else
+            delete[] buf;
+    }
+    fclose(fp);
+#else
+    const int fd = open_u(path, O_RDONLY, 0);
+    if (fd == -1)
+        return;
+    map_fd(fd);
+    close(fd);
+#endif
+}
+
+mapped_file::mapped_file(int fd)
+    : _data(nullptr), _size(0)
+{
+    map_fd(fd);
+}
+
+void mapped_file::map_fd(int fd)
+{
+#ifdef TARGET_OS_WINDOWS
+    const off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= 0 || lseek(fd, 0, SEEK_SET))
+        return;
+    unsigned char *buf = new unsigned char[size];
+    if (::read(fd, buf, size) == size)
+    {
+        _data = buf;
+        _size = size;
+    }
+    else
+        delete[] buf;
+#else
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0)
+    {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            _data = static_cast<const unsigned char *>(map);
+            _size = st.st_size;
+        }
+    }
+#endif
+}
+
+mapped_file::~mapped_file()
+{
+#ifdef TARGET_OS_WINDOWS
+    delete[] _data;
+#else
+    if (_data)
+        munmap(const_cast<unsigned char *>(_data), _size);
+#endif
+}
@@ -38,4 +38,31 @@ FILE *fopen_u(const char *path, const char *mode);
 int mkdir_u(const char *pathname, mode_t mode);
 int open_u(const char *pathname, int flags, mode_t mode);
 
+/**
+ * A file mapped read-only into memory, shared with any other process
+ * mapping it. Where files can't be mapped, it's read into memory instead.
+ * Replacing the file (by renaming another over it) doesn't change what's
+ * mapped; writing to it in place does, so don't.
+ */
+class mapped_file
+{
+public:
+    mapped_file(const char *path);
+    // Map a file already open for reading; fd is left open.
+    explicit mapped_file(int fd);
+    ~mapped_file();
+
+    bool valid() const { return _data; }
+    const unsigned char *data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    void map_fd(int fd);
+
+    const unsigned char *_data;
+    size_t _size;
+};
+
 #endif
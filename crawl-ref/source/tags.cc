@@ -96,17 +96,44 @@ extern set<pair<string, level_id> > auto_unique_annotations;
 // defined in abyss.cc
 extern abyss_state abyssal_state;
 
+// How much is gathered to be compressed at a time when writing a chunk of
+// the save.
+static const size_t CHUNK_STAGE_SIZE = 65536;
+
+static NORETURN void _short_read(bool safe_read)
+{
+    if (!crawl_state.need_save || safe_read)
+        throw short_read_exception();
+    // Would be nice to name the save chunk here, but in interesting cases
+    // we're reading a copy from memory (why?).
+    die_noline("short read while reading save");
+}
+
 reader::reader(const string &_read_filename, int minorVersion)
-    : _filename(_read_filename), _chunk(0), _pbuf(nullptr), _read_offset(0),
-      _minorVersion(minorVersion), _safe_read(false)
+    : _filename(_read_filename), _file(0), _chunk(0), opened_file(false),
+      _mapping(nullptr), _data(nullptr), _size(0), _read_offset(0),
+      _minorVersion(minorVersion), _safe_read(false), _view(nullptr),
+      _view_start(0), _view_end(0)
 {
+    _mapping = new mapped_file(_filename.c_str());
+    if (_mapping->valid())
+    {
+        _data = _mapping->data();
+        _size = _mapping->size();
+        return;
+    }
+
+    // Empty or unmappable; the file will do, if there is one.
+    delete _mapping;
+    _mapping = nullptr;
     _file       = fopen_u(_filename.c_str(), "rb");
     opened_file = !!_file;
 }
 
 reader::reader(package *save, const string &chunkname, int minorVersion)
-    : _file(0), _chunk(0), opened_file(false), _pbuf(0), _read_offset(0),
-     _minorVersion(minorVersion), _safe_read(false)
+    : _file(0), _chunk(0), opened_file(false), _mapping(nullptr), _data(0),
+      _size(0), _read_offset(0), _minorVersion(minorVersion),
+      _safe_read(false), _view(nullptr), _view_start(0), _view_end(0)
 {
     ASSERT(save);
     _chunk = new chunk_reader(save, chunkname);
@@ -124,10 +151,25 @@ void reader::close()
     if (opened_file && _file)
         fclose(_file);
     _file = nullptr;
+    if (_mapping)
+    {
+        delete _mapping;
+        _mapping = nullptr;
+        _data = nullptr;
+        _size = _read_offset = 0;
+    }
 }
 
 void reader::advance(size_t offset)
 {
+    if (!_file && !_chunk)
+    {
+        if (_read_offset + offset > _size)
+            _short_read(_safe_read);
+        _read_offset += offset;
+        return;
+    }
+
     char junk[128];
 
     while (offset)
@@ -141,16 +183,7 @@ void reader::advance(size_t offset)
 bool reader::valid() const
 {
     return (_file && !feof(_file)) ||
-           (_pbuf && _read_offset < _pbuf->size());
-}
-
-static NORETURN void _short_read(bool safe_read)
-{
-    if (!crawl_state.need_save || safe_read)
-        throw short_read_exception();
-    // Would be nice to name the save chunk here, but in interesting cases
-    // we're reading a copy from memory (why?).
-    die_noline("short read while reading save");
+           (_data && _read_offset < _size);
 }
 
 // Reads input in network byte order, from a file or buffer.
@@ -165,16 +198,18 @@ unsigned char reader::readByte()
     }
     else if (_chunk)
     {
+        if (_view_start < _view_end)
+            return _view[_view_start++];
         unsigned char buf;
-        if (_chunk->read(&buf, 1) != 1)
+        if (read_chunk(&buf, 1) != 1)
             _short_read(_safe_read);
         return buf;
     }
     else
     {
-        if (_read_offset >= _pbuf->size())
+        if (_read_offset >= _size)
             _short_read(_safe_read);
-        return (*_pbuf)[_read_offset++];
+        return _data[_read_offset++];
     }
 }
 
@@ -192,20 +227,42 @@ void reader::read(void *data, size_t size)
     }
     else if (_chunk)
     {
-        if (_chunk->read(data, size) != size)
+        if (read_chunk(data, size) != size)
             _short_read(_safe_read);
     }
     else
     {
-        if (_read_offset+size > _pbuf->size())
+        if (_read_offset+size > _size)
             _short_read(_safe_read);
         if (data && size)
-            memcpy(data, &(*_pbuf)[_read_offset], size);
+            memcpy(data, _data + _read_offset, size);
 
         _read_offset += size;
     }
 }
 
+// Read from the chunk through its views, returning how much was read.
+size_t reader::read_chunk(void *data, size_t size)
+{
+    unsigned char *out = static_cast<unsigned char *>(data);
+    size_t got = 0;
+    while (got < size)
+    {
+        if (_view_start == _view_end)
+        {
+            _view_start = 0;
+            _view_end = _chunk->view(_view);
+            if (!_view_end)
+                break;
+        }
+        const size_t len = min(size - got, _view_end - _view_start);
+        memcpy(out + got, _view + _view_start, len);
+        _view_start += len;
+        got += len;
+    }
+    return got;
+}
+
 int reader::getMinorVersion() const
 {
     ASSERT(_minorVersion != TAG_MINOR_INVALID);
@@ -220,14 +277,41 @@ void reader::setMinorVersion(int minorVersion)
 void reader::fail_if_not_eof(const string &name)
 {
     char dummy;
-    if (_chunk ? _chunk->read(&dummy, 1) :
+    if (_chunk ? read_chunk(&dummy, 1) :
         _file ? (fgetc(_file) != EOF) :
-        _read_offset >= _pbuf->size())
+        _read_offset < _size)
     {
         fail("Incomplete read of \"%s\" - aborting.", name.c_str());
     }
 }
 
+writer::writer(package *save, const string &chunkname)
+    : _filename(), _file(0), _chunk(0), _ignore_errors(false), _pbuf(0),
+      failed(false)
+{
+    ASSERT(save);
+    _chunk = save->writer(chunkname);
+    _stage.reserve(CHUNK_STAGE_SIZE);
+}
+
+writer::~writer()
+{
+    if (_chunk)
+    {
+        flush();
+        delete _chunk;
+    }
+}
+
+void writer::flush()
+{
+    if (_chunk && !_stage.empty())
+    {
+        _chunk->write(&_stage[0], _stage.size());
+        _stage.clear();
+    }
+}
+
 void writer::check_ok(bool ok)
 {
     if (!ok && !failed)
@@ -244,7 +328,11 @@ void writer::writeByte(unsigned char ch)
         return;
 
     if (_chunk)
-        _chunk->write(&ch, 1);
+    {
+        _stage.push_back(ch);
+        if (_stage.size() >= CHUNK_STAGE_SIZE)
+            flush();
+    }
     else if (_file)
         check_ok(fputc(ch, _file) != EOF);
     else
@@ -257,7 +345,16 @@ void writer::write(const void *data, size_t size)
         return;
 
     if (_chunk)
-        _chunk->write(data, size);
+    {
+        const unsigned char* cdata = static_cast<const unsigned char*>(data);
+        if (_stage.size() + size > CHUNK_STAGE_SIZE)
+            flush();
+        // Writes as big as the stage needn't be copied through it.
+        if (size < CHUNK_STAGE_SIZE)
+            _stage.insert(_stage.end(), cdata, cdata + size);
+        else
+            _chunk->write(data, size);
+    }
     else if (_file)
         check_ok(fwrite(data, 1, size, _file) == size);
     else
@@ -363,51 +460,65 @@ uint8_t unmarshallUByte(reader &th)
     return th.readByte();
 }
 
+// Encode a 2 byte short into buf in network order.
+static inline void _put_short(unsigned char *buf, int16_t data)
+{
+    buf[0] = (data & 0xFF00) >> 8;
+    buf[1] = data & 0x00FF;
+}
+
+static inline int16_t _get_short(const unsigned char *buf)
+{
+    return (int16_t)((buf[0] << 8) | buf[1]);
+}
+
+// Encode a 4 byte int into buf in network order.
+static inline void _put_int(unsigned char *buf, int32_t data)
+{
+    buf[0] = (data & 0xFF000000) >> 24;
+    buf[1] = (data & 0x00FF0000) >> 16;
+    buf[2] = (data & 0x0000FF00) >> 8;
+    buf[3] = data & 0x000000FF;
+}
+
+static inline int32_t _get_int(const unsigned char *buf)
+{
+    return (int32_t)((uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16
+                     | (uint32_t)buf[2] << 8 | (uint32_t)buf[3]);
+}
+
 // Marshall 2 byte short in network order.
 void marshallShort(writer &th, short data)
 {
     CHECK_INITIALIZED(data);
-    const char b2 = (char)(data & 0x00FF);
-    const char b1 = (char)((data & 0xFF00) >> 8);
-    th.writeByte(b1);
-    th.writeByte(b2);
+    unsigned char buf[2];
+    _put_short(buf, data);
+    th.write(buf, sizeof(buf));
 }
 
 // Unmarshall 2 byte short in network order.
 int16_t unmarshallShort(reader &th)
 {
-    int16_t b1 = th.readByte();
-    int16_t b2 = th.readByte();
-    int16_t data = (b1 << 8) | (b2 & 0x00FF);
-    return data;
+    unsigned char buf[2];
+    th.read(buf, sizeof(buf));
+    return _get_short(buf);
 }
 
 // Marshall 4 byte int in network order.
 void marshallInt(writer &th, int32_t data)
 {
     CHECK_INITIALIZED(data);
-    char b4 = (char) (data & 0x000000FF);
-    char b3 = (char)((data & 0x0000FF00) >> 8);
-    char b2 = (char)((data & 0x00FF0000) >> 16);
-    char b1 = (char)((data & 0xFF000000) >> 24);
-
-    th.writeByte(b1);
-    th.writeByte(b2);
-    th.writeByte(b3);
-    th.writeByte(b4);
+    unsigned char buf[4];
+    _put_int(buf, data);
+    th.write(buf, sizeof(buf));
 }
 
 // Unmarshall 4 byte signed int in network order.
 int32_t unmarshallInt(reader &th)
 {
-    int32_t b1 = th.readByte();
-    int32_t b2 = th.readByte();
-    int32_t b3 = th.readByte();
-    int32_t b4 = th.readByte();
-
-    int32_t data = (b1 << 24) | ((b2 & 0x000000FF) << 16);
-    data |= ((b3 & 0x000000FF) << 8) | (b4 & 0x000000FF);
-    return data;
+    unsigned char buf[4];
+    th.read(buf, sizeof(buf));
+    return _get_int(buf);
 }
 
 void marshallUnsigned(writer& th, uint64_t v)
@@ -1185,6 +1296,7 @@ static void _shunt_monsters_out_of_walls()
                     env.mgrid(m.pos()) = NON_MONSTER;
                     m.position = *di;
                     env.mgrid(*di) = i;
+                    env.mon_index.update(i);
                     break;
                 }
         }
@@ -1848,21 +1960,32 @@ static i_transit_list unmarshall_item_list(reader &th)
     return ilist;
 }
 
+// The masks are two ints for every cell, so they go as one block.
+static const int MAP_MASK_CELL_BYTES = 2 * 4;
+
 static void marshall_level_map_masks(writer &th)
 {
+    vector<unsigned char> buf(GXM * GYM * MAP_MASK_CELL_BYTES);
+    unsigned char *at = &buf[0];
     for (rectangle_iterator ri(0); ri; ++ri)
     {
-        marshallInt(th, env.level_map_mask(*ri));
-        marshallInt(th, env.level_map_ids(*ri));
+        _put_int(at, env.level_map_mask(*ri));
+        _put_int(at + 4, env.level_map_ids(*ri));
+        at += MAP_MASK_CELL_BYTES;
     }
+    th.write(&buf[0], buf.size());
 }
 
 static void unmarshall_level_map_masks(reader &th)
 {
+    vector<unsigned char> buf(GXM * GYM * MAP_MASK_CELL_BYTES);
+    th.read(&buf[0], buf.size());
+    const unsigned char *at = &buf[0];
     for (rectangle_iterator ri(0); ri; ++ri)
     {
-        env.level_map_mask(*ri) = unmarshallInt(th);
-        env.level_map_ids(*ri)  = unmarshallInt(th);
+        env.level_map_mask(*ri) = _get_int(at);
+        env.level_map_ids(*ri)  = _get_int(at + 4);
+        at += MAP_MASK_CELL_BYTES;
     }
 }
 
@@ -3299,9 +3422,15 @@ static void tag_read_you(reader &th)
     if (th.getMinorVersion() < TAG_MINOR_STICKY_FLAME)
     {
         if (you.props.exists("napalmer"))
-            you.props["sticky_flame_source"] = you.props["napalmer"];
+        {
+            const CrawlStoreValue source = you.props["napalmer"];
+            you.props["sticky_flame_source"] = source;
+        }
         if (you.props.exists("napalm_aux"))
-            you.props["sticky_flame_aux"] = you.props["napalm_aux"];
+        {
+            const CrawlStoreValue aux = you.props["napalm_aux"];
+            you.props["sticky_flame_aux"] = aux;
+        }
     }
 
     if (you.duration[DUR_WEAPON_BRAND] && !you.props.exists(ORIGINAL_BRAND_KEY))
@@ -3812,9 +3941,10 @@ static void tag_construct_level(writer &th)
 
     // how many clouds?
     marshallShort(th, env.cloud.size());
-    for (const auto& entry : env.cloud)
+    // In coord_def order, as when env.cloud was a map.
+    for (const coord_def &pos : env.cloud.positions())
     {
-        const cloud_struct& cloud = entry.second;
+        const cloud_struct& cloud = *env.cloud.find(pos);
         marshallByte(th, cloud.type);
         ASSERT(cloud.type != CLOUD_NONE);
         ASSERT_IN_BOUNDS(cloud.pos);
@@ -5129,6 +5259,9 @@ static void tag_construct_level_monsters(writer &th)
     }
 }
 
+// The shorts saved for the flavour of each cell.
+static const int TILE_FLAVOUR_BYTES = 7 * 2;
+
 void tag_construct_level_tiles(writer &th)
 {
     // Map grids.
@@ -5154,18 +5287,24 @@ void tag_construct_level_tiles(writer &th)
     marshallShort(th, env.tile_default.floor);
     marshallShort(th, env.tile_default.special);
 
+    // Every cell's flavour is the same size, so the grid goes as one block.
+    vector<unsigned char> buf(GXM * GYM * TILE_FLAVOUR_BYTES);
+    unsigned char *at = &buf[0];
     for (int count_x = 0; count_x < GXM; count_x++)
         for (int count_y = 0; count_y < GYM; count_y++)
         {
-            marshallShort(th, env.tile_flv[count_x][count_y].wall_idx);
-            marshallShort(th, env.tile_flv[count_x][count_y].floor_idx);
-            marshallShort(th, env.tile_flv[count_x][count_y].feat_idx);
-
-            marshallShort(th, env.tile_flv[count_x][count_y].wall);
-            marshallShort(th, env.tile_flv[count_x][count_y].floor);
-            marshallShort(th, env.tile_flv[count_x][count_y].feat);
-            marshallShort(th, env.tile_flv[count_x][count_y].special);
+            const tile_flavour &flv = env.tile_flv[count_x][count_y];
+            _put_short(at,      flv.wall_idx);
+            _put_short(at + 2,  flv.floor_idx);
+            _put_short(at + 4,  flv.feat_idx);
+
+            _put_short(at + 6,  flv.wall);
+            _put_short(at + 8,  flv.floor);
+            _put_short(at + 10, flv.feat);
+            _put_short(at + 12, flv.special);
+            at += TILE_FLAVOUR_BYTES;
         }
+    th.write(&buf[0], buf.size());
 
     marshallInt(th, TILE_WALL_MAX);
 }
@@ -5220,15 +5359,16 @@ static void tag_read_level(reader &th)
             }
 #endif
 
-            unmarshallMapCell(th, env.map_knowledge[i][j]);
+            map_cell &cell = env.map_knowledge(coord_def(i, j));
+            unmarshallMapCell(th, cell);
             // Fixup positions
-            if (env.map_knowledge[i][j].monsterinfo())
-                env.map_knowledge[i][j].monsterinfo()->pos = coord_def(i, j);
-            if (env.map_knowledge[i][j].cloudinfo())
-                env.map_knowledge[i][j].cloudinfo()->pos = coord_def(i, j);
+            if (cell.monsterinfo())
+                cell.monsterinfo()->pos = coord_def(i, j);
+            if (cell.cloudinfo())
+                cell.cloudinfo()->pos = coord_def(i, j);
 
-            env.map_knowledge[i][j].flags &= ~MAP_VISIBLE_FLAG;
-            if (env.map_knowledge[i][j].seen())
+            cell.flags &= ~MAP_VISIBLE_FLAG;
+            if (cell.seen())
                 env.map_seen.set(i, j);
             env.pgrid[i][j] = unmarshallInt(th);
 
@@ -5245,7 +5385,7 @@ static void tag_read_level(reader &th)
         MapKnowledge *f = new MapKnowledge();
         for (int x = 0; x < GXM; x++)
             for (int y = 0; y < GYM; y++)
-                unmarshallMapCell(th, (*f)[x][y]);
+                unmarshallMapCell(th, (*f)(coord_def(x, y)));
         env.map_forgotten.reset(f);
     }
     else
@@ -5457,6 +5597,7 @@ static void tag_read_level_items(reader &th)
         if (item.pos.origin())
             item.clear();
 #endif
+    reset_mitm_slots();
 }
 
 void unmarshallMonster(reader &th, monster& m)
@@ -5837,7 +5978,8 @@ void unmarshallMonster(reader &th, monster& m)
 
     if (m.props.exists("siren_call"))
     {
-        m.props["merfolk_avatar_call"] = m.props["siren_call"].get_bool();
+        const bool call = m.props["siren_call"].get_bool();
+        m.props["merfolk_avatar_call"] = call;
         m.props.erase("siren_call");
     }
 
@@ -5940,6 +6082,7 @@ static void tag_read_level_monsters(reader &th)
 #endif
         mgrd(m.pos()) = i;
     }
+    env.mon_index.rebuild();
 #if TAG_MAJOR_VERSION == 34
     // This relies on TAG_YOU (including lost monsters) being unmarshalled
     // on game load before the initial level.
@@ -6027,18 +6170,24 @@ void tag_read_level_tiles(reader &th)
     env.tile_default.floor     = unmarshallShort(th);
     env.tile_default.special   = unmarshallShort(th);
 
+    vector<unsigned char> buf(gx * gy * TILE_FLAVOUR_BYTES);
+    if (!buf.empty())
+        th.read(&buf[0], buf.size());
+    const unsigned char *at = buf.data();
     for (int x = 0; x < gx; x++)
         for (int y = 0; y < gy; y++)
         {
-            env.tile_flv[x][y].wall_idx  = unmarshallShort(th);
-            env.tile_flv[x][y].floor_idx = unmarshallShort(th);
-            env.tile_flv[x][y].feat_idx  = unmarshallShort(th);
+            tile_flavour &flv = env.tile_flv[x][y];
+            flv.wall_idx  = _get_short(at);
+            flv.floor_idx = _get_short(at + 2);
+            flv.feat_idx  = _get_short(at + 4);
 
             // These get overwritten by _regenerate_tile_flavour
-            env.tile_flv[x][y].wall    = unmarshallShort(th);
-            env.tile_flv[x][y].floor   = unmarshallShort(th);
-            env.tile_flv[x][y].feat    = unmarshallShort(th);
-            env.tile_flv[x][y].special = unmarshallShort(th);
+            flv.wall    = _get_short(at + 6);
+            flv.floor   = _get_short(at + 8);
+            flv.feat    = _get_short(at + 10);
+            flv.special = _get_short(at + 12);
+            at += TILE_FLAVOUR_BYTES;
         }
 
     _debug_count_tiles();
@@ -44,19 +44,15 @@ public:
     writer(vector<unsigned char>* poutput)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
           _pbuf(poutput), failed(false) { ASSERT(poutput); }
-    writer(package *save, const string &chunkname)
-        : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          failed(false)
-    {
-        ASSERT(save);
-        _chunk = save->writer(chunkname);
-    }
+    writer(package *save, const string &chunkname);
 
-    ~writer() { if (_chunk) delete _chunk; }
+    ~writer();
 
     void writeByte(unsigned char byte);
     void write(const void *data, size_t size);
     long tell();
+    // Pass what's been staged on to the chunk.
+    void flush();
 
     bool succeeded() const { return !failed; }
 
@@ -70,6 +66,9 @@ private:
     bool _ignore_errors;
 
     vector<unsigned char>* _pbuf;
+    // What's written to a chunk is gathered here, so that it goes to the
+    // compressor in blocks rather than a byte at a time.
+    vector<unsigned char> _stage;
 
     bool failed;
 };
@@ -98,12 +97,22 @@ class reader
 public:
     reader(const string &filename, int minorVersion = TAG_MINOR_INVALID);
     reader(FILE* input, int minorVersion = TAG_MINOR_INVALID)
-        : _file(input), _chunk(0), opened_file(false), _pbuf(0),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+        : _file(input), _chunk(0), opened_file(false), _mapping(nullptr),
+          _data(0), _size(0), _read_offset(0), _minorVersion(minorVersion),
+          _safe_read(false), _view(nullptr), _view_start(0), _view_end(0) {}
     reader(const vector<unsigned char>& input,
            int minorVersion = TAG_MINOR_INVALID)
-        : _file(0), _chunk(0), opened_file(false), _pbuf(&input),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+        : _file(0), _chunk(0), opened_file(false), _mapping(nullptr),
+          _data(input.data()), _size(input.size()), _read_offset(0),
+          _minorVersion(minorVersion), _safe_read(false), _view(nullptr),
+          _view_start(0), _view_end(0) {}
+    // Reads from memory that must outlive the reader, such as a mapped file.
+    reader(const unsigned char *data, size_t size,
+           int minorVersion = TAG_MINOR_INVALID)
+        : _file(0), _chunk(0), opened_file(false), _mapping(nullptr),
+          _data(data), _size(size), _read_offset(0),
+          _minorVersion(minorVersion), _safe_read(false), _view(nullptr),
+          _view_start(0), _view_end(0) {}
     reader(package *save, const string &chunkname,
            int minorVersion = TAG_MINOR_INVALID);
     ~reader();
@@ -126,11 +135,21 @@ private:
     FILE* _file;
     chunk_reader *_chunk;
     bool  opened_file;
-    const vector<unsigned char>* _pbuf;
-    unsigned int _read_offset;
+    // Files are read in place from a mapping, where they can be.
+    mapped_file *_mapping;
+    const unsigned char *_data;
+    size_t _size;
+    size_t _read_offset;
     int _minorVersion;
     // always throw an exception rather than dying when reading past EOF
     bool _safe_read;
+    // Reads from a chunk go through what it hands out a block at a time:
+    // its own buffer, or the save's mapping if the block isn't compressed.
+    const unsigned char *_view;
+    size_t _view_start;
+    size_t _view_end;
+
+    size_t read_chunk(void *data, size_t size);
 };
 
 class short_read_exception : exception {};
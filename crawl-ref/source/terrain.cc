@@ -1237,13 +1237,13 @@ bool swap_features(const coord_def &pos1, const coord_def &pos2,
     const dungeon_feature_type feat2 = grd(pos2);
 
     if (is_notable_terrain(feat1) && !you.see_cell(pos1)
-        && env.map_knowledge(pos1).known())
+        && env.map_knowledge.get(pos1).known())
     {
         return false;
     }
 
     if (is_notable_terrain(feat2) && !you.see_cell(pos2)
-        && env.map_knowledge(pos2).known())
+        && env.map_knowledge.get(pos2).known())
     {
         return false;
     }
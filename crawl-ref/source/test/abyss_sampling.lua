@@ -0,0 +1,39 @@
+-- Check that Worley noise for a batch of points, as the Abyss samples it,
+-- comes out exactly as it does a point at a time, near the origin and far
+-- afield.
+
+crawl.message("Testing batched Worley noise.")
+
+local gxm, gym = dgn.max_bounds()
+local shifts = { { 0, 0 }, { gxm * 7 + 3, -gym * 5 - 1 },
+                 { -123457, 98765 }, { 2 ^ 20, 2 ^ 19 } }
+local fields = { "distance 1", "distance 2", "id 1", "id 2",
+                 "x 1", "y 1", "z 1", "x 2", "y 2", "z 2" }
+
+for _, shift in ipairs(shifts) do
+  -- Scaled as WorleyLayout scales the Abyss's coordinates.
+  local xs, ys = { }, { }
+  for y = 0, gym - 1 do
+    for x = 0, gxm - 1 do
+      table.insert(xs, (x + shift[1]) / 5.0)
+      table.insert(ys, (y + shift[2]) / 5.0)
+    end
+  end
+
+  for _, z in ipairs({ 0, 1 / 5000, 1000 / 5000, 23571113 }) do
+    local batched = crawl.worley(xs, ys, z)
+    assert(#batched == #xs, "Worley noise for " .. #xs .. " points gave "
+                            .. #batched)
+    for i = 1, #xs do
+      local alone = { crawl.worley(xs[i], ys[i], z) }
+      for f, name in ipairs(fields) do
+        assert(batched[i][f] == alone[f],
+               "Batched Worley noise at (" .. xs[i] .. ", " .. ys[i] .. ", "
+               .. z .. ") has " .. name .. " " .. batched[i][f]
+               .. ", not " .. alone[f])
+      end
+    end
+  end
+end
+
+assert(#crawl.worley({ }, { }, 0) == 0, "Worley noise for no points")
@@ -0,0 +1,193 @@
+-- Check that apply_noises() propagates noise exactly as it did before its
+-- cells were kept from one turn to the next: the same cells hear the same
+-- noises at the same intensity, in the same order (so any random numbers
+-- drawn for them come out the same), on the recorded layouts of
+-- suite-noise.des and on some generated levels.
+
+crawl.message("Testing noise propagation.")
+
+local niters = 30
+local total_heard = 0
+
+local AUDIBLE = 1000
+
+local function audible(intensity)
+  return intensity >= AUDIBLE
+end
+
+local function attenuation(x, y)
+  if feat.is_permarock(x, y) then
+    return 250000
+  end
+  return 850 * (feat.is_wall(x, y) and 12
+                or feat.is_closed_door(x, y) and 8
+                or feat.is_tree(x, y) and 3
+                or feat.is_statue_or_idol(x, y) and 2
+                or 1)
+end
+
+-- How sharply the noise turns going on from a cell: 0 straight on (or from
+-- the source), up to 4 doubling back.
+local function turn_angle(cell, dx, dy)
+  if cell.dx == 0 and cell.dy == 0 then
+    return 0
+  end
+  if dx == -cell.dx and dy == -cell.dy then
+    return 4
+  end
+  return math.abs(cell.dx - dx) + math.abs(cell.dy - dy)
+end
+
+-- noise_grid::register_noise() and propagate_noise() as they were before
+-- the cells were kept from one turn to the next, noting the cells that hear
+-- a noise as debug.propagate_noise() does. None of the test levels are
+-- silenced anywhere.
+local function old_propagate(args)
+  local gxm = dgn.max_bounds()
+  local cells = { }
+  local function cell(x, y)
+    local key = y * gxm + x
+    local c = cells[key]
+    if not c then
+      c = { intensity = 0, id = -1, distance = 0, dx = 0, dy = 0 }
+      cells[key] = c
+    end
+    return c
+  end
+
+  local perimeter = { }
+  local nnoises = 0
+  for i = 1, #args, 3 do
+    local x, y = args[i], args[i + 1]
+    local intensity = (args[i + 2] + 1) * 1000
+    local c = cell(x, y)
+    if c.intensity < intensity then
+      c.intensity, c.id = intensity, nnoises
+      nnoises = nnoises + 1
+      table.insert(perimeter, { x, y })
+    end
+  end
+
+  local heard = { }
+  local travel = 0
+  while #perimeter > 0 do
+    local next_perimeter = { }
+    travel = travel + 1
+    for _, p in ipairs(perimeter) do
+      local x, y = p[1], p[2]
+      local c = cell(x, y)
+      if audible(c.intensity) then
+        table.insert(heard, { x, y, c.intensity, c.id, travel - 1 })
+        local att = attenuation(x, y)
+        if audible(c.intensity - att) then
+          for dx = -1, 1 do
+            for dy = -1, 1 do
+              local nx, ny = x + dx, y + dy
+              if (dx ~= 0 or dy ~= 0) and dgn.in_bounds(nx, ny)
+                 and cell(nx, ny).intensity < c.intensity - att then
+                local n = cell(nx, ny)
+                local angle = turn_angle(c, dx, dy)
+                local intensity = c.intensity
+                  - (angle > 0 and math.floor(att * (100 + angle * 25) / 100)
+                     or att)
+                if audible(intensity) and n.intensity < intensity then
+                  local old_distance = n.distance
+                  n.intensity, n.id, n.distance = intensity, c.id, travel
+                  n.dx, n.dy = dx, dy
+                  if old_distance ~= travel then
+                    table.insert(next_perimeter, { nx, ny })
+                  end
+                end
+              end
+            end
+          end
+        end
+      end
+    end
+    perimeter = next_perimeter
+  end
+  return heard
+end
+
+local function describe(h)
+  return "(" .. h[1] .. "," .. h[2] .. ") at " .. h[3] .. " from noise "
+         .. h[4] .. " after " .. h[5]
+end
+
+local function compare(name, args)
+  local now = debug.propagate_noise(unpack(args))
+  local was = old_propagate(args)
+  for i = 1, math.max(#was, #now) do
+    local a, b = was[i], now[i]
+    assert(a and b and a[1] == b[1] and a[2] == b[2] and a[3] == b[3]
+           and a[4] == b[4] and a[5] == b[5],
+           name .. ": cell " .. i .. " to hear a noise was "
+           .. (b and describe(b) or "none") .. ", not "
+           .. (a and describe(a) or "none"))
+  end
+  return #now
+end
+
+local function open_cells(x1, y1, x2, y2)
+  local cells = { }
+  for x = x1, x2 do
+    for y = y1, y2 do
+      if not feat.is_solid(x, y) then
+        table.insert(cells, dgn.point(x, y))
+      end
+    end
+  end
+  return cells
+end
+
+local function add_noise(args, p, loudness)
+  table.insert(args, p.x)
+  table.insert(args, p.y)
+  table.insert(args, loudness)
+end
+
+local function check(name, cells, loud)
+  for i = 1, niters do
+    local args = { }
+    for _, p in ipairs(loud) do
+      add_noise(args, p, 10 + crawl.random2(30))
+    end
+    for n = 1, 1 + crawl.random2(4) do
+      local p = cells[crawl.random2(#cells) + 1]
+      add_noise(args, p, 1 + crawl.random2(25))
+      -- Sometimes make another noise in the same place, which is only heard
+      -- if it's louder.
+      if crawl.one_chance_in(3) then
+        add_noise(args, p, 1 + crawl.random2(25))
+      end
+    end
+
+    total_heard = total_heard + compare(name, args)
+  end
+end
+
+local function test_recorded_map(map)
+  dgn.reset_level()
+  dgn.tags(map, "no_rotate no_vmirror no_hmirror no_pool_fixup")
+  dgn.with_map_anchors(20, 20,
+                       function () return dgn.place_map(map, true, true) end)
+  local cells = open_cells(20, 20, 60, 45)
+  local loud = dgn.find_marker_positions_by_prop("noise_source")
+  check(dgn.name(map), cells, loud)
+end
+
+local map = dgn.map_by_tag("debug_noise")
+assert(map, "Could not find noise test maps (tag 'debug_noise')")
+while map do
+  test_recorded_map(map)
+  map = dgn.map_by_tag("debug_noise")
+end
+
+for _, place in ipairs({ "D:3", "Lair:2", "Orc:1", "Elf:2", "Crypt:1" }) do
+  debug.goto_place(place)
+  test.regenerate_level()
+  local gxm, gym = dgn.max_bounds()
+  check(place, open_cells(1, 1, gxm - 2, gym - 2), { })
+end
+
+assert(total_heard > 0, "No noise was ever heard")
@@ -0,0 +1,57 @@
+-- Place and remove clouds all over a level, checking that every cell still
+-- knows its own cloud afterwards.
+
+crawl.message("Testing cloud placement and removal.")
+
+debug.goto_place("D:3")
+test.regenerate_level()
+
+local gxm, gym = dgn.max_bounds()
+local cells = { }
+for x = 1, gxm - 2 do
+  for y = 1, gym - 2 do
+    if not feat.is_solid(x, y) then
+      table.insert(cells, dgn.point(x, y))
+    end
+  end
+end
+
+local kinds = { "flame", "freezing vapour", "black smoke", "steam" }
+local expected = { }
+
+local function check_all()
+  for _, c in ipairs(cells) do
+    local want = expected[c.x .. "," .. c.y] or "none"
+    local got = dgn.cloud_at(c.x, c.y)
+    assert(got == want,
+           "Expected " .. want .. " at " .. c .. ", but found " .. got)
+  end
+end
+
+for _, c in ipairs(cells) do
+  dgn.delete_cloud(c.x, c.y)
+end
+
+for round = 1, 20 do
+  for i = 1, #cells do
+    local c = cells[crawl.random2(#cells) + 1]
+    local key = c.x .. "," .. c.y
+    if crawl.coinflip() then
+      local kind = kinds[crawl.random2(#kinds) + 1]
+      dgn.delete_cloud(c.x, c.y)
+      dgn.place_cloud(c.x, c.y, kind, 10)
+      expected[key] = dgn.cloud_at(c.x, c.y)
+      assert(expected[key] ~= "none", "Couldn't place " .. kind .. " at " .. c)
+    else
+      dgn.delete_cloud(c.x, c.y)
+      expected[key] = nil
+    end
+  end
+  check_all()
+end
+
+for _, c in ipairs(cells) do
+  dgn.delete_cloud(c.x, c.y)
+end
+expected = { }
+check_all()
@@ -0,0 +1,99 @@
+-- Check that dgn.fill_small_zones fills just what zonify's walk over the
+-- cells in Lua does, including which of several zones the same size it
+-- keeps.
+
+require("dlua/layout/zonify.lua")
+
+crawl.message("Testing dgn.fill_small_zones.")
+
+local map = dgn.map_by_tag("map_lines_test")
+local W, H
+local grd
+
+-- Rock, with floor on about chance percent of the cells inside the edge,
+-- and lava on some of the rest.
+local function random_map(width, height, chance)
+  W, H = width, height
+  dgn.extend_map(map, { width = W, height = H, fill = 'x' })
+  dgn.fill_area(map, { fill = 'x' })
+  grd = dgn.mapgrd_table(map)
+  for x = 1, W - 2 do
+    for y = 1, H - 2 do
+      if crawl.random2(100) < chance then
+        grd[x][y] = '.'
+      elseif crawl.one_chance_in(4) then
+        grd[x][y] = 'l'
+      end
+    end
+  end
+end
+
+local function snapshot()
+  local copy = { }
+  for x = 0, W - 1 do
+    copy[x] = { }
+    for y = 0, H - 1 do
+      copy[x][y] = grd[x][y]
+    end
+  end
+  return copy
+end
+
+local function restore(copy)
+  for x = 0, W - 1 do
+    for y = 0, H - 1 do
+      grd[x][y] = copy[x][y]
+    end
+  end
+end
+
+-- What zonify.map_fill_zones did before it called dgn.fill_small_zones.
+local function lua_fill(wall, keep, min_size)
+  local zonemap = zonify.map(
+    { x1 = 1, y1 = 1, x2 = W - 2, y2 = H - 2 },
+    function (x, y)
+      return x >= 1 and y >= 1 and x <= W - 2 and y <= H - 2
+             and { glyph = grd[x][y] } or nil
+    end,
+    function (val)
+      return string.find(wall, val.glyph, 1, true) and "wall" or "floor"
+    end)
+  zonify.fill_smallest_zones(zonemap, keep, "floor",
+                             function (x, y) grd[x][y] = '%' end, min_size)
+end
+
+local function native_fill(wall, keep, min_size)
+  dgn.fill_small_zones(map, { x1 = 1, y1 = 1, x2 = W - 2, y2 = H - 2,
+                              wall = wall, keep = keep, fill = '%',
+                              min_size = min_size })
+end
+
+local function check(what, wall, keep, min_size)
+  local before = snapshot()
+  lua_fill(wall, keep, min_size)
+  local want = snapshot()
+  restore(before)
+  native_fill(wall, keep, min_size)
+  for x = 0, W - 1 do
+    for y = 0, H - 1 do
+      assert(grd[x][y] == want[x][y],
+             what .. ", keeping " .. keep .. " over " .. min_size
+             .. " with walls '" .. wall .. "': expected '" .. want[x][y]
+             .. "' at " .. x .. "," .. y .. " but found '" .. grd[x][y]
+             .. "'")
+    end
+  end
+end
+
+for round = 1, 20 do
+  -- Sparse floor makes lots of zones of one or two cells, so which of
+  -- those is kept comes down to the order they're found in.
+  for _, chance in ipairs({ 15, 30, 45, 60 }) do
+    random_map(40, 30, chance)
+    local what = "round " .. round .. " at " .. chance .. "%"
+    check(what, "wlxcvbtg", 1, 1)
+    check(what, "wxcvbtg", 1, 1)
+    check(what, "wlxcvbtg", 1 + crawl.random2(4), 0)
+    check(what, "wxcvbtg", 3, crawl.random2(3))
+  end
+end
@@ -0,0 +1,52 @@
+-- Check that picking maps through the map index considers the same maps,
+-- in the same order, as looking at every map does.
+
+crawl.message("Testing the map index.")
+
+local places = { "D:1", "D:8", "D:15", "Lair:3", "Orc:1", "Elf:3", "Snake:4",
+                 "Vaults:2", "Crypt:3", "Depths:1", "Zot:5", "Temple",
+                 "Abyss", "Pan", "Sewer", "Zig:1", "Tomb:1" }
+
+local function check(place, pick, what)
+  local indexed = debug.eligible_maps(place, pick, false)
+  local scanned = debug.eligible_maps(place, pick, true)
+  for i = 1, math.max(#indexed, #scanned) do
+    assert(indexed[i] == scanned[i],
+           "Picking maps for " .. place .. " " .. what .. ": map " .. i
+           .. " is " .. tostring(indexed[i]) .. " through the index, but "
+           .. tostring(scanned[i]) .. " looking at every map")
+  end
+  return #indexed
+end
+
+local tags = debug.map_tags()
+assert(#tags > 0, "The map index has no tags")
+
+for _, place in ipairs(places) do
+  local picked = 0
+  -- Extra maps or not, or either (nil, which can't be a table key).
+  for _, extra in ipairs({ "either", true, false }) do
+    if extra == "either" then
+      extra = nil
+    end
+    local how = " (" .. tostring(extra) .. " extra)"
+    for _, mini in ipairs({ false, true }) do
+      local kind = (mini and "minivaults" or "maps") .. how
+      picked = picked
+        + check(place, { by = "place", mini = mini, extra = extra },
+                "by place, " .. kind)
+        + check(place, { by = "depth", mini = mini, extra = extra },
+                "by depth, " .. kind)
+    end
+    picked = picked + check(place, { by = "chance", extra = extra },
+                            "by chance" .. how)
+  end
+  for _, tag in ipairs(tags) do
+    for _, check_depth in ipairs({ false, true }) do
+      picked = picked
+        + check(place, { by = "tag", tag = tag, check_depth = check_depth },
+                "tagged " .. tag .. (check_depth and " at depth" or ""))
+    end
+  end
+  assert(picked > 0, "No maps were picked for " .. place)
+end
@@ -0,0 +1,143 @@
+-- Check the native map_lines operations in dgn against the same operations
+-- done a cell at a time in Lua. test/fill_small_zones.lua covers
+-- dgn.fill_small_zones.
+
+crawl.message("Testing map_lines operations.")
+
+local map = dgn.map_by_tag("map_lines_test")
+local W, H = 40, 30
+local grd
+
+local function in_map(x, y)
+  return x >= 0 and y >= 0 and x < W and y < H
+end
+
+-- Rock, with floor on about chance percent of the cells inside the edge.
+local function random_map(chance)
+  dgn.extend_map(map, { width = W, height = H, fill = 'x' })
+  dgn.fill_area(map, { fill = 'x' })
+  grd = dgn.mapgrd_table(map)
+  for x = 1, W - 2 do
+    for y = 1, H - 2 do
+      if crawl.random2(100) < chance then
+        grd[x][y] = '.'
+      end
+    end
+  end
+end
+
+local function snapshot()
+  local copy = { }
+  for x = 0, W - 1 do
+    copy[x] = { }
+    for y = 0, H - 1 do
+      copy[x][y] = grd[x][y]
+    end
+  end
+  return copy
+end
+
+local function check_same(want, what)
+  for x = 0, W - 1 do
+    for y = 0, H - 1 do
+      assert(grd[x][y] == want[x][y],
+             what .. ": expected '" .. want[x][y] .. "' at " .. x .. ","
+             .. y .. " but found '" .. grd[x][y] .. "'")
+    end
+  end
+end
+
+for round = 1, 10 do
+  -- fill_masked
+  random_map(50)
+  local want, count = snapshot(), 0
+  for x = 0, W - 1 do
+    for y = 0, H - 1 do
+      if want[x][y] ~= '.' then
+        want[x][y] = 'c'
+        count = count + 1
+      end
+    end
+  end
+  local filled = dgn.fill_masked(map, { mask = ".", fill = 'c',
+                                        invert = true })
+  assert(filled == count, "fill_masked filled " .. filled .. ", not "
+                          .. count)
+  check_same(want, "fill_masked")
+
+  -- cellular_step
+  random_map(55)
+  want = snapshot()
+  for step = 1, 3 do
+    local old = want
+    want = { }
+    for x = 0, W - 1 do
+      want[x] = { }
+      for y = 0, H - 1 do
+        local walls = 0
+        for dx = -1, 1 do
+          for dy = -1, 1 do
+            local nx, ny = x + dx, y + dy
+            if (dx ~= 0 or dy ~= 0)
+               and (not in_map(nx, ny) or old[nx][ny] == 'x') then
+              walls = walls + 1
+            end
+          end
+        end
+        want[x][y] = old[x][y]
+        if old[x][y] == '.' and walls >= 5 then
+          want[x][y] = 'x'
+        elseif old[x][y] == 'x' and walls < 4 then
+          want[x][y] = '.'
+        end
+      end
+    end
+  end
+  dgn.cellular_step(map, { iterations = 3 })
+  check_same(want, "cellular_step")
+
+  -- distance_map
+  random_map(60)
+  grd[W / 2][H / 2] = '@'
+  local dist, farthest = dgn.distance_map(map, { from = "@",
+                                                 passable = ".@" })
+  local queue, want_dist, most = { { x = W / 2, y = H / 2 } }, { }, 0
+  for x = 0, W - 1 do
+    want_dist[x] = { }
+  end
+  want_dist[W / 2][H / 2] = 0
+  local i = 1
+  while i <= #queue do
+    local c = queue[i]
+    for dx = -1, 1 do
+      for dy = -1, 1 do
+        local nx, ny = c.x + dx, c.y + dy
+        if in_map(nx, ny) and want_dist[nx][ny] == nil
+           and grd[nx][ny] == '.' then
+          want_dist[nx][ny] = want_dist[c.x][c.y] + 1
+          most = want_dist[nx][ny]
+          table.insert(queue, { x = nx, y = ny })
+        end
+      end
+    end
+    i = i + 1
+  end
+  assert(farthest == most, "distance_map: farthest " .. farthest
+                           .. ", not " .. most)
+  for x = 0, W - 1 do
+    for y = 0, H - 1 do
+      assert(dist[x][y] == want_dist[x][y],
+             "distance_map: wrong distance at " .. x .. "," .. y)
+    end
+  end
+
+  -- random_point
+  random_map(30)
+  local x, y = dgn.random_point(map, { glyphs = "." })
+  assert(x and grd[x][y] == '.', "random_point picked a cell not in mask")
+  grd[3][4] = '@'
+  x, y = dgn.random_point(map, { weights = { ["."] = 0, ["@"] = 5 } })
+  assert(x == 3 and y == 4, "random_point picked a cell of no weight")
+  x, y = dgn.random_point(map, { glyphs = "%" })
+  assert(x == nil, "random_point picked from an empty mask")
+end
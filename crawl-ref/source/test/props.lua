@@ -0,0 +1,67 @@
+-- Set and erase monster properties in random orders, checking that the
+-- monster's property table always holds just what was last put in it.
+
+crawl.message("Testing monster properties.")
+
+debug.goto_place("D:1")
+test.regenerate_level()
+debug.dismiss_monsters()
+
+local mons
+local gxm, gym = dgn.max_bounds()
+for x = 1, gxm - 2 do
+  for y = 1, gym - 2 do
+    if not mons and not feat.is_solid(x, y) and not dgn.mons_at(x, y) then
+      mons = dgn.create_monster(x, y, "rat")
+    end
+  end
+end
+assert(mons, "Couldn't make a rat")
+
+local names = { }
+for i = 1, 40 do
+  table.insert(names, "test_prop_" .. string.char(96 + (i * 7) % 26 + 1)
+                      .. i)
+end
+
+local expected = { }
+
+local function check_all()
+  for _, name in ipairs(names) do
+    local want = expected[name]
+    assert(mons.has_prop(name) == (want ~= nil),
+           "has_prop(" .. name .. ") disagrees")
+    if want ~= nil then
+      local got = mons.get_prop(name)
+      assert(got == want, "Expected " .. tostring(want) .. " for " .. name
+                          .. ", but found " .. tostring(got))
+    end
+  end
+end
+
+for round = 1, 30 do
+  for i = 1, #names do
+    local name = names[crawl.random2(#names) + 1]
+    local roll = crawl.random2(3)
+    -- Replacing a value with one of another type would assert.
+    mons.set_prop(name, nil)
+    if roll == 0 then
+      expected[name] = nil
+    elseif roll == 1 then
+      local n = crawl.random2(1000)
+      mons.set_prop(name, n)
+      expected[name] = n
+    else
+      local s = "value " .. crawl.random2(1000)
+      mons.set_prop(name, s)
+      expected[name] = s
+    end
+  end
+  check_all()
+end
+
+for _, name in ipairs(names) do
+  mons.set_prop(name, nil)
+end
+expected = { }
+check_all()
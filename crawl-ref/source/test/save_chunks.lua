@@ -0,0 +1,29 @@
+-- Check that the chunks a save leaves alone, because nothing in them changed,
+-- still read back just as they'd be written afresh.
+
+crawl.message("Testing saves leaving unchanged chunks alone.")
+
+local times = 40
+
+local function check(rewrite)
+  local left_alone, saved, fresh = debug.save_chunks(times, rewrite)
+  local desc = rewrite and "Rewriting every chunk" or "Leaving chunks alone"
+  local total, chunks = 0, 0
+  for name, n in pairs(left_alone) do
+    assert(saved[name], desc .. ", the " .. name .. " chunk is missing")
+    assert(saved[name] == fresh[name], desc .. ", the " .. name
+           .. " chunk isn't as it would be written now")
+    total = total + n
+    chunks = chunks + 1
+  end
+  assert(chunks > 0, desc .. ", no chunks could be left alone")
+  return total
+end
+
+-- Every chunk but messages is left alone after the first save, and messages
+-- half the time.
+local left_alone = check(false)
+assert(left_alone >= (times - 1) * 4,
+       "Only left chunks alone " .. left_alone .. " times")
+
+assert(check(true) == 0, "Chunks were left alone when rewriting them all")
@@ -0,0 +1,44 @@
+-- Check that save chunks, whole levels and data that runs up against the
+-- edges of the codecs' blocks among them, come back unchanged through every
+-- compression codec.
+
+crawl.message("Testing save codecs.")
+
+local codecs = { "zlib", "lz4" }
+local places = { "D:1", "D:10", "Lair:3", "Vaults:4", "Depths:2", "Zot:5",
+                 "Abyss", "Pan" }
+-- The largest LZ4 block a chunk is written in.
+local block = 65536
+
+-- Bytes that won't compress.
+local function noise(len)
+  local bytes = { }
+  for i = 1, len do
+    bytes[i] = string.char(crawl.random2(256))
+  end
+  return table.concat(bytes)
+end
+
+local function check(what, data)
+  for _, codec in ipairs(codecs) do
+    local saved, copied, viewed, err = debug.codec_round_trip(codec, data)
+    local desc = what .. " (" .. #data .. " bytes) through " .. codec
+    assert(saved == codec, desc .. " was saved with " .. saved)
+    assert(copied == data, desc .. " read back as " .. #copied
+                           .. " different bytes")
+    assert(viewed, desc .. " failed to read in place: " .. tostring(err))
+    assert(viewed == data, desc .. " read back different in place")
+  end
+end
+
+check("nothing", "")
+check("one byte", "x")
+check("a block of zeros", string.rep("\0", block))
+check("three blocks and more of one letter", string.rep("a", block * 3 + 7))
+check("noise", noise(block + 1))
+
+for _, place in ipairs(places) do
+  debug.goto_place(place)
+  test.regenerate_level()
+  check("the level on " .. place, debug.level_data())
+end
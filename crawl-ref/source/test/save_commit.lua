@@ -0,0 +1,82 @@
+-- Check that a save survives crashes at every stage of a commit, including
+-- commits finished in the background while more is written.
+
+crawl.message("Testing save commit crash safety.")
+
+-- The largest LZ4 block a chunk is written in.
+local block = 65536
+
+-- Noise, so that the chunks take up space and reuse what earlier commits
+-- freed.
+local function noise(len)
+  local bytes = { }
+  for i = 1, len do
+    bytes[i] = string.char(crawl.random2(256))
+  end
+  return table.concat(bytes)
+end
+
+-- The chunks of the save as of each of three commits: every commit rewrites
+-- some chunks, and deletes or adds others.
+local names = { "a", "b", "c", "d" }
+local present = { "abc", "ab", "abcd" }
+local written = { "abc", "ab", "acd" }
+local generations = { [0] = { } }
+for gen = 1, 3 do
+  local chunks = { }
+  for _, name in ipairs(names) do
+    if present[gen]:find(name) then
+      if written[gen]:find(name) then
+        chunks[name] = noise(3 * block / 2 + gen)
+      else
+        chunks[name] = generations[gen - 1][name]
+      end
+    end
+  end
+  generations[gen] = chunks
+end
+
+-- What to write to go from one commit's chunks to the next's.
+local function changes(gen)
+  local before, after = generations[gen - 1], generations[gen]
+  local chunks = { }
+  for name, _ in pairs(before) do
+    if not after[name] then
+      chunks[name] = false
+    end
+  end
+  for name, data in pairs(after) do
+    if before[name] ~= data then
+      chunks[name] = data
+    end
+  end
+  return chunks
+end
+
+for _, async in ipairs({ false, true }) do
+  for _, fault in ipairs({ "none", "before sync", "before header",
+                           "after header" }) do
+    local chunks, err = debug.crash_commit(fault ~= "none" and fault or nil,
+                                           async, changes(1), changes(2),
+                                           changes(3))
+    local desc = "Committing "
+                 .. (async and "in the background " or "synchronously ")
+                 .. (fault == "none" and "without a crash"
+                                      or "crashing " .. fault)
+    assert(chunks, desc .. ", the save won't open: " .. tostring(err))
+
+    -- As of the commit crashed in if it got as far as the header, else as
+    -- of the one before.
+    local expected = fault == "none" and generations[3]
+                     or fault == "after header" and generations[2]
+                     or generations[1]
+    for name, _ in pairs(chunks) do
+      assert(expected[name], desc .. ", chunk " .. name .. " is left over")
+    end
+    for name, data in pairs(expected) do
+      assert(chunks[name], desc .. ", chunk " .. name .. " is missing")
+      assert(chunks[name] == data, desc .. ", chunk " .. name
+                                   .. " is different")
+    end
+  end
+end
@@ -0,0 +1,97 @@
+-- Check that a seeded game makes the same levels, and ends with the same RNG
+-- state, whether or not levels are built ahead of time.
+
+crawl.message("Testing speculative level generation.")
+
+local depth = 5
+
+if debug.forked(function () return "" end) == nil then
+  -- Games can't be forked in this build.
+  return
+end
+
+local function stairs_down()
+  local gxm, gym = dgn.max_bounds()
+  for y = 1, gym - 2 do
+    for x = 1, gxm - 2 do
+      if dgn.feature_name(dgn.grid(x, y)) == "stone_stairs_down_i" then
+        return x, y
+      end
+    end
+  end
+  error("No stairs down on " .. you.where())
+end
+
+-- Strings, each after its length and a colon, so that they can be sent back
+-- from a forked game as one.
+local function pack(strings)
+  local packed = { }
+  for _, s in ipairs(strings) do
+    table.insert(packed, #s .. ":" .. s)
+  end
+  return table.concat(packed)
+end
+
+local function unpack_strings(packed)
+  local strings, at = { }, 1
+  while at <= #packed do
+    local colon = packed:find(":", at, true)
+    local len = tonumber(packed:sub(at, colon - 1))
+    table.insert(strings, packed:sub(colon + 1, colon + len))
+    at = colon + len + 1
+  end
+  return strings
+end
+
+-- Play a new game from seed down the Dungeon, in a forked copy of this one
+-- so as to leave it as it was. Returns each level made, as saved, the RNG
+-- state at the bottom, and how many levels built ahead of time were taken.
+local function descend(seed, speculate)
+  local packed = debug.forked(function ()
+    debug.seeded_game(seed)
+    local made = { }
+    for i = 1, depth do
+      you.moveto(stairs_down())
+      if speculate then
+        debug.speculate()
+      end
+      debug.down_stairs()
+      table.insert(made, debug.level_data())
+    end
+    table.insert(made, debug.rng_state())
+    table.insert(made, tostring(debug.levels_adopted()))
+    return pack(made)
+  end)
+  assert(packed, "Seed " .. seed .. " didn't make it down"
+                 .. (speculate and " building levels ahead of time" or ""))
+
+  local made = unpack_strings(packed)
+  local adopted = tonumber(table.remove(made))
+  local rng = table.remove(made)
+  return made, rng, adopted
+end
+
+local adopted = 0
+
+for _, seed in ipairs({ 1, 27, 4096 }) do
+  local levels, rng = descend(seed, false)
+  assert(#levels == depth,
+         "Seed " .. seed .. " only went down " .. #levels .. " levels")
+
+  local ahead_levels, ahead_rng, ahead_adopted = descend(seed, true)
+  assert(#ahead_levels == depth,
+         "Seed " .. seed .. " only went down " .. #ahead_levels
+         .. " levels when building them ahead of time")
+
+  for i = 1, depth do
+    assert(levels[i] == ahead_levels[i],
+           "Seed " .. seed .. " made a different level " .. i
+           .. " down when building it ahead of time")
+  end
+  assert(rng == ahead_rng,
+         "Seed " .. seed .. " left the RNG in a different state when"
+         .. " building levels ahead of time")
+  adopted = adopted + ahead_adopted
+end
+
+assert(adopted > 0, "No level built ahead of time was ever used")
@@ -0,0 +1,73 @@
+-- Check that the dungeon builder's connectivity checks find the same zones
+-- as flood filling the level cell by cell.
+
+crawl.message("Testing level zones.")
+
+local places = { "D:1", "D:5", "D:12", "Lair:2", "Swamp:3", "Shoals:2",
+                 "Orc:2", "Elf:2", "Snake:3", "Spider:2", "Vaults:3",
+                 "Crypt:2", "Depths:3", "Zot:4", "Abyss", "Pan", "Geh:3",
+                 "Coc:2", "Tar:5", "Dis:3" }
+
+-- Number the zones as the builder's flood fill used to: in the order their
+-- first cells come row by row, through passable cells and their eight
+-- neighbours.
+local function flood_fill(passable)
+  local gxm, gym = dgn.max_bounds()
+  local zones = { }
+  for x = 0, gxm - 1 do
+    zones[x] = { }
+  end
+
+  local nzones = 0
+  for y = 0, gym - 1 do
+    for x = 0, gxm - 1 do
+      if passable[x][y] and not zones[x][y] then
+        nzones = nzones + 1
+        zones[x][y] = nzones
+        local stack = { { x, y } }
+        while #stack > 0 do
+          local p = table.remove(stack)
+          for dx = -1, 1 do
+            for dy = -1, 1 do
+              local nx, ny = p[1] + dx, p[2] + dy
+              if nx >= 0 and nx < gxm and ny >= 0 and ny < gym
+                 and passable[nx][ny] and not zones[nx][ny] then
+                zones[nx][ny] = nzones
+                table.insert(stack, { nx, ny })
+              end
+            end
+          end
+        end
+      end
+    end
+  end
+  return nzones, zones
+end
+
+local function check(what, travel)
+  local nzones, zones, passable = debug.find_zones(travel)
+  local filled, fills = flood_fill(passable)
+  local gxm, gym = dgn.max_bounds()
+  for y = 0, gym - 1 do
+    for x = 0, gxm - 1 do
+      local fill = fills[x][y] or 0
+      assert(zones[x][y] == fill,
+             what .. ": (" .. x .. "," .. y .. ") is in zone " .. zones[x][y]
+             .. ", but flood filling puts it in zone " .. fill)
+    end
+  end
+  assert(nzones == filled, what .. ": " .. nzones .. " zones, but flood "
+                           .. "filling finds " .. filled)
+  return nzones
+end
+
+for _, place in ipairs(places) do
+  debug.goto_place(place)
+  for i = 1, 3 do
+    test.regenerate_level()
+    local where = place .. " (level " .. i .. ")"
+    local zones = check("Passable zones on " .. where, false)
+                  + check("Travel zones on " .. where, true)
+    assert(zones > 0, "No zones found on " .. where)
+  end
+end
@@ -139,7 +139,7 @@ static void _add_directional_overlays(const coord_def& gc, packed_cell* cell,
 static void _pack_shoal_waves(const coord_def &gc, packed_cell *cell)
 {
     // Add wave tiles on floor adjacent to shallow water.
-    const dungeon_feature_type feat = env.map_knowledge(gc).feat();
+    const dungeon_feature_type feat = env.map_knowledge.get(gc).feat();
     const bool feat_has_ink = (cloud_type_at(coord_def(gc)) == CLOUD_INK);
 
     if (feat == DNGN_DEEP_WATER && feat_has_ink)
@@ -163,13 +163,16 @@ static void _pack_shoal_waves(const coord_def &gc, packed_cell *cell)
 
     for (adjacent_iterator ri(gc, true); ri; ++ri)
     {
-        if (!env.map_knowledge(*ri).seen() && !env.map_knowledge(*ri).mapped())
+        if (!env.map_knowledge.get(*ri).seen()
+            && !env.map_knowledge.get(*ri).mapped())
+        {
             continue;
+        }
 
         const bool ink = (cloud_type_at(coord_def(*ri)) == CLOUD_INK);
 
         wave_type wt = WV_NONE;
-        if (env.map_knowledge(*ri).feat() == DNGN_SHALLOW_WATER)
+        if (env.map_knowledge.get(*ri).feat() == DNGN_SHALLOW_WATER)
         {
             // Adjacent shallow water is only interesting for
             // floor cells.
@@ -179,7 +182,7 @@ static void _pack_shoal_waves(const coord_def &gc, packed_cell *cell)
             if (feat != DNGN_SHALLOW_WATER)
                 wt = WV_SHALLOW;
         }
-        else if (env.map_knowledge(*ri).feat() == DNGN_DEEP_WATER)
+        else if (env.map_knowledge.get(*ri).feat() == DNGN_DEEP_WATER)
             wt = WV_DEEP;
         else
             continue;
@@ -329,7 +332,7 @@ static dungeon_feature_type _safe_feat(coord_def gc)
     if (!map_bounds(gc))
         return DNGN_UNSEEN;
 
-    return env.map_knowledge(gc).feat();
+    return env.map_knowledge.get(gc).feat();
 }
 
 static bool _feat_is_mangrove(dungeon_feature_type feat)
@@ -356,7 +359,7 @@ static void _pack_default_waves(const coord_def &gc, packed_cell *cell)
 {
     // Any tile on water with an adjacent solid tile will get an extra
     // bit of shoreline.
-    dungeon_feature_type feat = env.map_knowledge(gc).feat();
+    dungeon_feature_type feat = env.map_knowledge.get(gc).feat();
 
     // Treat trees in Swamp as though they were shallow water.
     if (cell->mangrove_water && feat == DNGN_TREE)
@@ -478,7 +481,7 @@ static bool _is_seen_slimy_wall(const coord_def& gc)
 
 void pack_cell_overlays(const coord_def &gc, packed_cell *cell)
 {
-    if (env.map_knowledge(gc).feat() == DNGN_UNSEEN)
+    if (env.map_knowledge.get(gc).feat() == DNGN_UNSEEN)
         return; // Don't put overlays on unseen tiles
 
     if (player_in_branch(BRANCH_SHOALS))
@@ -487,7 +490,7 @@ void pack_cell_overlays(const coord_def &gc, packed_cell *cell)
         _pack_default_waves(gc, cell);
 
     if (player_in_branch(BRANCH_SLIME) &&
-        env.map_knowledge(gc).feat() != DNGN_SLIMY_WALL)
+        env.map_knowledge.get(gc).feat() != DNGN_SLIMY_WALL)
     {
         _add_directional_overlays(gc, cell, TILE_SLIME_OVERLAY,
                                   _is_seen_slimy_wall);
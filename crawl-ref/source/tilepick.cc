@@ -468,7 +468,7 @@ bool is_door_tile(tileidx_t tile)
 
 tileidx_t tileidx_feature(const coord_def &gc)
 {
-    dungeon_feature_type feat = env.map_knowledge(gc).feat();
+    dungeon_feature_type feat = env.map_knowledge.get(gc).feat();
 
     tileidx_t override = env.tile_flv(gc).feat;
     bool can_override = !feat_is_door(feat)
@@ -491,7 +491,7 @@ tileidx_t tileidx_feature(const coord_def &gc)
             bool slimy = false;
             for (adjacent_iterator ai(gc); ai; ++ai)
             {
-                if (env.map_knowledge(*ai).feat() == DNGN_SLIMY_WALL)
+                if (env.map_knowledge.get(*ai).feat() == DNGN_SLIMY_WALL)
                 {
                     slimy = true;
                     break;
@@ -507,7 +507,7 @@ tileidx_t tileidx_feature(const coord_def &gc)
     case DNGN_PERMAROCK_WALL:
     case DNGN_CLEAR_PERMAROCK_WALL:
     {
-        unsigned colour = env.map_knowledge(gc).feat_colour();
+        unsigned colour = env.map_knowledge.get(gc).feat_colour();
         if (colour == 0)
         {
             colour = feat == DNGN_FLOOR     ? env.floor_colour :
@@ -535,7 +535,7 @@ tileidx_t tileidx_feature(const coord_def &gc)
 
     case DNGN_TRAP_MECHANICAL:
     case DNGN_TRAP_TELEPORT:
-        return _tileidx_trap(env.map_knowledge(gc).trap());
+        return _tileidx_trap(env.map_knowledge.get(gc).trap());
 
     case DNGN_TRAP_WEB:
     {
@@ -554,8 +554,8 @@ tileidx_t tileidx_feature(const coord_def &gc)
         };
         int solid = 0;
         for (int i = 0; i < 4; i++)
-            if (feat_is_solid(env.map_knowledge(neigh[i]).feat())
-                || env.map_knowledge(neigh[i]).trap() == TRAP_WEB)
+            if (feat_is_solid(env.map_knowledge.get(neigh[i]).feat())
+                || env.map_knowledge.get(neigh[i]).trap() == TRAP_WEB)
             {
                 solid |= 1 << i;
             }
@@ -566,8 +566,8 @@ tileidx_t tileidx_feature(const coord_def &gc)
     case DNGN_ENTER_SHOP:
         return _tileidx_shop(gc);
     case DNGN_DEEP_WATER:
-        if (env.map_knowledge(gc).feat_colour() == GREEN
-            || env.map_knowledge(gc).feat_colour() == LIGHTGREEN)
+        if (env.map_knowledge.get(gc).feat_colour() == GREEN
+            || env.map_knowledge.get(gc).feat_colour() == LIGHTGREEN)
         {
             return TILE_DNGN_DEEP_WATER_MURKY;
         }
@@ -578,15 +578,15 @@ tileidx_t tileidx_feature(const coord_def &gc)
     case DNGN_SHALLOW_WATER:
         {
             tileidx_t t = TILE_DNGN_SHALLOW_WATER;
-            if (env.map_knowledge(gc).feat_colour() == GREEN
-                || env.map_knowledge(gc).feat_colour() == LIGHTGREEN)
+            if (env.map_knowledge.get(gc).feat_colour() == GREEN
+                || env.map_knowledge.get(gc).feat_colour() == LIGHTGREEN)
             {
                 t = TILE_DNGN_SHALLOW_WATER_MURKY;
             }
             else if (player_in_branch(BRANCH_SHOALS))
                 t = TILE_SHOALS_SHALLOW_WATER;
 
-            if (env.map_knowledge(gc).invisible_monster())
+            if (env.map_knowledge.get(gc).invisible_monster())
             {
                 // Add disturbance to tile.
                 t += tile_dngn_count(t);
@@ -618,10 +618,10 @@ void tileidx_out_of_los(tileidx_t *fg, tileidx_t *bg, tileidx_t *cloud, const co
     // Detected info is just stored in map_knowledge and doesn't get
     // written to what the player remembers. We'll feather that in here.
 
-    const map_cell &cell = env.map_knowledge(gc);
+    const map_cell &cell = env.map_knowledge.get(gc);
 
     // Override terrain for magic mapping.
-    if (!cell.seen() && env.map_knowledge(gc).mapped())
+    if (!cell.seen() && env.map_knowledge.get(gc).mapped())
         *bg = tileidx_feature_base(cell.feat());
     else
         *bg = mem_bg;
@@ -630,12 +630,12 @@ void tileidx_out_of_los(tileidx_t *fg, tileidx_t *bg, tileidx_t *cloud, const co
     *bg &= ~(TILE_FLAG_RAY_MULTI | TILE_FLAG_RAY_OOR | TILE_FLAG_RAY | TILE_FLAG_LANDING);
 
     // Override foreground for monsters/items
-    if (env.map_knowledge(gc).detected_monster())
+    if (env.map_knowledge.get(gc).detected_monster())
     {
         ASSERT(cell.monster() == MONS_SENSED);
         *fg = tileidx_monster_base(cell.monsterinfo()->base_type);
     }
-    else if (env.map_knowledge(gc).detected_item())
+    else if (env.map_knowledge.get(gc).detected_item())
         *fg = tileidx_item(*cell.item());
     else
         *fg = mem_fg;
@@ -2672,7 +2672,7 @@ static bool _tentacle_tile_not_flying(tileidx_t tile)
 
 static tileidx_t _tileidx_monster_no_props(const monster_info& mon)
 {
-    bool in_water = feat_is_water(env.map_knowledge(mon.pos).feat());
+    bool in_water = feat_is_water(env.map_knowledge.get(mon.pos).feat());
 
     // Show only base class for detected monsters.
     if (mons_class_is_zombified(mon.type))
@@ -2704,7 +2704,7 @@ static tileidx_t _tileidx_monster_no_props(const monster_info& mon)
         case MONS_SLAVE:
             return TILEP_MONS_SLAVE + (mon.mname == "freed slave" ? 1 : 0);
         case MONS_BUSH:
-            if (env.map_knowledge(mon.pos).cloud() == CLOUD_FIRE)
+            if (env.map_knowledge.get(mon.pos).cloud() == CLOUD_FIRE)
                 return TILEP_MONS_BUSH_BURNING;
             else
                 return _mon_mod(TILEP_MONS_BUSH, tile_num);
@@ -5564,10 +5564,10 @@ tileidx_t tileidx_unseen_flag(const coord_def &gc)
 {
     if (!map_bounds(gc))
         return TILE_FLAG_UNSEEN;
-    else if (env.map_knowledge(gc).known()
-                && !env.map_knowledge(gc).seen()
-             || env.map_knowledge(gc).detected_item()
-             || env.map_knowledge(gc).detected_monster()
+    else if (env.map_knowledge.get(gc).known()
+                && !env.map_knowledge.get(gc).seen()
+             || env.map_knowledge.get(gc).detected_item()
+             || env.map_knowledge.get(gc).detected_monster()
            )
     {
         return TILE_FLAG_MM_UNSEEN;
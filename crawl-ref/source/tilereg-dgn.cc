@@ -1157,7 +1157,7 @@ bool tile_dungeon_tip(const coord_def &gc, string &tip)
         {
             if (adjacent(gc, you.pos()))
                 _add_tip(tip, "[L-Click] Move");
-            else if (env.map_knowledge(gc).feat() != DNGN_UNSEEN
+            else if (env.map_knowledge.get(gc).feat() != DNGN_UNSEEN
                      && i_feel_safe())
             {
                 _add_tip(tip, "[L-Click] Travel");
@@ -1186,7 +1186,7 @@ bool tile_dungeon_tip(const coord_def &gc, string &tip)
             }
         }
 
-        const dungeon_feature_type feat = env.map_knowledge(gc).feat();
+        const dungeon_feature_type feat = env.map_knowledge.get(gc).feat();
         const command_type dir = feat_stair_direction(feat);
         if (dir != CMD_NO_CMD)
         {
@@ -1254,7 +1254,7 @@ bool tile_dungeon_tip(const coord_def &gc, string &tip)
         }
     }
     else if (you.see_cell(gc)
-             && env.map_knowledge(gc).feat() != DNGN_UNSEEN)
+             && env.map_knowledge.get(gc).feat() != DNGN_UNSEEN)
     {
         _add_tip(tip, "[R-Click] Describe");
     }
@@ -1276,13 +1276,13 @@ bool DungeonRegion::update_alt_text(string &alt)
         return false;
     if (!map_bounds(gc))
         return false;
-    if (!env.map_knowledge(gc).seen())
+    if (!env.map_knowledge.get(gc).seen())
         return false;
     if (m_last_clicked_grid == gc)
         return false;
 
     describe_info inf;
-    dungeon_feature_type feat = env.map_knowledge(gc).feat();
+    dungeon_feature_type feat = env.map_knowledge.get(gc).feat();
     if (you.see_cell(gc))
         get_square_desc(gc, inf);
     else if (feat != DNGN_FLOOR && !feat_is_wall(feat) && !feat_is_tree(feat))
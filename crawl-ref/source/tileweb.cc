@@ -73,7 +73,10 @@ TilesFramework::TilesFramework()
       m_next_view_br(-1, -1),
       m_current_flash_colour(BLACK),
       m_next_flash_colour(BLACK),
+      m_map_version(0),
       m_need_full_map(true),
+      m_whole_map_snapshot(false),
+      m_last_map_bytes(0),
       m_text_crt("crt"),
       m_text_menu("menu_txt"),
       m_print_fg(15)
@@ -1290,26 +1293,27 @@ void TilesFramework::_send_cursor(cursor_type type)
     }
 }
 
+void TilesFramework::_mcache_ref_cell(const coord_def &gc, bool inc)
+{
+    int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
+    if (fg_idx >= TILEP_MCACHE_START)
+    {
+        mcache_entry *entry = mcache.get(fg_idx);
+        if (entry)
+        {
+            if (inc)
+                entry->inc_ref();
+            else
+                entry->dec_ref();
+        }
+    }
+}
+
 void TilesFramework::_mcache_ref(bool inc)
 {
     for (int y = 0; y < GYM; y++)
         for (int x = 0; x < GXM; x++)
-        {
-            coord_def gc(x, y);
-
-            int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
-            if (fg_idx >= TILEP_MCACHE_START)
-            {
-                mcache_entry *entry = mcache.get(fg_idx);
-                if (entry)
-                {
-                    if (inc)
-                        entry->inc_ref();
-                    else
-                        entry->dec_ref();
-                }
-            }
-        }
+            _mcache_ref_cell(coord_def(x, y), inc);
 }
 
 void TilesFramework::_send_map(bool force_full)
@@ -1351,6 +1355,7 @@ void TilesFramework::_send_map(bool force_full)
 
     coord_def last_gc(0, 0);
     bool send_gc = true;
+    bitset<GXM * GYM> sent_cells;
 
     json_open_array("cells");
     for (int y = 0; y < GYM; y++)
@@ -1371,6 +1376,7 @@ void TilesFramework::_send_map(bool force_full)
             }
 
             mark_clean(gc);
+            sent_cells[gc.y * GXM + gc.x] = true;
 
             if (m_origin.equals(-1, -1))
                 m_origin = gc;
@@ -1392,7 +1398,7 @@ void TilesFramework::_send_map(bool force_full)
             _send_cell(gc,
                        sc,
                        m_next_view(gc),
-                       mc, env.map_knowledge(gc),
+                       mc, env.map_knowledge.get(gc),
                        new_monster_locs, force_full);
 
             if (!json_is_empty())
@@ -1406,23 +1412,91 @@ void TilesFramework::_send_map(bool force_full)
 
     json_close_object(true);
 
+    m_last_map_bytes = m_msg_buf.size();
     finish_message();
 
     if (force_full)
         _send_cursor(CURSOR_MAP);
 
-    if (m_mcache_ref_done)
-        _mcache_ref(false);
+    _update_snapshot(sent_cells);
+
+    m_monster_locs = new_monster_locs;
+}
+
+/**
+ * Bring the copies of the view and of the map knowledge that the next map
+ * message will be diffed against up to date.
+ *
+ * m_next_view only changes in cells marked dirty, all of which have just been
+ * sent, so only those are copied. Of the map knowledge, only the cells the
+ * journal says have changed since the last time are copied: copying a
+ * map_cell means allocating its monster, item and cloud afresh.
+ *
+ * @param sent_cells The cells just sent.
+ */
+void TilesFramework::_update_snapshot(const bitset<GXM * GYM> &sent_cells)
+{
+    if (m_whole_map_snapshot)
+    {
+        if (m_mcache_ref_done)
+            _mcache_ref(false);
+        for (int y = 0; y < GYM; y++)
+            for (int x = 0; x < GXM; x++)
+            {
+                const coord_def gc(x, y);
+                m_current_map_knowledge(gc) = env.map_knowledge.get(gc);
+            }
+        m_current_view = m_next_view;
+        _mcache_ref(true);
+        m_mcache_ref_done = true;
+        m_map_version = env.map_knowledge.next_version();
+        return;
+    }
+
+    const unsigned int since = m_map_version;
+    m_map_version = env.map_knowledge.next_version();
 
-    m_current_map_knowledge = env.map_knowledge;
-    m_current_view = m_next_view;
+    for (int y = 0; y < GYM; y++)
+        for (int x = 0; x < GXM; x++)
+        {
+            const coord_def gc(x, y);
 
-    _mcache_ref(true);
-    m_mcache_ref_done = true;
+            if (env.map_knowledge.changed_since(gc, since))
+                m_current_map_knowledge(gc) = env.map_knowledge.get(gc);
 
-    m_monster_locs = new_monster_locs;
+            if (!sent_cells[y * GXM + x])
+                continue;
+
+            if (m_mcache_ref_done)
+                _mcache_ref_cell(gc, false);
+            m_current_view(gc) = m_next_view(gc);
+            if (m_mcache_ref_done)
+                _mcache_ref_cell(gc, true);
+        }
+
+    if (!m_mcache_ref_done)
+    {
+        _mcache_ref(true);
+        m_mcache_ref_done = true;
+    }
 }
 
+#ifdef WIZARD
+/**
+ * Send the map as redraw() would, for benchmarks.
+ *
+ * @param whole_snapshot Copy all of the view and map knowledge afterwards,
+ *                       as was done before the map knowledge journal.
+ * @return The size of the map message, in bytes.
+ */
+int TilesFramework::bench_send_map(bool whole_snapshot)
+{
+    unwind_bool whole(m_whole_map_snapshot, whole_snapshot);
+    _send_map(false);
+    return m_last_map_bytes;
+}
+#endif
+
 void TilesFramework::_send_monster(const coord_def &gc, const monster_info* m,
                                    map<uint32_t, coord_def>& new_monster_locs,
                                    bool force_full)
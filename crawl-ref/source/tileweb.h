@@ -107,6 +107,9 @@ public:
     void set_need_redraw(unsigned int min_tick_delay = 0);
     bool need_redraw() const;
     void redraw();
+#ifdef WIZARD
+    int bench_send_map(bool whole_snapshot);
+#endif
 
     void place_cursor(cursor_type type, const coord_def &gc);
     void clear_text_tags(text_tag_type type);
@@ -262,8 +265,12 @@ protected:
     int m_next_flash_colour;
 
     FixedArray<map_cell, GXM, GYM> m_current_map_knowledge;
+    // The map knowledge journal version m_current_map_knowledge is from.
+    unsigned int m_map_version;
     map<uint32_t, coord_def> m_monster_locs;
     bool m_need_full_map;
+    bool m_whole_map_snapshot;
+    int m_last_map_bytes;
 
     coord_def m_cursor[CURSOR_MAX];
     coord_def m_last_clicked_grid;
@@ -289,10 +296,12 @@ protected:
     void _send_everything();
 
     bool m_mcache_ref_done;
+    void _mcache_ref_cell(const coord_def &gc, bool inc);
     void _mcache_ref(bool inc);
 
     void _send_cursor(cursor_type type);
     void _send_map(bool force_full = false);
+    void _update_snapshot(const bitset<GXM * GYM> &sent_cells);
     void _send_cell(const coord_def &gc,
                     const screen_cell_t &current_sc, const screen_cell_t &next_sc,
                     const map_cell &current_mc, const map_cell &next_mc,
@@ -413,7 +413,7 @@ void change_labyrinth(bool msg)
 
         int count_known = 0;
         for (rectangle_iterator ri(c1, c2); ri; ++ri)
-            if (env.map_knowledge(*ri).seen())
+            if (env.map_knowledge.get(*ri).seen())
                 count_known++;
 
         if (tries > 1 && count_known > size * size / 6)
@@ -424,7 +424,7 @@ void change_labyrinth(bool msg)
         // directions, and by floor on the two remaining sides.
         for (rectangle_iterator ri(c1, c2); ri; ++ri)
         {
-            if (env.map_knowledge(*ri).seen() || !feat_is_wall(grd(*ri)))
+            if (env.map_knowledge.get(*ri).seen() || !feat_is_wall(grd(*ri)))
                 continue;
 
             // Skip on grids inside vaults so as not to disrupt them.
@@ -529,7 +529,7 @@ void change_labyrinth(bool msg)
                 continue;
 
             // Don't change any grids we remember.
-            if (env.map_knowledge(p).seen())
+            if (env.map_knowledge.get(p).seen())
                 continue;
 
             // We don't want to deal with monsters being shifted around.
@@ -1701,7 +1701,7 @@ void handle_items_on_shaft(const coord_def& pos, bool open_shaft)
     if (o == NON_ITEM)
         return;
 
-    bool need_open_message = env.map_knowledge(pos).seen() && open_shaft;
+    bool need_open_message = env.map_knowledge.get(pos).seen() && open_shaft;
 
     while (o != NON_ITEM)
     {
@@ -1716,7 +1716,7 @@ void handle_items_on_shaft(const coord_def& pos, bool open_shaft)
                 need_open_message = false;
             }
 
-            if (env.map_knowledge(pos).visible())
+            if (env.map_knowledge.get(pos).visible())
             {
                 mprf("%s fall%s through the shaft.",
                      mitm[o].name(DESC_INVENTORY).c_str(),
@@ -1731,9 +1731,7 @@ void handle_items_on_shaft(const coord_def& pos, bool open_shaft)
             mitm[o].pos = INVALID_COORD;
             add_item_to_transit(dest, mitm[o]);
 
-            mitm[o].base_type = OBJ_UNASSIGNED;
-            mitm[o].quantity = 0;
-            mitm[o].props.clear();
+            mitm[o].clear();
         }
 
         o = next;
@@ -189,18 +189,19 @@ static bool _is_travelsafe_square(const coord_def& c,
 //
 static inline bool is_trap(const coord_def& c)
 {
-    return feat_is_trap(env.map_knowledge(c).feat());
+    return feat_is_trap(env.map_knowledge.get(c).feat());
 }
 
 static inline bool _is_safe_cloud(const coord_def& c)
 {
-    const cloud_type ctype = env.map_knowledge(c).cloud();
+    const cloud_type ctype = env.map_knowledge.get(c).cloud();
     if (ctype == CLOUD_NONE)
         return true;
 
     // We can also safely run through smoke, or any of our own clouds if
     // following Qazlal.
-    return !is_damaging_cloud(ctype, true, YOU_KILL(env.map_knowledge(c).cloudinfo()->killer));
+    return !is_damaging_cloud(ctype, true,
+                              YOU_KILL(env.map_knowledge.get(c).cloudinfo()->killer));
 }
 
 // Returns an estimate for the time needed to cross this feature.
@@ -217,7 +218,7 @@ static inline int _feature_traverse_cost(dungeon_feature_type feature)
 
 bool is_unknown_stair(const coord_def &p)
 {
-    dungeon_feature_type feat = env.map_knowledge(p).feat();
+    dungeon_feature_type feat = env.map_knowledge.get(p).feat();
 
     return feat_is_travelable_stair(feat) && !travel_cache.know_stair(p)
            && feat != DNGN_EXIT_DUNGEON;
@@ -320,7 +321,7 @@ static bool _is_reseedable(const coord_def& c, bool ignore_danger = false)
     if (!ignore_danger && is_excluded(c))
         return true;
 
-    map_cell &cell(env.map_knowledge(c));
+    const map_cell &cell(env.map_knowledge.get(c));
     const dungeon_feature_type grid = cell.feat();
 
     if (feat_is_wall(grid) || grid == DNGN_TREE)
@@ -381,7 +382,7 @@ public:
 
 bool is_stair_exclusion(const coord_def &p)
 {
-    if (feat_stair_direction(env.map_knowledge(p).feat()) == CMD_NO_CMD)
+    if (feat_stair_direction(env.map_knowledge.get(p).feat()) == CMD_NO_CMD)
         return false;
 
     return get_exclusion_radius(p) == 1;
@@ -403,10 +404,10 @@ static bool _is_travelsafe_square(const coord_def& c, bool ignore_hostile,
                : cell.safe;
     }
 
-    if (!env.map_knowledge(c).known())
+    if (!env.map_knowledge.get(c).known())
         return false;
 
-    const dungeon_feature_type grid = env.map_knowledge(c).feat();
+    const dungeon_feature_type grid = env.map_knowledge.get(c).feat();
 
     // Only try pathing through temporary obstructions we remember, not
     // those we can actually see (since the latter are clearly still blockers)
@@ -415,7 +416,7 @@ static bool _is_travelsafe_square(const coord_def& c, bool ignore_hostile,
 
     // Also make note of what's displayed on the level map for
     // plant/fungus checks.
-    const map_cell& levelmap_cell = env.map_knowledge(c);
+    const map_cell& levelmap_cell = env.map_knowledge.get(c);
 
     // Travel will not voluntarily cross squares blocked by immobile
     // monsters.
@@ -448,7 +449,7 @@ static bool _is_travelsafe_square(const coord_def& c, bool ignore_hostile,
     {
         trap_def trap;
         trap.pos = c;
-        trap.type = env.map_knowledge(c).trap();
+        trap.type = env.map_knowledge.get(c).trap();
         trap.ammo_qty = 1;
         if (trap.is_safe())
             return true;
@@ -631,7 +632,7 @@ static bool _is_valid_explore_target(const coord_def& where)
 {
     // If a square in LOS is unmapped, it's valid.
     for (radius_iterator ri(where, LOS_DEFAULT, true); ri; ++ri)
-        if (!env.map_knowledge(*ri).seen())
+        if (!env.map_knowledge.get(*ri).seen())
             return true;
 
     if (you.running == RMODE_EXPLORE_GREEDY)
@@ -785,8 +786,8 @@ static void _explore_find_target_square()
 
             // Has moving along the straight line found an unexplored
             // square?
-            if (!env.map_knowledge(target + delta).seen() && target != you.pos()
-                && target != whereto)
+            if (!env.map_knowledge.get(target + delta).seen()
+                && target != you.pos() && target != whereto)
             {
                 // Auto-explore is only zigzagging if the preferred
                 // target (whereto) and the anti-zigzag target are
@@ -1126,7 +1127,7 @@ static void _fill_exclude_radius(const travel_exclude &exc)
         for (int x = c.x - radius; x <= c.x + radius; ++x)
         {
             const coord_def p(x, y);
-            if (!map_bounds(x, y) || !env.map_knowledge(p).known()
+            if (!map_bounds(x, y) || !env.map_knowledge.get(p).known()
                 || travel_point_distance[x][y])
             {
                 continue;
@@ -1447,7 +1448,8 @@ void travel_pathfind::get_features()
     for (dc.x = X_BOUND_1; dc.x <= X_BOUND_2; ++dc.x)
         for (dc.y = Y_BOUND_1; dc.y <= Y_BOUND_2; ++dc.y)
         {
-            const dungeon_feature_type feature = env.map_knowledge(dc).feat();
+            const dungeon_feature_type feature =
+                env.map_knowledge.get(dc).feat();
 
             if ((feature != DNGN_FLOOR
                     && !feat_is_water(feature)
@@ -1482,7 +1484,7 @@ bool travel_pathfind::square_slows_movement(const coord_def &c)
     // c is a known (explored) location - we never put unknown points in the
     // circumference vector, so we don't need to examine the map array, just the
     // grid array.
-    const dungeon_feature_type feature = env.map_knowledge(c).feat();
+    const dungeon_feature_type feature = env.map_knowledge.get(c).feat();
 
     // If this is a feature that'll take time to travel past, we simulate that
     // extra turn by taking this feature next turn, thereby artificially
@@ -1531,7 +1533,7 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
     if (floodout
         && (runmode == RMODE_EXPLORE || runmode == RMODE_EXPLORE_GREEDY))
     {
-        if (!env.map_knowledge(dc).seen())
+        if (!env.map_knowledge.get(dc).seen())
         {
             if (ignore_hostile && !player_in_branch(BRANCH_SHOALS))
             {
@@ -1582,7 +1584,7 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
                     {
                         const coord_def ddc = dc + Compass[dir];
 
-                        if (feat_is_wall(env.map_knowledge(ddc).feat()))
+                        if (feat_is_wall(env.map_knowledge.get(ddc).feat()))
                             dist -= Options.explore_wall_bias;
                     }
                 }
@@ -1682,7 +1684,7 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
 
         if (features && !ignore_hostile)
         {
-            dungeon_feature_type feature = env.map_knowledge(dc).feat();
+            dungeon_feature_type feature = env.map_knowledge.get(dc).feat();
 
             if (dc != start
                 && (feature != DNGN_FLOOR
@@ -1799,8 +1801,8 @@ void find_travel_pos(const coord_def& youpos,
         coord_def unseen = coord_def();
         for (adjacent_iterator ai(dest); ai; ++ai)
             if (!you.see_cell(*ai)
-                && (!env.map_knowledge(*ai).seen()
-                    || !feat_is_wall(env.map_knowledge(*ai).feat())))
+                && (!env.map_knowledge.get(*ai).seen()
+                    || !feat_is_wall(env.map_knowledge.get(*ai).feat())))
             {
                 unseen = *ai;
                 break;
@@ -1821,7 +1823,8 @@ void find_travel_pos(const coord_def& youpos,
             // happen by manual movement, so I don't think we need to worry
             // about this. (jpeg)
             if (!_is_travelsafe_square(new_dest)
-                || !feat_is_traversable_now(env.map_knowledge(new_dest).feat()))
+                || !feat_is_traversable_now(
+                        env.map_knowledge.get(new_dest).feat()))
             {
                 new_dest = dest;
             }
@@ -3057,7 +3060,7 @@ void start_explore(bool grab_items)
     }
 
     for (rectangle_iterator ri(0); ri; ++ri)
-        if (env.map_knowledge(*ri).seen())
+        if (env.map_knowledge.get(*ri).seen())
             env.map_seen.set(*ri);
 
     you.running.pos.reset();
@@ -3255,11 +3258,14 @@ bool LevelInfo::empty() const
 
 void LevelInfo::update_excludes()
 {
+    ++generation;
     excludes = curr_excludes;
 }
 
 void LevelInfo::update()
 {
+    ++generation;
+
     // First, set excludes, so that stair distances will be correctly populated.
     excludes = curr_excludes;
 
@@ -3321,6 +3327,7 @@ void LevelInfo::update_stair_distances()
 void LevelInfo::update_stair(const coord_def& stairpos, const level_pos &p,
                              bool guess)
 {
+    ++generation;
     stair_info *si = get_stair(stairpos);
 
     // What 'guess' signifies: whenever you take a stair from A to B, the
@@ -3407,6 +3414,7 @@ void LevelInfo::sync_branch_stairs(const stair_info *si)
 
 void LevelInfo::clear_stairs(dungeon_feature_type grid)
 {
+    ++generation;
     for (stair_info &si : stairs)
     {
         if (si.grid != grid)
@@ -3546,9 +3554,9 @@ void LevelInfo::get_stairs(vector<coord_def> &st)
     {
         const dungeon_feature_type feat = grd(*ri);
 
-        if ((*ri == you.pos() || env.map_knowledge(*ri).known())
+        if ((*ri == you.pos() || env.map_knowledge.get(*ri).known())
             && feat_is_travelable_stair(feat)
-            && (env.map_knowledge(*ri).seen() || !_is_branch_stair(*ri)))
+            && (env.map_knowledge.get(*ri).seen() || !_is_branch_stair(*ri)))
         {
             st.push_back(*ri);
         }
@@ -3749,6 +3757,7 @@ void TravelCache::update_waypoints() const
 
 void TravelCache::delete_waypoint()
 {
+    ++generation;
     if (!get_waypoint_count())
         return;
 
@@ -3837,6 +3846,7 @@ void TravelCache::add_waypoint(int x, int y)
 
     waypoints[waynum].id  = lid;
     waypoints[waynum].pos = pos;
+    ++generation;
 
     string new_dest = _get_trans_travel_dest(waypoints[waynum], false, true);
     clear_messages();
@@ -3900,6 +3910,7 @@ void TravelCache::save(writer& outf) const
 
 void TravelCache::load(reader& inf, int minorVersion)
 {
+    generation = change_generation() + 1;
     levels.clear();
 
     // Check version. If not compatible, we just ignore the file altogether.
@@ -3946,7 +3957,11 @@ void TravelCache::update()
 
 void TravelCache::update_daction_counters()
 {
-    ::update_daction_counters(&get_level_info(level_id::current()));
+    LevelInfo &li = get_level_info(level_id::current());
+    const FixedVector<int, NUM_DACTION_COUNTERS> counters = li.daction_counters;
+    ::update_daction_counters(&li);
+    if (!equal(counters.begin(), counters.end(), li.daction_counters.begin()))
+        ++li.generation;
 }
 
 unsigned int TravelCache::query_daction_counter(daction_type c)
@@ -3964,10 +3979,19 @@ unsigned int TravelCache::query_daction_counter(daction_type c)
 
 void TravelCache::clear_daction_counter(daction_type c)
 {
+    ++generation;
     for (auto &entry : levels)
         entry.second.daction_counters[c] = 0;
 }
 
+unsigned int TravelCache::change_generation() const
+{
+    unsigned int sum = generation;
+    for (const auto &entry : levels)
+        sum += entry.second.generation;
+    return sum;
+}
+
 void TravelCache::fixup_levels()
 {
     for (auto &entry : levels)
@@ -4075,7 +4099,7 @@ void runrest::set_run_check(int index, int dir)
     run_check[index].delta = Compass[dir];
 
     const coord_def p = you.pos() + Compass[dir];
-    run_check[index].grid = _base_feat_type(env.map_knowledge(p).feat());
+    run_check[index].grid = _base_feat_type(env.map_knowledge.get(p).feat());
 }
 
 bool runrest::check_stop_running()
@@ -4093,7 +4117,7 @@ bool runrest::check_stop_running()
 bool runrest::run_should_stop() const
 {
     const coord_def targ = you.pos() + pos;
-    const map_cell& tcell = env.map_knowledge(targ);
+    const map_cell& tcell = env.map_knowledge.get(targ);
 
     if (tcell.cloud() != CLOUD_NONE
         && (!in_good_standing(GOD_QAZLAL)
@@ -4123,7 +4147,7 @@ bool runrest::run_should_stop() const
     {
         const coord_def p = you.pos() + run_check[i].delta;
         const dungeon_feature_type feat =
-            _base_feat_type(env.map_knowledge(p).feat());
+            _base_feat_type(env.map_knowledge.get(p).feat());
 
         if (run_check[i].grid != feat)
             return true;
@@ -4297,7 +4321,7 @@ void explore_discoveries::found_feature(const coord_def &pos,
                 // If any neighbours have been seen (and thus announced) before,
                 // skip. For parts seen for the first time this turn, announce
                 // only the upper leftmost cell.
-                if (env.map_knowledge(*ai).feat() == DNGN_RUNED_DOOR
+                if (env.map_knowledge.get(*ai).feat() == DNGN_RUNED_DOOR
                     && (env.map_seen(*ai) || *ai < pos))
                 {
                     return;
@@ -4571,7 +4595,7 @@ static int _adjacent_cmd(const coord_def &gc, bool force)
         if (force)
         {
             if (grd(gc) == DNGN_OPEN_DOOR
-                && !env.map_knowledge(gc).monsterinfo())
+                && !env.map_knowledge.get(gc).monsterinfo())
             {
                 cmd += CMD_CLOSE_DOOR_LEFT - CMD_MOVE_LEFT;
             }
@@ -4598,7 +4622,7 @@ int click_travel(const coord_def &gc, bool force)
         && (!is_excluded(you.pos()) || is_stair_exclusion(you.pos()))
         && i_feel_safe(false, false, false, false))
     {
-        map_cell &cell(env.map_knowledge(gc));
+        const map_cell &cell(env.map_knowledge.get(gc));
         // If there's a monster that would block travel,
         // don't start traveling.
         if (!_monster_blocks_travel(cell.monsterinfo()))
@@ -4633,7 +4657,7 @@ bool check_for_interesting_features()
         const coord_def p(*ri);
 
         // Find just noticed squares.
-        if (env.map_knowledge(p).flags & MAP_SEEN_FLAG
+        if (env.map_knowledge.get(p).flags & MAP_SEEN_FLAG
             && !env.map_seen(p))
         {
             env.map_seen.set(p);
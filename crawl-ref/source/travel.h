@@ -290,7 +290,7 @@ public:
 // Information on a level that interlevel travel needs.
 struct LevelInfo
 {
-    LevelInfo() : stairs(), excludes(), stair_distances(), id()
+    LevelInfo() : stairs(), excludes(), stair_distances(), id(), generation(0)
     {
         daction_counters.init(0);
     }
@@ -359,6 +359,9 @@ private:
     vector<short> stair_distances;  // Dist between stairs
     level_id id;
 
+    // Bumped whenever what save() writes changes.
+    unsigned int generation;
+
     friend class TravelCache;
 
 private:
@@ -373,10 +376,17 @@ class TravelCache
 public:
     void clear_distances();
 
+    TravelCache() : generation(0) { }
+
     LevelInfo& get_level_info(const level_id &lev)
     {
-        LevelInfo &li = levels[lev];
-        li.id = lev;
+        auto added = levels.emplace(lev, LevelInfo());
+        LevelInfo &li = added.first->second;
+        if (added.second)
+        {
+            ++generation;
+            li.id = lev;
+        }
         return li;
     }
 
@@ -388,7 +398,12 @@ public:
 
     void erase_level_info(const level_id& lev)
     {
-        levels.erase(lev);
+        auto i = levels.find(lev);
+        if (i == levels.end())
+            return;
+        // Keep what the level counted, so the sum never goes back.
+        generation += i->second.generation + 1;
+        levels.erase(i);
     }
 
     bool know_stair(const coord_def &c);
@@ -426,6 +441,10 @@ public:
     unsigned int query_daction_counter(daction_type c);
     void clear_daction_counter(daction_type c);
 
+    // Changes whenever what save() writes does: the cache's own count of
+    // changes, plus each level's.
+    unsigned int change_generation() const;
+
 private:
     void update_stone_stair(const coord_def &c);
     void fixup_levels();
@@ -434,6 +453,7 @@ private:
     typedef map<level_id, LevelInfo> travel_levels_map;
     travel_levels_map levels;
     level_pos waypoints[TRAVEL_WAYPOINT_COUNT];
+    unsigned int generation;
 };
 
 // Handles travel and explore floodfill pathfinding. Does not do interlevel
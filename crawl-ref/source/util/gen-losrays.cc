@@ -0,0 +1,221 @@
+/**
+ * @file
+ * @brief Writes out the LOS rays of losrays.cc as losray-data.h.
+ *
+ * Built for the host and linked with losrays.cc, ray.cc and geom2d.cc
+ * only. Built with -DCHECK_LOSRAY_DATA it instead includes losray-data.h
+ * and exits with an error unless its tables, once compiled, are the same as
+ * the rays it casts itself.
+**/
+
+#include "AppHdr.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+#include "losrays.h"
+#ifdef CHECK_LOSRAY_DATA
+#include "losray-data.h"
+#endif
+
+#undef die
+NORETURN void die(const char *file, int line, const char *format, ...)
+{
+    va_list args;
+    fprintf(stderr, "%s:%d: ", file, line);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+NORETURN void die_noline(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+#ifdef ASSERTS
+NORETURN void AssertFailed(const char *expr, const char *file, int line,
+                           const char *text, ...)
+{
+    fprintf(stderr, "%s:%d: ASSERT(%s) failed", file, line, expr);
+    if (text)
+    {
+        va_list args;
+        fprintf(stderr, ": ");
+        va_start(args, text);
+        vfprintf(stderr, text, args);
+        va_end(args);
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+#endif
+
+#ifndef CHECK_LOSRAY_DATA
+// Enough digits for every double to be read back exactly.
+static void _write_double(double d)
+{
+    printf("%.17g", d);
+}
+
+static void _write_tables(const los_ray_tables &tables)
+{
+    const int cells = (LOS_MAX_RANGE+1) * (LOS_MAX_RANGE+1);
+    const int words = tables.blockrays(coord_def(0, 0)).size();
+
+    printf("// Generated by util/gen-losrays from losrays.cc. Do not edit!\n"
+           "\n"
+           "#include \"losrays.h\"\n"
+           "\n"
+           "COMPILE_CHECK(LOS_MAX_RANGE == %d);\n"
+           "\n", LOS_MAX_RANGE);
+
+    printf("static const double losray_fullrays[%u][4] =\n{\n",
+           (unsigned int)tables.fullrays.size());
+    for (const los_fullray &ray : tables.fullrays)
+    {
+        printf("    { ");
+        _write_double(ray.r.start.x);
+        printf(", ");
+        _write_double(ray.r.start.y);
+        printf(", ");
+        _write_double(ray.r.dir.x);
+        printf(", ");
+        _write_double(ray.r.dir.y);
+        printf(" },\n");
+    }
+    printf("};\n\n");
+
+    printf("static const uint16_t losray_spans[%u][2] =\n{\n",
+           (unsigned int)tables.fullrays.size());
+    for (const los_fullray &ray : tables.fullrays)
+        printf("    { %d, %d },\n", ray.start, ray.length);
+    printf("};\n\n");
+
+    printf("static const uint8_t losray_coords[%u][2] =\n{\n",
+           (unsigned int)tables.ray_coords.size());
+    for (const coord_def &c : tables.ray_coords)
+        printf("    { %d, %d },\n", c.x, c.y);
+    printf("};\n\n");
+
+    printf("static const uint16_t losray_min_ends[%u] =\n{\n",
+           (unsigned int)tables.min_ends.size());
+    for (unsigned int i = 0; i < tables.min_ends.size(); ++i)
+    {
+        printf("%s%d,%s", i % 12 ? " " : "    ", tables.min_ends[i],
+               i % 12 == 11 || i + 1 == tables.min_ends.size() ? "\n" : "");
+    }
+    printf("};\n\n");
+
+    printf("static const uint64_t losray_blockrays[%d][%d][%d] =\n{\n",
+           LOS_MAX_RANGE+1, LOS_MAX_RANGE+1, words);
+    for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+    {
+        printf("    {\n");
+        for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        {
+            const vector<uint64_t> &w = tables.blockrays(coord_def(x, y));
+            ASSERT((int)w.size() == words);
+            printf("        {");
+            for (int i = 0; i < words; ++i)
+            {
+                printf("%s0x%016" PRIx64 "ULL,", i % 3 ? " " : "\n            ",
+                       w[i]);
+            }
+            printf("\n        },\n");
+        }
+        printf("    },\n");
+    }
+    printf("};\n\n");
+
+    // The minimal cellrays to (x, y) are losray_target_rays[n..m-1], where
+    // n and m are losray_target_starts[x][y] and the one after it.
+    vector<los_cellray> target_rays;
+    printf("static const uint16_t losray_target_starts[%d] =\n{\n", cells + 1);
+    for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+    {
+        printf("   ");
+        for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        {
+            printf(" %u,", (unsigned int)target_rays.size());
+            const vector<los_cellray> &rays =
+                tables.target_rays(coord_def(x, y));
+            target_rays.insert(target_rays.end(), rays.begin(), rays.end());
+        }
+        printf("\n");
+    }
+    printf("    %u,\n};\n\n", (unsigned int)target_rays.size());
+
+    printf("static const uint16_t losray_target_rays[%u][2] =\n{\n",
+           (unsigned int)target_rays.size());
+    for (const los_cellray &c : target_rays)
+        printf("    { %d, %d },\n", c.ray, c.end);
+    printf("};\n\n");
+
+    printf("static void los_load_ray_tables(los_ray_tables &tables)\n"
+           "{\n"
+           "    tables.fullrays.clear();\n"
+           "    for (unsigned int i = 0; i < ARRAYSZ(losray_fullrays); ++i)\n"
+           "    {\n"
+           "        const double *r = losray_fullrays[i];\n"
+           "        tables.fullrays.push_back({ geom::ray(r[0], r[1], r[2], r[3]),\n"
+           "                                    losray_spans[i][0],\n"
+           "                                    losray_spans[i][1] });\n"
+           "    }\n"
+           "\n"
+           "    tables.ray_coords.clear();\n"
+           "    for (const uint8_t *c : losray_coords)\n"
+           "        tables.ray_coords.emplace_back(c[0], c[1]);\n"
+           "\n"
+           "    tables.min_ends.assign(losray_min_ends,\n"
+           "                           losray_min_ends + ARRAYSZ(losray_min_ends));\n"
+           "\n"
+           "    for (int x = 0; x <= LOS_MAX_RANGE; ++x)\n"
+           "        for (int y = 0; y <= LOS_MAX_RANGE; ++y)\n"
+           "        {\n"
+           "            const coord_def p(x, y);\n"
+           "            const uint64_t *words = losray_blockrays[x][y];\n"
+           "            tables.blockrays(p).assign(words,\n"
+           "                words + ARRAYSZ(losray_blockrays[x][y]));\n"
+           "\n"
+           "            const int cell = x * (LOS_MAX_RANGE+1) + y;\n"
+           "            tables.target_rays(p).clear();\n"
+           "            for (int i = losray_target_starts[cell];\n"
+           "                 i < losray_target_starts[cell + 1]; ++i)\n"
+           "            {\n"
+           "                tables.target_rays(p).push_back(\n"
+           "                    { losray_target_rays[i][0],\n"
+           "                      losray_target_rays[i][1] });\n"
+           "            }\n"
+           "        }\n"
+           "}\n");
+}
+#endif
+
+int main()
+{
+    los_ray_tables tables;
+    los_cast_rays(tables);
+
+#ifdef CHECK_LOSRAY_DATA
+    los_ray_tables embedded;
+    los_load_ray_tables(embedded);
+    if (!(embedded == tables))
+    {
+        fprintf(stderr, "losray-data.h doesn't match the rays cast by "
+                        "losrays.cc; remove it and build again.\n");
+        return 1;
+    }
+#else
+    _write_tables(tables);
+#endif
+
+    return 0;
+}
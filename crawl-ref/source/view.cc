@@ -548,12 +548,12 @@ bool magic_mapping(int map_radius, int proportion, bool suppress_msg,
                 continue;
         }
 
-        if (env.map_knowledge(*ri).changed())
+        if (env.map_knowledge.get(*ri).changed())
         {
             // If the player has already seen the square, update map
             // knowledge with the new terrain. Otherwise clear what we had
             // before.
-            if (env.map_knowledge(*ri).seen())
+            if (env.map_knowledge.get(*ri).seen())
             {
                 dungeon_feature_type newfeat = grd(*ri);
                 if (newfeat == DNGN_UNDISCOVERED_TRAP)
@@ -565,7 +565,7 @@ bool magic_mapping(int map_radius, int proportion, bool suppress_msg,
                 env.map_knowledge(*ri).clear();
         }
 
-        if (!wizard_map && (env.map_knowledge(*ri).seen() || env.map_knowledge(*ri).mapped()))
+        if (!wizard_map && (env.map_knowledge.get(*ri).seen() || env.map_knowledge.get(*ri).mapped()))
             continue;
 
         const dungeon_feature_type feat = grd(*ri);
@@ -594,7 +594,7 @@ bool magic_mapping(int map_radius, int proportion, bool suppress_msg,
                     feat_is_trap(grd(*ri)) ? get_trap_type(*ri)
                                            : TRAP_UNASSIGNED);
             }
-            else if (!env.map_knowledge(*ri).feat())
+            else if (!env.map_knowledge.get(*ri).feat())
                 env.map_knowledge(*ri).set_feature(magic_map_base_feat(grd(*ri)));
             if (emphasise(*ri))
                 env.map_knowledge(*ri).flags |= MAP_EMPHASIZE;
@@ -778,14 +778,14 @@ void view_update_at(const coord_def &pos)
     show_update_at(pos);
 
 #ifndef USE_TILE_LOCAL
-    if (!env.map_knowledge(pos).visible())
+    if (!env.map_knowledge.get(pos).visible())
         return;
     cglyph_t g = get_cell_glyph(pos);
 
     int flash_colour = you.flash_colour == BLACK
         ? viewmap_flash_colour()
         : you.flash_colour;
-    monster_type mons = env.map_knowledge(pos).monster();
+    monster_type mons = env.map_knowledge.get(pos).monster();
     int cell_colour =
         flash_colour &&
         (mons == MONS_NO_MONSTER || mons_class_is_firewood(mons))
@@ -939,8 +939,11 @@ static update_flags player_view_update_at(const coord_def &gc)
     if (crawl_state.game_is_hints())
         hints_observe_cell(gc);
 
-    if (env.map_knowledge(gc).changed() || !env.map_knowledge(gc).seen())
+    if (env.map_knowledge.get(gc).changed()
+        || !env.map_knowledge.get(gc).seen())
+    {
         ret |= update_flag::AFFECT_EXCLUDES;
+    }
 
     set_terrain_visible(gc);
 
@@ -1409,7 +1412,7 @@ void draw_cell(screen_cell_t *cell, const coord_def &gc,
 #else
         else if (gc != you.pos())
         {
-            monster_type mons = env.map_knowledge(gc).monster();
+            monster_type mons = env.map_knowledge.get(gc).monster();
             if (mons == MONS_NO_MONSTER || mons_class_is_firewood(mons))
                 cell->colour = real_colour(flash_colour);
         }
@@ -1469,7 +1472,7 @@ void draw_cell(screen_cell_t *cell, const coord_def &gc,
         && map_bounds(gc)
         && (_layers == LAYERS_NONE
             || gc != you.pos()
-               && (env.map_knowledge(gc).monster() == MONS_NO_MONSTER
+               && (env.map_knowledge.get(gc).monster() == MONS_NO_MONSTER
                    || !you.see_cell(gc)))
         && travel_colour_override(gc))
     {
@@ -737,6 +737,7 @@ static void _debug_acquirement_stats(FILE *ostat)
         return;
     }
     mitm[p].base_type = OBJ_UNASSIGNED;
+    mitm_slot_emptied(mitm[p]);
 
     clear_messages();
     mpr("[a] Weapons [b] Armours [c] Jewellery      [d] Books");
@@ -63,15 +63,39 @@ namespace worley
        is 1.0. This makes an easy natural "scale" size of the cellular features. */
 #define DENSITY_ADJUSTMENT  0.398150
 
+    /* The feature points of a cube: at most 5, from Poisson_count. */
+    struct cube_points
+    {
+        int32_t xi, yi, zi;
+        int32_t count;
+        uint32_t id[5];
+        double pos[5][3];
+    };
+
+    /* Feature points of the cubes looked at lately, so that nearby samples
+       taken together don't work them out again. Direct mapped: a cube
+       only ever goes in one slot. */
+    class cube_cache
+    {
+    public:
+        cube_cache() : filled() { }
+        const cube_points &get(int32_t xi, int32_t yi, int32_t zi);
+    private:
+        static const int SIZE = 512;
+        cube_points cubes[SIZE];
+        bool filled[SIZE];
+    };
+
     /* the function to merge-sort a "cube" of samples into the current best-found
        list of values. */
     static void AddSamples(int32_t xi, int32_t yi, int32_t zi, int32_t max_order,
             double at[3], double *F,
-            double (*delta)[3], uint32_t *ID);
+            double (*delta)[3], uint32_t *ID, cube_cache *cache);
 
     /* The main function! */
     static void _worley(double at[3], int32_t max_order,
-            double *F, double (*delta)[3], uint32_t *ID)
+            double *F, double (*delta)[3], uint32_t *ID,
+            cube_cache *cache = nullptr)
     {
         double x2,y2,z2, mx2, my2, mz2;
         double new_at[3];
@@ -99,7 +123,7 @@ namespace worley
            int32_t ii, jj, kk;
            for (ii=-1; ii<=1; ii++) for (jj=-1; jj<=1; jj++) for (kk=-1; kk<=1; kk++)
            AddSamples(int_at[0]+ii,int_at[1]+jj,int_at[2]+kk,
-           max_order, new_at, F, delta, ID);
+           max_order, new_at, F, delta, ID, cache);
            }
            But this wastes a lot of time working on cubes which are known to be
            too far away to matter! So we can use a more complex testing method
@@ -107,7 +131,7 @@ namespace worley
            speed of the algorithm. */
 
         /* Test the central cube for closest point(s). */
-        AddSamples(int_at[0], int_at[1], int_at[2], max_order, new_at, F, delta, ID);
+        AddSamples(int_at[0], int_at[1], int_at[2], max_order, new_at, F, delta, ID, cache);
 
         /* We test if neighbor cubes are even POSSIBLE contributors by examining the
            combinations of the sum of the squared distances from the cube's lower
@@ -125,62 +149,62 @@ namespace worley
         /* Test 6 facing neighbors of center cube. These are closest and most
            likely to have a close feature point. */
         if (x2<F[max_order-1])  AddSamples(int_at[0]-1, int_at[1]  , int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (y2<F[max_order-1])  AddSamples(int_at[0]  , int_at[1]-1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (z2<F[max_order-1])  AddSamples(int_at[0]  , int_at[1]  , int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
 
         if (mx2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]  , int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (my2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]+1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mz2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]  , int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
 
         /* Test 12 "edge cube" neighbors if necessary. They're next closest. */
         if ( x2+ y2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]-1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+ z2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]  , int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( y2+ z2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]-1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+my2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]+1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+mz2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]  , int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (my2+mz2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]+1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+my2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]+1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+mz2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]  , int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( y2+mz2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]-1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+ y2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]-1, int_at[2]  ,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+ z2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]  , int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (my2+ z2<F[max_order-1]) AddSamples(int_at[0]  , int_at[1]+1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
 
         /* Final 8 "corner" cubes */
         if ( x2+ y2+ z2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]-1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+ y2+mz2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]-1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+my2+ z2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]+1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if ( x2+my2+mz2<F[max_order-1]) AddSamples(int_at[0]-1, int_at[1]+1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+ y2+ z2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]-1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+ y2+mz2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]-1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+my2+ z2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]+1, int_at[2]-1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
         if (mx2+my2+mz2<F[max_order-1]) AddSamples(int_at[0]+1, int_at[1]+1, int_at[2]+1,
-                max_order, new_at, F, delta, ID);
+                max_order, new_at, F, delta, ID, cache);
 
         /* We're done! Convert everything to right size scale */
         for (i=0; i<max_order; i++)
@@ -194,13 +218,15 @@ namespace worley
         return;
     }
 
-    static void AddSamples(int32_t xi, int32_t yi, int32_t zi, int32_t max_order,
-            double at[3], double *F,
-            double (*delta)[3], uint32_t *ID)
+    static void _find_cube_points(int32_t xi, int32_t yi, int32_t zi,
+                                  cube_points &cube)
     {
-        double dx, dy, dz, fx, fy, fz, d2;
-        int32_t count, i, j, index;
-        uint32_t seed, this_id;
+        int32_t j;
+        uint32_t seed;
+
+        cube.xi = xi;
+        cube.yi = yi;
+        cube.zi = zi;
 
         /* Each cube has a random number seed based on the cube's ID number.
            The seed might be better if it were a nonlinear hash like Perlin uses
@@ -209,22 +235,58 @@ namespace worley
         seed=702395077*xi + 915488749*yi + 2120969693*zi;
 
         /* How many feature points are in this cube? */
-        count=Poisson_count[(seed>>24)%256]; /* 256 element lookup table. Use MSB */
+        cube.count=Poisson_count[(seed>>24)%256]; /* 256 element lookup table. Use MSB */
 
         seed=1402024253*seed+586950981; /* churn the seed with good Knuth LCG */
 
-        for (j=0; j<count; j++) /* test and insert each point into our solution */
+        for (j=0; j<cube.count; j++)
         {
-            this_id=seed;
+            cube.id[j]=seed;
             seed=1402024253*seed+586950981; /* churn */
 
             /* compute the 0..1 feature point location's XYZ */
-            fx=(seed+0.5)*(1.0/4294967296.0);
+            cube.pos[j][0]=(seed+0.5)*(1.0/4294967296.0);
             seed=1402024253*seed+586950981; /* churn */
-            fy=(seed+0.5)*(1.0/4294967296.0);
+            cube.pos[j][1]=(seed+0.5)*(1.0/4294967296.0);
             seed=1402024253*seed+586950981; /* churn */
-            fz=(seed+0.5)*(1.0/4294967296.0);
+            cube.pos[j][2]=(seed+0.5)*(1.0/4294967296.0);
             seed=1402024253*seed+586950981; /* churn */
+        }
+    }
+
+    const cube_points &cube_cache::get(int32_t xi, int32_t yi, int32_t zi)
+    {
+        const uint32_t slot = ((uint32_t)xi * 73856093U
+                               ^ (uint32_t)yi * 19349663U
+                               ^ (uint32_t)zi * 83492791U) % SIZE;
+        cube_points &cube = cubes[slot];
+        if (!filled[slot] || cube.xi != xi || cube.yi != yi || cube.zi != zi)
+        {
+            _find_cube_points(xi, yi, zi, cube);
+            filled[slot] = true;
+        }
+        return cube;
+    }
+
+    static void AddSamples(int32_t xi, int32_t yi, int32_t zi, int32_t max_order,
+            double at[3], double *F,
+            double (*delta)[3], uint32_t *ID, cube_cache *cache)
+    {
+        double dx, dy, dz, fx, fy, fz, d2;
+        int32_t i, j, index;
+        uint32_t this_id;
+
+        cube_points found;
+        if (!cache)
+            _find_cube_points(xi, yi, zi, found);
+        const cube_points &cube = cache ? cache->get(xi, yi, zi) : found;
+
+        for (j=0; j<cube.count; j++) /* test and insert each point into our solution */
+        {
+            this_id=cube.id[j];
+            fx=cube.pos[j][0];
+            fy=cube.pos[j][1];
+            fz=cube.pos[j][2];
 
             /* delta from feature point to sample location */
             dx=xi+fx-at[0];
@@ -281,14 +343,14 @@ cases.]
         return;
     }
 
-    noise_datum noise(double x, double y, double z)
+    static noise_datum _noise(double x, double y, double z, cube_cache *cache)
     {
         double point[3] = {x,y,z};
         double F[2];
         double delta[2][3];
         uint32_t id[2];
 
-        _worley(point, 2, F, delta, id);
+        _worley(point, 2, F, delta, id, cache);
 
         noise_datum datum;
         datum.distance[0] = F[0];
@@ -300,4 +362,17 @@ cases.]
                 datum.pos[i][j] = delta[i][j];
         return datum;
     }
+
+    noise_datum noise(double x, double y, double z)
+    {
+        return _noise(x, y, z, nullptr);
+    }
+
+    void noise(const double *x, const double *y, double z, int n,
+               noise_datum *out)
+    {
+        unique_ptr<cube_cache> cache(new cube_cache);
+        for (int i = 0; i < n; ++i)
+            out[i] = _noise(x[i], y[i], z, cache.get());
+    }
 }
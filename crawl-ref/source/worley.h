@@ -69,5 +69,9 @@ struct noise_datum
 };
 
 noise_datum noise(double x, double y, double z);
+// Noise at n points sharing a z, the same as noise() at each point but with
+// the feature points of each cube only worked out once for nearby points.
+void noise(const double *x, const double *y, double z, int n,
+           noise_datum *out);
 }
 #endif /* WORLEY_H */
@@ -414,7 +414,7 @@ static int _exploration_estimate(bool seen_only = false, bool debug = false)
         tries++;
 
         coord_def pos = random_in_bounds();
-        if (!seen_only && env.map_knowledge(pos).known() || env.map_knowledge(pos).seen())
+        if (!seen_only && env.map_knowledge.get(pos).known() || env.map_knowledge.get(pos).seen())
         {
             seen++;
             total++;